@@ -0,0 +1,105 @@
+import sys
+
+# Import renderdoc if not already imported (e.g. in the UI)
+if 'renderdoc' not in sys.modules and '_renderdoc' not in sys.modules:
+	import renderdoc
+
+# Alias renderdoc for legibility
+rd = renderdoc
+
+def printState(state):
+	print("Step %d, next instruction %d:" % (state.stepIndex, state.nextInstruction))
+
+	for c in state.changes:
+		# Variables that went out of scope have no name after the change
+		if c.after.name == '':
+			print("  %s went out of scope" % c.before.name)
+		else:
+			values = ['%.3f' % c.after.value.fv[i] for i in range(0, c.after.columns)]
+			print("  %s = %s" % (c.after.name, ', '.join(values)))
+
+def sampleCode(controller):
+	# Find the last draw in the frame, and move to it
+	draw = controller.GetDrawcalls()[-1]
+	while len(draw.children) > 0:
+		draw = draw.children[-1]
+
+	controller.SetFrameEvent(draw.eventId, True)
+
+	# Debug the pixel in the middle of the first colour output
+	state = controller.GetPipelineState()
+	target = state.GetOutputTargets()[0].resourceId
+	tex = [t for t in controller.GetTextures() if t.resourceId == target][0]
+
+	trace = controller.DebugPixel(tex.width // 2, tex.height // 2, 0, rd.ReplayController.NoPreference)
+
+	if trace.debugger is None:
+		print("Couldn't debug the pixel")
+		controller.FreeTrace(trace)
+		return
+
+	# Ask for the states to be kept before running the debugger, so we can go back to them later
+	controller.RecordDebugStates(trace.debugger)
+
+	# Run the shader to completion. We only need to count the states as they come back
+	numStates = 0
+	while True:
+		states = controller.ContinueDebug(trace.debugger)
+		if len(states) == 0:
+			break
+
+		numStates += len(states)
+
+	print("The shader ran for %d steps" % numStates)
+
+	# Step backwards from the end of the shader
+	for state in reversed(controller.GetDebugStates(trace.debugger, max(0, numStates - 3), 3)):
+		printState(state)
+
+	# Jump straight to a step in the middle
+	printState(controller.GetDebugStates(trace.debugger, numStates // 2, 1)[0])
+
+	# Freeing the trace also frees the states that were kept
+	controller.FreeTrace(trace)
+
+def loadCapture(filename):
+	# Open a capture file handle
+	cap = rd.OpenCaptureFile()
+
+	# Open a particular file - see also OpenBuffer to load from memory
+	status = cap.OpenFile(filename, '', None)
+
+	# Make sure the file opened successfully
+	if status != rd.ReplayStatus.Succeeded:
+		raise RuntimeError("Couldn't open file: " + str(status))
+
+	# Make sure we can replay
+	if not cap.LocalReplaySupport():
+		raise RuntimeError("Capture cannot be replayed")
+
+	# Initialise the replay
+	status,controller = cap.OpenCapture(rd.ReplayOptions(), None)
+
+	if status != rd.ReplayStatus.Succeeded:
+		raise RuntimeError("Couldn't initialise replay: " + str(status))
+
+	return (cap, controller)
+
+if 'pyrenderdoc' in globals():
+	pyrenderdoc.Replay().BlockInvoke(sampleCode)
+else:
+	rd.InitialiseReplay(rd.GlobalEnvironment(), [])
+
+	if len(sys.argv) <= 1:
+		print('Usage: python3 {} filename.rdc'.format(sys.argv[0]))
+		sys.exit(0)
+
+	cap,controller = loadCapture(sys.argv[1])
+
+	sampleCode(controller)
+
+	controller.Shutdown()
+	cap.Shutdown()
+
+	rd.ShutdownReplay()
+
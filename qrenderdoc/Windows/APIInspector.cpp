@@ -152,6 +152,8 @@ void APIInspector::fillAPIView()
       {
         SDChunk *chunk = file.chunks[ev.chunkIndex];
 
+        file.PopulateChunk(chunk);
+
         root->setText(1, chunk->name);
 
         addStructuredObjects(root, chunk->data.children, false);
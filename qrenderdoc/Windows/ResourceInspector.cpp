@@ -313,6 +313,8 @@ void ResourceInspector::Inspect(ResourceId id)
       {
         SDChunk *chunkObj = file.chunks[chunk];
 
+        file.PopulateChunk(chunkObj);
+
         root->setText(0, chunkObj->name);
 
         addStructuredObjects(root, chunkObj->data.children, false);
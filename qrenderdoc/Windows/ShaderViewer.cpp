@@ -685,7 +685,10 @@ void ShaderViewer::debugShader(const ShaderBindpointMapping *bind, const ShaderR
       if(!me)
         return;
 
-      rdcarray<ShaderDebugState> states = r->ContinueDebug(m_Trace->debugger);
+      // the states are kept by the replay, so we only need to count them here
+      r->RecordDebugStates(m_Trace->debugger);
+
+      size_t numStates = r->ContinueDebug(m_Trace->debugger).size();
 
       bool finished = false;
       do
@@ -693,13 +696,13 @@ void ShaderViewer::debugShader(const ShaderBindpointMapping *bind, const ShaderR
         if(!me)
           return;
 
-        rdcarray<ShaderDebugState> nextStates = r->ContinueDebug(m_Trace->debugger);
+        size_t numNextStates = r->ContinueDebug(m_Trace->debugger).size();
 
         if(!me)
           return;
 
-        states.append(nextStates);
-        finished = nextStates.empty();
+        numStates += numNextStates;
+        finished = (numNextStates == 0);
       } while(!finished && m_BackgroundRunning.available() == 1);
 
       if(!me || m_BackgroundRunning.available() != 1)
@@ -712,10 +715,10 @@ void ShaderViewer::debugShader(const ShaderBindpointMapping *bind, const ShaderR
       if(!me)
         return;
 
-      GUIInvoke::call(this, [this, states]() {
-        m_States = states;
+      GUIInvoke::call(this, [this, numStates]() {
+        m_NumStates = numStates;
 
-        if(!m_States.empty())
+        if(m_NumStates > 0)
         {
           for(const ShaderVariableChange &c : GetCurrentState().changes)
             m_Variables.push_back(c.after);
@@ -1493,7 +1496,7 @@ void ShaderViewer::on_watch_itemChanged(QTableWidgetItem *item)
 
 bool ShaderViewer::stepBack()
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return false;
 
   if(IsFirstState())
@@ -1547,7 +1550,7 @@ bool ShaderViewer::stepBack()
 
 bool ShaderViewer::stepNext()
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return false;
 
   if(IsLastState())
@@ -1586,7 +1589,7 @@ bool ShaderViewer::stepNext()
 
 void ShaderViewer::runToCursor()
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   ScintillaEdit *cur = currentScintilla();
@@ -1649,31 +1652,65 @@ bool ShaderViewer::IsFirstState() const
 
 bool ShaderViewer::IsLastState() const
 {
-  return m_CurrentStateIdx == m_States.size() - 1;
+  return m_CurrentStateIdx == m_NumStates - 1;
 }
 
 const ShaderDebugState &ShaderViewer::GetPreviousState() const
 {
   if(m_CurrentStateIdx > 0)
-    return m_States[m_CurrentStateIdx - 1];
+    return GetState(m_CurrentStateIdx - 1);
 
-  return m_States.front();
+  return GetState(0);
 }
 
 const ShaderDebugState &ShaderViewer::GetCurrentState() const
 {
-  if(m_CurrentStateIdx < m_States.size())
-    return m_States[m_CurrentStateIdx];
+  if(m_CurrentStateIdx < m_NumStates)
+    return GetState(m_CurrentStateIdx);
 
-  return m_States.back();
+  return GetState(m_NumStates - 1);
 }
 
 const ShaderDebugState &ShaderViewer::GetNextState() const
 {
-  if(m_CurrentStateIdx + 1 < m_States.size())
-    return m_States[m_CurrentStateIdx + 1];
+  if(m_CurrentStateIdx + 1 < m_NumStates)
+    return GetState(m_CurrentStateIdx + 1);
+
+  return GetState(m_NumStates - 1);
+}
+
+const ShaderDebugState &ShaderViewer::GetState(size_t idx) const
+{
+  // the window always holds the states either side of the current one too, so references to any of
+  // them stay valid until the current step moves.
+  size_t first = m_CurrentStateIdx > 0 ? m_CurrentStateIdx - 1 : 0;
+  size_t last = qMin(m_CurrentStateIdx + 1, m_NumStates - 1);
+  size_t end = m_StatesBase + m_States.size();
+
+  if(first < m_StatesBase || last >= end || idx < m_StatesBase || idx >= end)
+  {
+    // fetch states either side of the current step, so stepping in either direction stays local
+    const size_t windowSize = 512;
+
+    size_t base = m_CurrentStateIdx > windowSize / 2 ? m_CurrentStateIdx - windowSize / 2 : 0;
+
+    ShaderDebugger *debugger = m_Trace->debugger;
+    rdcarray<ShaderDebugState> states;
+
+    m_Ctx.Replay().BlockInvoke([debugger, base, windowSize, &states](IReplayController *r) {
+      states = r->GetDebugStates(debugger, (uint32_t)base, (uint32_t)windowSize);
+    });
+
+    m_States.swap(states);
+    m_StatesBase = base;
+    end = m_StatesBase + m_States.size();
+  }
+
+  if(idx >= m_StatesBase && idx < end)
+    return m_States[idx - m_StatesBase];
 
-  return m_States.back();
+  static const ShaderDebugState empty = ShaderDebugState();
+  return m_States.empty() ? empty : m_States.back();
 }
 
 void ShaderViewer::runToSample()
@@ -1698,7 +1735,7 @@ void ShaderViewer::run()
 
 void ShaderViewer::runTo(QVector<size_t> runToInstruction, bool forward, ShaderEvents condition)
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   bool firstStep = true;
@@ -1740,7 +1777,7 @@ void ShaderViewer::runTo(QVector<size_t> runToInstruction, bool forward, ShaderE
 
 void ShaderViewer::runToResourceAccess(bool forward, VarType type, const BindpointIndex &resource)
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   // this is effectively infinite as we break out before moving to next/previous state if that would
@@ -2146,7 +2183,7 @@ RDTreeWidgetItem *ShaderViewer::findVarInTree(RDTreeWidgetItem *root, QString na
 
 bool ShaderViewer::findVar(QString name, ShaderVariable *var)
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return false;
 
   // try source mapped variables first, as if we have ambiguity (a source variable the same as a
@@ -2461,7 +2498,7 @@ void ShaderViewer::updateAccessedResources()
 
 void ShaderViewer::updateDebugState()
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   if(ui->debugToggle->isEnabled())
@@ -3726,7 +3763,7 @@ uint32_t ShaderViewer::CurrentStep()
 
 void ShaderViewer::SetCurrentStep(uint32_t step)
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   while(GetCurrentState().stepIndex != step)
@@ -3754,7 +3791,7 @@ void ShaderViewer::SetCurrentStep(uint32_t step)
 
 void ShaderViewer::ToggleBreakpoint(int instruction)
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   sptr_t instLine = -1;
@@ -4343,7 +4380,7 @@ bool ShaderViewer::eventFilter(QObject *watched, QEvent *event)
 void ShaderViewer::disasm_tooltipShow(int x, int y)
 {
   // do nothing if there's no trace
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   ScintillaEdit *sc = qobject_cast<ScintillaEdit *>(QObject::sender());
@@ -4397,7 +4434,7 @@ void ShaderViewer::showVariableTooltip(QString name)
 
 void ShaderViewer::updateVariableTooltip()
 {
-  if(!m_Trace || m_States.empty())
+  if(!m_Trace || m_NumStates == 0)
     return;
 
   ShaderVariable var;
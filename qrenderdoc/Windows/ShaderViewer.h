@@ -252,7 +252,11 @@ private:
   CloseCallback m_CloseCallback;
 
   ShaderDebugTrace *m_Trace = NULL;
-  rdcarray<ShaderDebugState> m_States;
+  // the replay keeps every state of the trace, and a window of them around the current step is
+  // fetched from there as the current step moves.
+  size_t m_NumStates = 0;
+  mutable rdcarray<ShaderDebugState> m_States;
+  mutable size_t m_StatesBase = 0;
   size_t m_CurrentStateIdx = 0;
   rdcarray<ShaderVariable> m_Variables;
 
@@ -297,6 +301,7 @@ private:
   const ShaderDebugState &GetPreviousState() const;
   const ShaderDebugState &GetCurrentState() const;
   const ShaderDebugState &GetNextState() const;
+  const ShaderDebugState &GetState(size_t idx) const;
 
   void updateDebugState();
   void updateWatchVariables();
@@ -886,6 +886,57 @@ completed, further calls will return an empty list.
 )");
   virtual rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger) = 0;
 
+  DOCUMENT(R"(Run a shader's debugging with a given shader debugger instance until it reaches a
+breakpoint or completes. Unlike :meth:`ContinueDebug` no intermediate states are recorded, only the
+state where execution stopped is returned.
+
+Execution stops before any instruction in the breakpoint list is executed, except for the one at the
+current position so that running repeatedly makes progress. To stop at a source line, pass the
+instructions where that line starts in :data:`ShaderDebugTrace.lineInfo`. An empty list runs to
+completion.
+
+The returned state contains a change for every variable that is valid at the stop point, with no
+previous value, and can be used in place of all the states that were skipped. Stepping can be
+resumed from it with :meth:`ContinueDebug`.
+
+If the list is empty, the debugging process had already completed.
+
+:param ShaderDebugger debugger: The shader debugger to run.
+:param List[int] breakpoints: The instructions to stop at.
+:return: The state at the stop point.
+:rtype: ``list`` of :class:`ShaderDebugState`
+)");
+  virtual rdcarray<ShaderDebugState> RunDebug(ShaderDebugger *debugger,
+                                              const rdcarray<uint32_t> &breakpoints) = 0;
+
+  DOCUMENT(R"(Start keeping the states of a shader's debugging that are returned from
+:meth:`ContinueDebug` or :meth:`RunDebug`, so they can be retrieved with :meth:`GetDebugStates`.
+
+States are not kept unless this is called, and only states returned after it is called are kept.
+
+:param ShaderDebugger debugger: The shader debugger to keep states for.
+)");
+  virtual void RecordDebugStates(ShaderDebugger *debugger) = 0;
+
+  DOCUMENT(R"(Retrieve states of a shader's debugging that were previously returned from
+:meth:`ContinueDebug` or :meth:`RunDebug`, after :meth:`RecordDebugStates` was called.
+
+Every recorded state is kept in a compact form until the trace is freed, so there is no need to hold
+on to them to step backwards or jump to an earlier step. Retrieving any state takes a bounded amount
+of time regardless of how long the trace is.
+
+Steps that were skipped over by :meth:`RunDebug` were never returned and are not available, they
+will be omitted from the list.
+
+:param ShaderDebugger debugger: The shader debugger the states were returned from.
+:param int firstStep: The :data:`ShaderDebugState.stepIndex` of the first state to retrieve.
+:param int count: The maximum number of states to retrieve.
+:return: The states in step order.
+:rtype: ``list`` of :class:`ShaderDebugState`
+)");
+  virtual rdcarray<ShaderDebugState> GetDebugStates(ShaderDebugger *debugger, uint32_t firstStep,
+                                                    uint32_t count) = 0;
+
   DOCUMENT(R"(Free a debugging trace from running a shader invocation debug.
 
 :param ShaderDebugTrace trace: The shader debugging trace to free.
@@ -1946,6 +1997,9 @@ has been called. It should be called exactly once, and before shutdown you must
 extern "C" RENDERDOC_API void RENDERDOC_CC RENDERDOC_InitialiseReplay(GlobalEnvironment env,
                                                                       const rdcarray<rdcstr> &args);
 
+DOCUMENT("Internal function that runs serialisation and compression micro-benchmarks.");
+extern "C" RENDERDOC_API int RENDERDOC_CC RENDERDOC_RunBenchmarks(const rdcarray<rdcstr> &args);
+
 DOCUMENT(R"(Shutdown RenderDoc for replay. Replay API functions should not be called after this
 has been called. It is not safe to re-initialise replay after this function has been called so it
 should only be called at program shutdown. This function must only be called if
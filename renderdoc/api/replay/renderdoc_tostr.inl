@@ -1072,6 +1072,7 @@ rdcstr DoStringise(const SectionFlags &el)
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(ASCIIStored, "Stored as ASCII");
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(LZ4Compressed, "Compressed with LZ4");
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(ZstdCompressed, "Compressed with Zstd");
+    STRINGISE_BITFIELD_CLASS_BIT_NAMED(BlockIndexed, "Compressed in indexed blocks");
   }
   END_BITFIELD_STRINGISE();
 }
@@ -3834,6 +3834,12 @@ DOCUMENT(R"(A set of flags describing the properties of a section in a renderdoc
 .. data:: ZstdCompressed
 
   This section is compressed with Zstd on disk.
+
+.. data:: BlockIndexed
+
+  This section is compressed in independent blocks with an index of block offsets stored after the
+  compressed data, so that it can be read starting from any offset without decompressing everything
+  before it. This must be combined with either :data:`LZ4Compressed` or :data:`ZstdCompressed`.
 )");
 enum class SectionFlags : uint32_t
 {
@@ -3841,6 +3847,7 @@ enum class SectionFlags : uint32_t
   ASCIIStored = 0x1,
   LZ4Compressed = 0x2,
   ZstdCompressed = 0x4,
+  BlockIndexed = 0x8,
 };
 
 BITMASK_OPERATORS(SectionFlags);
@@ -219,12 +219,18 @@ DOCUMENT(R"(Bitfield flags that could be applied to an :class:`SDChunk`.
 
   This chunk has a callstack. Used to indicate the presence of a callstack even if it's empty
   (perhaps due to failure to collect the stack frames).
+
+.. data:: Lazy
+
+  This chunk's contents haven't been decoded yet and only its metadata is available. Call
+  :meth:`SDFile.PopulateChunk` to decode the children.
 )");
 enum class SDChunkFlags : uint64_t
 {
   NoFlags = 0x0,
   OpaqueChunk = 0x1,
   HasCallstack = 0x2,
+  Lazy = 0x4,
 };
 
 BITMASK_OPERATORS(SDChunkFlags);
@@ -370,12 +376,67 @@ private:
 
 DECLARE_REFLECTION_STRUCT(SDObjectData);
 
-DOCUMENT("Defines a single structured object.");
-struct SDObject
+#if !defined(SWIG)
+// A bump allocator that a file's objects can be allocated from, so that building a large file
+// doesn't pay for one heap allocation per object. Slabs come from the same dll-safe allocation as
+// everything else and are only freed when the arena is destroyed - deleting an object allocated
+// here runs its destructor but doesn't reclaim the memory. Not thread-safe.
+struct SDObjectArena
 {
+  SDObjectArena() = default;
+  ~SDObjectArena()
+  {
+    while(m_Slab)
+    {
+      Slab *next = m_Slab->next;
+      deallocate(m_Slab);
+      m_Slab = next;
+    }
+  }
+
+  void *Allocate(size_t sz)
+  {
+    // keep everything 8-byte aligned, which is enough for any object stored here
+    sz = (sz + 7) & ~size_t(7);
+
+    if(m_Slab == NULL || m_Slab->used + sz > m_Slab->size)
+    {
+      size_t slabSize = sz > SlabSize ? sz : SlabSize;
+
+      Slab *slab = (Slab *)allocate(sizeof(Slab) + slabSize);
+      slab->next = m_Slab;
+      slab->size = slabSize;
+      slab->used = 0;
+      m_Slab = slab;
+
+      m_Reserved += slabSize;
+    }
+
+    void *ret = ((byte *)(m_Slab + 1)) + m_Slab->used;
+    m_Slab->used += sz;
+    return ret;
+  }
+
+  // the number of bytes in slabs owned by the arena
+  uint64_t GetReservedSize() const { return m_Reserved; }
   /////////////////////////////////////////////////////////////////
   // memory management, in a dll safe way
-  void *operator new(size_t sz)
+  void *operator new(size_t sz) { return allocate(sz); }
+  void operator delete(void *p) { deallocate(p); }
+  void *operator new[](size_t count) = delete;
+  void operator delete[](void *p) = delete;
+
+private:
+  static const size_t SlabSize = 256 * 1024;
+
+  struct Slab
+  {
+    Slab *next;
+    uint64_t size;
+    uint64_t used;
+  };
+
+  static void *allocate(size_t sz)
   {
     void *ret = NULL;
 #ifdef RENDERDOC_EXPORTS
@@ -387,7 +448,7 @@ struct SDObject
 #endif
     return ret;
   }
-  void operator delete(void *p)
+  static void deallocate(void *p)
   {
 #ifdef RENDERDOC_EXPORTS
     free(p);
@@ -395,6 +456,29 @@ struct SDObject
     RENDERDOC_FreeArrayMem(p);
 #endif
   }
+
+  SDObjectArena(const SDObjectArena &) = delete;
+  SDObjectArena &operator=(const SDObjectArena &) = delete;
+
+  Slab *m_Slab = NULL;
+  uint64_t m_Reserved = 0;
+};
+#else
+struct SDObjectArena;
+#endif
+
+DOCUMENT("Defines a single structured object.");
+struct SDObject
+{
+  /////////////////////////////////////////////////////////////////
+  // memory management, in a dll safe way
+  void *operator new(size_t sz) { return allocate(sz, NULL); }
+  void operator delete(void *p) { deallocate(p); }
+#if !defined(SWIG)
+  // allocate from an arena, if one is given
+  void *operator new(size_t sz, SDObjectArena *arena) { return allocate(sz, arena); }
+  void operator delete(void *p, SDObjectArena *arena) { deallocate(p); }
+#endif
   void *operator new[](size_t count) = delete;
   void operator delete[](void *p) = delete;
 
@@ -634,6 +718,48 @@ protected:
   SDObject() {}
   SDObject(const SDObject &other) = delete;
   SDObject &operator=(const SDObject &other) = delete;
+
+  // every object is prefixed with the arena it was allocated from, or NULL if it was allocated on
+  // its own. That way objects can be freely deleted regardless of where they came from.
+  static const size_t AllocHeaderSize = sizeof(uint64_t);
+
+  static void *allocate(size_t sz, SDObjectArena *arena)
+  {
+    void *ret = NULL;
+    if(arena)
+    {
+      ret = arena->Allocate(sz + AllocHeaderSize);
+    }
+    else
+    {
+#ifdef RENDERDOC_EXPORTS
+      ret = malloc(sz + AllocHeaderSize);
+      if(ret == NULL)
+        RENDERDOC_OutOfMemory(sz + AllocHeaderSize);
+#else
+      ret = RENDERDOC_AllocArrayMem(sz + AllocHeaderSize);
+#endif
+    }
+    *(SDObjectArena **)ret = arena;
+    return ((byte *)ret) + AllocHeaderSize;
+  }
+  static void deallocate(void *p)
+  {
+    if(p == NULL)
+      return;
+
+    void *alloc = ((byte *)p) - AllocHeaderSize;
+
+    // arena memory is only released with the arena itself
+    if(*(SDObjectArena **)alloc != NULL)
+      return;
+
+#ifdef RENDERDOC_EXPORTS
+    free(alloc);
+#else
+    RENDERDOC_FreeArrayMem(alloc);
+#endif
+  }
 };
 
 DECLARE_REFLECTION_STRUCT(SDObject);
@@ -889,26 +1015,12 @@ struct SDChunk : public SDObject
 {
   /////////////////////////////////////////////////////////////////
   // memory management, in a dll safe way
-  void *operator new(size_t sz)
-  {
-    void *ret = NULL;
-#ifdef RENDERDOC_EXPORTS
-    ret = malloc(sz);
-    if(ret == NULL)
-      RENDERDOC_OutOfMemory(sz);
-#else
-    ret = RENDERDOC_AllocArrayMem(sz);
-#endif
-    return ret;
-  }
-  void operator delete(void *p)
-  {
-#ifdef RENDERDOC_EXPORTS
-    free(p);
-#else
-    RENDERDOC_FreeArrayMem(p);
+  void *operator new(size_t sz) { return allocate(sz, NULL); }
+  void operator delete(void *p) { deallocate(p); }
+#if !defined(SWIG)
+  void *operator new(size_t sz, SDObjectArena *arena) { return allocate(sz, arena); }
+  void operator delete(void *p, SDObjectArena *arena) { deallocate(p); }
 #endif
-  }
   void *operator new[](size_t count) = delete;
   void operator delete[](void *p) = delete;
 
@@ -1013,6 +1125,19 @@ private:
 
 DECLARE_REFLECTION_STRUCT(StructuredBufferList);
 
+#if !defined(SWIG)
+// Implemented inside the library for files whose chunks are decoded on demand, see
+// SDFile::PopulateChunk
+struct ISDChunkSource
+{
+  virtual void PopulateChunk(SDChunk *chunk) = 0;
+
+protected:
+  ISDChunkSource() = default;
+  ~ISDChunkSource() = default;
+};
+#endif
+
 DOCUMENT("Contains the structured information in a file. Owns the buffers and chunks.");
 struct SDFile
 {
@@ -1055,6 +1180,9 @@ public:
 
     for(bytebuf *buf : buffers)
       delete buf;
+
+    // objects allocated from the arena have been destructed above, now free their memory in one go
+    delete m_Arena;
   }
 
   DOCUMENT("A ``list`` of :class:`SDChunk` objects with the chunks in order.");
@@ -1066,14 +1194,49 @@ public:
   DOCUMENT("The version of this structured stream, typically only used internally.");
   uint64_t version = 0;
 
+  DOCUMENT(R"(Make sure the children of a chunk have been decoded.
+
+Chunks flagged with :data:`SDChunkFlags.Lazy` only contain their metadata until they're populated.
+Populated chunks may be released again when other chunks are populated, so objects inside a chunk
+shouldn't be held on to after populating a different chunk.
+
+:param SDChunk chunk: The chunk to populate.
+)");
+  inline void PopulateChunk(SDChunk *chunk) const
+  {
+    if(m_ChunkSource && chunk)
+      m_ChunkSource->PopulateChunk(chunk);
+  }
+
   inline void Swap(SDFile &other)
   {
     chunks.swap(other.chunks);
     buffers.swap(other.buffers);
     std::swap(version, other.version);
+    std::swap(m_ChunkSource, other.m_ChunkSource);
+    std::swap(m_Arena, other.m_Arena);
   }
 
+#if !defined(SWIG)
+  void SetChunkSource(ISDChunkSource *source) { m_ChunkSource = source; }
+
+  // objects allocated from this arena must only be referenced by this file's chunks, they can be
+  // moved between files only by swapping whole files.
+  SDObjectArena *GetArena()
+  {
+    if(m_Arena == NULL)
+      m_Arena = new SDObjectArena;
+    return m_Arena;
+  }
+#endif
+
 protected:
   SDFile(const SDFile &) = delete;
   SDFile &operator=(const SDFile &) = delete;
+
+private:
+#if !defined(SWIG)
+  ISDChunkSource *m_ChunkSource = NULL;
+  SDObjectArena *m_Arena = NULL;
+#endif
 };
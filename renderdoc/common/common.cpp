@@ -26,6 +26,7 @@
 #include "common.h"
 #include <stdarg.h>
 #include <string.h>
+#include "common/log_queue.h"
 #include "common/threading.h"
 #include "os/os_specific.h"
 #include "strings/string_utils.h"
@@ -39,145 +40,6 @@ void rdcassert(const char *msg, const char *file, unsigned int line, const char
                 "Assertion failed: %s", msg);
 }
 
-#if 0
-static __m128 zero = {0};
-#endif
-
-// assumes a and b both point to 16-byte aligned 16-byte chunks of memory.
-// Returns if they're equal or different
-bool Vec16NotEqual(void *a, void *b)
-{
-// disabled SSE version as it's acting dodgy
-#if 0
-	__m128 avec = _mm_load_ps(aflt);
-	__m128 bvec = _mm_load_ps(bflt);
-
-	__m128 diff = _mm_xor_ps(avec, bvec);
-
-	__m128 eq = _mm_cmpeq_ps(diff, zero);
-	int mask = _mm_movemask_ps(eq);
-	int signMask = _mm_movemask_ps(diff);
-
-	// first check ensures that diff is floatequal to zero (ie. avec bitwise equal to bvec).
-	// HOWEVER -0 is floatequal to 0, so we ensure no sign bits are set on diff
-	if((mask^0xf) || signMask != 0)
-	{
-		return true;
-	}
-	
-	return false;
-#elif ENABLED(RDOC_X64)
-  uint64_t *a64 = (uint64_t *)a;
-  uint64_t *b64 = (uint64_t *)b;
-
-  return a64[0] != b64[0] || a64[1] != b64[1];
-#else
-  uint32_t *a32 = (uint32_t *)a;
-  uint32_t *b32 = (uint32_t *)b;
-
-  return a32[0] != b32[0] || a32[1] != b32[1] || a32[2] != b32[2] || a32[3] != b32[3];
-#endif
-}
-
-bool FindDiffRange(void *a, void *b, size_t bufSize, size_t &diffStart, size_t &diffEnd)
-{
-  RDCASSERT(uintptr_t(a) % 16 == 0);
-  RDCASSERT(uintptr_t(b) % 16 == 0);
-
-  diffStart = bufSize + 1;
-  diffEnd = 0;
-
-  size_t alignedSize = bufSize & (~0xf);
-  size_t numVecs = alignedSize / 16;
-
-  size_t offs = 0;
-
-  float *aflt = (float *)a;
-  float *bflt = (float *)b;
-
-  // sweep to find the start of differences
-  for(size_t v = 0; v < numVecs; v++)
-  {
-    if(Vec16NotEqual(aflt, bflt))
-    {
-      diffStart = offs;
-      break;
-    }
-
-    aflt += 4;
-    bflt += 4;
-    offs += 4 * sizeof(float);
-  }
-
-  // make sure we're byte-accurate, to comply with WRITE_NO_OVERWRITE
-  while(diffStart < bufSize && *((byte *)a + diffStart) == *((byte *)b + diffStart))
-    diffStart++;
-
-  // do we have some unaligned bytes at the end of the buffer?
-  if(bufSize > alignedSize)
-  {
-    size_t numBytes = bufSize - alignedSize;
-
-    // if we haven't even found a start, check in these bytes
-    if(diffStart > bufSize)
-    {
-      offs = alignedSize;
-
-      for(size_t by = 0; by < numBytes; by++)
-      {
-        if(*((byte *)a + alignedSize + by) != *((byte *)b + alignedSize + by))
-        {
-          diffStart = offs;
-          break;
-        }
-
-        offs++;
-      }
-    }
-
-    // sweep from the last byte to find the end
-    for(size_t by = 0; by < numBytes; by++)
-    {
-      if(*((byte *)a + bufSize - 1 - by) != *((byte *)b + bufSize - 1 - by))
-      {
-        diffEnd = bufSize - by;
-        break;
-      }
-    }
-  }
-
-  // if we haven't found a start, or we've found a start AND and end,
-  // then we're done.
-  if(diffStart > bufSize || diffEnd > 0)
-    return diffStart < bufSize;
-
-  offs = alignedSize;
-
-  // sweep from the last __m128
-  aflt = (float *)a + offs / sizeof(float) - 4;
-  bflt = (float *)b + offs / sizeof(float) - 4;
-
-  for(size_t v = 0; v < numVecs; v++)
-  {
-    if(Vec16NotEqual(aflt, bflt))
-    {
-      diffEnd = offs;
-      break;
-    }
-
-    aflt -= 4;
-    bflt -= 4;
-    offs -= 16;
-  }
-
-  // make sure we're byte-accurate, to comply with WRITE_NO_OVERWRITE
-  while(diffEnd > 0 && *((byte *)a + diffEnd - 1) == *((byte *)b + diffEnd - 1))
-    diffEnd--;
-
-  // if we found a start then we necessarily found an end
-  return diffStart < bufSize;
-}
-
 uint32_t CalcNumMips(int w, int h, int d)
 {
   int mipLevels = 1;
@@ -251,6 +113,16 @@ uint64_t Log2Floor(uint64_t value)
 static rdcstr logfile;
 static FileIO::LogFileHandle *logfileHandle = NULL;
 
+// when logging asynchronously, messages are queued here and written out on a background thread
+static LogQueue *logQueue = NULL;
+
+// serialises writing to the log outputs
+static Threading::CriticalSection &rdclog_outputlock()
+{
+  static Threading::CriticalSection *lock = new Threading::CriticalSection();
+  return *lock;
+}
+
 const char *rdclog_getfilename()
 {
   return logfile.c_str();
@@ -264,6 +136,11 @@ void rdclog_filename(const char *filename)
   if(filename && filename[0])
     logfile = filename;
 
+  // write anything queued to the previous log before switching
+  rdclog_flush();
+
+  SCOPED_LOCK(rdclog_outputlock());
+
   FileIO::logfile_close(logfileHandle, NULL);
 
   logfileHandle = NULL;
@@ -292,22 +169,34 @@ void rdclog_enableoutput()
   log_output_enabled = true;
 }
 
+// stops queueing and writes out anything still queued. The queue itself is leaked since other
+// threads may still be looking at it.
+static void rdclog_stopqueue()
+{
+  LogQueue *queue = logQueue;
+  logQueue = NULL;
+  if(queue)
+    queue->Stop();
+}
+
 void rdclog_closelog()
 {
+  rdclog_stopqueue();
+
   log_output_enabled = false;
   FileIO::logfile_close(logfileHandle, logfile.c_str());
 }
 
 void rdclog_flush()
 {
+  LogQueue *queue = logQueue;
+  if(queue)
+    queue->Flush();
 }
 
-void rdclogprint_int(LogType type, const char *fullMsg, const char *msg)
+// writes a message to all outputs except the log file
+static void rdclog_writeoutput(LogType type, const char *fullMsg, const char *msg)
 {
-  static Threading::CriticalSection *lock = new Threading::CriticalSection();
-
-  SCOPED_LOCK(*lock);
-
 #if ENABLED(OUTPUT_LOG_TO_DEBUG_OUT)
   OSUtility::WriteOutput(OSUtility::Output_DebugMon, fullMsg);
 #endif
@@ -321,6 +210,14 @@ void rdclogprint_int(LogType type, const char *fullMsg, const char *msg)
   if(type != LogType::Debug && log_output_enabled)
     OSUtility::WriteOutput(OSUtility::Output_StdErr, msg);
 #endif
+}
+
+void rdclogprint_int(LogType type, const char *fullMsg, const char *msg)
+{
+  SCOPED_LOCK(rdclog_outputlock());
+
+  rdclog_writeoutput(type, fullMsg, msg);
+
 #if ENABLED(OUTPUT_LOG_TO_DISK)
   if(logfileHandle)
   {
@@ -330,6 +227,101 @@ void rdclogprint_int(LogType type, const char *fullMsg, const char *msg)
 #endif
 }
 
+static const char *typestr[(uint32_t)LogType::Count] = {
+    "Debug  ", "Log    ", "Warning", "Error  ", "Fatal  ",
+};
+
+#if ENABLED(RDOC_WIN32)
+static const char newline[] = "\r\n";
+#else
+static const char newline[] = "\n";
+#endif
+
+// formats the prefix that starts every log line, returning the number of characters written or a
+// negative value on failure
+static int rdclog_prefix(char *output, size_t available, time_t utcTime, uint32_t pid, LogType type,
+                         const char *project, const char *file, unsigned int line)
+{
+  rdcstr timestamp;
+#if ENABLED(INCLUDE_TIMESTAMP_IN_LOG)
+  timestamp = StringFormat::sntimef(utcTime, "[%H:%M:%S] ");
+#endif
+
+  char location[64] = {0};
+#if ENABLED(INCLUDE_LOCATION_IN_LOG)
+  rdcstr loc;
+  loc = get_basename(file);
+  utf8printf(location, 63, "% 20s(%4d) - ", loc.c_str(), line);
+#endif
+
+  return utf8printf(output, available, "% 4s %06u: %s%s%s - ", project, pid, timestamp.c_str(),
+                    location, typestr[(uint32_t)type]);
+}
+
+// writes out a batch of queued messages, formatted the same as rdclog_direct does, with the whole
+// batch going to the log file in one write.
+static void rdclog_writebatch(const rdcarray<LogQueueMessage> &messages)
+{
+  // these are leaked so they're still valid when the queue is stopped during static destruction
+  static rdcstr &fileOutput = *(new rdcstr);
+  static rdcstr &output = *(new rdcstr);
+
+  fileOutput.clear();
+
+  char prefix[256];
+
+  SCOPED_LOCK(rdclog_outputlock());
+
+  for(const LogQueueMessage &msg : messages)
+  {
+    int prefixLength = rdclog_prefix(prefix, sizeof(prefix), msg.utcTime, msg.pid, msg.type,
+                                     msg.project, msg.file, msg.line);
+
+    if(prefixLength < 0)
+      continue;
+
+    prefixLength = RDCMIN(prefixLength, int(sizeof(prefix) - 1));
+
+    // the output without the prefix still includes the type on the first line
+    size_t noPrefixOffset = size_t(prefixLength) - strlen(typestr[(uint32_t)msg.type]) - 3;
+
+    // print the message in sections to ensure newlines are in native format
+    const char *text = msg.text;
+    for(;;)
+    {
+      const char *nl = strchr(text, '\n');
+      size_t length = nl ? size_t(nl - text) : strlen(text);
+
+      output.assign(prefix, prefixLength);
+      output.append(text, length);
+      output.append(newline);
+
+      rdclog_writeoutput(msg.type, output.c_str(), output.c_str() + noPrefixOffset);
+
+      fileOutput.append(output);
+
+      if(nl == NULL)
+        break;
+
+      text = nl + 1;
+      noPrefixOffset = prefixLength;
+    }
+  }
+
+#if ENABLED(OUTPUT_LOG_TO_DISK)
+  if(logfileHandle && !fileOutput.empty())
+    FileIO::logfile_append(logfileHandle, fileOutput.c_str(), fileOutput.size());
+#endif
+}
+
+void rdclog_enableasync(bool enable)
+{
+  if(enable && logQueue == NULL)
+    logQueue = new LogQueue(&rdclog_writebatch);
+  else if(!enable)
+    rdclog_stopqueue();
+}
+
 const int rdclog_outBufSize = 4 * 1024;
 static char rdclog_outputBuffer[rdclog_outBufSize + 3];
 
@@ -354,28 +346,44 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
     pid = curpid;
 
   va_list args;
+
+  LogQueue *queue = logQueue;
+  if(queue)
+  {
+    // only the message itself is formatted here since the arguments can't be kept past this call,
+    // the rest is formatted when the queue is written out.
+    char message[512];
+
+    va_start(args, fmt);
+    int length = utf8printv(message, sizeof(message), fmt, args);
+    va_end(args);
+
+    bool queued = false;
+
+    if(length >= 0 && size_t(length) < sizeof(message))
+      queued = queue->Push(utcTime, pid, type, project, file, line, message, size_t(length));
+
+    if(queued)
+    {
+      // errors are rare and the most important to have if something goes wrong, so don't leave
+      // them in the queue
+      if(type >= LogType::Error)
+        queue->Flush();
+
+      return;
+    }
+
+    // if the message couldn't be queued, write out anything before it so it stays in order and
+    // then write it directly.
+    queue->Flush();
+  }
+
   va_start(args, fmt);
 
   // this copy is just for in case we need to print again if the buffer is oversized
   va_list args2;
   va_copy(args2, args);
 
-  rdcstr timestamp;
-#if ENABLED(INCLUDE_TIMESTAMP_IN_LOG)
-  timestamp = StringFormat::sntimef(utcTime, "[%H:%M:%S] ");
-#endif
-
-  char location[64] = {0};
-#if ENABLED(INCLUDE_LOCATION_IN_LOG)
-  rdcstr loc;
-  loc = get_basename(file);
-  utf8printf(location, 63, "% 20s(%4d) - ", loc.c_str(), line);
-#endif
-
-  const char *typestr[(uint32_t)LogType::Count] = {
-      "Debug  ", "Log    ", "Warning", "Error  ", "Fatal  ",
-  };
-
   static Threading::CriticalSection *lock = new Threading::CriticalSection();
 
   SCOPED_LOCK(*lock);
@@ -387,8 +395,7 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
 
   char *base = output;
 
-  int numWritten = utf8printf(output, available, "% 4s %06u: %s%s%s - ", project, pid,
-                              timestamp.c_str(), location, typestr[(uint32_t)type]);
+  int numWritten = rdclog_prefix(output, available, utcTime, pid, type, project, file, line);
 
   if(numWritten < 0)
   {
@@ -401,7 +408,7 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
   available -= numWritten;
 
   // -3 is for the " - " after the type.
-  const char *noPrefixOutput = (output - 3 - (sizeof(typestr[(uint32_t)type]) - 1));
+  const char *noPrefixOutput = (output - 3 - strlen(typestr[(uint32_t)type]));
   const char *prefixEnd = output;
 
   int totalWritten = numWritten;
@@ -429,16 +436,14 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
     oversizedBuffer = output = new char[available + 3];
     base = output;
 
-    numWritten =
-        utf8printf(output, available, "% 4s %06u: %s%s%s - ", project, Process::GetCurrentPID(),
-                   timestamp.c_str(), location, typestr[(uint32_t)type]);
+    numWritten = rdclog_prefix(output, available, utcTime, pid, type, project, file, line);
 
     output += numWritten;
     available -= numWritten;
 
     prefixEnd = output;
 
-    noPrefixOutput = (output - 3 - (sizeof(typestr[(uint32_t)type]) - 1));
+    noPrefixOutput = (output - 3 - strlen(typestr[(uint32_t)type]));
 
     numWritten = utf8printv(output, available, fmt, args2);
 
@@ -355,6 +355,10 @@ inline size_t Log2Floor(size_t value)
   do                   \
   {                    \
   } while((void)0, 0)
+#define RDCLOGASYNC(enable) \
+  do                        \
+  {                         \
+  } while((void)0, 0)
 #define RDCLOGDELETE() \
   do                   \
   {                    \
@@ -443,12 +447,15 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
 const char *rdclog_getfilename();
 void rdclog_filename(const char *filename);
 void rdclog_enableoutput();
+// when enabled, messages are queued and written out on a background thread
+void rdclog_enableasync(bool enable);
 void rdclog_closelog();
 
 #define RDCLOGFILE(fn) rdclog_filename(fn)
 #define RDCGETLOGFILE() rdclog_getfilename()
 
 #define RDCLOGOUTPUT() rdclog_enableoutput()
+#define RDCLOGASYNC(enable) rdclog_enableasync(enable)
 #define RDCSTOPLOGGING() rdclog_closelog()
 
 #if(ENABLED(RDOC_DEVEL) || ENABLED(FORCE_DEBUG_LOGS)) && DISABLED(STRIP_DEBUG_LOGS)
@@ -0,0 +1,686 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "jobsystem.h"
+#include "core/settings.h"
+
+RDOC_CONFIG(uint32_t, Threading_JobWorkerThreads, 0,
+            "The number of worker threads in the shared job system. 0 uses one thread per CPU "
+            "core.");
+
+namespace Threading
+{
+struct Job
+{
+  std::function<void()> func;
+  JobGroup *group = NULL;
+};
+
+// a double-ended queue of jobs. The worker that owns it pushes and pops at the back so it works on
+// the most recently queued job, which is most likely to still be in cache, and other workers steal
+// from the front.
+class JobQueue
+{
+public:
+  void PushBack(Job &&job)
+  {
+    SCOPED_SPINLOCK(m_Lock);
+
+    if((size_t)m_Count == m_Jobs.size())
+      Grow();
+
+    m_Jobs[(m_Head + m_Count) % m_Jobs.size()] = std::move(job);
+    Atomic::Inc32(&m_Count);
+  }
+
+  bool PopBack(Job &job)
+  {
+    // cheap early-out without taking the lock
+    if(Empty())
+      return false;
+
+    SCOPED_SPINLOCK(m_Lock);
+
+    if(m_Count == 0)
+      return false;
+
+    int32_t idx = Atomic::Dec32(&m_Count);
+    job = std::move(m_Jobs[(m_Head + idx) % m_Jobs.size()]);
+    return true;
+  }
+
+  bool PopFront(Job &job)
+  {
+    if(Empty())
+      return false;
+
+    SCOPED_SPINLOCK(m_Lock);
+
+    if(m_Count == 0)
+      return false;
+
+    job = std::move(m_Jobs[m_Head]);
+    m_Head = (m_Head + 1) % m_Jobs.size();
+    Atomic::Dec32(&m_Count);
+    return true;
+  }
+
+private:
+  // the count is only modified under the lock, but can be read outside it to skip empty queues
+  bool Empty() { return Atomic::CmpExch32(&m_Count, 0, 0) == 0; }
+
+  void Grow()
+  {
+    rdcarray<Job> jobs;
+    jobs.resize(RDCMAX((size_t)64, m_Jobs.size() * 2));
+
+    for(int32_t i = 0; i < m_Count; i++)
+      jobs[i] = std::move(m_Jobs[(m_Head + i) % m_Jobs.size()]);
+
+    m_Jobs.swap(jobs);
+    m_Head = 0;
+  }
+
+  SpinLock m_Lock;
+  rdcarray<Job> m_Jobs;
+  size_t m_Head = 0;
+  int32_t m_Count = 0;
+};
+
+class JobSystem
+{
+public:
+  // returns the running job system, starting it if necessary. Returns NULL if no workers could be
+  // started or the job system has been shut down, in which case jobs should be run on the calling
+  // thread.
+  static JobSystem *Get();
+  // returns the running job system without starting it
+  static JobSystem *Current() { return m_Instance; }
+  static void Shutdown();
+
+  void Push(Job &&job);
+  // run one queued job on the calling thread, if there are any
+  bool RunOne();
+  // sleep until group completes or a job is queued. Returns immediately if either has happened
+  void Block(JobGroup &group);
+
+  JobSystemStats GetStats() const;
+
+private:
+  JobSystem(uint32_t numWorkers);
+  ~JobSystem();
+
+  void Stop();
+
+  uint32_t CurrentWorker() const;
+  bool Pop(uint32_t self, Job &job);
+  void Execute(Job &job);
+  void WakeOne();
+  void WorkerMain(uint32_t idx);
+
+  static SpinLock m_InstanceLock;
+  static JobSystem *m_Instance;
+  static bool m_StartFailed;
+  static bool m_ShutDown;
+  static uint64_t m_WorkerSlot;
+
+  uint32_t m_NumWorkers;
+  rdcarray<ThreadHandle> m_Threads;
+
+  // one queue per worker, plus a shared queue for jobs submitted from other threads
+  JobQueue *m_WorkerQueues = NULL;
+  JobQueue m_SharedQueue;
+
+  // workers that are (about to be) waiting for work. Released once for each worker woken
+  int32_t m_Sleeping = 0;
+  Semaphore m_WorkAvailable;
+
+  // groups that threads are blocked waiting on, one entry per waiting thread. One is woken when a
+  // job is queued and there's no sleeping worker to pick it up.
+  SpinLock m_BlockedLock;
+  rdcarray<JobGroup *> m_Blocked;
+  int32_t m_NumBlocked = 0;
+
+  int32_t m_Running = 0;
+  int32_t m_Shutdown = 0;
+
+  // statistics
+  int32_t m_Queued = 0;
+  int32_t m_MaxQueued = 0;
+  int64_t m_Submitted = 0;
+  int64_t m_Executed = 0;
+  int64_t m_Stolen = 0;
+};
+
+SpinLock JobSystem::m_InstanceLock;
+JobSystem *JobSystem::m_Instance = NULL;
+bool JobSystem::m_StartFailed = false;
+bool JobSystem::m_ShutDown = false;
+uint64_t JobSystem::m_WorkerSlot = 0;
+
+static uint32_t ConfiguredWorkers()
+{
+  uint32_t numWorkers = Threading_JobWorkerThreads();
+  if(numWorkers == 0)
+    numWorkers = NumberOfCores();
+  return RDCMAX(1U, numWorkers);
+}
+
+JobSystem *JobSystem::Get()
+{
+  JobSystem *ret = m_Instance;
+  if(ret)
+    return ret;
+
+  SCOPED_SPINLOCK(m_InstanceLock);
+
+  if(m_Instance || m_StartFailed || m_ShutDown)
+    return m_Instance;
+
+  m_WorkerSlot = AllocateTLSSlot();
+
+  ret = new JobSystem(ConfiguredWorkers());
+
+  if(ret->m_Threads.empty())
+  {
+    RDCWARN("Couldn't create any job system worker threads, jobs will run serially");
+    ret->Stop();
+    delete ret;
+    m_StartFailed = true;
+    return NULL;
+  }
+
+  m_Instance = ret;
+  return ret;
+}
+
+void JobSystem::Shutdown()
+{
+  JobSystem *jobs = NULL;
+
+  {
+    SCOPED_SPINLOCK(m_InstanceLock);
+    jobs = m_Instance;
+    m_Instance = NULL;
+    m_ShutDown = true;
+  }
+
+  if(!jobs)
+    return;
+
+  JobSystemStats stats = jobs->GetStats();
+
+  if(stats.executed > 0)
+    RDCLOG("Job system ran %llu jobs on %u workers, %llu stolen, max queue depth %u",
+           stats.executed, stats.numWorkers, stats.stolen, stats.maxQueueDepth);
+
+  jobs->Stop();
+  delete jobs;
+}
+
+JobSystem::JobSystem(uint32_t numWorkers) : m_NumWorkers(numWorkers)
+{
+  m_WorkerQueues = new JobQueue[m_NumWorkers];
+
+  m_Threads.reserve(m_NumWorkers);
+  for(uint32_t i = 0; i < m_NumWorkers; i++)
+  {
+    Atomic::Inc32(&m_Running);
+    ThreadHandle thread = CreateThread([this, i]() { WorkerMain(i); });
+    if(thread)
+    {
+      m_Threads.push_back(thread);
+    }
+    else
+    {
+      Atomic::Dec32(&m_Running);
+      break;
+    }
+  }
+
+  // any queues past the threads we managed to create are never used
+  m_NumWorkers = (uint32_t)m_Threads.size();
+}
+
+JobSystem::~JobSystem()
+{
+  delete[] m_WorkerQueues;
+}
+
+void JobSystem::Stop()
+{
+  Atomic::CmpExch32(&m_Shutdown, 0, 1);
+  m_WorkAvailable.Release((uint32_t)m_Threads.size());
+
+  // workers run any remaining queued jobs and then exit
+  for(ThreadHandle thread : m_Threads)
+  {
+    JoinThread(thread);
+    CloseThread(thread);
+  }
+  m_Threads.clear();
+}
+
+uint32_t JobSystem::CurrentWorker() const
+{
+  uintptr_t idx = (uintptr_t)GetTLSValue(m_WorkerSlot);
+  return idx == 0 ? ~0U : uint32_t(idx - 1);
+}
+
+void JobSystem::Push(Job &&job)
+{
+  uint32_t self = CurrentWorker();
+
+  if(self < m_NumWorkers)
+    m_WorkerQueues[self].PushBack(std::move(job));
+  else
+    m_SharedQueue.PushBack(std::move(job));
+
+  int32_t depth = Atomic::Inc32(&m_Queued);
+  int32_t maxDepth = m_MaxQueued;
+  while(depth > maxDepth && Atomic::CmpExch32(&m_MaxQueued, maxDepth, depth) != maxDepth)
+    maxDepth = m_MaxQueued;
+
+  Atomic::Inc64(&m_Submitted);
+
+  WakeOne();
+}
+
+void JobSystem::Block(JobGroup &group)
+{
+  {
+    SCOPED_SPINLOCK(m_BlockedLock);
+
+    // count ourselves as blocked before checking the queues, so a job queued after we look either
+    // sees us and wakes us, or we see it.
+    Atomic::Inc32(&m_NumBlocked);
+
+    bool wait = false;
+    if(Atomic::CmpExch32(&m_Queued, 0, 0) == 0)
+    {
+      SCOPED_SPINLOCK(group.m_Lock);
+      if(group.m_Pending > 0)
+      {
+        group.m_Waiters++;
+        wait = true;
+      }
+    }
+
+    if(!wait)
+    {
+      Atomic::Dec32(&m_NumBlocked);
+      return;
+    }
+
+    m_Blocked.push_back(&group);
+  }
+
+  group.m_Wake.Acquire();
+
+  // if we were woken by the group completing we're still in the list. Remove ourselves so that the
+  // group isn't woken once it could have been destroyed.
+  SCOPED_SPINLOCK(m_BlockedLock);
+  int32_t idx = m_Blocked.indexOf(&group);
+  if(idx >= 0)
+  {
+    m_Blocked.erase(idx);
+    Atomic::Dec32(&m_NumBlocked);
+  }
+}
+
+bool JobSystem::Pop(uint32_t self, Job &job)
+{
+  bool found = false;
+
+  if(self < m_NumWorkers && m_WorkerQueues[self].PopBack(job))
+  {
+    found = true;
+  }
+  else if(m_SharedQueue.PopFront(job))
+  {
+    found = true;
+  }
+  else
+  {
+    uint32_t start = self < m_NumWorkers ? self + 1 : 0;
+    for(uint32_t i = 0; i < m_NumWorkers; i++)
+    {
+      uint32_t victim = (start + i) % m_NumWorkers;
+      if(victim != self && m_WorkerQueues[victim].PopFront(job))
+      {
+        Atomic::Inc64(&m_Stolen);
+        found = true;
+        break;
+      }
+    }
+  }
+
+  if(found)
+    Atomic::Dec32(&m_Queued);
+
+  return found;
+}
+
+void JobSystem::Execute(Job &job)
+{
+  JobGroup *group = job.group;
+
+  job.func();
+  job.func = std::function<void()>();
+
+  Atomic::Inc64(&m_Executed);
+
+  if(group)
+    group->JobFinished();
+}
+
+bool JobSystem::RunOne()
+{
+  Job job;
+  if(!Pop(CurrentWorker(), job))
+    return false;
+
+  Execute(job);
+  return true;
+}
+
+void JobSystem::WakeOne()
+{
+  int32_t sleeping = m_Sleeping;
+  while(sleeping > 0)
+  {
+    if(Atomic::CmpExch32(&m_Sleeping, sleeping, sleeping - 1) == sleeping)
+    {
+      m_WorkAvailable.Release(1);
+      return;
+    }
+
+    sleeping = m_Sleeping;
+  }
+
+  // every worker is busy, wake a thread that's blocked in JobGroup::Wait() to run the job, in case
+  // the workers are all blocked too.
+  if(Atomic::CmpExch32(&m_NumBlocked, 0, 0) > 0)
+  {
+    SCOPED_SPINLOCK(m_BlockedLock);
+    while(!m_Blocked.empty())
+    {
+      JobGroup *group = m_Blocked.back();
+      m_Blocked.pop_back();
+      Atomic::Dec32(&m_NumBlocked);
+
+      // the waiter can't leave Block() until it has removed itself from m_Blocked, so the group
+      // is still alive while we hold the lock.
+      SCOPED_SPINLOCK(group->m_Lock);
+
+      // if the group has completed, its waiters have all been released already and this entry is
+      // stale. Try the next one instead.
+      if(group->m_Waiters > 0)
+      {
+        group->m_Waiters--;
+        group->m_Wake.Release(1);
+        break;
+      }
+    }
+  }
+}
+
+void JobSystem::WorkerMain(uint32_t idx)
+{
+  SetCurrentThreadName("JobWorker");
+  SetTLSValue(m_WorkerSlot, (void *)uintptr_t(idx + 1));
+
+  for(;;)
+  {
+    Job job;
+    if(Pop(idx, job))
+    {
+      Execute(job);
+      continue;
+    }
+
+    // only exit once the queues are drained
+    if(m_Shutdown)
+      break;
+
+    Atomic::Inc32(&m_Sleeping);
+
+    // check again now that we're marked as sleeping, in case a job was pushed after we looked but
+    // before the pusher could see us.
+    if(m_Queued > 0 || m_Shutdown)
+    {
+      int32_t sleeping = m_Sleeping;
+      bool unmarked = false;
+      while(sleeping > 0 && !unmarked)
+      {
+        unmarked = Atomic::CmpExch32(&m_Sleeping, sleeping, sleeping - 1) == sleeping;
+        sleeping = m_Sleeping;
+      }
+
+      // if someone else already decremented the count on our behalf they've released the
+      // semaphore for us, so consume that.
+      if(!unmarked)
+        m_WorkAvailable.Acquire();
+
+      continue;
+    }
+
+    m_WorkAvailable.Acquire();
+  }
+
+  SetTLSValue(m_WorkerSlot, NULL);
+  Atomic::Dec32(&m_Running);
+}
+
+JobSystemStats JobSystem::GetStats() const
+{
+  JobSystemStats ret;
+  ret.numWorkers = m_NumWorkers;
+  ret.queueDepth = (uint32_t)RDCMAX(0, m_Queued);
+  ret.maxQueueDepth = (uint32_t)m_MaxQueued;
+  ret.submitted = (uint64_t)m_Submitted;
+  ret.executed = (uint64_t)m_Executed;
+  ret.stolen = (uint64_t)m_Stolen;
+  return ret;
+}
+
+void JobGroup::Submit(std::function<void()> job)
+{
+  JobSystem *jobs = JobSystem::Get();
+
+  if(!jobs)
+  {
+    job();
+    return;
+  }
+
+  Atomic::Inc32(&m_Pending);
+
+  Job j;
+  j.func = std::move(job);
+  j.group = this;
+  jobs->Push(std::move(j));
+}
+
+void JobGroup::Then(JobGroup &next, std::function<void()> continuation)
+{
+  // a group can't continue into itself, it would never complete
+  RDCASSERT(&next != this);
+
+  // count the continuation in next immediately, so anyone waiting on next waits for us
+  Atomic::Inc32(&next.m_Pending);
+
+  {
+    SCOPED_SPINLOCK(m_Lock);
+
+    if(m_Pending > 0)
+    {
+      m_Continuations.push_back({&next, std::move(continuation)});
+      return;
+    }
+  }
+
+  Job j;
+  j.func = std::move(continuation);
+  j.group = &next;
+
+  JobSystem *jobs = JobSystem::Get();
+  if(jobs)
+  {
+    jobs->Push(std::move(j));
+  }
+  else
+  {
+    j.func();
+    next.JobFinished();
+  }
+}
+
+void JobGroup::Wait()
+{
+  uint32_t idle = 0;
+
+  while(Atomic::CmpExch32(&m_Pending, 0, 0) > 0)
+  {
+    // jobs are only pending while the job system is running, Shutdown() runs them all before
+    // returning.
+    JobSystem *jobs = JobSystem::Current();
+    if(jobs && jobs->RunOne())
+    {
+      idle = 0;
+      continue;
+    }
+
+    // the remaining jobs are already running elsewhere. Spin briefly in case they're short, then
+    // sleep until they're done or there's another job we can run.
+    if(++idle <= 64)
+      continue;
+
+    if(jobs)
+      jobs->Block(*this);
+    else
+      Sleep(0);
+  }
+
+  // whichever thread finished the last job may still hold the lock, and the group could be
+  // destroyed as soon as we return.
+  SCOPED_SPINLOCK(m_Lock);
+}
+
+void JobGroup::JobFinished()
+{
+  rdcarray<rdcpair<JobGroup *, std::function<void()>>> continuations;
+
+  {
+    SCOPED_SPINLOCK(m_Lock);
+
+    if(Atomic::Dec32(&m_Pending) == 0)
+    {
+      continuations.swap(m_Continuations);
+
+      // waiters return once they can take the lock, so this must be done while we hold it
+      if(m_Waiters > 0)
+      {
+        m_Wake.Release((uint32_t)m_Waiters);
+        m_Waiters = 0;
+      }
+    }
+  }
+
+  // we can't touch this group past here, a waiter may have already returned.
+  if(continuations.empty())
+    return;
+
+  JobSystem *jobs = JobSystem::Get();
+
+  for(rdcpair<JobGroup *, std::function<void()>> &c : continuations)
+  {
+    Job j;
+    j.func = std::move(c.second);
+    j.group = c.first;
+
+    if(jobs)
+    {
+      jobs->Push(std::move(j));
+    }
+    else
+    {
+      j.func();
+      j.group->JobFinished();
+    }
+  }
+}
+
+void ParallelFor(uint32_t begin, uint32_t end, std::function<void(uint32_t)> body,
+                 uint32_t grainSize)
+{
+  if(end <= begin)
+    return;
+
+  uint32_t count = end - begin;
+
+  if(grainSize == 0)
+    grainSize = RDCMAX(1U, count / (GetJobConcurrency() * 4));
+
+  // queue everything but the first range, which we run here while the others are picked up
+  JobGroup group;
+
+  uint32_t start = begin + RDCMIN(grainSize, count);
+  while(start < end)
+  {
+    uint32_t rangeEnd = start + RDCMIN(grainSize, end - start);
+
+    group.Submit([&body, start, rangeEnd]() {
+      for(uint32_t i = start; i < rangeEnd; i++)
+        body(i);
+    });
+
+    start = rangeEnd;
+  }
+
+  for(uint32_t i = begin; i < begin + RDCMIN(grainSize, count); i++)
+    body(i);
+
+  group.Wait();
+}
+
+JobSystemStats GetJobSystemStats()
+{
+  JobSystem *jobs = JobSystem::Current();
+  if(jobs)
+    return jobs->GetStats();
+
+  return JobSystemStats();
+}
+
+uint32_t GetJobConcurrency()
+{
+  return ConfiguredWorkers();
+}
+
+void ShutdownJobSystem()
+{
+  JobSystem::Shutdown();
+}
+};
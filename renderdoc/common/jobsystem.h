@@ -0,0 +1,105 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include "api/replay/rdcpair.h"
+#include "common/threading.h"
+
+namespace Threading
+{
+// A set of jobs on the shared job system that can be waited on together.
+//
+// The job system is a process-wide pool of worker threads, one per core unless configured
+// otherwise, each with its own queue. Jobs submitted from a worker go on that worker's queue and
+// idle workers steal from the others, so nested submissions stay local where possible. Workers are
+// only started the first time a job is submitted.
+//
+// A group must outlive all the jobs submitted against it, the destructor waits for them.
+class JobGroup
+{
+public:
+  JobGroup() = default;
+  ~JobGroup() { Wait(); }
+  JobGroup(const JobGroup &) = delete;
+  JobGroup &operator=(const JobGroup &) = delete;
+
+  // queue a job to run on the job system. If no workers are available it runs immediately.
+  void Submit(std::function<void()> job);
+
+  // queue continuation as a job in next, once every job in this group has completed - including
+  // any submitted after this call. It counts as pending in next from now, so waiting on next
+  // includes waiting for this group. If this group is already complete it's queued immediately.
+  void Then(JobGroup &next, std::function<void()> continuation);
+
+  // blocks until every job in the group has completed. While waiting this thread runs queued jobs
+  // from any group, so it's safe to wait from inside a job. Once there's nothing left to run it
+  // sleeps until the group completes or more jobs are queued.
+  void Wait();
+
+  bool IsComplete() const { return m_Pending == 0; }
+private:
+  friend class JobSystem;
+
+  void JobFinished();
+
+  int32_t m_Pending = 0;
+  SpinLock m_Lock;
+  rdcarray<rdcpair<JobGroup *, std::function<void()>>> m_Continuations;
+
+  // threads sleeping in Wait(), released when the group completes. Protected by m_Lock
+  int32_t m_Waiters = 0;
+  Semaphore m_Wake;
+};
+
+// run body for every index in [begin, end) across the job system, returning once all are done.
+// Indices are handed out in contiguous ranges of grainSize, if it's 0 a size is chosen to give each
+// worker a few ranges to balance load.
+void ParallelFor(uint32_t begin, uint32_t end, std::function<void(uint32_t)> body,
+                 uint32_t grainSize = 0);
+
+struct JobSystemStats
+{
+  // number of worker threads running, 0 if the job system hasn't been started
+  uint32_t numWorkers = 0;
+  // jobs currently queued and not yet started, and the most that have been queued at once
+  uint32_t queueDepth = 0;
+  uint32_t maxQueueDepth = 0;
+  // jobs submitted and completed overall
+  uint64_t submitted = 0;
+  uint64_t executed = 0;
+  // jobs that were run by a different worker to the one they were queued on
+  uint64_t stolen = 0;
+};
+
+JobSystemStats GetJobSystemStats();
+
+// the number of threads that jobs can run on, including the calling thread
+uint32_t GetJobConcurrency();
+
+// stops the worker threads. Any jobs still queued are run first. Jobs submitted after this run
+// immediately on the submitting thread.
+void ShutdownJobSystem();
+};
@@ -0,0 +1,624 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "log_queue.h"
+#include <string.h>
+#include <algorithm>
+#include "os/os_specific.h"
+
+// how long the drain thread waits after writing a batch, to let more messages arrive to write
+// together
+static const uint32_t BatchIntervalMS = 5;
+
+static const uint32_t LogRecordPadding = ~0U;
+
+// each message in a ring is one of these followed by the project, file and text, each
+// NULL-terminated, padded to keep the next record aligned.
+struct LogRecord
+{
+  // total size of the record including the strings and padding
+  uint32_t size;
+  // the LogType, or LogRecordPadding if this just fills the space at the end of the ring
+  uint32_t type;
+  uint64_t seq;
+  int64_t utcTime;
+  uint32_t pid;
+  uint32_t line;
+  uint32_t projectLength;
+  uint32_t fileLength;
+  uint64_t textLength;
+};
+
+const int32_t LogQueue::MaxRings;
+
+static uint64_t NextQueueID = 0;
+
+// the queues that exist, by ID. Never freed since threads can exit during static destruction
+static Threading::CriticalSection *LiveQueuesLock()
+{
+  static Threading::CriticalSection *lock = new Threading::CriticalSection;
+  return lock;
+}
+
+static rdcarray<rdcpair<uint64_t, LogQueue *>> &LiveQueues()
+{
+  static rdcarray<rdcpair<uint64_t, LogQueue *>> *queues =
+      new rdcarray<rdcpair<uint64_t, LogQueue *>>;
+  return *queues;
+}
+
+struct LogQueue::ThreadRings
+{
+  ~ThreadRings();
+
+  // the queue ID and this thread's ring in it
+  rdcarray<rdcpair<uint64_t, Ring *>> rings;
+};
+
+thread_local LogQueue::ThreadRings LogQueue::threadRings;
+thread_local bool LogQueue::threadRingsReleased = false;
+
+LogQueue::ThreadRings::~ThreadRings()
+{
+  threadRingsReleased = true;
+
+  SCOPED_LOCK(*LiveQueuesLock());
+
+  for(const rdcpair<uint64_t, Ring *> &r : rings)
+  {
+    for(const rdcpair<uint64_t, LogQueue *> &q : LiveQueues())
+    {
+      if(q.first == r.first)
+      {
+        q.second->ReleaseRing(r.second);
+        break;
+      }
+    }
+  }
+}
+
+LogQueue::LogQueue(Sink sink, uint32_t ringSize)
+{
+  RDCASSERT((ringSize & (ringSize - 1)) == 0 && ringSize >= 1024);
+
+  m_Sink = sink;
+  m_RingSize = ringSize;
+  m_ID = (uint64_t)Atomic::Inc64((int64_t *)&NextQueueID);
+
+  {
+    SCOPED_LOCK(*LiveQueuesLock());
+    LiveQueues().push_back({m_ID, this});
+  }
+
+  m_SharedRing.data = new byte[m_RingSize];
+
+  m_DrainRunning = 1;
+  m_DrainThread = Threading::CreateThread([this]() { DrainThreadMain(); });
+  if(m_DrainThread == 0)
+    m_DrainRunning = 0;
+}
+
+LogQueue::~LogQueue()
+{
+  Stop();
+
+  {
+    SCOPED_LOCK(*LiveQueuesLock());
+    for(size_t i = 0; i < LiveQueues().size(); i++)
+    {
+      if(LiveQueues()[i].second == this)
+      {
+        LiveQueues().erase(i);
+        break;
+      }
+    }
+  }
+
+  for(int32_t i = 0; i < m_NumRings; i++)
+  {
+    if(m_Rings[i])
+      delete[] m_Rings[i]->data;
+    delete m_Rings[i];
+  }
+
+  delete[] m_SharedRing.data;
+}
+
+int32_t LogQueue::GetRingCount()
+{
+  return Atomic::CmpExch32(&m_NumRings, 0, 0);
+}
+
+LogQueue::Ring *LogQueue::GetRing()
+{
+  // a thread that's exiting has already given its rings back
+  if(threadRingsReleased)
+    return &m_SharedRing;
+
+  for(const rdcpair<uint64_t, Ring *> &r : threadRings.rings)
+    if(r.first == m_ID)
+      return r.second;
+
+  Ring *ring = NULL;
+
+  {
+    Threading::ScopedSpinLock lock(m_FreeLock);
+
+    if(!m_FreeRings.empty())
+    {
+      // any messages the previous owner left are still drained from here, and we carry on writing
+      // after them
+      ring = m_FreeRings.back();
+      m_FreeRings.pop_back();
+    }
+    else if(m_NumRings < MaxRings)
+    {
+      ring = new Ring;
+      ring->data = new byte[m_RingSize];
+
+      // the drain thread only looks at rings up to m_NumRings, so publish the ring before that
+      Atomic::CmpExchPtr((void **)&m_Rings[m_NumRings], NULL, ring);
+      Atomic::Inc32(&m_NumRings);
+    }
+  }
+
+  // past MaxRings live threads, share one ring. This isn't remembered so that we can pick up a
+  // ring once one is given back.
+  if(!ring)
+    return &m_SharedRing;
+
+  threadRings.rings.push_back({m_ID, ring});
+
+  return ring;
+}
+
+void LogQueue::ReleaseRing(Ring *ring)
+{
+  Threading::ScopedSpinLock lock(m_FreeLock);
+  m_FreeRings.push_back(ring);
+}
+
+bool LogQueue::Push(time_t utcTime, uint32_t pid, LogType type, const char *project,
+                    const char *file, uint32_t line, const char *text, size_t textLength)
+{
+  bool ret = false;
+
+  // mark ourselves as pushing before checking if we're stopped, so that Stop() either sees us and
+  // waits or we see that it's stopped.
+  Atomic::Inc32(&m_Pushing);
+
+  // the sink might log while it's writing, which can't be queued since it would need to drain
+  // recursively
+  if(!m_Stopped && m_DrainThread != 0 && m_DrainingThread != Threading::GetCurrentID())
+  {
+    Ring *ring = GetRing();
+
+    if(ring == &m_SharedRing)
+    {
+      Threading::ScopedSpinLock lock(m_SharedLock);
+      ret = Write(ring, utcTime, pid, type, project, file, line, text, textLength);
+    }
+    else
+    {
+      ret = Write(ring, utcTime, pid, type, project, file, line, text, textLength);
+    }
+  }
+
+  Atomic::Dec32(&m_Pushing);
+
+  if(ret)
+    WakeDrainThread();
+
+  return ret;
+}
+
+bool LogQueue::Write(Ring *ring, time_t utcTime, uint32_t pid, LogType type, const char *project,
+                     const char *file, uint32_t line, const char *text, size_t textLength)
+{
+  size_t projectLength = strlen(project);
+  size_t fileLength = strlen(file);
+
+  size_t recordSize = AlignUp(sizeof(LogRecord) + projectLength + fileLength + textLength + 3,
+                              sizeof(uint64_t));
+
+  // very large messages would starve the ring, they're written directly instead
+  if(recordSize > m_RingSize / 4)
+    return false;
+
+  int64_t head = ring->head;
+  size_t offs = size_t(head) & (m_RingSize - 1);
+  size_t contiguous = m_RingSize - offs;
+
+  // if the record doesn't fit before the end of the ring, skip to the start
+  size_t total = recordSize <= contiguous ? recordSize : contiguous + recordSize;
+
+  if(head + int64_t(total) - Atomic::ExchAdd64(&ring->tail, 0) > int64_t(m_RingSize))
+  {
+    // the ring is full, drain it here rather than waiting for the drain thread
+    Flush();
+
+    if(head + int64_t(total) - Atomic::ExchAdd64(&ring->tail, 0) > int64_t(m_RingSize))
+      return false;
+  }
+
+  if(total > recordSize)
+  {
+    // if there's not even room for a header the drain skips the space implicitly
+    if(contiguous >= sizeof(LogRecord))
+    {
+      LogRecord *padding = (LogRecord *)(ring->data + offs);
+      padding->size = uint32_t(contiguous);
+      padding->type = LogRecordPadding;
+    }
+
+    offs = 0;
+  }
+
+  LogRecord *record = (LogRecord *)(ring->data + offs);
+  record->size = uint32_t(recordSize);
+  record->type = uint32_t(type);
+  record->seq = (uint64_t)Atomic::Inc64(&m_Seq);
+  record->utcTime = (int64_t)utcTime;
+  record->pid = pid;
+  record->line = line;
+  record->projectLength = uint32_t(projectLength);
+  record->fileLength = uint32_t(fileLength);
+  record->textLength = textLength;
+
+  char *strings = (char *)(record + 1);
+  memcpy(strings, project, projectLength + 1);
+  strings += projectLength + 1;
+  memcpy(strings, file, fileLength + 1);
+  strings += fileLength + 1;
+  memcpy(strings, text, textLength);
+  strings[textLength] = 0;
+
+  // publish the record, the atomic add acts as the barrier so the contents are visible first
+  Atomic::ExchAdd64(&ring->head, int64_t(total));
+
+  return true;
+}
+
+bool LogQueue::Pending()
+{
+  if(Atomic::ExchAdd64(&m_SharedRing.head, 0) != m_SharedRing.tail)
+    return true;
+
+  for(int32_t i = 0; i < m_NumRings; i++)
+  {
+    Ring *ring = m_Rings[i];
+    if(ring && Atomic::ExchAdd64(&ring->head, 0) != ring->tail)
+      return true;
+  }
+
+  return false;
+}
+
+size_t LogQueue::Drain()
+{
+  SCOPED_LOCK(m_DrainLock);
+
+  m_DrainingThread = Threading::GetCurrentID();
+
+  m_Batch.clear();
+
+  int32_t numRings = m_NumRings;
+  for(int32_t i = -1; i < numRings; i++)
+  {
+    Ring *ring = i < 0 ? &m_SharedRing : m_Rings[i];
+
+    // reserved but not yet published
+    if(!ring)
+      continue;
+
+    int64_t head = Atomic::ExchAdd64(&ring->head, 0);
+    int64_t tail = ring->tail;
+
+    while(tail < head)
+    {
+      size_t offs = size_t(tail) & (m_RingSize - 1);
+      size_t contiguous = m_RingSize - offs;
+
+      if(contiguous < sizeof(LogRecord))
+      {
+        tail += contiguous;
+        continue;
+      }
+
+      const LogRecord *record = (const LogRecord *)(ring->data + offs);
+
+      if(record->type != LogRecordPadding)
+      {
+        const char *strings = (const char *)(record + 1);
+
+        LogQueueMessage msg;
+        msg.seq = record->seq;
+        msg.utcTime = (time_t)record->utcTime;
+        msg.pid = record->pid;
+        msg.type = (LogType)record->type;
+        msg.line = record->line;
+        msg.project = strings;
+        msg.file = msg.project + record->projectLength + 1;
+        msg.text = msg.file + record->fileLength + 1;
+        msg.textLength = (size_t)record->textLength;
+
+        m_Batch.push_back(msg);
+      }
+
+      tail += record->size;
+    }
+
+    if(tail != ring->tail)
+      m_Consumed.push_back({ring, tail});
+  }
+
+  // messages from different threads are interleaved, put them back in the order they were queued
+  std::sort(m_Batch.begin(), m_Batch.end(),
+            [](const LogQueueMessage &a, const LogQueueMessage &b) { return a.seq < b.seq; });
+
+  size_t count = m_Batch.size();
+
+  if(count > 0)
+    m_Sink(m_Batch);
+
+  m_Batch.clear();
+
+  // the messages pointed into the rings, so the space can only be reused now
+  for(const rdcpair<Ring *, int64_t> &consumed : m_Consumed)
+    Atomic::ExchAdd64(&consumed.first->tail, consumed.second - consumed.first->tail);
+  m_Consumed.clear();
+
+  m_DrainingThread = 0;
+
+  return count;
+}
+
+void LogQueue::Flush()
+{
+  // the sink may log while writing, in which case we're already draining
+  if(m_DrainingThread == Threading::GetCurrentID())
+    return;
+
+  Drain();
+}
+
+void LogQueue::Stop()
+{
+  if(Atomic::CmpExch32(&m_Stopped, 0, 1) != 0)
+    return;
+
+  // wait for any pushes that started before we stopped to land in their rings
+  while(m_Pushing > 0)
+    Threading::Sleep(0);
+
+  if(m_DrainThread)
+  {
+    WakeDrainThread();
+
+    // this can happen during module unload where joining could deadlock, so wait a bounded time
+    // for the thread to exit.
+    for(int i = 0; i < 1000 && m_DrainRunning > 0; i++)
+      Threading::Sleep(1);
+
+    Threading::CloseThread(m_DrainThread);
+    m_DrainThread = 0;
+  }
+
+  Drain();
+}
+
+void LogQueue::WakeDrainThread()
+{
+  // only the first message after the drain thread goes idle needs to wake it, after that it picks
+  // up messages in batches until the rings are empty
+  if(m_DrainSleeping && Atomic::CmpExch32(&m_DrainSleeping, 1, 0) == 1)
+    m_WakeDrain.Release(1);
+}
+
+void LogQueue::DrainThreadMain()
+{
+  Threading::SetCurrentThreadName("LogQueue");
+
+  for(;;)
+  {
+    size_t drained = Drain();
+
+    if(m_Stopped)
+      break;
+
+    if(drained > 0)
+    {
+      // give more messages a chance to arrive so they can be written together
+      Threading::Sleep(BatchIntervalMS);
+      continue;
+    }
+
+    Atomic::CmpExch32(&m_DrainSleeping, 0, 1);
+
+    // check again now that we're marked as sleeping, in case a message was pushed after we drained
+    // but before the pusher could see us.
+    if(Pending() || m_Stopped)
+    {
+      // if a pusher already cleared the flag they've released the semaphore for us, so consume that
+      if(Atomic::CmpExch32(&m_DrainSleeping, 1, 0) != 1)
+        m_WakeDrain.Acquire();
+
+      continue;
+    }
+
+    m_WakeDrain.Acquire();
+  }
+
+  Atomic::Dec32(&m_DrainRunning);
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+#include "common/formatting.h"
+
+TEST_CASE("Test log queue", "[logging]")
+{
+  rdcarray<rdcstr> received;
+  // whether every batch so far was in queue order. Messages from different threads can be split
+  // across batches if one was still being pushed when the other was drained, so this is only
+  // guaranteed within a batch
+  bool batchesOrdered = true;
+  int32_t batches = 0;
+
+  LogQueue::Sink sink = [&](const rdcarray<LogQueueMessage> &messages) {
+    batches++;
+    for(size_t i = 0; i < messages.size(); i++)
+    {
+      const LogQueueMessage &msg = messages[i];
+      CHECK(strlen(msg.text) == msg.textLength);
+      received.push_back(StringFormat::Fmt("%s|%s|%u|%u|%s", msg.project, msg.file, msg.line,
+                                           (uint32_t)msg.type, msg.text));
+      if(i > 0 && messages[i - 1].seq >= msg.seq)
+        batchesOrdered = false;
+    }
+  };
+
+  SECTION("Messages from many threads are all written in order")
+  {
+    // a small ring so that it wraps and fills up
+    LogQueue queue(sink, 4096);
+
+    const int numThreads = 8;
+    const int numMessages = 500;
+
+    rdcarray<Threading::ThreadHandle> threads;
+    for(int t = 0; t < numThreads; t++)
+    {
+      threads.push_back(Threading::CreateThread([&queue, t]() {
+        for(int i = 0; i < numMessages; i++)
+        {
+          rdcstr text = StringFormat::Fmt("thread %d message %d", t, i);
+
+          // vary the length so records land at different places in the ring
+          text += rdcstr(" ......................................", i % 37);
+
+          bool pushed = queue.Push(0, 1234, LogType::Comment, "TEST", "file.cpp", uint32_t(t),
+                                   text.c_str(), text.size());
+          CHECK(pushed);
+        }
+      }));
+    }
+
+    for(Threading::ThreadHandle t : threads)
+    {
+      Threading::JoinThread(t);
+      Threading::CloseThread(t);
+    }
+
+    queue.Flush();
+
+    REQUIRE(received.size() == numThreads * numMessages);
+
+    CHECK(batchesOrdered);
+
+    // each thread's messages arrive in the order that thread logged them
+    int next[numThreads] = {};
+    for(const rdcstr &msg : received)
+    {
+      int t = -1, i = -1;
+      REQUIRE(msg.beginsWith("TEST|file.cpp|"));
+      sscanf(msg.c_str(), "TEST|file.cpp|%*u|%*u|thread %d message %d", &t, &i);
+
+      REQUIRE(t >= 0);
+      REQUIRE(t < numThreads);
+      CHECK(i == next[t]);
+      next[t] = i + 1;
+    }
+  };
+
+  SECTION("Rings are reused once their thread exits")
+  {
+    LogQueue queue(sink, 4096);
+
+    // more threads than there are rings, but only a couple alive at once
+    const int numThreads = 200;
+
+    for(int t = 0; t < numThreads; t += 2)
+    {
+      Threading::ThreadHandle threads[2];
+      for(int i = 0; i < 2; i++)
+      {
+        threads[i] = Threading::CreateThread([&queue, t, i]() {
+          rdcstr text = StringFormat::Fmt("thread %d", t + i);
+          CHECK(queue.Push(0, 1, LogType::Comment, "PROJ", "a.cpp", 1, text.c_str(), text.size()));
+        });
+      }
+
+      for(int i = 0; i < 2; i++)
+      {
+        Threading::JoinThread(threads[i]);
+        Threading::CloseThread(threads[i]);
+      }
+    }
+
+    queue.Flush();
+
+    CHECK(received.size() == numThreads);
+    CHECK(queue.GetRingCount() <= 2);
+  };
+
+  SECTION("Flushing writes synchronously")
+  {
+    LogQueue queue(sink);
+
+    CHECK(queue.Push(0, 1, LogType::Warning, "PROJ", "a.cpp", 10, "first", 5));
+    CHECK(queue.Push(0, 1, LogType::Error, "PROJ", "b.cpp", 20, "second\nline", 11));
+
+    queue.Flush();
+
+    REQUIRE(received.size() == 2);
+    CHECK(received[0] == "PROJ|a.cpp|10|2|first");
+    CHECK(received[1] == "PROJ|b.cpp|20|3|second\nline");
+  };
+
+  SECTION("Messages that can't be queued are rejected")
+  {
+    LogQueue queue(sink, 4096);
+
+    rdcstr big;
+    big.fill(2000, 'x');
+    CHECK_FALSE(queue.Push(0, 1, LogType::Comment, "PROJ", "a.cpp", 1, big.c_str(), big.size()));
+
+    CHECK(queue.Push(0, 1, LogType::Comment, "PROJ", "a.cpp", 1, "queued", 6));
+
+    queue.Stop();
+
+    // stopping drains anything left
+    REQUIRE(received.size() == 1);
+    CHECK(received[0] == "PROJ|a.cpp|1|1|queued");
+
+    CHECK_FALSE(queue.Push(0, 1, LogType::Comment, "PROJ", "a.cpp", 1, "stopped", 7));
+
+    queue.Flush();
+    CHECK(received.size() == 1);
+  };
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -0,0 +1,142 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include "api/replay/rdcarray.h"
+#include "api/replay/rdcpair.h"
+#include "common/common.h"
+#include "common/threading.h"
+
+struct LogQueueMessage
+{
+  // order the message was queued in, across all threads
+  uint64_t seq;
+  time_t utcTime;
+  uint32_t pid;
+  LogType type;
+  uint32_t line;
+  // NULL-terminated strings, only valid while the sink is processing the batch
+  const char *project;
+  const char *file;
+  const char *text;
+  size_t textLength;
+};
+
+// Queues log messages to be written out on a background thread, so that threads logging at the
+// same time don't serialise against each other and don't each pay for writing to the log.
+//
+// Each thread that logs gets its own single-producer ring buffer, so queueing a message takes no
+// locks. The message text must already be formatted since arguments can't be kept past the call,
+// but everything else (prefixes, timestamps, splitting lines) is left to the sink. The background
+// thread drains all the rings into one batch in queue order and passes it to the sink, so that
+// writes can be combined. Each thread's messages are always written in the order it pushed them,
+// but a message that's still being pushed when a batch is drained lands in the next batch even if
+// another thread queued a later one in time for this batch.
+class LogQueue
+{
+public:
+  typedef std::function<void(const rdcarray<LogQueueMessage> &)> Sink;
+
+  LogQueue(Sink sink, uint32_t ringSize = 64 * 1024);
+  ~LogQueue();
+
+  // copies the message into the calling thread's ring. If it can't be queued - because it's too
+  // large for a ring or the queue has been stopped - this returns false and the caller should write
+  // it directly after calling Flush() so that it stays in order.
+  bool Push(time_t utcTime, uint32_t pid, LogType type, const char *project, const char *file,
+            uint32_t line, const char *text, size_t textLength);
+
+  // drains everything queued so far through the sink before returning
+  void Flush();
+
+  // stops the background thread and drains anything left. Subsequent pushes fail.
+  void Stop();
+
+  // the number of per-thread rings that have been allocated
+  int32_t GetRingCount();
+
+private:
+  struct Ring
+  {
+    byte *data = NULL;
+    // producer and consumer positions, only ever increasing. Only the producer writes head and only
+    // the consumer writes tail.
+    int64_t head = 0;
+    int64_t tail = 0;
+  };
+
+  // the number of rings that can be owned by threads at once. Rings are given back when their
+  // thread exits, past this many live threads the rest share one ring under a lock
+  static const int32_t MaxRings = 64;
+
+  // the rings owned by the current thread, which gives them back when it exits
+  struct ThreadRings;
+  static thread_local ThreadRings threadRings;
+  // set once threadRings has been destroyed, anything logged after that uses the shared ring. This
+  // has no destructor so it can still be read then.
+  static thread_local bool threadRingsReleased;
+
+  Ring *GetRing();
+  void ReleaseRing(Ring *ring);
+  bool Write(Ring *ring, time_t utcTime, uint32_t pid, LogType type, const char *project,
+             const char *file, uint32_t line, const char *text, size_t textLength);
+  bool Pending();
+  size_t Drain();
+  void WakeDrainThread();
+  void DrainThreadMain();
+
+  Sink m_Sink;
+  uint32_t m_RingSize;
+  // unique for each queue, so that exiting threads can tell if the queue they used still exists
+  uint64_t m_ID;
+
+  Ring *m_Rings[MaxRings] = {};
+  int32_t m_NumRings = 0;
+
+  // rings given back by exited threads, protects allocating new rings too
+  Threading::SpinLock m_FreeLock;
+  rdcarray<Ring *> m_FreeRings;
+
+  Threading::SpinLock m_SharedLock;
+  Ring m_SharedRing;
+
+  int64_t m_Seq = 0;
+
+  // serialises draining, so there's only one consumer for each ring
+  Threading::CriticalSection m_DrainLock;
+  uint64_t m_DrainingThread = 0;
+  rdcarray<LogQueueMessage> m_Batch;
+  rdcarray<rdcpair<Ring *, int64_t>> m_Consumed;
+
+  Threading::ThreadHandle m_DrainThread = 0;
+  Threading::Semaphore m_WakeDrain;
+  int32_t m_DrainSleeping = 0;
+  int32_t m_DrainRunning = 0;
+
+  int32_t m_Stopped = 0;
+  // pushes that are in progress, so that stopping can wait for them to finish
+  int32_t m_Pushing = 0;
+};
@@ -0,0 +1,682 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "memory_diff.h"
+#include <string.h>
+#include "common/common.h"
+#include "common/jobsystem.h"
+#include "core/settings.h"
+
+RDOC_CONFIG(uint32_t, Capture_MapDiffMergeGap, 1024,
+            "When flushing mapped memory during capture, differences separated by no more than "
+            "this many unchanged bytes are flushed together rather than as separate ranges.");
+
+#if defined(_M_X64) || defined(__x86_64__)
+
+#define DIFF_SIMD_X86 OPTION_ON
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define DIFF_TARGET(isa)
+#else
+#define DIFF_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#else
+
+#define DIFF_SIMD_X86 OPTION_OFF
+
+#endif
+
+// buffers are compared in blocks of this size, which is one full-width AVX-512 compare
+static const size_t DiffBlockSize = 64;
+
+// when searching backwards, blocks are scanned forwards in windows of this many blocks
+static const size_t BackwardWindowBlocks = 64;
+
+// buffers at least this big are split into chunks that are compared in parallel
+static const size_t ParallelDiffThreshold = 8 * 1024 * 1024;
+static const size_t ParallelDiffChunkSize = 1024 * 1024;
+
+// returns how many blocks from the start either all differ or are all identical, depending on
+// differ. This is the only part that touches every byte so it's what gets vectorised.
+typedef size_t (*CountBlocksFunc)(const byte *a, const byte *b, size_t numBlocks, bool differ);
+
+static size_t CountBlocks_Generic(const byte *a, const byte *b, size_t numBlocks, bool differ)
+{
+  for(size_t i = 0; i < numBlocks; i++, a += DiffBlockSize, b += DiffBlockSize)
+  {
+    uint64_t x = 0;
+    for(size_t w = 0; w < DiffBlockSize; w += sizeof(uint64_t))
+    {
+      uint64_t aw, bw;
+      memcpy(&aw, a + w, sizeof(aw));
+      memcpy(&bw, b + w, sizeof(bw));
+      x |= aw ^ bw;
+    }
+
+    if((x != 0) != differ)
+      return i;
+  }
+
+  return numBlocks;
+}
+
+#if ENABLED(DIFF_SIMD_X86)
+
+// SSE2 is part of x64 so this is always available
+static size_t CountBlocks_SSE2(const byte *a, const byte *b, size_t numBlocks, bool differ)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  for(size_t i = 0; i < numBlocks; i++, a += DiffBlockSize, b += DiffBlockSize)
+  {
+    __m128i x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + 0)),
+                               _mm_loadu_si128((const __m128i *)(b + 0)));
+    __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + 16)),
+                               _mm_loadu_si128((const __m128i *)(b + 16)));
+    __m128i x2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + 32)),
+                               _mm_loadu_si128((const __m128i *)(b + 32)));
+    __m128i x3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + 48)),
+                               _mm_loadu_si128((const __m128i *)(b + 48)));
+
+    __m128i x = _mm_or_si128(_mm_or_si128(x0, x1), _mm_or_si128(x2, x3));
+
+    bool blockDiffers = _mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)) != 0xffff;
+
+    if(blockDiffers != differ)
+      return i;
+  }
+
+  return numBlocks;
+}
+
+DIFF_TARGET("avx2")
+static size_t CountBlocks_AVX2(const byte *a, const byte *b, size_t numBlocks, bool differ)
+{
+  for(size_t i = 0; i < numBlocks; i++, a += DiffBlockSize, b += DiffBlockSize)
+  {
+    __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + 0)),
+                                  _mm256_loadu_si256((const __m256i *)(b + 0)));
+    __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + 32)),
+                                  _mm256_loadu_si256((const __m256i *)(b + 32)));
+
+    __m256i x = _mm256_or_si256(x0, x1);
+
+    bool blockDiffers = _mm256_testz_si256(x, x) == 0;
+
+    if(blockDiffers != differ)
+      return i;
+  }
+
+  return numBlocks;
+}
+
+DIFF_TARGET("avx512f")
+static size_t CountBlocks_AVX512(const byte *a, const byte *b, size_t numBlocks, bool differ)
+{
+  for(size_t i = 0; i < numBlocks; i++, a += DiffBlockSize, b += DiffBlockSize)
+  {
+    __mmask8 mask = _mm512_cmpneq_epi64_mask(_mm512_loadu_si512((const void *)a),
+                                             _mm512_loadu_si512((const void *)b));
+
+    if((mask != 0) != differ)
+      return i;
+  }
+
+  return numBlocks;
+}
+
+#if defined(_MSC_VER)
+
+static uint64_t EnabledXSaveFeatures()
+{
+  int info[4];
+  __cpuid(info, 1);
+
+  // OSXSAVE must be set before xgetbv can be used
+  if((info[2] & (1 << 27)) == 0)
+    return 0;
+
+  return _xgetbv(0);
+}
+
+static bool CPUSupportsAVX2()
+{
+  int info[4];
+  __cpuid(info, 0);
+  if(info[0] < 7)
+    return false;
+
+  // the OS must save the XMM and YMM state
+  if((EnabledXSaveFeatures() & 0x6) != 0x6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+}
+
+static bool CPUSupportsAVX512()
+{
+  int info[4];
+  __cpuid(info, 0);
+  if(info[0] < 7)
+    return false;
+
+  // as well as XMM and YMM the OS must save the opmask and both halves of the ZMM state
+  if((EnabledXSaveFeatures() & 0xe6) != 0xe6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 16)) != 0;
+}
+
+#else
+
+// these check the OS has enabled the register state as well as the CPU feature bits
+static bool CPUSupportsAVX2()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+}
+
+static bool CPUSupportsAVX512()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f") != 0;
+}
+
+#endif
+
+#endif    // ENABLED(DIFF_SIMD_X86)
+
+struct DiffKernel
+{
+  const char *name;
+  CountBlocksFunc func;
+  bool supported;
+};
+
+// returns the kernels built in, widest first
+static rdcarray<DiffKernel> EnumerateDiffKernels()
+{
+  rdcarray<DiffKernel> ret;
+#if ENABLED(DIFF_SIMD_X86)
+  ret.push_back({"AVX-512", &CountBlocks_AVX512, CPUSupportsAVX512()});
+  ret.push_back({"AVX2", &CountBlocks_AVX2, CPUSupportsAVX2()});
+  ret.push_back({"SSE2", &CountBlocks_SSE2, true});
+#endif
+  ret.push_back({"generic", &CountBlocks_Generic, true});
+  return ret;
+}
+
+static CountBlocksFunc ChooseDiffKernel()
+{
+  for(const DiffKernel &kernel : EnumerateDiffKernels())
+  {
+    if(kernel.supported)
+    {
+      RDCDEBUG("Using %s kernel for memory diffs", kernel.name);
+      return kernel.func;
+    }
+  }
+
+  return &CountBlocks_Generic;
+}
+
+static CountBlocksFunc GetCountBlocks()
+{
+  static CountBlocksFunc func = ChooseDiffKernel();
+  return func;
+}
+
+// returns the offset of the first differing byte in [start, end), or end if there is none
+static size_t FirstDiffByte(const byte *a, const byte *b, size_t start, size_t end)
+{
+  while(start < end && a[start] == b[start])
+    start++;
+  return start;
+}
+
+// returns one past the offset of the last differing byte in [start, end), or start if there is none
+static size_t LastDiffByte(const byte *a, const byte *b, size_t start, size_t end)
+{
+  while(end > start && a[end - 1] == b[end - 1])
+    end--;
+  return end;
+}
+
+// returns one past the last differing block in [firstBlock, endBlock), or firstBlock if there is
+// none. The kernels only scan forwards so this steps back a window at a time.
+static size_t LastDiffBlock(CountBlocksFunc countBlocks, const byte *a, const byte *b,
+                            size_t firstBlock, size_t endBlock)
+{
+  size_t windowEnd = endBlock;
+
+  while(windowEnd > firstBlock)
+  {
+    size_t windowStart = windowEnd - RDCMIN(windowEnd - firstBlock, BackwardWindowBlocks);
+
+    size_t last = windowStart;
+    size_t blk = windowStart;
+    while(blk < windowEnd)
+    {
+      blk += countBlocks(a + blk * DiffBlockSize, b + blk * DiffBlockSize, windowEnd - blk, false);
+      if(blk >= windowEnd)
+        break;
+      blk += countBlocks(a + blk * DiffBlockSize, b + blk * DiffBlockSize, windowEnd - blk, true);
+      last = blk;
+    }
+
+    if(last > windowStart)
+      return last;
+
+    windowEnd = windowStart;
+  }
+
+  return firstBlock;
+}
+
+// appends a range, extending the previous one if they touch
+static void AppendRange(rdcarray<rdcpair<size_t, size_t>> &ranges, size_t start, size_t end)
+{
+  if(!ranges.empty() && ranges.back().second == start)
+    ranges.back().second = end;
+  else
+    ranges.push_back(make_rdcpair(start, end));
+}
+
+// appends the byte ranges covered by runs of differing blocks in [firstBlock, endBlock)
+static void FindDiffBlocks(const byte *a, const byte *b, size_t firstBlock, size_t endBlock,
+                           rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  CountBlocksFunc countBlocks = GetCountBlocks();
+
+  size_t blk = firstBlock;
+  while(blk < endBlock)
+  {
+    blk += countBlocks(a + blk * DiffBlockSize, b + blk * DiffBlockSize, endBlock - blk, false);
+    if(blk >= endBlock)
+      break;
+
+    size_t runStart = blk;
+    blk += countBlocks(a + blk * DiffBlockSize, b + blk * DiffBlockSize, endBlock - blk, true);
+
+    AppendRange(ranges, runStart * DiffBlockSize, blk * DiffBlockSize);
+  }
+}
+
+void FindDiffRanges(const void *a, const void *b, size_t bufSize, size_t mergeGap,
+                    rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  ranges.clear();
+
+  const byte *abyte = (const byte *)a;
+  const byte *bbyte = (const byte *)b;
+
+  const size_t numBlocks = bufSize / DiffBlockSize;
+  const size_t alignedSize = numBlocks * DiffBlockSize;
+
+  if(bufSize >= ParallelDiffThreshold)
+  {
+    const size_t chunkBlocks = ParallelDiffChunkSize / DiffBlockSize;
+    const uint32_t numChunks = uint32_t((numBlocks + chunkBlocks - 1) / chunkBlocks);
+
+    rdcarray<rdcarray<rdcpair<size_t, size_t>>> chunkRanges;
+    chunkRanges.resize(numChunks);
+
+    auto findChunk = [&](uint32_t chunk) {
+      size_t first = chunk * chunkBlocks;
+      FindDiffBlocks(abyte, bbyte, first, RDCMIN(first + chunkBlocks, numBlocks),
+                     chunkRanges[chunk]);
+    };
+
+    if(Threading::GetJobConcurrency() > 1)
+    {
+      Threading::ParallelFor(0, numChunks, findChunk, 1);
+    }
+    else
+    {
+      for(uint32_t chunk = 0; chunk < numChunks; chunk++)
+        findChunk(chunk);
+    }
+
+    // a run that crosses a chunk boundary is joined back up here
+    for(const rdcarray<rdcpair<size_t, size_t>> &chunk : chunkRanges)
+      for(const rdcpair<size_t, size_t> &range : chunk)
+        AppendRange(ranges, range.first, range.second);
+  }
+  else
+  {
+    FindDiffBlocks(abyte, bbyte, 0, numBlocks, ranges);
+  }
+
+  // any bytes past the last whole block
+  if(FirstDiffByte(abyte, bbyte, alignedSize, bufSize) < bufSize)
+    AppendRange(ranges, alignedSize, bufSize);
+
+  // a run of differing blocks can only hide an unchanged gap shorter than two blocks, so the runs
+  // only need to be searched within when the merge gap is smaller than that. Otherwise each is just
+  // trimmed to be byte-accurate, to comply with WRITE_NO_OVERWRITE.
+  const bool splitRuns = mergeGap < DiffBlockSize * 2;
+
+  rdcarray<rdcpair<size_t, size_t>> blockRanges;
+  blockRanges.swap(ranges);
+
+  for(const rdcpair<size_t, size_t> &blockRange : blockRanges)
+  {
+    size_t offs = blockRange.first;
+    while(offs < blockRange.second)
+    {
+      size_t start = FirstDiffByte(abyte, bbyte, offs, blockRange.second);
+
+      // the memory may be written concurrently, so the difference could be gone by now
+      if(start >= blockRange.second)
+        break;
+
+      size_t end;
+      if(splitRuns)
+      {
+        end = start + 1;
+        while(end < blockRange.second && abyte[end] != bbyte[end])
+          end++;
+      }
+      else
+      {
+        end = RDCMAX(LastDiffByte(abyte, bbyte, start, blockRange.second), start + 1);
+      }
+
+      offs = end;
+
+      if(!ranges.empty() && start - ranges.back().second <= mergeGap)
+        ranges.back().second = end;
+      else
+        ranges.push_back(make_rdcpair(start, end));
+    }
+  }
+}
+
+void FindDiffRanges(const void *a, const void *b, size_t bufSize,
+                    rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  FindDiffRanges(a, b, bufSize, Capture_MapDiffMergeGap(), ranges);
+}
+
+bool FindDiffRange(void *a, void *b, size_t bufSize, size_t &diffStart, size_t &diffEnd)
+{
+  diffStart = bufSize + 1;
+  diffEnd = 0;
+
+  const byte *abyte = (const byte *)a;
+  const byte *bbyte = (const byte *)b;
+
+  CountBlocksFunc countBlocks = GetCountBlocks();
+
+  const size_t numBlocks = bufSize / DiffBlockSize;
+  const size_t alignedSize = numBlocks * DiffBlockSize;
+
+  // sweep to find the start of differences, then make sure we're byte-accurate to comply with
+  // WRITE_NO_OVERWRITE
+  size_t firstBlock = countBlocks(abyte, bbyte, numBlocks, false);
+
+  size_t start = FirstDiffByte(abyte, bbyte, firstBlock * DiffBlockSize, bufSize);
+  if(start >= bufSize)
+    return false;
+
+  // check any bytes past the last whole block first, and if there are no differences there sweep
+  // back through the blocks.
+  size_t tailStart = RDCMAX(start, alignedSize);
+  size_t end = LastDiffByte(abyte, bbyte, tailStart, bufSize);
+
+  if(end == tailStart)
+  {
+    size_t endBlock = LastDiffBlock(countBlocks, abyte, bbyte, firstBlock, numBlocks);
+    end = LastDiffByte(abyte, bbyte, start, RDCMIN(endBlock * DiffBlockSize, tailStart));
+  }
+
+  diffStart = start;
+  // the memory may be written concurrently, so ensure the range is at least never inverted
+  diffEnd = RDCMAX(end, start + 1);
+
+  return true;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+// reference implementation, finds each maximal run of differing bytes
+static rdcarray<rdcpair<size_t, size_t>> NaiveDiffRanges(const byte *a, const byte *b,
+                                                         size_t bufSize, size_t mergeGap)
+{
+  rdcarray<rdcpair<size_t, size_t>> ret;
+  for(size_t i = 0; i < bufSize; i++)
+  {
+    if(a[i] == b[i])
+      continue;
+
+    if(!ret.empty() && i - ret.back().second <= mergeGap)
+      ret.back().second = i + 1;
+    else
+      ret.push_back(make_rdcpair(i, i + 1));
+  }
+  return ret;
+}
+
+static bool RangesMatch(const rdcarray<rdcpair<size_t, size_t>> &a,
+                        const rdcarray<rdcpair<size_t, size_t>> &b)
+{
+  return a == b;
+}
+
+TEST_CASE("Test memory diff kernels", "[memorydiff]")
+{
+  const size_t numBlocks = 64;
+
+  bytebuf a, b;
+  a.resize(numBlocks * DiffBlockSize + 1);
+  b.resize(numBlocks * DiffBlockSize + 1);
+
+  uint32_t seed = 1234;
+  for(size_t i = 0; i < a.size(); i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    a[i] = b[i] = byte(seed >> 16);
+  }
+
+  // differences in a scattering of blocks, at every byte position within a block
+  for(size_t blk = 0; blk < numBlocks; blk += 3)
+    b[blk * DiffBlockSize + (blk * 7) % DiffBlockSize] ^= 0x80;
+
+  for(const DiffKernel &kernel : EnumerateDiffKernels())
+  {
+    if(!kernel.supported)
+      continue;
+
+    INFO("kernel: " << kernel.name);
+
+    // compare from an unaligned pointer too, the kernels mustn't rely on alignment
+    for(size_t offs = 0; offs < 2; offs++)
+    {
+      const byte *pa = a.data() + offs;
+      const byte *pb = b.data() + offs;
+      const size_t blocks = numBlocks - offs;
+
+      for(size_t start = 0; start < blocks; start++)
+      {
+        bool differ = CountBlocks_Generic(pa + start * DiffBlockSize, pb + start * DiffBlockSize,
+                                          1, true) == 1;
+
+        CHECK(kernel.func(pa + start * DiffBlockSize, pb + start * DiffBlockSize, blocks - start,
+                          false) == CountBlocks_Generic(pa + start * DiffBlockSize,
+                                                        pb + start * DiffBlockSize,
+                                                        blocks - start, false));
+        CHECK(kernel.func(pa + start * DiffBlockSize, pb + start * DiffBlockSize, blocks - start,
+                          true) == CountBlocks_Generic(pa + start * DiffBlockSize,
+                                                       pb + start * DiffBlockSize, blocks - start,
+                                                       true));
+        CHECK((kernel.func(pa + start * DiffBlockSize, pb + start * DiffBlockSize, 1, true) == 1) ==
+              differ);
+      }
+    }
+  }
+};
+
+TEST_CASE("Test finding memory diff ranges", "[memorydiff]")
+{
+  rdcarray<rdcpair<size_t, size_t>> ranges;
+
+  SECTION("Identical buffers")
+  {
+    bytebuf a, b;
+    a.resize(1000);
+    b.resize(1000);
+
+    FindDiffRanges(a.data(), b.data(), a.size(), 0, ranges);
+    CHECK(ranges.empty());
+
+    size_t diffStart, diffEnd;
+    CHECK_FALSE(FindDiffRange(a.data(), b.data(), a.size(), diffStart, diffEnd));
+  };
+
+  SECTION("Ranges are byte-accurate and merged by the gap")
+  {
+    bytebuf a, b;
+    a.resize(4096 + 13);
+    b.resize(4096 + 13);
+
+    b[5] = 1;
+    b[6] = 1;
+    b[100] = 1;
+    b[130] = 1;
+    b[2000] = 1;
+    b[4096 + 12] = 1;
+
+    FindDiffRanges(a.data(), b.data(), a.size(), 0, ranges);
+
+    REQUIRE(ranges.size() == 5);
+    CHECK(ranges[0].first == 5);
+    CHECK(ranges[0].second == 7);
+    CHECK(ranges[1].first == 100);
+    CHECK(ranges[1].second == 101);
+    CHECK(ranges[2].first == 130);
+    CHECK(ranges[2].second == 131);
+    CHECK(ranges[3].first == 2000);
+    CHECK(ranges[3].second == 2001);
+    CHECK(ranges[4].first == 4096 + 12);
+    CHECK(ranges[4].second == 4096 + 13);
+
+    FindDiffRanges(a.data(), b.data(), a.size(), 29, ranges);
+
+    REQUIRE(ranges.size() == 4);
+    CHECK(ranges[1].first == 100);
+    CHECK(ranges[1].second == 131);
+
+    FindDiffRanges(a.data(), b.data(), a.size(), 100000, ranges);
+
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].first == 5);
+    CHECK(ranges[0].second == 4096 + 13);
+
+    size_t diffStart, diffEnd;
+    CHECK(FindDiffRange(a.data(), b.data(), a.size(), diffStart, diffEnd));
+    CHECK(diffStart == 5);
+    CHECK(diffEnd == 4096 + 13);
+  };
+
+  SECTION("Random differences match a reference")
+  {
+    uint32_t seed = 5678;
+    for(int iter = 0; iter < 50; iter++)
+    {
+      seed = seed * 1103515245 + 12345;
+      size_t bufSize = 1 + (seed >> 8) % 20000;
+
+      bytebuf a, b;
+      a.resize(bufSize);
+      b.resize(bufSize);
+
+      seed = seed * 1103515245 + 12345;
+      size_t numDiffs = (seed >> 8) % 40;
+      for(size_t d = 0; d < numDiffs; d++)
+      {
+        seed = seed * 1103515245 + 12345;
+        size_t offs = (seed >> 8) % bufSize;
+        seed = seed * 1103515245 + 12345;
+        size_t len = RDCMIN(bufSize - offs, size_t(1 + (seed >> 8) % 300));
+        for(size_t i = 0; i < len; i++)
+          b[offs + i] = byte(1 + (i & 0x7f));
+      }
+
+      for(size_t mergeGap : {0, 1, 64, 1000})
+      {
+        INFO("iteration " << iter << " size " << bufSize << " gap " << mergeGap);
+
+        FindDiffRanges(a.data(), b.data(), bufSize, mergeGap, ranges);
+        CHECK(RangesMatch(ranges, NaiveDiffRanges(a.data(), b.data(), bufSize, mergeGap)));
+      }
+
+      rdcarray<rdcpair<size_t, size_t>> all = NaiveDiffRanges(a.data(), b.data(), bufSize, ~0U);
+
+      size_t diffStart, diffEnd;
+      bool found = FindDiffRange(a.data(), b.data(), bufSize, diffStart, diffEnd);
+      CHECK(found == !all.empty());
+      if(found && !all.empty())
+      {
+        CHECK(diffStart == all[0].first);
+        CHECK(diffEnd == all[0].second);
+      }
+    }
+  };
+
+  SECTION("Large buffers compared in parallel")
+  {
+    const size_t bufSize = ParallelDiffThreshold * 2 + 17;
+
+    bytebuf a, b;
+    a.resize(bufSize);
+    b.resize(bufSize);
+
+    // a run crossing a chunk boundary, and some isolated differences
+    for(size_t i = ParallelDiffChunkSize - 100; i < ParallelDiffChunkSize + 100; i++)
+      b[i] = 1;
+    b[ParallelDiffChunkSize * 5 + 3] = 1;
+    b[ParallelDiffChunkSize * 5 + 1003] = 1;
+    b[bufSize - 1] = 1;
+
+    FindDiffRanges(a.data(), b.data(), bufSize, 0, ranges);
+    CHECK(RangesMatch(ranges, NaiveDiffRanges(a.data(), b.data(), bufSize, 0)));
+    REQUIRE(ranges.size() == 4);
+    CHECK(ranges[0].first == ParallelDiffChunkSize - 100);
+    CHECK(ranges[0].second == ParallelDiffChunkSize + 100);
+
+    FindDiffRanges(a.data(), b.data(), bufSize, 1000, ranges);
+    CHECK(RangesMatch(ranges, NaiveDiffRanges(a.data(), b.data(), bufSize, 1000)));
+    CHECK(ranges.size() == 3);
+  };
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
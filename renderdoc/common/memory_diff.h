@@ -0,0 +1,42 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/rdcarray.h"
+#include "api/replay/rdcpair.h"
+
+// Finds every range of bytes that differs between a and b, and replaces the contents of ranges with
+// them as byte-accurate [start, end) offsets in increasing order. Differences separated by no more
+// than mergeGap identical bytes are coalesced into one range, since each range usually costs a
+// flush or a chunk of its own and splitting over a small gap isn't worth it.
+//
+// Comparison is done with the widest vector instructions available at runtime, and large buffers
+// are compared in parallel on the job system.
+void FindDiffRanges(const void *a, const void *b, size_t bufSize, size_t mergeGap,
+                    rdcarray<rdcpair<size_t, size_t>> &ranges);
+
+// as above, using the configured merge gap for flushing mapped memory
+void FindDiffRanges(const void *a, const void *b, size_t bufSize,
+                    rdcarray<rdcpair<size_t, size_t>> &ranges);
@@ -26,6 +26,7 @@
 
 #include <map>
 #include "common/common.h"
+#include "serialise/parallelio.h"
 #include "serialise/streamio.h"
 #include "serialise/zstdio.h"
 
@@ -115,8 +116,9 @@ void SaveShaderCache(const char *filename, uint32_t magicNumber, uint32_t versio
 
   fileWriter.Write(uncompressedSize);
 
-  StreamWriter compressedWriter(new ZSTDCompressor(&fileWriter, Ownership::Nothing),
-                                Ownership::Stream);
+  StreamWriter compressedWriter(
+      new ParallelCompressor(&fileWriter, Ownership::Nothing, SectionFlags::ZstdCompressed),
+      Ownership::Stream);
 
   compressedWriter.Write(numentries);
 
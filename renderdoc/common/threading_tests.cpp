@@ -22,7 +22,10 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <algorithm>
+#include "common/jobsystem.h"
 #include "common/threading.h"
+#include "common/wrapped_pool.h"
 #include "os/os_specific.h"
 
 #if ENABLED(ENABLE_UNIT_TESTS)
@@ -31,6 +34,17 @@
 
 static int value = 0;
 
+// a deliberately small pool so that additional pools are needed
+struct PoolTestObject
+{
+  uint64_t thread;
+  uint64_t index;
+
+  ALLOCATE_WITH_WRAPPED_POOL(PoolTestObject, 64);
+};
+
+WRAPPED_POOL_INST(PoolTestObject);
+
 TEST_CASE("Test spin lock", "[threading]")
 {
   int finalValue = 0;
@@ -71,4 +85,200 @@ TEST_CASE("Test spin lock", "[threading]")
   CHECK(finalValue == value);
 }
 
+TEST_CASE("Test wrapped pool allocation across threads", "[threading]")
+{
+  const int numThreads = 8;
+  const int numObjects = 200;
+
+  rdcarray<Threading::ThreadHandle> threads;
+  rdcarray<rdcarray<PoolTestObject *>> objects;
+
+  threads.resize(numThreads);
+  objects.resize(numThreads);
+
+  for(int t = 0; t < numThreads; t++)
+  {
+    threads[t] = Threading::CreateThread([&objects, t]() {
+      rdcarray<PoolTestObject *> &objs = objects[t];
+
+      // allocate, free every other object, then allocate again so slots are recycled while other
+      // threads are allocating too
+      for(int i = 0; i < numObjects; i++)
+        objs.push_back(new PoolTestObject);
+
+      for(int i = 0; i < numObjects; i += 2)
+      {
+        delete objs[i];
+        objs[i] = new PoolTestObject;
+      }
+
+      for(int i = 0; i < numObjects; i++)
+      {
+        objs[i]->thread = t;
+        objs[i]->index = i;
+      }
+    });
+  }
+
+  for(Threading::ThreadHandle t : threads)
+  {
+    Threading::JoinThread(t);
+    Threading::CloseThread(t);
+  }
+
+  rdcarray<PoolTestObject *> all;
+  bool allOwned = true, allIntact = true;
+
+  for(int t = 0; t < numThreads; t++)
+  {
+    for(int i = 0; i < numObjects; i++)
+    {
+      PoolTestObject *obj = objects[t][i];
+      allOwned &= PoolTestObject::IsAlloc(obj);
+      allIntact &= (obj->thread == (uint64_t)t && obj->index == (uint64_t)i);
+      all.push_back(obj);
+    }
+  }
+
+  CHECK(allOwned);
+  CHECK(allIntact);
+
+  // no slot was handed out twice
+  std::sort(all.begin(), all.end());
+  CHECK(std::unique(all.begin(), all.end()) == all.end());
+
+  PoolTestObject onStack;
+  CHECK_FALSE(PoolTestObject::IsAlloc(&onStack));
+  CHECK_FALSE(PoolTestObject::IsAlloc(NULL));
+
+  for(PoolTestObject *obj : all)
+    delete obj;
+
+  // freed slots are reused rather than adding more pools
+  PoolTestObject *reused = new PoolTestObject;
+  CHECK(PoolTestObject::IsAlloc(reused));
+  delete reused;
+}
+
+TEST_CASE("Test job system", "[threading]")
+{
+  SECTION("Jobs in a group all complete before waiting returns")
+  {
+    int32_t count = 0;
+
+    Threading::JobGroup group;
+    for(int i = 0; i < 1000; i++)
+      group.Submit([&count]() { Atomic::Inc32(&count); });
+    group.Wait();
+
+    CHECK(group.IsComplete());
+    CHECK(count == 1000);
+
+    Threading::JobSystemStats stats = Threading::GetJobSystemStats();
+    CHECK(stats.numWorkers > 0);
+    CHECK(stats.executed >= 1000);
+    CHECK(stats.maxQueueDepth > 0);
+  };
+
+  SECTION("Jobs can submit and wait on other jobs")
+  {
+    int32_t count = 0;
+
+    Threading::JobGroup outer;
+    for(int i = 0; i < 16; i++)
+    {
+      outer.Submit([&count]() {
+        Threading::JobGroup inner;
+        for(int j = 0; j < 64; j++)
+          inner.Submit([&count]() { Atomic::Inc32(&count); });
+        inner.Wait();
+
+        CHECK(count >= 64);
+      });
+    }
+    outer.Wait();
+
+    CHECK(count == 16 * 64);
+  };
+
+  SECTION("Waiting threads wake for completion and for newly queued jobs")
+  {
+    int32_t count = 0;
+
+    // the waiter runs out of jobs and sleeps while these are still running, then more are queued
+    Threading::JobGroup group;
+    for(int i = 0; i < 4; i++)
+    {
+      group.Submit([&group, &count]() {
+        Threading::Sleep(20);
+        for(int j = 0; j < 8; j++)
+          group.Submit([&count]() { Atomic::Inc32(&count); });
+        Atomic::Inc32(&count);
+      });
+    }
+    group.Wait();
+
+    CHECK(count == 4 * 9);
+  };
+
+  SECTION("Parallel for visits every index once")
+  {
+    rdcarray<int32_t> visited;
+    visited.resize(10000);
+
+    Threading::ParallelFor(0, (uint32_t)visited.size(),
+                           [&visited](uint32_t i) { Atomic::Inc32(&visited[i]); });
+
+    bool allOnce = true;
+    for(int32_t v : visited)
+      allOnce &= (v == 1);
+    CHECK(allOnce);
+
+    // explicit grain sizes that don't divide the range evenly, and a range not starting at 0
+    for(uint32_t grain : {1U, 7U, 20000U})
+    {
+      int32_t count = 0;
+      Threading::ParallelFor(100, 1100, [&count](uint32_t) { Atomic::Inc32(&count); }, grain);
+      CHECK(count == 1000);
+    }
+
+    int32_t count = 0;
+    Threading::ParallelFor(5, 5, [&count](uint32_t) { Atomic::Inc32(&count); });
+    CHECK(count == 0);
+  };
+
+  SECTION("Continuations run after the group completes")
+  {
+    rdcarray<int32_t> values;
+    values.resize(256);
+
+    Threading::JobGroup producers;
+    Threading::JobGroup consumer;
+
+    for(size_t i = 0; i < values.size(); i++)
+      producers.Submit([&values, i]() { values[i] = int32_t(i); });
+
+    int32_t sum = -1;
+    producers.Then(consumer, [&values, &sum]() {
+      int32_t total = 0;
+      for(int32_t v : values)
+        total += v;
+      sum = total;
+    });
+
+    // waiting on the consumer waits for the producers too
+    consumer.Wait();
+
+    CHECK(producers.IsComplete());
+    CHECK(sum == 255 * 256 / 2);
+
+    // a continuation on a completed group is queued immediately
+    bool ran = false;
+    producers.Then(consumer, [&ran]() { ran = true; });
+    consumer.Wait();
+
+    CHECK(ran);
+  };
+}
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -48,65 +48,39 @@ public:
   typedef C Type;
 };
 
-// allocate each class in its own pool so we can identify the type by the pointer
+// allocate each class in its own pool so we can identify the type by the pointer.
+//
+// Allocating and freeing is lock-free, each pool keeps its free slots in a lock-free stack. The
+// lock is only taken when every slot in the pools we know about is in use, to add another pool.
+// Addresses are divided into power-of-two spans at least as large as a pool, so each additional
+// pool overlaps at most two spans. The pool containing a pointer can then be found from its
+// address via a small hash table keyed by span, rather than searching.
 template <typename WrapType, int PoolCount = 8192, int MaxPoolByteSize = 1024 * 1024, bool DebugClear = true>
 class WrappingPool
 {
 public:
   void *Allocate()
   {
-    SCOPED_LOCK(m_Lock);
-
     // try and allocate from immediate pool
     void *ret = m_ImmediatePool.Allocate();
     if(ret != NULL)
       return ret;
 
-    // fall back to additional pools, if there are any
-    for(size_t i = 0; i < m_AdditionalPools.size(); i++)
+    // then the additional pool we last allocated from, if there is one
+    ItemPool *pool = (ItemPool *)LoadPtr((void **)&m_CurrentPool);
+    if(pool)
     {
-      ret = m_AdditionalPools[i]->Allocate();
+      ret = pool->Allocate();
       if(ret != NULL)
         return ret;
     }
 
-// warn when we need to allocate an additional pool
-#if ENABLED(INCLUDE_TYPE_NAMES)
-    RDCWARN("Ran out of free slots in %s pool!", GetTypeName<WrapType>::Name());
-#else
-    RDCWARN("Ran out of free slots in pool 0x%p!", &m_ImmediatePool.items[0]);
-#endif
-
-    // allocate a new additional pool and use that to allocate from
-    m_AdditionalPools.push_back(new ItemPool());
-
-#if ENABLED(INCLUDE_TYPE_NAMES)
-    RDCDEBUG("WrappingPool[%d]<%s>: %p -> %p", (uint32_t)m_AdditionalPools.size() - 1,
-             GetTypeName<WrapType>::Name(), &m_AdditionalPools.back()->items[0],
-             &m_AdditionalPools.back()->items[AllocCount - 1]);
-#endif
-
-    return m_AdditionalPools.back()->Allocate();
+    return AllocateSlow();
   }
 
   bool IsAlloc(const void *p)
   {
-    // we can check the immediate pool without locking
-    if(m_ImmediatePool.IsAlloc(p))
-      return true;
-
-    // if we have additional pools, lock and check them.
-    // TODO: Check for additional pools in a lock-free manner,
-    // to prevent the cost of locking if there are no more pools.
-    {
-      SCOPED_LOCK(m_Lock);
-
-      for(size_t i = 0; i < m_AdditionalPools.size(); i++)
-        if(m_AdditionalPools[i]->IsAlloc(p))
-          return true;
-    }
-
-    return false;
+    return m_ImmediatePool.IsAlloc(p) || FindAdditionalPool(p) != NULL;
   }
 
   void Deallocate(void *p)
@@ -114,25 +88,19 @@ public:
     if(p == NULL)
       return;
 
-    SCOPED_LOCK(m_Lock);
-
     // try immediate pool
     if(m_ImmediatePool.IsAlloc(p))
     {
       m_ImmediatePool.Deallocate(p);
       return;
     }
-    else if(!m_AdditionalPools.empty())
+
+    // fall back and try additional pools
+    ItemPool *pool = FindAdditionalPool(p);
+    if(pool)
     {
-      // fall back and try additional pools
-      for(size_t i = 0; i < m_AdditionalPools.size(); i++)
-      {
-        if(m_AdditionalPools[i]->IsAlloc(p))
-        {
-          m_AdditionalPools[i]->Deallocate(p);
-          return;
-        }
-      }
+      pool->Deallocate(p);
+      return;
     }
 
 // this is an error - deleting an object that we don't recognise
@@ -150,8 +118,15 @@ public:
   static const size_t AllocByteSize;
 
 private:
+  struct ItemPool;
+
   WrappingPool()
   {
+    // spans are the smallest power of two that fits a pool
+    m_PoolSpanShift = 0;
+    while((size_t(1) << m_PoolSpanShift) < AllocCount * AllocByteSize)
+      m_PoolSpanShift++;
+
 #if ENABLED(INCLUDE_TYPE_NAMES)
     // hack - print in kB because float printing relies on statics that might not be initialised
     // yet in loading order. Ugly :(
@@ -166,8 +141,143 @@ private:
       delete m_AdditionalPools[i];
 
     m_AdditionalPools.clear();
+
+    for(size_t i = 0; i < m_PoolTables.size(); i++)
+    {
+      delete[] m_PoolTables[i]->slots;
+      delete m_PoolTables[i];
+    }
+
+    m_PoolTables.clear();
   }
 
+  void *AllocateSlow()
+  {
+    SCOPED_LOCK(m_Lock);
+
+    // another thread may have freed slots or added a pool while we waited for the lock
+    void *ret = m_ImmediatePool.Allocate();
+    if(ret != NULL)
+      return ret;
+
+    for(size_t i = 0; i < m_AdditionalPools.size(); i++)
+    {
+      ret = m_AdditionalPools[i]->Allocate();
+      if(ret != NULL)
+      {
+        StorePtr((void **)&m_CurrentPool, m_AdditionalPools[i]);
+        return ret;
+      }
+    }
+
+// warn when we need to allocate an additional pool
+#if ENABLED(INCLUDE_TYPE_NAMES)
+    RDCWARN("Ran out of free slots in %s pool!", GetTypeName<WrapType>::Name());
+#else
+    RDCWARN("Ran out of free slots in pool 0x%p!", &m_ImmediatePool.items[0]);
+#endif
+
+    // allocate a new additional pool and use that to allocate from
+    ItemPool *pool = new ItemPool();
+    m_AdditionalPools.push_back(pool);
+    AddToPoolTable(pool);
+
+#if ENABLED(INCLUDE_TYPE_NAMES)
+    RDCDEBUG("WrappingPool[%d]<%s>: %p -> %p", (uint32_t)m_AdditionalPools.size() - 1,
+             GetTypeName<WrapType>::Name(), &m_AdditionalPools.back()->items[0],
+             &m_AdditionalPools.back()->items[AllocCount - 1]);
+#endif
+
+    StorePtr((void **)&m_CurrentPool, pool);
+
+    return pool->Allocate();
+  }
+
+  // open-addressed hash table from span to the additional pools overlapping it, with one entry for
+  // each span a pool overlaps. It's only modified under the lock, and when it needs to grow a new
+  // table is published and the old one kept alive in case another thread is still looking through
+  // it.
+  struct PoolTable
+  {
+    size_t mask;
+    ItemPool **slots;
+  };
+
+  ItemPool *FindAdditionalPool(const void *p) const
+  {
+    PoolTable *table = (PoolTable *)LoadPtr((void **)&m_PoolTable);
+    if(table == NULL)
+      return NULL;
+
+    // the table is never full, so we always reach an empty slot
+    size_t hash = size_t(uintptr_t(p) >> m_PoolSpanShift);
+    for(size_t i = 0;; i++)
+    {
+      ItemPool *pool = (ItemPool *)LoadPtr((void **)&table->slots[(hash + i) & table->mask]);
+      if(pool == NULL)
+        return NULL;
+      if(pool->IsAlloc(p))
+        return pool;
+    }
+  }
+
+  void InsertIntoPoolTable(PoolTable *table, ItemPool *pool, size_t span)
+  {
+    for(size_t i = 0;; i++)
+    {
+      void **slot = (void **)&table->slots[(span + i) & table->mask];
+      if(*slot == NULL)
+      {
+        // publish with a barrier so the pool is fully constructed before anyone can find it
+        Atomic::CmpExchPtr(slot, NULL, pool);
+        return;
+      }
+    }
+  }
+
+  void InsertIntoPoolTable(PoolTable *table, ItemPool *pool)
+  {
+    // a pool is no larger than a span, so it starts and ends in the same or adjacent spans
+    size_t first = size_t(uintptr_t(&pool->items[0]) >> m_PoolSpanShift);
+    size_t last =
+        size_t((uintptr_t(&pool->items[0]) + AllocCount * AllocByteSize - 1) >> m_PoolSpanShift);
+
+    InsertIntoPoolTable(table, pool, first);
+    if(last != first)
+      InsertIntoPoolTable(table, pool, last);
+  }
+
+  void AddToPoolTable(ItemPool *pool)
+  {
+    PoolTable *table = m_PoolTable;
+
+    // keep the table at most half full with up to two entries per pool, m_AdditionalPools already
+    // contains the new pool
+    if(table == NULL || m_AdditionalPools.size() * 4 > table->mask + 1)
+    {
+      size_t size = table ? (table->mask + 1) * 2 : 16;
+
+      table = new PoolTable;
+      table->mask = size - 1;
+      table->slots = new ItemPool *[size];
+      memset(table->slots, 0, sizeof(ItemPool *) * size);
+
+      for(size_t i = 0; i < m_AdditionalPools.size(); i++)
+        InsertIntoPoolTable(table, m_AdditionalPools[i]);
+
+      m_PoolTables.push_back(table);
+      StorePtr((void **)&m_PoolTable, table);
+      return;
+    }
+
+    InsertIntoPoolTable(table, pool);
+  }
+
+  // pointers read without the lock are loaded and stored with barriers, so whatever they point to
+  // is seen fully constructed. Stores are only done under the lock.
+  static void *LoadPtr(void **ptr) { return Atomic::CmpExchPtr(ptr, NULL, NULL); }
+  static void StorePtr(void **ptr, void *val) { Atomic::CmpExchPtr(ptr, *ptr, val); }
+
   Threading::CriticalSection m_Lock;
 
   struct ItemPool
@@ -175,26 +285,42 @@ private:
     ItemPool()
     {
       items = (WrapType *)(new uint8_t[AllocCount * AllocByteSize]);
-      freeStack = new int[AllocCount];
-      for(int i = 0; i < (int)AllocCount; ++i)
+
+      // free slots form a linked list through next[], terminated by AllocCount
+      next = new uint32_t[AllocCount];
+      for(uint32_t i = 0; i < (uint32_t)AllocCount; ++i)
       {
-        freeStack[i] = i;
+        next[i] = i + 1;
       }
-      freeStackHead = AllocCount;
+      head = 0;
     }
     ~ItemPool()
     {
       delete[](uint8_t *) items;
-      delete[] freeStack;
+      delete[] next;
     }
     void *Allocate()
     {
-      if(freeStackHead == 0)
+      int64_t oldHead = head;
+
+      for(;;)
       {
-        return NULL;
+        uint32_t idx = uint32_t(oldHead & 0xffffffff);
+        if(idx >= AllocCount)
+          return NULL;
+
+        // next[idx] may be stale if another thread takes idx first, but then the tag has changed
+        // and the exchange will fail.
+        int64_t newHead = NextTag(oldHead) | next[idx];
+        int64_t prevHead = Atomic::CmpExch64(&head, oldHead, newHead);
+
+        if(prevHead == oldHead)
+          break;
+
+        oldHead = prevHead;
       }
-      --freeStackHead;
-      void *ret = items + freeStack[freeStackHead];
+
+      void *ret = items + uint32_t(oldHead & 0xffffffff);
 
 #if ENABLED(RDOC_DEVEL)
       memset(ret, 0xb0, AllocByteSize);
@@ -215,25 +341,52 @@ private:
       }
 #endif
 
-      int idx = (int)((WrapType *)p - &items[0]);
-
-      freeStack[freeStackHead] = idx;
-      ++freeStackHead;
+      uint32_t idx = (uint32_t)((WrapType *)p - &items[0]);
 
+      // clear before the slot is returned, as another thread can reuse it immediately after
 #if ENABLED(RDOC_DEVEL)
       if(DebugClear)
         memset(p, 0xfe, AllocByteSize);
 #endif
+
+      int64_t oldHead = head;
+
+      for(;;)
+      {
+        next[idx] = uint32_t(oldHead & 0xffffffff);
+
+        int64_t prevHead = Atomic::CmpExch64(&head, oldHead, NextTag(oldHead) | idx);
+
+        if(prevHead == oldHead)
+          return;
+
+        oldHead = prevHead;
+      }
     }
 
     bool IsAlloc(const void *p) const { return p >= &items[0] && p < &items[PoolCount]; }
+    // the upper 32 bits of head are a tag incremented on every change, so that a slot being freed
+    // and reallocated between reading head and exchanging it can't corrupt the list.
+    static int64_t NextTag(int64_t h)
+    {
+      return int64_t((uint64_t(h) & 0xffffffff00000000ULL) + 0x100000000ULL);
+    }
+
     WrapType *items;
-    int *freeStack;
-    int freeStackHead;
+    uint32_t *next;
+    int64_t head;
   };
 
   ItemPool m_ImmediatePool;
+
+  // only accessed under m_Lock
   rdcarray<ItemPool *> m_AdditionalPools;
+  rdcarray<PoolTable *> m_PoolTables;
+
+  // read without the lock
+  ItemPool *m_CurrentPool = NULL;
+  PoolTable *m_PoolTable = NULL;
+  uint32_t m_PoolSpanShift;
 
   friend typename FriendMaker<WrapType>::Type;
 };
@@ -28,6 +28,7 @@
 #include <algorithm>
 #include "api/replay/version.h"
 #include "common/common.h"
+#include "common/jobsystem.h"
 #include "common/threading.h"
 #include "core/settings.h"
 #include "hooks/hooks.h"
@@ -45,6 +46,21 @@
 
 #include "replay/renderdoc_serialise.inl"
 
+RDOC_CONFIG(bool, Capture_AsyncFileWriting, false,
+            "Compress and write captures to disk on a background thread, so the application "
+            "continues as soon as the frame has been gathered. Captures only become available once "
+            "they've finished writing.");
+
+RDOC_CONFIG(bool, Capture_DeduplicateInitialContents, true,
+            "Store resource initial contents with identical data only once in a capture. This "
+            "writes the frame capture block-indexed so that the copies can be referenced.");
+
+RDOC_CONFIG(bool, Log_Asynchronous, false,
+            "Queue log messages and write them out on a background thread, so that threads which "
+            "log don't stall each other. Errors are always written out immediately, but other "
+            "queued messages can be lost if the process crashes where there is no crash handler "
+            "to flush them.");
+
 RDOC_DEBUG_CONFIG(bool, Capture_Debug_SnapshotDiagnosticLog, false,
                   "Snapshot the diagnostic log at capture time and embed in the capture.");
 
@@ -466,6 +482,8 @@ void RenderDoc::Initialise()
     RDCLOGOUTPUT();
 
   ProcessConfig();
+
+  RDCLOGASYNC(Log_Asynchronous());
 }
 
 RenderDoc::~RenderDoc()
@@ -479,6 +497,19 @@ RenderDoc::~RenderDoc()
     (*it)();
   m_ShutdownFunctions.clear();
 
+  if(m_CaptureWriteThread)
+  {
+    // make sure any captures still being written make it to disk, then wake the thread with
+    // nothing queued so it exits.
+    FlushCaptureWrites();
+    m_CaptureWriteAvailable.Release(1);
+    Threading::JoinThread(m_CaptureWriteThread);
+    Threading::CloseThread(m_CaptureWriteThread);
+    m_CaptureWriteThread = 0;
+  }
+
+  Threading::ShutdownJobSystem();
+
   for(size_t i = 0; i < m_Captures.size(); i++)
   {
     if(m_Captures[i].retrieved)
@@ -1164,31 +1195,44 @@ void RenderDoc::EncodePixelsPNG(const RDCThumb &in, RDCThumb &out)
   out.format = FileType::PNG;
 }
 
-RDCFile *RenderDoc::CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePixels &fp)
+rdcstr RenderDoc::ReserveCaptureFilename(uint32_t frameNum)
 {
-  RDCFile *ret = new RDCFile;
-
   rdcstr suffix = StringFormat::Fmt("_frame%u", frameNum);
 
   if(frameNum == ~0U)
     suffix = "_capture";
 
-  m_CurrentLogFile = StringFormat::Fmt("%s%s.rdc", m_CaptureFileTemplate.c_str(), suffix.c_str());
+  rdcstr path = StringFormat::Fmt("%s%s.rdc", m_CaptureFileTemplate.c_str(), suffix.c_str());
 
-  // make sure we don't stomp another capture if we make multiple captures in the same frame.
+  // make sure we don't stomp another capture if we make multiple captures in the same frame,
+  // including ones that are still being written.
+  SCOPED_LOCK(m_CaptureLock);
+  int altnum = 2;
+  while(m_PendingCapturePaths.contains(path) ||
+        std::find_if(m_Captures.begin(), m_Captures.end(), [&path](const CaptureData &o) {
+          return o.path == path;
+        }) != m_Captures.end())
   {
-    SCOPED_LOCK(m_CaptureLock);
-    int altnum = 2;
-    while(std::find_if(m_Captures.begin(), m_Captures.end(), [this](const CaptureData &o) {
-            return o.path == m_CurrentLogFile;
-          }) != m_Captures.end())
-    {
-      m_CurrentLogFile =
-          StringFormat::Fmt("%s%s_%d.rdc", m_CaptureFileTemplate.c_str(), suffix.c_str(), altnum);
-      altnum++;
-    }
+    path = StringFormat::Fmt("%s%s_%d.rdc", m_CaptureFileTemplate.c_str(), suffix.c_str(), altnum);
+    altnum++;
   }
 
+  m_PendingCapturePaths.push_back(path);
+
+  return path;
+}
+
+RDCFile *RenderDoc::CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePixels &fp)
+{
+  m_CurrentLogFile = ReserveCaptureFilename(frameNum);
+
+  return CreateRDCFile(driver, m_CurrentLogFile, fp);
+}
+
+RDCFile *RenderDoc::CreateRDCFile(RDCDriver driver, const rdcstr &path, const FramePixels &fp)
+{
+  RDCFile *ret = new RDCFile;
+
   RDCThumb outRaw, outPng;
   if(fp.data)
   {
@@ -1200,13 +1244,13 @@ RDCFile *RenderDoc::CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePi
   ret->SetData(driver, ToStr(driver).c_str(), OSUtility::GetMachineIdent(), &outPng, m_TimeBase,
                m_TimeFrequency);
 
-  FileIO::CreateParentDirectory(m_CurrentLogFile);
+  FileIO::CreateParentDirectory(path);
 
-  ret->Create(m_CurrentLogFile.c_str());
+  ret->Create(path.c_str());
 
   if(ret->ErrorCode() != ContainerError::NoError)
   {
-    RDCERR("Error creating RDC at '%s'", m_CurrentLogFile.c_str());
+    RDCERR("Error creating RDC at '%s'", path.c_str());
     SAFE_DELETE(ret);
   }
 
@@ -1639,6 +1683,147 @@ void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
 {
   RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 0.0f);
 
+  FinishCaptureFile(rdc, m_CurrentLogFile, frameNumber);
+}
+
+struct QueuedCaptureWrite
+{
+  RDCDriver driver;
+  uint32_t frameNumber;
+  rdcstr path;
+  RenderDoc::FramePixels fp;
+  SectionProperties props;
+  StreamWriter *frameData;
+};
+
+bool RenderDoc::IsCaptureBlobDeduplication() const
+{
+  return Capture_DeduplicateInitialContents();
+}
+
+bool RenderDoc::IsCaptureWritingAsync() const
+{
+  return Capture_AsyncFileWriting();
+}
+
+void RenderDoc::QueueCaptureWrite(RDCDriver driver, uint32_t frameNumber, FramePixels &fp,
+                                  const SectionProperties &props, StreamWriter *frameData)
+{
+  QueuedCaptureWrite *write = new QueuedCaptureWrite;
+  write->driver = driver;
+  write->frameNumber = frameNumber;
+  // the path is decided now, while the capture file template is the one the capture was made with
+  write->path = ReserveCaptureFilename(frameNumber);
+  write->fp = fp;
+  write->props = props;
+  write->frameData = frameData;
+
+  // the queued copy owns the pixel data now
+  fp.data = NULL;
+
+  {
+    SCOPED_LOCK(m_CaptureWriteLock);
+    m_QueuedCaptureWrites.push_back(write);
+    m_CaptureWritesInFlight++;
+
+    if(m_CaptureWriteThread == 0)
+      m_CaptureWriteThread = Threading::CreateThread([this]() { CaptureWriteThread(); });
+  }
+
+  m_CaptureWriteAvailable.Release(1);
+}
+
+void RenderDoc::FlushCaptureWrites()
+{
+  {
+    SCOPED_LOCK(m_CaptureWriteLock);
+    if(m_CaptureWritesInFlight == 0)
+      return;
+
+    m_CaptureFlushWaiters++;
+  }
+
+  // the writing thread releases this once for each waiter when the last write finishes
+  m_CaptureWritesFlushed.Acquire();
+}
+
+void RenderDoc::CaptureWriteThread()
+{
+  Threading::SetCurrentThreadName("Capture writing");
+
+  for(;;)
+  {
+    m_CaptureWriteAvailable.Acquire();
+
+    QueuedCaptureWrite *write = NULL;
+
+    {
+      SCOPED_LOCK(m_CaptureWriteLock);
+      if(!m_QueuedCaptureWrites.empty())
+      {
+        write = m_QueuedCaptureWrites[0];
+        m_QueuedCaptureWrites.erase(0);
+      }
+    }
+
+    // woken with nothing to do means we're shutting down
+    if(write == NULL)
+      return;
+
+    WriteQueuedCapture(*write);
+
+    delete write->frameData;
+    delete write;
+
+    {
+      SCOPED_LOCK(m_CaptureWriteLock);
+      m_CaptureWritesInFlight--;
+
+      if(m_CaptureWritesInFlight == 0 && m_CaptureFlushWaiters > 0)
+      {
+        m_CaptureWritesFlushed.Release(m_CaptureFlushWaiters);
+        m_CaptureFlushWaiters = 0;
+      }
+    }
+  }
+}
+
+void RenderDoc::WriteQueuedCapture(QueuedCaptureWrite &write)
+{
+  PerformanceTimer timer;
+
+  RDCFile *rdc = CreateRDCFile(write.driver, write.path, write.fp);
+
+  if(rdc)
+  {
+    StreamWriter *w = rdc->WriteSection(write.props);
+
+    const byte *data = write.frameData->GetData();
+    const uint64_t size = write.frameData->GetOffset();
+
+    // write in pieces so we can report progress as it's compressed
+    const uint64_t pieceSize = 16 * 1024 * 1024;
+
+    for(uint64_t offs = 0; offs < size && !w->IsErrored(); offs += pieceSize)
+    {
+      SetProgress(CaptureProgress::FileWriting, float(offs) / float(size));
+
+      w->Write(data + offs, RDCMIN(pieceSize, size - offs));
+    }
+
+    w->Finish();
+
+    delete w;
+
+    RDCLOG("Wrote %f MB capture section in the background in %f seconds",
+           double(size) / (1024.0 * 1024.0), timer.GetMilliseconds() / 1000.0);
+  }
+
+  FinishCaptureFile(rdc, write.path, write.frameNumber);
+}
+
+void RenderDoc::FinishCaptureFile(RDCFile *rdc, const rdcstr &path, uint32_t frameNumber)
+{
   if(rdc)
   {
     // add the resolve database if we were capturing callstacks.
@@ -1703,12 +1888,13 @@ void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
       delete w;
     }
 
-    RDCLOG("Written to disk: %s", m_CurrentLogFile.c_str());
+    RDCLOG("Written to disk: %s", path.c_str());
 
-    CaptureData cap(m_CurrentLogFile, Timing::GetUnixTimestamp(), rdc->GetDriver(), frameNumber);
+    CaptureData cap(path, Timing::GetUnixTimestamp(), rdc->GetDriver(), frameNumber);
     {
       SCOPED_LOCK(m_CaptureLock);
       m_Captures.push_back(cap);
+      m_PendingCapturePaths.removeOne(path);
     }
 
     delete rdc;
@@ -1716,6 +1902,9 @@ void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
   else
   {
     RDCLOG("Discarded capture, Frame %u", frameNumber);
+
+    SCOPED_LOCK(m_CaptureLock);
+    m_PendingCapturePaths.removeOne(path);
   }
 
   RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 1.0f);
@@ -51,8 +51,11 @@ class IRemoteDriver;
 class IReplayDriver;
 
 class StreamReader;
+class StreamWriter;
 class RDCFile;
 struct SDFile;
+struct SectionProperties;
+struct QueuedCaptureWrite;
 enum class VulkanLayerFlags : uint32_t;
 
 namespace Callstack
@@ -443,6 +446,19 @@ public:
   void EncodePixelsPNG(const RDCThumb &in, RDCThumb &out);
   RDCFile *CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePixels &fp);
   void FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber);
+  // if enabled, drivers write their frame capture section block-indexed so that identical initial
+  // contents can be stored once and referenced by offset. See SerialiserFlags::Deduplicate
+  bool IsCaptureBlobDeduplication() const;
+
+  // if enabled, drivers serialise the frame capture section uncompressed into memory and queue it
+  // here. The RDC is then created, compressed and written on a background thread so the
+  // application can continue as soon as the frame data has been gathered.
+  bool IsCaptureWritingAsync() const;
+  // takes ownership of the pixel data in fp, and of frameData
+  void QueueCaptureWrite(RDCDriver driver, uint32_t frameNumber, FramePixels &fp,
+                         const SectionProperties &props, StreamWriter *frameData);
+  // blocks until all queued captures have been written to disk
+  void FlushCaptureWrites();
 
   void AddChildProcess(uint32_t pid, uint32_t ident);
   rdcarray<rdcpair<uint32_t, uint32_t>> GetChildProcesses();
@@ -585,6 +601,14 @@ private:
 
   void SyncAvailableGPUThread();
 
+  // picks a unique path for a new capture of the given frame, reserving it until the capture is
+  // finished with FinishCaptureFile
+  rdcstr ReserveCaptureFilename(uint32_t frameNum);
+  RDCFile *CreateRDCFile(RDCDriver driver, const rdcstr &path, const FramePixels &fp);
+  void FinishCaptureFile(RDCFile *rdc, const rdcstr &path, uint32_t frameNumber);
+  void CaptureWriteThread();
+  void WriteQueuedCapture(QueuedCaptureWrite &write);
+
   static RenderDoc *m_Inst;
 
   bool m_Replay;
@@ -624,6 +648,20 @@ private:
 
   Threading::CriticalSection m_CaptureLock;
   rdcarray<CaptureData> m_Captures;
+  // paths reserved for captures that haven't been finished yet, protected by m_CaptureLock
+  rdcarray<rdcstr> m_PendingCapturePaths;
+
+  Threading::ThreadHandle m_CaptureWriteThread = 0;
+  // protects m_QueuedCaptureWrites, m_CaptureWritesInFlight and m_CaptureFlushWaiters
+  Threading::CriticalSection m_CaptureWriteLock;
+  // released once for each queued capture write, and once with an empty queue to shut down
+  Threading::Semaphore m_CaptureWriteAvailable;
+  rdcarray<QueuedCaptureWrite *> m_QueuedCaptureWrites;
+  // number of queued capture writes that haven't finished yet, including the one in progress
+  uint32_t m_CaptureWritesInFlight = 0;
+  // threads blocked in FlushCaptureWrites, woken through m_CaptureWritesFlushed
+  uint32_t m_CaptureFlushWaiters = 0;
+  Threading::Semaphore m_CaptureWritesFlushed;
 
   Threading::CriticalSection m_ChildLock;
   rdcarray<rdcpair<uint32_t, uint32_t>> m_Children;
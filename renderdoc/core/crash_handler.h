@@ -87,7 +87,7 @@ public:
     RDCLOG("Connecting to server %s", m_PipeName.c_str());
 
     m_ExHandler = new google_breakpad::ExceptionHandler(
-        StringFormat::UTF82Wide(dumpFolder).c_str(), NULL, NULL, NULL,
+        StringFormat::UTF82Wide(dumpFolder).c_str(), &FlushLog, NULL, NULL,
         google_breakpad::ExceptionHandler::HANDLER_ALL, dumpType,
         StringFormat::UTF82Wide(m_PipeName).c_str(), &custom);
 
@@ -102,7 +102,7 @@ public:
       CreateCrashHandlingServer();
 
       m_ExHandler = new google_breakpad::ExceptionHandler(
-          StringFormat::UTF82Wide(dumpFolder).c_str(), NULL, NULL, NULL,
+          StringFormat::UTF82Wide(dumpFolder).c_str(), &FlushLog, NULL, NULL,
           google_breakpad::ExceptionHandler::HANDLER_ALL, dumpType,
           StringFormat::UTF82Wide(m_PipeName).c_str(), &custom);
 
@@ -116,6 +116,13 @@ public:
       m_ExHandler->RegisterAppMemory((void *)mem[i].ptr, mem[i].length);
   }
 
+  // make sure any queued log messages are written before the dump, so they aren't lost
+  static bool FlushLog(void *context, EXCEPTION_POINTERS *exinfo, MDRawAssertionInfo *assertion)
+  {
+    rdclog_flush();
+    return true;
+  }
+
   void CreateCrashHandlingServer()
   {
     PROCESS_INFORMATION pi;
@@ -288,6 +288,11 @@ public:
     return new ShaderDebugTrace();
   }
   rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger) { return {}; }
+  rdcarray<ShaderDebugState> RunDebug(ShaderDebugger *debugger,
+                                      const rdcarray<uint32_t> &breakpoints)
+  {
+    return {};
+  }
   void FreeDebugger(ShaderDebugger *debugger) { delete debugger; }
   void BuildTargetShader(ShaderEncoding sourceEncoding, const bytebuf &source, const rdcstr &entry,
                          const ShaderCompileFlags &compileFlags, ShaderStage type, ResourceId &id,
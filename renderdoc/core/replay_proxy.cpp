@@ -96,6 +96,7 @@ rdcstr DoStringise(const ReplayProxyPacket &el)
 
     STRINGISE_ENUM_NAMED(eReplayProxy_ContinueDebug, "ContinueDebug");
     STRINGISE_ENUM_NAMED(eReplayProxy_FreeDebugger, "FreeDebugger");
+    STRINGISE_ENUM_NAMED(eReplayProxy_RunDebug, "RunDebug");
   }
   END_ENUM_STRINGISE();
 }
@@ -1600,6 +1601,42 @@ rdcarray<ShaderDebugState> ReplayProxy::ContinueDebug(ShaderDebugger *debugger)
   PROXY_FUNCTION(ContinueDebug, debugger);
 }
 
+template <typename ParamSerialiser, typename ReturnSerialiser>
+rdcarray<ShaderDebugState> ReplayProxy::Proxied_RunDebug(ParamSerialiser &paramser,
+                                                         ReturnSerialiser &retser,
+                                                         ShaderDebugger *debugger,
+                                                         const rdcarray<uint32_t> &breakpoints)
+{
+  const ReplayProxyPacket expectedPacket = eReplayProxy_RunDebug;
+  ReplayProxyPacket packet = eReplayProxy_RunDebug;
+  rdcarray<ShaderDebugState> ret;
+
+  {
+    BEGIN_PARAMS();
+    uint64_t debugger_ptr = (uint64_t)(uintptr_t)debugger;
+    SERIALISE_ELEMENT(debugger_ptr);
+    SERIALISE_ELEMENT(breakpoints);
+    debugger = (ShaderDebugger *)(uintptr_t)debugger_ptr;
+    END_PARAMS();
+  }
+
+  {
+    REMOTE_EXECUTION();
+    if(paramser.IsReading() && !paramser.IsErrored() && !m_IsErrored)
+      ret = m_Remote->RunDebug(debugger, breakpoints);
+  }
+
+  SERIALISE_RETURN(ret);
+
+  return ret;
+}
+
+rdcarray<ShaderDebugState> ReplayProxy::RunDebug(ShaderDebugger *debugger,
+                                                 const rdcarray<uint32_t> &breakpoints)
+{
+  PROXY_FUNCTION(RunDebug, debugger, breakpoints);
+}
+
 template <typename ParamSerialiser, typename ReturnSerialiser>
 void ReplayProxy::Proxied_FreeDebugger(ParamSerialiser &paramser, ReturnSerialiser &retser,
                                        ShaderDebugger *debugger)
@@ -1830,6 +1867,8 @@ void ReplayProxy::Proxied_FetchStructuredFile(ParamSerialiser &paramser, ReturnS
     {
       if(retser.IsReading())
         file->chunks[c] = new SDChunk("");
+      else
+        file->PopulateChunk(file->chunks[c]);
 
       ser.Serialise("chunk"_lit, *file->chunks[c]);
     }
@@ -2830,6 +2869,7 @@ bool ReplayProxy::Tick(int type)
     }
     case eReplayProxy_ContinueDebug: ContinueDebug(NULL); break;
     case eReplayProxy_FreeDebugger: FreeDebugger(NULL); break;
+    case eReplayProxy_RunDebug: RunDebug(NULL, {}); break;
     case eReplayProxy_RenderOverlay:
       RenderOverlay(ResourceId(), FloatVector(), DebugOverlay::NoOverlay, 0, rdcarray<uint32_t>());
       break;
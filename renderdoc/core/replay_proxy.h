@@ -103,6 +103,7 @@ enum ReplayProxyPacket
 
   eReplayProxy_ContinueDebug,
   eReplayProxy_FreeDebugger,
+  eReplayProxy_RunDebug,
 };
 
 DECLARE_REFLECTION_ENUM(ReplayProxyPacket);
@@ -530,6 +531,8 @@ public:
   IMPLEMENT_FUNCTION_PROXIED(ShaderDebugTrace *, DebugThread, uint32_t eventId,
                              const uint32_t groupid[3], const uint32_t threadid[3]);
   IMPLEMENT_FUNCTION_PROXIED(rdcarray<ShaderDebugState>, ContinueDebug, ShaderDebugger *debugger);
+  IMPLEMENT_FUNCTION_PROXIED(rdcarray<ShaderDebugState>, RunDebug, ShaderDebugger *debugger,
+                             const rdcarray<uint32_t> &breakpoints);
   IMPLEMENT_FUNCTION_PROXIED(void, FreeDebugger, ShaderDebugger *debugger);
 
   IMPLEMENT_FUNCTION_PROXIED(rdcarray<ShaderEncoding>, GetTargetShaderEncodings);
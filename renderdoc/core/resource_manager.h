@@ -34,6 +34,7 @@
 #include "api/replay/resourceid.h"
 #include "common/threading.h"
 #include "core/core.h"
+#include "core/sharded_resource_map.h"
 #include "os/os_specific.h"
 #include "serialise/serialiser.h"
 
@@ -624,6 +625,10 @@ public:
   bool HasReplacement(ResourceId from);
   void RemoveReplacement(ResourceId id);
 
+  // incremented whenever the live resource an original ID maps to could change, so that anything
+  // caching the results of GetLiveResource() knows to invalidate.
+  uint64_t GetLiveGeneration() const { return m_LiveGeneration; }
+
   // get the original ID for a real ID that may be a replacement. i.e. if ID 123 is ID 10000005
   // live, and 10000005 live is replaced with 10000839, then calling this function with either ID
   // 10000005 or ID 10000839 will return ID 123.
@@ -656,6 +661,7 @@ public:
   bool HasIrrelevantAge(ResourceId id);
   bool IsResourcePostponed(ResourceId id);
   bool IsResourceSkipped(ResourceId id);
+  void UpdateSkippedOrPostponedCount();
   bool ShouldPostpone(ResourceId id);
   bool ShouldSkip(ResourceId id);
 
@@ -700,11 +706,13 @@ protected:
   // Unwrap)
   std::map<RealResourceType, WrappedResourceType> m_WrapperMap;
 
-  // used during capture - holds resources referenced in current frame (and how they're referenced)
-  std::map<ResourceId, FrameRefType> m_FrameReferencedResources;
+  // used during capture - holds resources referenced in current frame (and how they're referenced).
+  // This and the other per-reference containers below are sharded with their own locks, rather
+  // than being under m_Lock, since every recording thread updates them constantly.
+  ShardedResourceMap<FrameRefType> m_FrameReferencedResources;
 
   // used during capture - holds resources marked as dirty, needing initial contents
-  std::set<ResourceId> m_DirtyResources;
+  ShardedResourceMap<bool> m_DirtyResources;
 
   struct InitialContentDataOrChunk
   {
@@ -746,35 +754,38 @@ protected:
   // replacement -> replaced (for looking up original IDs)
   std::unordered_map<ResourceId, ResourceId> m_Replaced;
 
+  // see GetLiveGeneration
+  uint64_t m_LiveGeneration = 0;
+
   // During initial resources preparation, persistent resources are
   // postponed until serializing to RDC file.
   std::unordered_set<ResourceId> m_PostponedResourceIDs;
   // During initial resources preparation, resources that are completely written
   // over are skipped
   std::unordered_set<ResourceId> m_SkippedResourceIDs;
+  // the combined size of the two sets above, so that marking references can skip taking m_Lock
+  // to check them in the common case where both are empty. Only accessed atomically, see
+  // UpdateSkippedOrPostponedCount.
+  int32_t m_SkippedOrPostponedCount = 0;
 
   struct ResourceRefTimes
   {
-    ResourceId id;
-
     // On marking resource write-referenced in frame, its last write time is reset. The time is used
     // to determine persistent resources, and is checked against the `PERSISTENT_RESOURCE_AGE`.
-    double writeTime;
+    double writeTime = 0.0;
 
     // partialUseTime is referring to: eFrameRef_PartialWrite, eFrameRef_Read,
     // eFrameRef_ReadBeforeWrite, eFrameRef_WriteBeforeRead. The goal is to predict whether a
     // resource will only ever have a eFrameRef_CompleteWrite reference. If it does, then we don't
     // need to serialise the initial contents because we know it will always be fully initialised
     // within the frame.
-    double partialUseTime;
-
-    bool operator<(const ResourceId &o) const { return id < o; }
+    double partialUseTime = 0.0;
   };
 
-  // all resources that are written in some way end up in this list. We then check the last time
+  // all resources that are written in some way end up in this map. We then check the last time
   // they were written, and the last time they were ever partially used (not completely overwritten
   // in one atomic chunk).
-  rdcarray<ResourceRefTimes> m_ResourceRefTimes;
+  ShardedResourceMap<ResourceRefTimes> m_ResourceRefTimes;
 
   // Timestamp at the beginning of the frame capture. Used to determine which
   // resources to refresh for their last write or partial use time (see `ResourceRefTimes`).
@@ -828,65 +839,24 @@ template <typename Configuration>
 void ResourceManager<Configuration>::MarkBackgroundFrameReferenced(
     const rdcflatmap<ResourceId, FrameRefType> &refs)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(IsBackgroundCapturing(m_State))
   {
-    if(refs.size() <= m_ResourceRefTimes.size())
-    {
-      for(auto it = refs.begin(); it != refs.end(); ++it)
-        UpdateLastWriteAndPartialUseTime(it->first, it->second);
-    }
-    else
-    {
-      for(const ResourceRefTimes &res : m_ResourceRefTimes)
-      {
-        auto it = refs.find(res.id);
-
-        if(it != refs.end())
-          UpdateLastWriteAndPartialUseTime(it->first, it->second);
-      }
-    }
+    for(auto it = refs.begin(); it != refs.end(); ++it)
+      UpdateLastWriteAndPartialUseTime(it->first, it->second);
   }
 }
 
 template <typename Configuration>
 void ResourceManager<Configuration>::CleanBackgroundFrameReferences()
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(IsBackgroundCapturing(m_State))
   {
     double now = m_ResourcesUpdateTimer.GetMilliseconds();
 
     // retire any old entries, if they were written once they shouldn't be tracked forever.
-    //
-    // walk the array. If we find an item we want to remove we increment src otherwise we copy src
-    // to dst (if they are different). Thus next time dst will point at the item we want to skip, at
-    // each stage copying src to dst (if they are different). If we find an item we want to remove
-    // we increment src and continue (thus it will get copied ove
-    size_t dst = 0, src = 0;
-    for(dst = 0, src = 0; src < m_ResourceRefTimes.size();)
-    {
-      ResourceRefTimes &check = m_ResourceRefTimes[src];
-      if(now - check.writeTime > IRRELEVANT_RESOURCE_AGE)
-      {
-        // skip src, check the next one
-        src++;
-        continue;
-      }
-
-      // we want to keep src. If dst == src we can just continue on to the next iteration, if not
-      // then we need to copy src into dst (where dst is the leftovers from previously remove
-      // entries)
-      if(dst != src)
-        m_ResourceRefTimes[dst] = m_ResourceRefTimes[src];
-
-      dst++;
-      src++;
-    }
-
-    m_ResourceRefTimes.resize(dst);
+    m_ResourceRefTimes.EraseIf([now](ResourceId, const ResourceRefTimes &times) {
+      return now - times.writeTime > IRRELEVANT_RESOURCE_AGE;
+    });
   }
 }
 
@@ -895,13 +865,15 @@ template <typename Compose>
 void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
                                                                  FrameRefType refType, Compose comp)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(id == ResourceId())
     return;
 
-  if(IsActiveCapturing(m_State))
+  // the skipped and postponed sets are only populated when a capture begins, so most of the time
+  // there's nothing to look up and no need to serialise against other threads on m_Lock.
+  if(IsActiveCapturing(m_State) && Atomic::CmpExch32(&m_SkippedOrPostponedCount, 0, 0) > 0)
   {
+    SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+
     SkipOrPostponeOrPrepare_InitialState(id, refType);
 
     if(IsDirtyFrameRef(refType))
@@ -915,7 +887,10 @@ void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
   if(IsBackgroundCapturing(m_State))
     return;
 
-  bool newRef = MarkReferenced(m_FrameReferencedResources, id, refType, comp);
+  bool newRef =
+      m_FrameReferencedResources.Update(id, [refType, &comp](FrameRefType &ref, bool added) {
+        ref = added ? refType : comp(ref, refType);
+      });
 
   if(newRef)
   {
@@ -935,23 +910,19 @@ void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
 template <typename Configuration>
 void ResourceManager<Configuration>::MarkDirtyResource(ResourceId res)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(res == ResourceId())
     return;
 
-  m_DirtyResources.insert(res);
+  m_DirtyResources.Insert(res);
 }
 
 template <typename Configuration>
 bool ResourceManager<Configuration>::IsResourceDirty(ResourceId res)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(res == ResourceId())
     return false;
 
-  return m_DirtyResources.find(res) != m_DirtyResources.end();
+  return m_DirtyResources.Contains(res);
 }
 
 template <typename Configuration>
@@ -1031,12 +1002,14 @@ void ResourceManager<Configuration>::Serialise_InitialContentsNeeded(WriteSerial
   // need to be reset.
   rdcarray<WrittenRecord> NeededInitials;
 
+  rdcarray<rdcpair<ResourceId, FrameRefType>> frameRefs = m_FrameReferencedResources.GetSorted();
+
   // reasonable estimate, and these records are small
-  NeededInitials.reserve(m_FrameReferencedResources.size() + m_InitialContents.size());
+  NeededInitials.reserve(frameRefs.size() + m_InitialContents.size());
 
   // all resources that were recorded as being modified should be included in the list of those
   // needing initial contents
-  for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
+  for(auto it = frameRefs.begin(); it != frameRefs.end(); ++it)
   {
     RecordType *record = GetResourceRecord(it->first);
     if(IsDirtyFrameRef(it->second))
@@ -1056,7 +1029,7 @@ void ResourceManager<Configuration>::Serialise_InitialContentsNeeded(WriteSerial
     bool include = RenderDoc::Inst().GetCaptureOptions().refAllResources;
 
     ResourceId id = it->first;
-    if(m_FrameReferencedResources.find(id) != m_FrameReferencedResources.end())
+    if(m_FrameReferencedResources.Contains(id))
       include = true;
 
     if(include)
@@ -1085,6 +1058,7 @@ void ResourceManager<Configuration>::FreeInitialContents()
   }
   m_PostponedResourceIDs.clear();
   m_SkippedResourceIDs.clear();
+  UpdateSkippedOrPostponedCount();
 }
 
 template <typename Configuration>
@@ -1102,6 +1076,7 @@ void ResourceManager<Configuration>::Prepare_InitialStateIfPostponed(ResourceId
   Prepare_InitialState(res);
 
   m_PostponedResourceIDs.erase(id);
+  UpdateSkippedOrPostponedCount();
 }
 
 template <typename Configuration>
@@ -1118,6 +1093,7 @@ void ResourceManager<Configuration>::SkipOrPostponeOrPrepare_InitialState(Resour
   // it immediately. We can't retrieve its initial state once it has
   // been written over.
   m_SkippedResourceIDs.erase(id);
+  UpdateSkippedOrPostponedCount();
 
   // skip this forever if the first encounter is a complete write
   if(IsCompleteWriteFrameRef(refType))
@@ -1132,6 +1108,7 @@ void ResourceManager<Configuration>::SkipOrPostponeOrPrepare_InitialState(Resour
   if(!IsDirtyFrameRef(refType) && IsResourceTrackedForPersistency(GetCurrentResource(id)))
   {
     m_PostponedResourceIDs.insert(id);
+    UpdateSkippedOrPostponedCount();
     RDCDEBUG("Resource %s converted from skipped to postponed on refType of %s", ToStr(id).c_str(),
              ToStr(refType).c_str());
     SetInitialContents(id, InitialContentData());
@@ -1158,80 +1135,64 @@ template <typename Configuration>
 inline void ResourceManager<Configuration>::ResetLastWriteTimes()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-  for(auto it = m_ResourceRefTimes.begin(); it != m_ResourceRefTimes.end(); ++it)
-  {
+  m_ResourceRefTimes.ForEach([this](ResourceId, ResourceRefTimes &times) {
     // Reset only those resources which were below the threshold on
     // capture start. Other resource are already above the threshold.
-    if(m_captureStartTime - it->writeTime <= PERSISTENT_RESOURCE_AGE)
-      it->writeTime = m_ResourcesUpdateTimer.GetMilliseconds();
-  }
+    if(m_captureStartTime - times.writeTime <= PERSISTENT_RESOURCE_AGE)
+      times.writeTime = m_ResourcesUpdateTimer.GetMilliseconds();
+  });
 }
 
 template <typename Configuration>
 inline void ResourceManager<Configuration>::UpdateLastWriteAndPartialUseTime(ResourceId id,
                                                                              FrameRefType refType)
 {
-  // parent must hold m_Lock for us
-
-  ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
-
-  if(it == m_ResourceRefTimes.end() || it->id != id)
-  {
-    // don't add resources unless it's a dirty ref. After that, we'll keep updating for read and
-    // write refs to get partialUseTime
-    if(!IsDirtyFrameRef(refType))
-      return;
+  double now = m_ResourcesUpdateTimer.GetMilliseconds();
 
-    // if it's not pointing to the end, figure out where we need to insert it there
-    size_t idx = it - m_ResourceRefTimes.begin();
-    m_ResourceRefTimes.insert(idx, {id, 0.0, 0.0});
-    it = m_ResourceRefTimes.begin() + idx;
-  }
+  auto update = [now, refType](ResourceRefTimes &times) {
+    if(IsDirtyFrameRef(refType))
+      times.writeTime = now;
 
-  double now = m_ResourcesUpdateTimer.GetMilliseconds();
+    if(!IsCompleteWriteFrameRef(refType))
+      times.partialUseTime = now;
+  };
 
+  // don't add resources unless it's a dirty ref. After that, we'll keep updating for read and
+  // write refs to get partialUseTime
   if(IsDirtyFrameRef(refType))
-    it->writeTime = now;
-
-  if(!IsCompleteWriteFrameRef(refType))
-    it->partialUseTime = now;
+    m_ResourceRefTimes.Update(id, [&update](ResourceRefTimes &times, bool) { update(times); });
+  else
+    m_ResourceRefTimes.Modify(id, update);
 }
 
 template <typename Configuration>
 inline void ResourceManager<Configuration>::ResetLastPartialUseTimes()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-  for(auto it = m_ResourceRefTimes.begin(); it != m_ResourceRefTimes.end(); ++it)
-  {
-    if(m_captureStartTime - it->partialUseTime <= IRRELEVANT_RESOURCE_AGE)
-      it->partialUseTime = m_ResourcesUpdateTimer.GetMilliseconds();
-  }
+  m_ResourceRefTimes.ForEach([this](ResourceId, ResourceRefTimes &times) {
+    if(m_captureStartTime - times.partialUseTime <= IRRELEVANT_RESOURCE_AGE)
+      times.partialUseTime = m_ResourcesUpdateTimer.GetMilliseconds();
+  });
 }
 
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasPersistentAge(ResourceId id)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
-  ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
-
-  if(it == m_ResourceRefTimes.end() || it->id != id)
+  ResourceRefTimes times;
+  if(!m_ResourceRefTimes.Find(id, times))
     return true;
 
-  return m_ResourcesUpdateTimer.GetMilliseconds() - it->writeTime >= PERSISTENT_RESOURCE_AGE;
+  return m_ResourcesUpdateTimer.GetMilliseconds() - times.writeTime >= PERSISTENT_RESOURCE_AGE;
 }
 
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasIrrelevantAge(ResourceId id)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
-  ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
-
-  if(it == m_ResourceRefTimes.end() || it->id != id)
+  ResourceRefTimes times;
+  if(!m_ResourceRefTimes.Find(id, times))
     return false;
 
-  return m_ResourcesUpdateTimer.GetMilliseconds() - it->partialUseTime >= IRRELEVANT_RESOURCE_AGE;
+  return m_ResourcesUpdateTimer.GetMilliseconds() - times.partialUseTime >= IRRELEVANT_RESOURCE_AGE;
 }
 
 template <typename Configuration>
@@ -1248,6 +1209,19 @@ inline bool ResourceManager<Configuration>::IsResourceSkipped(ResourceId id)
   return m_SkippedResourceIDs.find(id) != m_SkippedResourceIDs.end();
 }
 
+template <typename Configuration>
+inline void ResourceManager<Configuration>::UpdateSkippedOrPostponedCount()
+{
+  // parent must hold m_Lock for us
+  const int32_t count = int32_t(m_SkippedResourceIDs.size() + m_PostponedResourceIDs.size());
+
+  // store with a full barrier, pairing with the unlocked load in MarkResourceFrameReferenced so
+  // that it observes the update in order with the changes to the sets
+  int32_t prev = Atomic::CmpExch32(&m_SkippedOrPostponedCount, 0, 0);
+  while(Atomic::CmpExch32(&m_SkippedOrPostponedCount, prev, count) != prev)
+    prev = Atomic::CmpExch32(&m_SkippedOrPostponedCount, 0, 0);
+}
+
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::ShouldPostpone(ResourceId id)
 {
@@ -1361,7 +1335,9 @@ void ResourceManager<Configuration>::InsertReferencedChunks(WriteSerialiser &ser
 
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
-  RDCDEBUG("%u frame resource records", (uint32_t)m_FrameReferencedResources.size());
+  rdcarray<rdcpair<ResourceId, FrameRefType>> frameRefs = m_FrameReferencedResources.GetSorted();
+
+  RDCDEBUG("%u frame resource records", (uint32_t)frameRefs.size());
 
   if(RenderDoc::Inst().GetCaptureOptions().refAllResources)
   {
@@ -1375,8 +1351,7 @@ void ResourceManager<Configuration>::InsertReferencedChunks(WriteSerialiser &ser
       RenderDoc::Inst().SetProgress(CaptureProgress::AddReferencedResources, idx / num);
       idx += 1.0f;
 
-      if(m_FrameReferencedResources.find(it->first) == m_FrameReferencedResources.end() &&
-         it->second->InternalResource)
+      if(!m_FrameReferencedResources.Contains(it->first) && it->second->InternalResource)
         continue;
 
       it->second->Insert(sortedChunks);
@@ -1384,10 +1359,10 @@ void ResourceManager<Configuration>::InsertReferencedChunks(WriteSerialiser &ser
   }
   else
   {
-    float num = float(m_FrameReferencedResources.size());
+    float num = float(frameRefs.size());
     float idx = 0.0f;
 
-    for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
+    for(auto it = frameRefs.begin(); it != frameRefs.end(); ++it)
     {
       RenderDoc::Inst().SetProgress(CaptureProgress::AddReferencedResources, idx / num);
       idx += 1.0f;
@@ -1411,17 +1386,19 @@ void ResourceManager<Configuration>::PrepareInitialContents()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
-  RDCDEBUG("Preparing up to %u potentially dirty resources", (uint32_t)m_DirtyResources.size());
+  rdcarray<rdcpair<ResourceId, bool>> dirtyResources = m_DirtyResources.GetSorted();
+
+  RDCDEBUG("Preparing up to %u potentially dirty resources", (uint32_t)dirtyResources.size());
   uint32_t prepared = 0;
   uint32_t postponed = 0;
   uint32_t skipped = 0;
 
-  float num = float(m_DirtyResources.size());
+  float num = float(dirtyResources.size());
   float idx = 0.0f;
 
-  for(auto it = m_DirtyResources.begin(); it != m_DirtyResources.end(); ++it)
+  for(auto it = dirtyResources.begin(); it != dirtyResources.end(); ++it)
   {
-    ResourceId id = *it;
+    ResourceId id = it->first;
 
     RenderDoc::Inst().SetProgress(CaptureProgress::PrepareInitialStates, idx / num);
     idx += 1.0f;
@@ -1464,6 +1441,8 @@ void ResourceManager<Configuration>::PrepareInitialContents()
     Prepare_InitialState(res);
   }
 
+  UpdateSkippedOrPostponedCount();
+
   RDCDEBUG("Prepared %u dirty resources, postponed %u, skipped %u", prepared, postponed, skipped);
 }
 
@@ -1487,7 +1466,7 @@ void ResourceManager<Configuration>::InsertInitialContentsChunks(WriteSerialiser
     RenderDoc::Inst().SetProgress(CaptureProgress::SerialiseInitialStates, idx / num);
     idx += 1.0f;
 
-    if(m_FrameReferencedResources.find(id) == m_FrameReferencedResources.end() &&
+    if(!m_FrameReferencedResources.Contains(id) &&
        !RenderDoc::Inst().GetCaptureOptions().refAllResources)
     {
 #if ENABLED(VERBOSE_DIRTY_RESOURCES)
@@ -1549,6 +1528,9 @@ void ResourceManager<Configuration>::InsertInitialContentsChunks(WriteSerialiser
   }
 
   RDCDEBUG("Serialised %u resources, skipped %u unreferenced", dirty, skipped);
+
+  if(ser.GetDeduplicatedBytes() > 0)
+    RDCLOG("Deduplicated %llu bytes of identical initial contents", ser.GetDeduplicatedBytes());
 }
 
 template <typename Configuration>
@@ -1560,7 +1542,7 @@ void ResourceManager<Configuration>::ApplyInitialContentsNonChunks(WriteSerialis
   {
     ResourceId id = it->first;
 
-    if(m_FrameReferencedResources.find(id) == m_FrameReferencedResources.end() &&
+    if(!m_FrameReferencedResources.Contains(id) &&
        !RenderDoc::Inst().GetCaptureOptions().refAllResources)
     {
       continue;
@@ -1581,7 +1563,11 @@ void ResourceManager<Configuration>::ClearReferencedResources()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
-  for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
+  // take the references out before processing them, as deleting records can re-enter the manager
+  rdcarray<rdcpair<ResourceId, FrameRefType>> frameRefs = m_FrameReferencedResources.GetSorted();
+  m_FrameReferencedResources.clear();
+
+  for(auto it = frameRefs.begin(); it != frameRefs.end(); ++it)
   {
     RecordType *record = GetResourceRecord(it->first);
 
@@ -1592,8 +1578,6 @@ void ResourceManager<Configuration>::ClearReferencedResources()
       record->Delete(this);
     }
   }
-
-  m_FrameReferencedResources.clear();
 }
 
 template <typename Configuration>
@@ -1605,6 +1589,7 @@ void ResourceManager<Configuration>::ReplaceResource(ResourceId from, ResourceId
   {
     m_Replacements[from] = to;
     m_Replaced[to] = from;
+    m_LiveGeneration++;
   }
 }
 
@@ -1628,6 +1613,7 @@ void ResourceManager<Configuration>::RemoveReplacement(ResourceId id)
 
   m_Replaced.erase(it->second);
   m_Replacements.erase(it);
+  m_LiveGeneration++;
 }
 
 template <typename Configuration>
@@ -1773,6 +1759,7 @@ void ResourceManager<Configuration>::AddLiveResource(ResourceId origid, WrappedR
   }
 
   m_LiveResourceMap[origid] = livePtr;
+  m_LiveGeneration++;
 }
 
 template <typename Configuration>
@@ -1815,6 +1802,7 @@ void ResourceManager<Configuration>::EraseLiveResource(ResourceId origid)
   RDCASSERT(HasLiveResource(origid), origid);
 
   m_LiveResourceMap.erase(origid);
+  m_LiveGeneration++;
 }
 
 template <typename Configuration>
@@ -1861,11 +1849,8 @@ void ResourceManager<Configuration>::ReleaseCurrentResource(ResourceId id)
   }
 
   m_CurrentResourceMap.erase(id);
-  m_DirtyResources.erase(id);
-
-  auto it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
-  if(it != m_ResourceRefTimes.end())
-    m_ResourceRefTimes.erase(it - m_ResourceRefTimes.begin());
+  m_DirtyResources.Erase(id);
+  m_ResourceRefTimes.Erase(id);
 }
 
 template <typename Configuration>
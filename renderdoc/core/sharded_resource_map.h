@@ -0,0 +1,303 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include "api/replay/rdcarray.h"
+#include "api/replay/rdcpair.h"
+#include "api/replay/resourceid.h"
+#include "common/threading.h"
+
+// A hash map keyed by ResourceId, split into a fixed number of independently locked shards so
+// that threads marking different resources rarely contend with each other. Each shard is a flat
+// open-addressed table with linear probing - ResourceId() is the empty marker and so can't be
+// stored. This is used for per-frame bookkeeping during capture which is updated from every
+// recording thread, where a single lock around node-based containers was a bottleneck.
+//
+// Callbacks that are passed a value run with that value's shard locked, so they must not call back
+// into the same map.
+template <typename T>
+class ShardedResourceMap
+{
+public:
+  static const uint32_t NumShards = 16;
+
+  ShardedResourceMap() = default;
+  ShardedResourceMap(const ShardedResourceMap &) = delete;
+  ShardedResourceMap &operator=(const ShardedResourceMap &) = delete;
+
+  // inserts a default-constructed value if id isn't present, then calls update(T &, bool inserted)
+  // on it. Returns true if the value was newly inserted.
+  template <typename UpdateFunc>
+  bool Update(ResourceId id, UpdateFunc update)
+  {
+    Shard &shard = GetShard(id);
+    Threading::ScopedSpinLock lock(shard.lock);
+
+    bool inserted = false;
+    T &val = shard.Insert(id, Hash(id), inserted);
+    update(val, inserted);
+    return inserted;
+  }
+
+  // calls update(T &) on the value for id only if it's present. Returns true if it was present.
+  template <typename UpdateFunc>
+  bool Modify(ResourceId id, UpdateFunc update)
+  {
+    Shard &shard = GetShard(id);
+    Threading::ScopedSpinLock lock(shard.lock);
+
+    T *val = shard.Find(id, Hash(id));
+    if(val)
+      update(*val);
+    return val != NULL;
+  }
+
+  bool Insert(ResourceId id)
+  {
+    return Update(id, [](T &, bool) {});
+  }
+
+  bool Find(ResourceId id, T &value)
+  {
+    Shard &shard = GetShard(id);
+    Threading::ScopedSpinLock lock(shard.lock);
+
+    T *val = shard.Find(id, Hash(id));
+    if(val)
+      value = *val;
+    return val != NULL;
+  }
+
+  bool Contains(ResourceId id)
+  {
+    Shard &shard = GetShard(id);
+    Threading::ScopedSpinLock lock(shard.lock);
+
+    return shard.Find(id, Hash(id)) != NULL;
+  }
+
+  bool Erase(ResourceId id)
+  {
+    Shard &shard = GetShard(id);
+    Threading::ScopedSpinLock lock(shard.lock);
+
+    return shard.Erase(id, Hash(id));
+  }
+
+  // calls func(ResourceId, T &) for each entry, in no particular order. Each shard is locked while
+  // it's being visited
+  template <typename Func>
+  void ForEach(Func func)
+  {
+    for(Shard &shard : m_Shards)
+    {
+      Threading::ScopedSpinLock lock(shard.lock);
+
+      for(rdcpair<ResourceId, T> &slot : shard.slots)
+        if(slot.first != ResourceId())
+          func(slot.first, slot.second);
+    }
+  }
+
+  // removes every entry for which pred(ResourceId, const T &) returns true
+  template <typename Predicate>
+  void EraseIf(Predicate pred)
+  {
+    for(Shard &shard : m_Shards)
+    {
+      Threading::ScopedSpinLock lock(shard.lock);
+
+      rdcarray<rdcpair<ResourceId, T>> old;
+      old.swap(shard.slots);
+
+      shard.slots.resize(old.size());
+      shard.count = 0;
+      for(rdcpair<ResourceId, T> &slot : old)
+      {
+        if(slot.first == ResourceId() || pred(slot.first, (const T &)slot.second))
+          continue;
+
+        bool inserted = false;
+        shard.Insert(slot.first, Hash(slot.first), inserted) = slot.second;
+      }
+    }
+  }
+
+  // returns a copy of all entries sorted by ID, so that anything written out from it is in a
+  // deterministic order regardless of which threads inserted what.
+  rdcarray<rdcpair<ResourceId, T>> GetSorted()
+  {
+    rdcarray<rdcpair<ResourceId, T>> ret;
+    ret.reserve(size());
+    ForEach([&ret](ResourceId id, T &val) { ret.push_back({id, val}); });
+    std::sort(ret.begin(), ret.end(),
+              [](const rdcpair<ResourceId, T> &a, const rdcpair<ResourceId, T> &b) {
+                return a.first < b.first;
+              });
+    return ret;
+  }
+
+  size_t size()
+  {
+    size_t ret = 0;
+    for(Shard &shard : m_Shards)
+    {
+      Threading::ScopedSpinLock lock(shard.lock);
+      ret += shard.count;
+    }
+    return ret;
+  }
+
+  bool empty() { return size() == 0; }
+
+  // empties the map but keeps the storage allocated, as these maps typically fill back up to a
+  // similar size every frame.
+  void clear()
+  {
+    for(Shard &shard : m_Shards)
+    {
+      Threading::ScopedSpinLock lock(shard.lock);
+
+      for(rdcpair<ResourceId, T> &slot : shard.slots)
+        slot = rdcpair<ResourceId, T>();
+      shard.count = 0;
+    }
+  }
+
+private:
+  static uint64_t Hash(ResourceId id)
+  {
+    // IDs are allocated sequentially so mix the bits (fibonacci hashing) to spread them across
+    // shards and slots.
+    return uint64_t(std::hash<ResourceId>()(id)) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  struct Shard
+  {
+    // size is always zero or a power of two
+    rdcarray<rdcpair<ResourceId, T>> slots;
+    size_t count = 0;
+    Threading::SpinLock lock;
+
+    // pad out to a cache line so neighbouring shard locks don't share one
+    byte padding[64 - sizeof(rdcarray<char>) - sizeof(size_t) - sizeof(Threading::SpinLock)];
+
+    size_t Mask() const { return slots.size() - 1; }
+    T *Find(ResourceId id, uint64_t hash)
+    {
+      if(count == 0)
+        return NULL;
+
+      for(size_t i = size_t(hash) & Mask();; i = (i + 1) & Mask())
+      {
+        if(slots[i].first == id)
+          return &slots[i].second;
+        if(slots[i].first == ResourceId())
+          return NULL;
+      }
+    }
+
+    T &Insert(ResourceId id, uint64_t hash, bool &inserted)
+    {
+      // keep the load factor at or below 1/2 so probe sequences stay short
+      if((count + 1) * 2 > slots.size())
+        Grow();
+
+      size_t i = size_t(hash) & Mask();
+      for(;; i = (i + 1) & Mask())
+      {
+        if(slots[i].first == id)
+        {
+          inserted = false;
+          return slots[i].second;
+        }
+        if(slots[i].first == ResourceId())
+          break;
+      }
+
+      inserted = true;
+      count++;
+      slots[i].first = id;
+      slots[i].second = T();
+      return slots[i].second;
+    }
+
+    bool Erase(ResourceId id, uint64_t hash)
+    {
+      if(count == 0)
+        return false;
+
+      size_t i = size_t(hash) & Mask();
+      for(;; i = (i + 1) & Mask())
+      {
+        if(slots[i].first == id)
+          break;
+        if(slots[i].first == ResourceId())
+          return false;
+      }
+
+      // backward-shift deletion: move any later entries in the same probe run back into the hole,
+      // so lookups never need tombstones.
+      for(size_t j = (i + 1) & Mask(); slots[j].first != ResourceId(); j = (j + 1) & Mask())
+      {
+        size_t home = size_t(Hash(slots[j].first)) & Mask();
+
+        // the entry at j can fill the hole at i only if its home slot isn't cyclically in (i, j]
+        bool homeInRange = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if(!homeInRange)
+        {
+          slots[i] = slots[j];
+          i = j;
+        }
+      }
+
+      slots[i] = rdcpair<ResourceId, T>();
+      count--;
+      return true;
+    }
+
+    void Grow()
+    {
+      rdcarray<rdcpair<ResourceId, T>> old;
+      old.swap(slots);
+
+      slots.resize(old.empty() ? 16 : old.size() * 2);
+      count = 0;
+
+      bool inserted = false;
+      for(rdcpair<ResourceId, T> &slot : old)
+        if(slot.first != ResourceId())
+          Insert(slot.first, Hash(slot.first), inserted) = slot.second;
+    }
+  };
+
+  // use the top bits for the shard, the slot index comes from the low bits
+  Shard &GetShard(ResourceId id) { return m_Shards[Hash(id) >> 60]; }
+  static_assert(NumShards == 16, "Shard selection assumes 16 shards");
+
+  Shard m_Shards[NumShards];
+};
@@ -0,0 +1,186 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/globalconfig.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include <map>
+#include "core/resource_manager.h"
+#include "sharded_resource_map.h"
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Test sharded resource map", "[resourcemanager]")
+{
+  rdcarray<ResourceId> ids;
+  for(int i = 0; i < 2000; i++)
+    ids.push_back(ResourceIDGen::GetNewUniqueID());
+
+  SECTION("Insert, update and find")
+  {
+    ShardedResourceMap<uint32_t> map;
+
+    CHECK(map.empty());
+    CHECK_FALSE(map.Contains(ids[0]));
+
+    for(size_t i = 0; i < ids.size(); i++)
+    {
+      bool added = map.Update(ids[i], [i](uint32_t &val, bool inserted) {
+        CHECK(inserted);
+        val = uint32_t(i);
+      });
+      CHECK(added);
+    }
+
+    CHECK(map.size() == ids.size());
+
+    // updating again shouldn't insert
+    bool added = map.Update(ids[5], [](uint32_t &val, bool inserted) {
+      CHECK_FALSE(inserted);
+      val += 1000;
+    });
+    CHECK_FALSE(added);
+    CHECK(map.size() == ids.size());
+
+    uint32_t val = 0;
+    CHECK(map.Find(ids[5], val));
+    CHECK(val == 1005);
+
+    CHECK(map.Modify(ids[6], [](uint32_t &v) { v = 42; }));
+    CHECK(map.Find(ids[6], val));
+    CHECK(val == 42);
+
+    ResourceId missing = ResourceIDGen::GetNewUniqueID();
+    CHECK_FALSE(map.Modify(missing, [](uint32_t &v) { v = 42; }));
+    CHECK_FALSE(map.Contains(missing));
+    CHECK(map.size() == ids.size());
+
+    rdcarray<rdcpair<ResourceId, uint32_t>> sorted = map.GetSorted();
+    REQUIRE(sorted.size() == ids.size());
+    for(size_t i = 1; i < sorted.size(); i++)
+      CHECK(sorted[i - 1].first < sorted[i].first);
+
+    map.clear();
+    CHECK(map.empty());
+    for(ResourceId id : ids)
+      CHECK_FALSE(map.Contains(id));
+
+    // the map is still usable after clearing
+    CHECK(map.Insert(ids[10]));
+    CHECK(map.Contains(ids[10]));
+    CHECK(map.size() == 1);
+  };
+
+  SECTION("Erasing matches a reference map")
+  {
+    ShardedResourceMap<uint32_t> map;
+    std::map<ResourceId, uint32_t> reference;
+
+    uint32_t seed = 0x1234567;
+    for(int i = 0; i < 20000; i++)
+    {
+      seed = seed * 1664525 + 1013904223;
+      ResourceId id = ids[(seed >> 8) % ids.size()];
+
+      // bias towards inserts so the map fills and grows as well as emptying
+      if((seed >> 28) < 6)
+      {
+        CHECK(map.Erase(id) == (reference.erase(id) == 1));
+      }
+      else
+      {
+        map.Update(id, [i](uint32_t &val, bool) { val = i; });
+        reference[id] = i;
+      }
+    }
+
+    CHECK(map.size() == reference.size());
+
+    for(ResourceId id : ids)
+    {
+      uint32_t val = 0;
+      auto it = reference.find(id);
+      CHECK(map.Find(id, val) == (it != reference.end()));
+      if(it != reference.end())
+        CHECK(val == it->second);
+    }
+
+    map.EraseIf([](ResourceId, const uint32_t &val) { return (val & 1) != 0; });
+
+    for(auto it = reference.begin(); it != reference.end();)
+    {
+      if(it->second & 1)
+        it = reference.erase(it);
+      else
+        ++it;
+    }
+
+    CHECK(map.size() == reference.size());
+
+    rdcarray<rdcpair<ResourceId, uint32_t>> sorted = map.GetSorted();
+    REQUIRE(sorted.size() == reference.size());
+    size_t idx = 0;
+    for(auto it = reference.begin(); it != reference.end(); ++it, ++idx)
+    {
+      CHECK(sorted[idx].first == it->first);
+      CHECK(sorted[idx].second == it->second);
+    }
+  };
+
+  SECTION("Concurrent updates from multiple threads")
+  {
+    ShardedResourceMap<uint32_t> map;
+
+    const int numThreads = 8;
+    Threading::ThreadHandle threads[numThreads];
+    int32_t newRefs = 0;
+
+    for(int t = 0; t < numThreads; t++)
+    {
+      threads[t] = Threading::CreateThread([&map, &ids, &newRefs]() {
+        for(ResourceId id : ids)
+        {
+          if(map.Update(id, [](uint32_t &val, bool) { val++; }))
+            Atomic::Inc32(&newRefs);
+        }
+      });
+    }
+
+    for(Threading::ThreadHandle t : threads)
+    {
+      Threading::JoinThread(t);
+      Threading::CloseThread(t);
+    }
+
+    // every ID is newly added exactly once, and sees every thread's update
+    CHECK(newRefs == (int32_t)ids.size());
+    CHECK(map.size() == ids.size());
+
+    uint32_t expected = numThreads;
+    map.ForEach([expected](ResourceId, uint32_t &val) { CHECK(val == expected); });
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
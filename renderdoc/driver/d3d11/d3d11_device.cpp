@@ -1889,29 +1889,38 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
       }
     }
 
-    RDCFile *rdc =
-        RenderDoc::Inst().CreateRDC(RDCDriver::D3D11, m_CapturedFrames.back().frameNumber, fp);
+    SectionProperties props;
 
-    StreamWriter *captureWriter = NULL;
+    // Compress with LZ4 so that it's fast
+    props.flags = SectionFlags::LZ4Compressed;
+    props.version = m_SectionVersion;
+    props.type = SectionType::FrameCapture;
 
-    if(rdc)
-    {
-      SectionProperties props;
+    const bool asyncWrite = RenderDoc::Inst().IsCaptureWritingAsync();
 
-      // Compress with LZ4 so that it's fast
-      props.flags = SectionFlags::LZ4Compressed;
-      props.version = m_SectionVersion;
-      props.type = SectionType::FrameCapture;
+    RDCFile *rdc = NULL;
 
-      captureWriter = rdc->WriteSection(props);
+    StreamWriter *captureWriter = NULL;
+
+    if(asyncWrite)
+    {
+      // gather the frame uncompressed in memory, the file is created and written in the background
+      captureWriter = new StreamWriter(StreamWriter::DefaultScratchSize);
     }
     else
     {
-      captureWriter = new StreamWriter(StreamWriter::InvalidStream);
+      rdc = RenderDoc::Inst().CreateRDC(RDCDriver::D3D11, m_CapturedFrames.back().frameNumber, fp);
+
+      if(rdc)
+        captureWriter = rdc->WriteSection(props);
+      else
+        captureWriter = new StreamWriter(StreamWriter::InvalidStream);
     }
 
+    uint64_t captureSize = 0;
+
     {
-      WriteSerialiser ser(captureWriter, Ownership::Stream);
+      WriteSerialiser ser(captureWriter, asyncWrite ? Ownership::Nothing : Ownership::Stream);
 
       ser.SetChunkMetadataRecording(m_ScratchSerialiser.GetChunkMetadataRecording());
 
@@ -1979,13 +1988,18 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
       }
 
       UnlockForChunkFlushing();
+
+      captureSize = captureWriter->GetOffset();
     }
 
     RDCLOG("Captured D3D11 frame with %f MB capture section in %f seconds",
-           double(captureWriter->GetOffset()) / (1024.0 * 1024.0),
-           m_CaptureTimer.GetMilliseconds() / 1000.0);
+           double(captureSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
-    RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
+    if(asyncWrite)
+      RenderDoc::Inst().QueueCaptureWrite(RDCDriver::D3D11, m_CapturedFrames.back().frameNumber,
+                                          fp, props, captureWriter);
+    else
+      RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
 
     m_State = CaptureState::BackgroundCapturing;
 
@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "d3d12_command_queue.h"
+#include "common/memory_diff.h"
 #include "d3d12_command_list.h"
 #include "d3d12_resources.h"
 
@@ -501,8 +502,7 @@ void WrappedID3D12CommandQueue::ExecuteCommandListsInternal(UINT NumCommandLists
         // here AND serialise them there, but we'll play it safe.
         res->LockMaps();
 
-        size_t diffStart = 0, diffEnd = 0;
-        bool found = true;
+        rdcarray<rdcpair<size_t, size_t>> diffRanges;
 
         byte *ref = res->GetShadow(subres);
         byte *data = res->GetMap(subres);
@@ -512,18 +512,23 @@ void WrappedID3D12CommandQueue::ExecuteCommandListsInternal(UINT NumCommandLists
         if(data)
         {
           if(ref)
-            found = FindDiffRange(data, ref, size, diffStart, diffEnd);
+            FindDiffRanges(data, ref, size, diffRanges);
           else
-            diffEnd = size;
+            diffRanges.push_back({0, size});
 
-          if(found)
+          if(!diffRanges.empty())
           {
-            RDCLOG("Persistent map flush forced for %s (%llu -> %llu)",
-                   ToStr(res->GetResourceID()).c_str(), (uint64_t)diffStart, (uint64_t)diffEnd);
+            RDCLOG("Persistent map flush forced for %s (%llu -> %llu in %zu ranges)",
+                   ToStr(res->GetResourceID()).c_str(), (uint64_t)diffRanges.front().first,
+                   (uint64_t)diffRanges.back().second, diffRanges.size());
 
-            D3D12_RANGE range = {diffStart, diffEnd};
+            // each range is written separately so only the bytes that changed are serialised
+            for(const rdcpair<size_t, size_t> &diff : diffRanges)
+            {
+              D3D12_RANGE range = {diff.first, diff.second};
 
-            m_pDevice->MapDataWrite(res, subres, data, range);
+              m_pDevice->MapDataWrite(res, subres, data, range);
+            }
 
             if(ref == NULL)
             {
@@ -2127,33 +2127,46 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
     }
   }
 
-  RDCFile *rdc =
-      RenderDoc::Inst().CreateRDC(RDCDriver::D3D12, m_CapturedFrames.back().frameNumber, fp);
+  SectionProperties props;
 
-  StreamWriter *captureWriter = NULL;
+  // Compress with LZ4 so that it's fast
+  props.flags = SectionFlags::LZ4Compressed;
+  // block-indexed so that initial contents can reference identical data written earlier
+  if(RenderDoc::Inst().IsCaptureBlobDeduplication())
+    props.flags |= SectionFlags::BlockIndexed;
+  props.version = m_SectionVersion;
+  props.type = SectionType::FrameCapture;
 
-  if(rdc)
-  {
-    SectionProperties props;
+  const bool asyncWrite = RenderDoc::Inst().IsCaptureWritingAsync();
 
-    // Compress with LZ4 so that it's fast
-    props.flags = SectionFlags::LZ4Compressed;
-    props.version = m_SectionVersion;
-    props.type = SectionType::FrameCapture;
+  RDCFile *rdc = NULL;
 
-    captureWriter = rdc->WriteSection(props);
+  StreamWriter *captureWriter = NULL;
+
+  if(asyncWrite)
+  {
+    // gather the frame uncompressed in memory, the file is created and written in the background
+    captureWriter = new StreamWriter(StreamWriter::DefaultScratchSize);
   }
   else
   {
-    captureWriter = new StreamWriter(StreamWriter::InvalidStream);
+    rdc = RenderDoc::Inst().CreateRDC(RDCDriver::D3D12, m_CapturedFrames.back().frameNumber, fp);
+
+    if(rdc)
+      captureWriter = rdc->WriteSection(props);
+    else
+      captureWriter = new StreamWriter(StreamWriter::InvalidStream);
   }
 
+  uint64_t captureSize = 0;
+
   {
-    WriteSerialiser ser(captureWriter, Ownership::Stream);
+    WriteSerialiser ser(captureWriter, asyncWrite ? Ownership::Nothing : Ownership::Stream);
 
     ser.SetChunkMetadataRecording(GetThreadSerialiser().GetChunkMetadataRecording());
 
     ser.SetUserData(GetResourceManager());
+    ser.SetBlobDeduplication(bool(props.flags & SectionFlags::BlockIndexed));
 
     m_InitParams.usedDXIL = m_UsedDXIL;
 
@@ -2233,13 +2246,18 @@ bool WrappedID3D12Device::EndFrameCapture(void *dev, void *wnd)
     }
 
     RDCDEBUG("Done");
+
+    captureSize = captureWriter->GetOffset();
   }
 
   RDCLOG("Captured D3D12 frame with %f MB capture section in %f seconds",
-         double(captureWriter->GetOffset()) / (1024.0 * 1024.0),
-         m_CaptureTimer.GetMilliseconds() / 1000.0);
+         double(captureSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
-  RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
+  if(asyncWrite)
+    RenderDoc::Inst().QueueCaptureWrite(RDCDriver::D3D12, m_CapturedFrames.back().frameNumber, fp,
+                                        props, captureWriter);
+  else
+    RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
 
   m_HeaderChunk->Delete();
   m_HeaderChunk = NULL;
@@ -46,7 +46,7 @@ struct D3D12InitParams
   bool usedDXIL = false;
 
   // check if a frame capture section version is supported
-  static const uint64_t CurrentVersion = 0x9;
+  static const uint64_t CurrentVersion = 0xA;
 
   static bool IsSupportedVersion(uint64_t ver);
 };
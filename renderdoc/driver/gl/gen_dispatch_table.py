@@ -231,6 +231,7 @@ template = '''
 #define FuncWrapper{num}(ret, function{macroargs}) \\
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)({argdecl}) \\
   {{ \\
+    IDLE_CALL(function, {argpass}); \\
     SCOPED_GLCALL(function); \\
     UNINIT_CALL(function, {argpass}); \\
     return glhook.driver->function({argpass}); \\
@@ -244,6 +245,7 @@ template = '''
 #define AliasWrapper{num}(ret, function, realfunc{macroargs}) \\
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)({argdecl}) \\
   {{ \\
+    IDLE_CALL(realfunc, {argpass}); \\
     SCOPED_GLCALL(function); \\
     UNINIT_CALL(realfunc, {argpass}); \\
     return glhook.driver->realfunc({argpass}); \\
@@ -1198,6 +1198,10 @@ bool GLInitParams::IsSupportedVersion(uint64_t ver)
   if(ver == 0x21)
     return true;
 
+  // 0x23 -> 0x24 - initial contents may reference identical data earlier in the capture
+  if(ver == 0x23)
+    return true;
+
   return false;
 }
 
@@ -6390,6 +6390,7 @@
 #define FuncWrapper0(ret, function) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)() \
   { \
+    IDLE_CALL(function, ); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, ); \
     return glhook.driver->function(); \
@@ -6403,6 +6404,7 @@
 #define AliasWrapper0(ret, function, realfunc) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)() \
   { \
+    IDLE_CALL(realfunc, ); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, ); \
     return glhook.driver->realfunc(); \
@@ -6439,6 +6441,7 @@
 #define FuncWrapper1(ret, function, t1, p1) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1) \
   { \
+    IDLE_CALL(function, p1); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1); \
     return glhook.driver->function(p1); \
@@ -6452,6 +6455,7 @@
 #define AliasWrapper1(ret, function, realfunc, t1, p1) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1) \
   { \
+    IDLE_CALL(realfunc, p1); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1); \
     return glhook.driver->realfunc(p1); \
@@ -6488,6 +6492,7 @@
 #define FuncWrapper2(ret, function, t1, p1, t2, p2) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2) \
   { \
+    IDLE_CALL(function, p1, p2); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2); \
     return glhook.driver->function(p1, p2); \
@@ -6501,6 +6506,7 @@
 #define AliasWrapper2(ret, function, realfunc, t1, p1, t2, p2) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2) \
   { \
+    IDLE_CALL(realfunc, p1, p2); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2); \
     return glhook.driver->realfunc(p1, p2); \
@@ -6537,6 +6543,7 @@
 #define FuncWrapper3(ret, function, t1, p1, t2, p2, t3, p3) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3) \
   { \
+    IDLE_CALL(function, p1, p2, p3); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3); \
     return glhook.driver->function(p1, p2, p3); \
@@ -6550,6 +6557,7 @@
 #define AliasWrapper3(ret, function, realfunc, t1, p1, t2, p2, t3, p3) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3); \
     return glhook.driver->realfunc(p1, p2, p3); \
@@ -6586,6 +6594,7 @@
 #define FuncWrapper4(ret, function, t1, p1, t2, p2, t3, p3, t4, p4) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4); \
     return glhook.driver->function(p1, p2, p3, p4); \
@@ -6599,6 +6608,7 @@
 #define AliasWrapper4(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4); \
     return glhook.driver->realfunc(p1, p2, p3, p4); \
@@ -6635,6 +6645,7 @@
 #define FuncWrapper5(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5); \
     return glhook.driver->function(p1, p2, p3, p4, p5); \
@@ -6648,6 +6659,7 @@
 #define AliasWrapper5(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5); \
@@ -6684,6 +6696,7 @@
 #define FuncWrapper6(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6); \
@@ -6697,6 +6710,7 @@
 #define AliasWrapper6(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6); \
@@ -6733,6 +6747,7 @@
 #define FuncWrapper7(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7); \
@@ -6746,6 +6761,7 @@
 #define AliasWrapper7(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7); \
@@ -6782,6 +6798,7 @@
 #define FuncWrapper8(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8); \
@@ -6795,6 +6812,7 @@
 #define AliasWrapper8(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8); \
@@ -6831,6 +6849,7 @@
 #define FuncWrapper9(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9); \
@@ -6844,6 +6863,7 @@
 #define AliasWrapper9(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9); \
@@ -6880,6 +6900,7 @@
 #define FuncWrapper10(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10); \
@@ -6893,6 +6914,7 @@
 #define AliasWrapper10(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10); \
@@ -6929,6 +6951,7 @@
 #define FuncWrapper11(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11); \
@@ -6942,6 +6965,7 @@
 #define AliasWrapper11(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11); \
@@ -6978,6 +7002,7 @@
 #define FuncWrapper12(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12); \
@@ -6991,6 +7016,7 @@
 #define AliasWrapper12(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12); \
@@ -7027,6 +7053,7 @@
 #define FuncWrapper13(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13); \
@@ -7040,6 +7067,7 @@
 #define AliasWrapper13(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13); \
@@ -7076,6 +7104,7 @@
 #define FuncWrapper14(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14); \
@@ -7089,6 +7118,7 @@
 #define AliasWrapper14(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14); \
@@ -7125,6 +7155,7 @@
 #define FuncWrapper15(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14, t15, p15) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14, t15 p15) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15); \
@@ -7138,6 +7169,7 @@
 #define AliasWrapper15(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14, t15, p15) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14, t15 p15) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15); \
@@ -7174,6 +7206,7 @@
 #define FuncWrapper16(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14, t15, p15, t16, p16) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14, t15 p15, t16 p16) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16); \
@@ -7187,6 +7220,7 @@
 #define AliasWrapper16(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14, t15, p15, t16, p16) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14, t15 p15, t16 p16) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16); \
@@ -7223,6 +7257,7 @@
 #define FuncWrapper17(ret, function, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14, t15, p15, t16, p16, t17, p17) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14, t15 p15, t16 p16, t17 p17) \
   { \
+    IDLE_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(function, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17); \
     return glhook.driver->function(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17); \
@@ -7236,6 +7271,7 @@
 #define AliasWrapper17(ret, function, realfunc, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6, t7, p7, t8, p8, t9, p9, t10, p10, t11, p11, t12, p12, t13, p13, t14, p14, t15, p15, t16, p16, t17, p17) \
   ret HOOK_CC CONCAT(function, _renderdoc_hooked)(t1 p1, t2 p2, t3 p3, t4 p4, t5 p5, t6 p6, t7 p7, t8 p8, t9 p9, t10 p10, t11 p11, t12 p12, t13 p13, t14 p14, t15 p15, t16 p16, t17 p17) \
   { \
+    IDLE_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17); \
     SCOPED_GLCALL(function); \
     UNINIT_CALL(realfunc, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17); \
     return glhook.driver->realfunc(p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17); \
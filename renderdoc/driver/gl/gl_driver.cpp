@@ -26,12 +26,17 @@
 #include "gl_driver.h"
 #include <algorithm>
 #include "common/common.h"
+#include "core/settings.h"
 #include "driver/shaders/spirv/spirv_compile.h"
 #include "jpeg-compressor/jpge.h"
 #include "serialise/rdcfile.h"
 #include "strings/string_utils.h"
 #include "gl_replay.h"
 
+RDOC_CONFIG(bool, OpenGL_CacheDecodedChunks, false,
+            "Keep the frame's chunks in decoded form after the first replay, so that replaying "
+            "to a different event doesn't need to deserialise the capture again.");
+
 std::map<uint64_t, GLWindowingData> WrappedOpenGL::m_ActiveContexts;
 
 void WrappedOpenGL::BuildGLExtensions()
@@ -928,6 +933,7 @@ WrappedOpenGL::~WrappedOpenGL()
 
   m_ArrayMS.Destroy();
 
+  m_DecodeCache.Clear();
   SAFE_DELETE(m_FrameReader);
 
   GetResourceManager()->ClearReferencedResources();
@@ -1009,7 +1015,45 @@ void WrappedOpenGL::CheckImplicitThread()
 
 WrappedOpenGL::ContextData &WrappedOpenGL::GetCtxData()
 {
-  return m_ContextData[GetCtx().ctx];
+  GLContextTLSData *tls = (GLContextTLSData *)Threading::GetTLSValue(m_CurCtxDataTLS);
+  if(tls == NULL)
+    return m_ContextData[m_EmptyTLSData.ctxPair.ctx];
+
+  if(tls->ctxData == NULL)
+    tls->ctxData = &m_ContextData[tls->ctxPair.ctx];
+
+  return *(ContextData *)tls->ctxData;
+}
+
+void WrappedOpenGL::ForgetContextData(void *ctx)
+{
+  auto it = m_ContextData.find(ctx);
+  if(it == m_ContextData.end())
+    return;
+
+  for(GLContextTLSData *tls : m_CtxDataVector)
+  {
+    if(tls->ctxData == &it->second)
+      tls->ctxData = NULL;
+  }
+}
+
+void WrappedOpenGL::BlockIdleCalls()
+{
+  Atomic::Inc32(&m_IdleCallsBlocked);
+
+  // any thread that got past the check before we blocked it is only calling into GL, which won't
+  // take long. Wait for them so that nothing can be half-way through a call once we change state.
+  for(GLContextTLSData *tls : m_CtxDataVector)
+  {
+    while(Atomic::CmpExch32(&tls->idleCalls, 0, 0) != 0)
+      Threading::Sleep(0);
+  }
+}
+
+void WrappedOpenGL::UnblockIdleCalls()
+{
+  Atomic::Dec32(&m_IdleCallsBlocked);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -1079,6 +1123,7 @@ void WrappedOpenGL::DeleteContext(void *contextHandle)
     ctxdata.UnassociateWindow(this, wndHandle);
   }
 
+  ForgetContextData(contextHandle);
   m_ContextData.erase(contextHandle);
 }
 
@@ -1228,6 +1273,7 @@ void WrappedOpenGL::UnregisterReplayContext(GLWindowingData windata)
     delete ctxdata.shareGroup;
   }
 
+  ForgetContextData(contextHandle);
   m_ContextData.erase(contextHandle);
 }
 
@@ -1354,11 +1400,13 @@ void WrappedOpenGL::ActivateContext(GLWindowingData winData)
     {
       tlsData->ctxPair = {winData.ctx, GetShareGroup(winData.ctx)};
       tlsData->ctxRecord = ctxdata.m_ContextDataRecord;
+      tlsData->ctxData = &ctxdata;
     }
     else
     {
       tlsData = new GLContextTLSData(ContextPair({winData.ctx, GetShareGroup(winData.ctx)}),
                                      ctxdata.m_ContextDataRecord);
+      tlsData->ctxData = &ctxdata;
       m_CtxDataVector.push_back(tlsData);
 
       Threading::SetTLSValue(m_CurCtxDataTLS, tlsData);
@@ -2164,7 +2212,11 @@ void WrappedOpenGL::StartFrameCapture(void *dev, void *wnd)
 
   SCOPED_LOCK(glLock);
 
+  // once we're active capturing hooks stop bypassing the driver by themselves, we only need to
+  // block them until the state has changed.
+  BlockIdleCalls();
   m_State = CaptureState::ActiveCapturing;
+  UnblockIdleCalls();
 
   GetResourceManager()->ResetCaptureStartTime();
 
@@ -2259,39 +2311,53 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
     if(bbim == NULL)
       bbim = SaveBackbufferImage();
 
-    RDCFile *rdc =
-        RenderDoc::Inst().CreateRDC(GetDriverType(), m_CapturedFrames.back().frameNumber, bbim[0]);
+    SectionProperties props;
 
-    SAFE_DELETE(bbim);
+    // Compress with LZ4 so that it's fast
+    props.flags = SectionFlags::LZ4Compressed;
+    // block-indexed so that initial contents can reference identical data written earlier
+    if(RenderDoc::Inst().IsCaptureBlobDeduplication())
+      props.flags |= SectionFlags::BlockIndexed;
+    props.version = m_SectionVersion;
+    props.type = SectionType::FrameCapture;
 
-    for(auto it = m_BackbufferImages.begin(); it != m_BackbufferImages.end(); ++it)
-      delete it->second;
-    m_BackbufferImages.clear();
+    const bool asyncWrite = RenderDoc::Inst().IsCaptureWritingAsync();
+
+    RDCFile *rdc = NULL;
 
     StreamWriter *captureWriter = NULL;
 
-    if(rdc)
+    if(asyncWrite)
     {
-      SectionProperties props;
-
-      // Compress with LZ4 so that it's fast
-      props.flags = SectionFlags::LZ4Compressed;
-      props.version = m_SectionVersion;
-      props.type = SectionType::FrameCapture;
-
-      captureWriter = rdc->WriteSection(props);
+      // gather the frame uncompressed in memory, the file is created and written in the background
+      captureWriter = new StreamWriter(StreamWriter::DefaultScratchSize);
     }
     else
     {
-      captureWriter = new StreamWriter(StreamWriter::InvalidStream);
+      rdc = RenderDoc::Inst().CreateRDC(GetDriverType(), m_CapturedFrames.back().frameNumber,
+                                        bbim[0]);
+
+      SAFE_DELETE(bbim);
+
+      if(rdc)
+        captureWriter = rdc->WriteSection(props);
+      else
+        captureWriter = new StreamWriter(StreamWriter::InvalidStream);
     }
 
+    for(auto it = m_BackbufferImages.begin(); it != m_BackbufferImages.end(); ++it)
+      delete it->second;
+    m_BackbufferImages.clear();
+
+    uint64_t captureSize = 0;
+
     {
-      WriteSerialiser ser(captureWriter, Ownership::Stream);
+      WriteSerialiser ser(captureWriter, asyncWrite ? Ownership::Nothing : Ownership::Stream);
 
       ser.SetChunkMetadataRecording(m_ScratchSerialiser.GetChunkMetadataRecording());
 
       ser.SetUserData(GetResourceManager());
+      ser.SetBlobDeduplication(bool(props.flags & SectionFlags::BlockIndexed));
 
       {
         // we no longer use this one, but for ease of compatibility we still serialise it here. This
@@ -2371,13 +2437,23 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
 
         RDCDEBUG("Done");
       }
+
+      captureSize = captureWriter->GetOffset();
     }
 
     RDCLOG("Captured GL frame with %f MB capture section in %f seconds",
-           double(captureWriter->GetOffset()) / (1024.0 * 1024.0),
-           m_CaptureTimer.GetMilliseconds() / 1000.0);
+           double(captureSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
-    RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
+    if(asyncWrite)
+    {
+      RenderDoc::Inst().QueueCaptureWrite(GetDriverType(), m_CapturedFrames.back().frameNumber,
+                                          bbim[0], props, captureWriter);
+      SAFE_DELETE(bbim);
+    }
+    else
+    {
+      RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
+    }
 
     m_State = CaptureState::BackgroundCapturing;
 
@@ -3324,10 +3400,15 @@ ReplayStatus WrappedOpenGL::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
     {
       GetReplay()->WriteFrameRecord().frameInfo.fileOffset = offsetStart;
 
-      // read the remaining data into memory and pass to immediate context
+      // the remaining data is the frame, which is passed to the immediate context
       frameDataSize = reader->GetSize() - reader->GetOffset();
 
-      m_FrameReader = new StreamReader(reader, frameDataSize);
+      // if the frame can be seeked without decompressing it from the start, read it from the file
+      // each time it's replayed instead of keeping a decompressed copy in memory.
+      m_FrameReader = rdc->ReadSectionRange(sectionIdx, reader->GetOffset(), frameDataSize);
+
+      if(!m_FrameReader)
+        m_FrameReader = new StreamReader(reader, frameDataSize);
 
       rdcarray<DebugMessage> savedDebugMessages;
 
@@ -5033,6 +5114,18 @@ ReplayStatus WrappedOpenGL::ContextReplayLog(CaptureState readType, uint32_t sta
 
     m_StructuredFile = &ser.GetStructuredFile();
   }
+  else if(OpenGL_CacheDecodedChunks())
+  {
+    // resources are looked up while decoding, so if they've changed anything cached is stale. This
+    // includes any resources created within the frame, which are re-created on every replay.
+    if(m_DecodeCacheGeneration != GetResourceManager()->GetLiveGeneration())
+    {
+      m_DecodeCache.Clear();
+      m_DecodeCacheGeneration = GetResourceManager()->GetLiveGeneration();
+    }
+
+    ser.SetDecodeCache(&m_DecodeCache);
+  }
 
   SystemChunk header = ser.ReadChunk<SystemChunk>();
   RDCASSERTEQUAL(header, SystemChunk::CaptureBegin);
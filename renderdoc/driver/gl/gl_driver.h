@@ -59,7 +59,7 @@ struct GLInitParams
   rdcstr renderer, version;
 
   // check if a frame capture section version is supported
-  static const uint64_t CurrentVersion = 0x23;
+  static const uint64_t CurrentVersion = 0x24;
   static bool IsSupportedVersion(uint64_t ver);
 };
 
@@ -172,6 +172,10 @@ private:
 
   StreamReader *m_FrameReader = NULL;
 
+  // decoded chunks from m_FrameReader, valid as long as the live resource generation matches
+  ChunkDecodeCache m_DecodeCache;
+  uint64_t m_DecodeCacheGeneration = 0;
+
   static std::map<uint64_t, GLWindowingData> m_ActiveContexts;
 
   void *m_LastCtx;
@@ -181,6 +185,13 @@ private:
   uint64_t m_CurCtxDataTLS;
   rdcarray<GLContextTLSData *> m_CtxDataVector;
 
+  // set while a capture is starting, to keep hooks on the idle fast path out of the driver
+  int32_t m_IdleCallsBlocked = 0;
+
+  void BlockIdleCalls();
+  void UnblockIdleCalls();
+  void ForgetContextData(void *ctx);
+
   uint32_t m_InternalShader = 0;
 
   rdcarray<GLWindowingData> m_LastContexts;
@@ -609,6 +620,29 @@ public:
 
   void CheckImplicitThread();
 
+  // While background capturing, calls that only set context state don't need anything from the
+  // driver and can go straight to GL without taking glLock. This marks the calling thread as being
+  // in such a call and returns its TLS data, or NULL if the call must go through the driver as
+  // normal. A non-NULL return must be paired with EndIdleCall.
+  GLContextTLSData *BeginIdleCall()
+  {
+    GLContextTLSData *tls = (GLContextTLSData *)Threading::GetTLSValue(m_CurCtxDataTLS);
+    if(tls == NULL)
+      return NULL;
+
+    // this is a full barrier, so either a capture starting sees us as in-flight and waits, or we
+    // see it blocking us here.
+    Atomic::Inc32(&tls->idleCalls);
+
+    if(m_IdleCallsBlocked == 0 && IsBackgroundCapturing(m_State))
+      return tls;
+
+    Atomic::Dec32(&tls->idleCalls);
+    return NULL;
+  }
+
+  void EndIdleCall(GLContextTLSData *tls) { Atomic::Dec32(&tls->idleCalls); }
+
   void CreateTextureImage(GLuint tex, GLenum internalFormat, GLenum initFormatHint,
                           GLenum initTypeHint, GLenum textype, GLint dim, GLint width, GLint height,
                           GLint depth, GLint samples, int mips);
@@ -154,6 +154,94 @@ void default_ret()
 
 #endif
 
+// functions that while background capturing only set context state, so the driver does nothing
+// but pass them on to GL. When idle these skip glLock and go to GL directly.
+template <GLChunk chunk>
+struct GLIdlePassthrough
+{
+  static const bool value = false;
+};
+
+#define IDLE_PASSTHROUGH(function)            \
+  template <>                                 \
+  struct GLIdlePassthrough<GLChunk::function> \
+  {                                           \
+    static const bool value = true;           \
+  }
+
+IDLE_PASSTHROUGH(glBlendColor);
+IDLE_PASSTHROUGH(glBlendEquation);
+IDLE_PASSTHROUGH(glBlendEquationi);
+IDLE_PASSTHROUGH(glBlendEquationSeparate);
+IDLE_PASSTHROUGH(glBlendEquationSeparatei);
+IDLE_PASSTHROUGH(glBlendFunc);
+IDLE_PASSTHROUGH(glBlendFunci);
+IDLE_PASSTHROUGH(glBlendFuncSeparate);
+IDLE_PASSTHROUGH(glBlendFuncSeparatei);
+IDLE_PASSTHROUGH(glClearColor);
+IDLE_PASSTHROUGH(glClearDepth);
+IDLE_PASSTHROUGH(glClearDepthf);
+IDLE_PASSTHROUGH(glClearStencil);
+IDLE_PASSTHROUGH(glColorMask);
+IDLE_PASSTHROUGH(glColorMaski);
+IDLE_PASSTHROUGH(glCullFace);
+IDLE_PASSTHROUGH(glDepthBoundsEXT);
+IDLE_PASSTHROUGH(glDepthFunc);
+IDLE_PASSTHROUGH(glDepthMask);
+IDLE_PASSTHROUGH(glDepthRange);
+IDLE_PASSTHROUGH(glDepthRangef);
+IDLE_PASSTHROUGH(glDepthRangeArrayv);
+IDLE_PASSTHROUGH(glDepthRangeIndexed);
+IDLE_PASSTHROUGH(glDisablei);
+IDLE_PASSTHROUGH(glEnablei);
+IDLE_PASSTHROUGH(glFrontFace);
+IDLE_PASSTHROUGH(glHint);
+IDLE_PASSTHROUGH(glLineWidth);
+IDLE_PASSTHROUGH(glLogicOp);
+IDLE_PASSTHROUGH(glMinSampleShading);
+IDLE_PASSTHROUGH(glPatchParameteri);
+IDLE_PASSTHROUGH(glPointParameterf);
+IDLE_PASSTHROUGH(glPointParameteri);
+IDLE_PASSTHROUGH(glPointSize);
+IDLE_PASSTHROUGH(glPolygonMode);
+IDLE_PASSTHROUGH(glPolygonOffset);
+IDLE_PASSTHROUGH(glPolygonOffsetClamp);
+IDLE_PASSTHROUGH(glPrimitiveRestartIndex);
+IDLE_PASSTHROUGH(glProvokingVertex);
+IDLE_PASSTHROUGH(glSampleCoverage);
+IDLE_PASSTHROUGH(glSampleMaski);
+IDLE_PASSTHROUGH(glScissor);
+IDLE_PASSTHROUGH(glScissorArrayv);
+IDLE_PASSTHROUGH(glStencilFunc);
+IDLE_PASSTHROUGH(glStencilFuncSeparate);
+IDLE_PASSTHROUGH(glStencilMask);
+IDLE_PASSTHROUGH(glStencilMaskSeparate);
+IDLE_PASSTHROUGH(glStencilOp);
+IDLE_PASSTHROUGH(glStencilOpSeparate);
+IDLE_PASSTHROUGH(glViewport);
+IDLE_PASSTHROUGH(glViewportArrayv);
+
+struct ScopedIdleCall
+{
+  ScopedIdleCall(WrappedOpenGL *driver) : driver(driver), tls(driver->BeginIdleCall()) {}
+  ~ScopedIdleCall()
+  {
+    if(tls)
+      driver->EndIdleCall(tls);
+  }
+  WrappedOpenGL *driver;
+  GLContextTLSData *tls;
+};
+
+// the check on the function is constant, so this compiles away for anything not listed above
+#define IDLE_CALL(function, ...)                                    \
+  if(GLIdlePassthrough<GLChunk::function>::value && glhook.enabled) \
+  {                                                                 \
+    ScopedIdleCall idle(glhook.driver);                             \
+    if(idle.tls)                                                    \
+      return GL.function(__VA_ARGS__);                              \
+  }
+
 DefineSupportedHooks();
 DefineUnsupportedHooks();
 
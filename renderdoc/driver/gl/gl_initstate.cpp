@@ -1151,7 +1151,8 @@ bool GLResourceManager::Serialise_InitialState(SerialiserType &ser, ResourceId i
 
     // not using SERIALISE_ELEMENT_ARRAY so we can deliberately avoid allocation - we serialise
     // directly into upload memory
-    ser.Serialise("BufferContents"_lit, BufferContents, BufferContentsSize, SerialiserFlags::NoFlags);
+    ser.Serialise("BufferContents"_lit, BufferContents, BufferContentsSize,
+                  SerialiserFlags::Deduplicate);
 
     if(mappedBuffer.name)
       GL.glUnmapNamedBufferEXT(mappedBuffer.name);
@@ -1656,8 +1657,11 @@ bool GLResourceManager::Serialise_InitialState(SerialiserType &ser, ResourceId i
                 }
               }
 
-              // serialise without allocating memory as we already have our scratch buf sized.
-              ser.Serialise("SubresourceContents"_lit, scratchBuf, size, SerialiserFlags::NoFlags);
+              // serialise without allocating memory as we already have our scratch buf sized. If
+              // the contents are resident in the stream we use them in place rather than copying.
+              byte *contents = scratchBuf;
+              ser.Serialise("SubresourceContents"_lit, contents, size,
+                            SerialiserFlags::InPlace | SerialiserFlags::Deduplicate);
 
               // on replay, restore the data into the initial contents texture
               if(IsReplayingAndReading() && !ser.IsErrored())
@@ -1670,32 +1674,32 @@ bool GLResourceManager::Serialise_InitialState(SerialiserType &ser, ResourceId i
                         IsCubeFace(targets[trg]) ? CubeTargetIndex(targets[trg]) * size : 0;
 
                     details.compressedData[i].resize(startOffs + size);
-                    memcpy(details.compressedData[i].data() + startOffs, scratchBuf, size);
+                    memcpy(details.compressedData[i].data() + startOffs, contents, size);
                   }
 
                   if(texDim == 1)
                     GL.glCompressedTextureSubImage1DEXT(tex, targets[trg], i, 0, w,
                                                         TextureState.internalformat, (GLsizei)size,
-                                                        scratchBuf);
+                                                        contents);
                   else if(texDim == 2)
                     GL.glCompressedTextureSubImage2DEXT(tex, targets[trg], i, 0, 0, w, h,
                                                         TextureState.internalformat, (GLsizei)size,
-                                                        scratchBuf);
+                                                        contents);
                   else if(texDim == 3)
                     GL.glCompressedTextureSubImage3DEXT(tex, targets[trg], i, 0, 0, 0, w, h, d,
                                                         TextureState.internalformat, (GLsizei)size,
-                                                        scratchBuf);
+                                                        contents);
                 }
                 else
                 {
                   if(texDim == 1)
-                    GL.glTextureSubImage1DEXT(tex, targets[trg], i, 0, w, fmt, type, scratchBuf);
+                    GL.glTextureSubImage1DEXT(tex, targets[trg], i, 0, w, fmt, type, contents);
                   else if(texDim == 2)
                     GL.glTextureSubImage2DEXT(tex, targets[trg], i, 0, 0, w, h, fmt, type,
-                                              scratchBuf);
+                                              contents);
                   else if(texDim == 3)
                     GL.glTextureSubImage3DEXT(tex, targets[trg], i, 0, 0, 0, w, h, d, fmt, type,
-                                              scratchBuf);
+                                              contents);
                 }
               }
             }
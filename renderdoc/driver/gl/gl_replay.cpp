@@ -3690,6 +3690,13 @@ rdcarray<ShaderDebugState> GLReplay::ContinueDebug(ShaderDebugger *debugger)
   return {};
 }
 
+rdcarray<ShaderDebugState> GLReplay::RunDebug(ShaderDebugger *debugger,
+                                              const rdcarray<uint32_t> &breakpoints)
+{
+  GLNOTIMP("RunDebug");
+  return {};
+}
+
 void GLReplay::FreeDebugger(ShaderDebugger *debugger)
 {
   delete debugger;
@@ -243,6 +243,9 @@ struct GLResourceRecord : public ResourceRecord
     bool orphaned;
     bool persistent;
     byte *ptr;
+    // for coherent persistent maps, tracks pages written since they were last compared against
+    // the shadow storage, if that's possible.
+    MemoryTracking::Region *writeTracking;
   } Map;
 
   void VerifyDataType(GLenum target)
@@ -311,6 +314,10 @@ struct GLResourceRecord : public ResourceRecord
     }
     ShadowPtr[0] = ShadowPtr[1] = NULL;
     ShadowSize = 0;
+
+    // tracking is only useful while there's something to compare against
+    MemoryTracking::EndTracking(Map.writeTracking);
+    Map.writeTracking = NULL;
   }
 
   byte *GetShadowPtr(int p) { return ShadowPtr[p]; }
@@ -325,4 +332,9 @@ struct GLContextTLSData
   GLContextTLSData(ContextPair p, GLResourceRecord *r) : ctxPair(p), ctxRecord(r) {}
   ContextPair ctxPair;
   GLResourceRecord *ctxRecord;
+  // the WrappedOpenGL::ContextData for ctxPair.ctx, cached to avoid looking it up on every call.
+  // Cleared if the context is deleted
+  void *ctxData = NULL;
+  // non-zero while this thread is in a hook that's bypassing the driver, see BeginIdleCall()
+  int32_t idleCalls = 0;
 };
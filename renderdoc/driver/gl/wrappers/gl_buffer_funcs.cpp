@@ -25,6 +25,7 @@
 
 #include "../gl_driver.h"
 #include "common/common.h"
+#include "common/memory_diff.h"
 #include "strings/string_utils.h"
 #include "tinyfiledialogs/tinyfiledialogs.h"
 
@@ -403,7 +404,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferStorageEXT(SerialiserType &ser, GLuin
   SERIALISE_ELEMENT_LOCAL(buffer, BufferRes(GetCtx(), bufferHandle));
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(data, bytesize);
 
   if(ser.IsWriting())
   {
@@ -548,7 +549,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferDataEXT(SerialiserType &ser, GLuint b
   SERIALISE_ELEMENT_LOCAL(buffer, BufferRes(GetCtx(), bufferHandle));
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(data, bytesize);
 
   if(ser.IsWriting())
   {
@@ -904,7 +905,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferSubDataEXT(SerialiserType &ser, GLuin
   SERIALISE_ELEMENT_LOCAL(offset, (uint64_t)offsetPtr);
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(data, bytesize);
 
   SERIALISE_CHECK_READ_ERRORS();
 
@@ -2554,7 +2555,7 @@ bool WrappedOpenGL::Serialise_glUnmapNamedBufferEXT(SerialiserType &ser, GLuint
   SERIALISE_ELEMENT(diffStart);
   SERIALISE_ELEMENT(diffEnd);
 
-  SERIALISE_ELEMENT_ARRAY(MapWrittenData, length);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(MapWrittenData, length);
 
   SERIALISE_CHECK_READ_ERRORS();
 
@@ -2597,6 +2598,10 @@ GLboolean WrappedOpenGL::glUnmapNamedBufferEXT(GLuint buffer)
 
     GetResourceManager()->MarkResourceFrameReferenced(record, eFrameRef_ReadBeforeWrite);
 
+    // stop tracking writes before the pointer becomes invalid
+    MemoryTracking::EndTracking(record->Map.writeTracking);
+    record->Map.writeTracking = NULL;
+
     GLboolean ret = GL_TRUE;
 
     switch(status)
@@ -2737,7 +2742,7 @@ bool WrappedOpenGL::Serialise_glFlushMappedNamedBufferRangeEXT(SerialiserType &s
     MapOffset = record->Map.offset;
   }
 
-  SERIALISE_ELEMENT_ARRAY(FlushedData, length);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(FlushedData, length);
 
   if(ser.VersionAtLeast(0x1F))
   {
@@ -2931,27 +2936,51 @@ void WrappedOpenGL::PersistentMapMemoryBarrier(const std::set<GLResourceRecord *
 
     RDCASSERT(record && record->Map.ptr);
 
-    if(record->Map.ptr)
+    if(record->Map.ptr == NULL)
+      continue;
+
+    if(record->GetShadowPtr(0) == NULL)
     {
-      size_t diffStart = 0, diffEnd = record->Map.length;
-      bool found = true;
+      record->AllocShadowStorage(record->Map.length);
+
+      // start tracking writes before taking the snapshot to compare against, so that no write
+      // after the snapshot can be missed.
+      record->Map.writeTracking =
+          MemoryTracking::BeginTracking(record->Map.ptr, (size_t)record->Map.length);
 
-      if(record->GetShadowPtr(0))
-        found = FindDiffRange(record->GetShadowPtr(0), record->Map.ptr, (size_t)record->Map.length,
-                              diffStart, diffEnd);
+      memcpy(record->GetShadowPtr(0), record->Map.ptr, (size_t)record->Map.length);
 
-      if(found && diffEnd > diffStart)
+      // nothing to compare against the first time, so serialise everything. We use our own flush
+      // function so it will serialise chunks when necessary, and it also handles copying into the
+      // persistent mapped pointer and flushing the real GL buffer
+      gl_CurChunk = GLChunk::CoherentMapWrite;
+      glFlushMappedNamedBufferRangeEXT(record->Resource.name, 0, record->Map.length);
+      continue;
+    }
+
+    // if we're tracking writes, only the pages written since the last check need comparing
+    rdcarray<rdcpair<size_t, size_t>> searchRanges;
+    if(record->Map.writeTracking)
+      MemoryTracking::GetAndResetDirtyRanges(record->Map.writeTracking, searchRanges);
+    else
+      searchRanges.push_back({0, (size_t)record->Map.length});
+
+    rdcarray<rdcpair<size_t, size_t>> diffRanges;
+    for(const rdcpair<size_t, size_t> &search : searchRanges)
+    {
+      FindDiffRanges(record->GetShadowPtr(0) + search.first, record->Map.ptr + search.first,
+                     search.second - search.first, diffRanges);
+
+      // each changed range is flushed separately so only the bytes that changed are serialised
+      for(const rdcpair<size_t, size_t> &diff : diffRanges)
       {
+        size_t diffStart = search.first + diff.first;
+        size_t diffEnd = search.first + diff.second;
+
         // update the modified region in the 'comparison' shadow buffer for next check
-        if(record->GetShadowPtr(0) == NULL)
-          record->AllocShadowStorage(record->Map.length);
-        else
-          memcpy(record->GetShadowPtr(0) + diffStart, record->Map.ptr + diffStart,
-                 diffEnd - diffStart);
+        memcpy(record->GetShadowPtr(0) + diffStart, record->Map.ptr + diffStart,
+               diffEnd - diffStart);
 
-        // we use our own flush function so it will serialise chunks when necessary, and it
-        // also handles copying into the persistent mapped pointer and flushing the real GL
-        // buffer
         gl_CurChunk = GLChunk::CoherentMapWrite;
         glFlushMappedNamedBufferRangeEXT(record->Resource.name, GLintptr(diffStart),
                                          GLsizeiptr(diffEnd - diffStart));
@@ -2555,7 +2555,7 @@ bool WrappedOpenGL::Serialise_glTextureImage1DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, 1, 1, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -2781,7 +2781,7 @@ bool WrappedOpenGL::Serialise_glTextureImage2DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, height, 1, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3037,7 +3037,7 @@ bool WrappedOpenGL::Serialise_glTextureImage3DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, height, depth, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3268,7 +3268,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage1DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3589,7 +3589,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage2DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3850,7 +3850,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage3DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -5515,6 +5515,71 @@ rdcarray<ShaderDebugState> InterpretDebugger::ContinueDebug(DXBCDebug::DebugAPIW
   return ret;
 }
 
+rdcarray<ShaderDebugState> InterpretDebugger::RunDebug(DXBCDebug::DebugAPIWrapper *apiWrapper,
+                                                       const rdcarray<uint32_t> &breakpoints)
+{
+  DXBCDebug::ThreadState &active = activeLane();
+
+  rdcarray<ShaderDebugState> ret;
+
+  // if we've finished, return an empty set to signify that
+  if(active.Finished())
+    return ret;
+
+  // the initial state is implicit, we only ever return the state where we stop. Don't stop on a
+  // breakpoint at the current position, otherwise running again would never make progress.
+  bool moved = false;
+  if(steps == 0)
+  {
+    steps++;
+    moved = true;
+  }
+
+  rdcarray<DXBCDebug::ThreadState> oldworkgroup = workgroup;
+
+  rdcarray<bool> activeMask;
+
+  while(!active.Finished())
+  {
+    if(moved && breakpoints.contains(active.nextInstruction))
+      break;
+
+    for(size_t i = 0; i < oldworkgroup.size(); i++)
+      oldworkgroup[i].variables = workgroup[i].variables;
+
+    CalcActiveMask(activeMask);
+
+    for(int i = 0; i < workgroup.count(); i++)
+    {
+      if(activeMask[i])
+      {
+        workgroup[i].StepNext(NULL, apiWrapper, oldworkgroup);
+
+        if(i == activeLaneIndex)
+        {
+          steps++;
+          moved = true;
+        }
+      }
+    }
+  }
+
+  // return the complete set of values at the stop point, as if every variable had just been
+  // assigned
+  ShaderDebugState state;
+
+  for(const ShaderVariable &v : active.variables)
+    state.changes.push_back({ShaderVariable(), v});
+
+  state.stepIndex = steps - 1;
+  state.nextInstruction = active.nextInstruction;
+  dxbc->FillStateInstructionInfo(state);
+
+  ret.push_back(state);
+
+  return ret;
+}
+
 };    // namespace ShaderDebug
 
 #if ENABLED(ENABLE_UNIT_TESTS)
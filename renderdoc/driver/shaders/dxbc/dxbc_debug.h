@@ -347,6 +347,8 @@ struct InterpretDebugger : public ShaderDebugger
 
   void CalcActiveMask(rdcarray<bool> &activeMask);
   rdcarray<ShaderDebugState> ContinueDebug(DebugAPIWrapper *apiWrapper);
+  rdcarray<ShaderDebugState> RunDebug(DebugAPIWrapper *apiWrapper,
+                                      const rdcarray<uint32_t> &breakpoints);
 };
 
 uint32_t GetLogicalIdentifierForBindingSlot(const DXBCBytecode::Program &program,
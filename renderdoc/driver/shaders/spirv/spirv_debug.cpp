@@ -70,6 +70,8 @@ ThreadState::ThreadState(uint32_t workgroupIdx, Debugger &debug, const GlobalSta
   nextInstruction = 0;
   helperInvocation = false;
   killed = false;
+
+  variables.resize(debugger.GetNumVariables());
 }
 
 ThreadState::~ThreadState()
@@ -92,13 +94,12 @@ void ThreadState::FillCallstack(ShaderDebugState &state)
 
 void ThreadState::EnterFunction(const rdcarray<Id> &arguments)
 {
-  Iter it = debugger.GetIterForInstruction(nextInstruction);
+  uint32_t inst = nextInstruction;
 
-  RDCASSERT(OpDecoder(it).op == Op::Function);
+  RDCASSERT(debugger.GetDecodedInstruction(inst).op == Op::Function);
 
-  OpFunction func(it);
   StackFrame *frame = new StackFrame();
-  frame->function = func.result;
+  frame->function = debugger.GetDecodedInstruction(inst).result;
 
   // if there's a previous stack frame, save its live list
   if(!callstack.empty())
@@ -115,19 +116,23 @@ void ThreadState::EnterFunction(const rdcarray<Id> &arguments)
 
   callstack.push_back(frame);
 
-  it++;
+  inst++;
+
+  auto isLine = [this](uint32_t i) {
+    Op op = debugger.GetDecodedInstruction(i).op;
+    return op == Op::Line || op == Op::NoLine;
+  };
 
   size_t arg = 0;
-  while(OpDecoder(it).op == Op::FunctionParameter || OpDecoder(it).op == Op::Line ||
-        OpDecoder(it).op == Op::NoLine)
+  while(debugger.GetDecodedInstruction(inst).op == Op::FunctionParameter || isLine(inst))
   {
-    if(OpDecoder(it).op == Op::Line || OpDecoder(it).op == Op::NoLine)
+    if(isLine(inst))
     {
-      it++;
+      inst++;
       continue;
     }
 
-    OpFunctionParameter param(it);
+    const DecodedInstruction &param = debugger.GetDecodedInstruction(inst);
 
     if(arg <= arguments.size())
     {
@@ -136,7 +141,7 @@ void ThreadState::EnterFunction(const rdcarray<Id> &arguments)
       // copied in and points to whatever storage that is.
       // That means we don't have to allocate anything here, we just set up the ID and copy the
       // value from the argument
-      SetDst(param.result, ids[arguments[arg]]);
+      SetDst(param.result, GetSrc(arguments[arg]));
     }
     else
     {
@@ -144,47 +149,45 @@ void ThreadState::EnterFunction(const rdcarray<Id> &arguments)
     }
 
     arg++;
-    it++;
+    inst++;
   }
 
-  while(OpDecoder(it).op == Op::Line || OpDecoder(it).op == Op::NoLine)
-    it++;
+  while(isLine(inst))
+    inst++;
 
   // next should be the start of the first function block
-  RDCASSERT(OpDecoder(it).op == Op::Label);
-  frame->lastBlock = frame->curBlock = OpLabel(it).result;
-  it++;
+  RDCASSERT(debugger.GetDecodedInstruction(inst).op == Op::Label);
+  frame->lastBlock = frame->curBlock = debugger.GetDecodedInstruction(inst).result;
+  inst++;
 
   size_t numVars = 0;
-  Iter varCounter = it;
-  while(OpDecoder(varCounter).op == Op::Variable || OpDecoder(varCounter).op == Op::Line ||
-        OpDecoder(varCounter).op == Op::NoLine)
+  for(uint32_t varCounter = inst;
+      debugger.GetDecodedInstruction(varCounter).op == Op::Variable || isLine(varCounter);
+      varCounter++)
   {
-    varCounter++;
-    if(OpDecoder(varCounter).op == Op::Line || OpDecoder(varCounter).op == Op::NoLine)
-      continue;
-
-    numVars++;
+    if(!isLine(varCounter))
+      numVars++;
   }
 
   frame->locals.resize(numVars);
 
   // don't add source vars for variables, we'll add it on the first store
   ShaderDebugState *state = m_State;
+  bool track = trackSourceVars;
   m_State = NULL;
+  trackSourceVars = false;
 
   size_t i = 0;
   // handle any variable declarations
-  while(OpDecoder(it).op == Op::Variable || OpDecoder(it).op == Op::Line ||
-        OpDecoder(it).op == Op::NoLine)
+  while(debugger.GetDecodedInstruction(inst).op == Op::Variable || isLine(inst))
   {
-    if(OpDecoder(it).op == Op::Line || OpDecoder(it).op == Op::NoLine)
+    if(isLine(inst))
     {
-      it++;
+      inst++;
       continue;
     }
 
-    OpVariable decl(it);
+    const DecodedInstruction &decl = debugger.GetDecodedInstruction(inst);
 
     ShaderVariable &stackvar = frame->locals[i];
     stackvar.name = debugger.GetRawName(decl.result);
@@ -193,31 +196,75 @@ void ThreadState::EnterFunction(const rdcarray<Id> &arguments)
 
     debugger.AllocateVariable(decl.result, decl.resultType, stackvar);
 
-    if(decl.HasInitializer())
-      AssignValue(stackvar, ids[decl.initializer]);
+    // the operands are the storage class and optionally an initializer
+    if(decl.numOperands > 1)
+      AssignValue(stackvar, GetSrc(Id::fromWord(debugger.GetOperands(decl)[1])));
 
     SetDst(decl.result, debugger.MakePointerVariable(decl.result, &stackvar));
 
-    it++;
+    inst++;
     i++;
   }
 
   m_State = state;
+  trackSourceVars = track;
 
   // next instruction is the first actual instruction we'll execute
-  nextInstruction = debugger.GetInstructionForIter(it);
+  nextInstruction = inst;
 
   SkipIgnoredInstructions();
 }
 
 const ShaderVariable &ThreadState::GetSrc(Id id) const
 {
-  return ids[id];
+  uint32_t slot = debugger.GetValueSlot(id);
+
+  if(slot == Debugger::NoSlot)
+  {
+    static const ShaderVariable empty;
+    return empty;
+  }
+
+  if(slot & Debugger::VariableSlot)
+    return variables[slot & ~Debugger::VariableSlot];
+
+  return debugger.ReadRegister(slot, workgroupIndex);
+}
+
+void ThreadState::SetValue(Id id, const ShaderVariable &val)
+{
+  uint32_t slot = debugger.GetValueSlot(id);
+
+  // e.g. the result of a function call returning void
+  if(slot == Debugger::NoSlot)
+    return;
+
+  if(slot & Debugger::VariableSlot)
+  {
+    ShaderVariable &var = variables[slot & ~Debugger::VariableSlot];
+    var = val;
+    var.name.clear();
+    return;
+  }
+
+  // slots are assigned by type, so only scalars and vectors should get here
+  RDCASSERT(val.members.empty() && val.type != VarType::GPUPointer, val.type);
+
+  debugger.WriteRegister(slot, workgroupIndex, val);
+}
+
+ShaderVariable ThreadState::GetDebugValue(Id id) const
+{
+  ShaderVariable var = GetSrc(id);
+  var.name = debugger.GetRawName(id);
+  return debugger.GetPointerValue(var);
 }
 
 void ThreadState::WritePointerValue(Id pointer, const ShaderVariable &val)
 {
-  RDCASSERT(ids[pointer].type == VarType::GPUPointer);
+  const ShaderVariable var = GetSrc(pointer);
+
+  RDCASSERT(var.type == VarType::GPUPointer);
 
   // this is the only place we don't use SetDst because it's the only place that "violates" SSA
   // i.e. changes an existing value. That way SetDst can always unconditionally assign values,
@@ -225,12 +272,13 @@ void ThreadState::WritePointerValue(Id pointer, const ShaderVariable &val)
 
   if(!m_State)
   {
-    debugger.WriteThroughPointer(ids[pointer], val);
+    if(trackSourceVars)
+      ReferencePointer(debugger.GetPointerBaseId(var));
+
+    debugger.WriteThroughPointer(var, val);
   }
   else
   {
-    ShaderVariable &var = ids[pointer];
-
     if(ContainsNaNInf(val))
       m_State->flags |= ShaderEvents::GeneratedNanOrInf;
 
@@ -242,18 +290,18 @@ void ThreadState::WritePointerValue(Id pointer, const ShaderVariable &val)
 
     ShaderVariableChange basechange;
 
-    if(debugger.IsOpaquePointer(ids[ptrid]))
+    if(debugger.IsOpaquePointer(GetSrc(ptrid)))
     {
       // if this is a write to a SSBO pointer, don't record any alias changes, just record a no-op
       // change to this pointer
-      basechange.after = basechange.before = debugger.GetPointerValue(ids[pointer]);
+      basechange.after = basechange.before = GetDebugValue(pointer);
       m_State->changes.push_back(basechange);
       debugger.WriteThroughPointer(var, val);
       return;
     }
 
     rdcarray<ShaderVariableChange> changes;
-    basechange.before = debugger.GetPointerValue(ids[ptrid]);
+    basechange.before = GetDebugValue(ptrid);
 
     rdcarray<Id> &pointers = pointersForId[ptrid];
 
@@ -261,13 +309,13 @@ void ThreadState::WritePointerValue(Id pointer, const ShaderVariable &val)
 
     // for every other pointer, evaluate its value now before
     for(size_t i = 0; i < pointers.size(); i++)
-      changes[i].before = debugger.GetPointerValue(ids[pointers[i]]);
+      changes[i].before = GetDebugValue(pointers[i]);
 
     debugger.WriteThroughPointer(var, val);
 
     // now evaluate the value after
     for(size_t i = 0; i < pointers.size(); i++)
-      changes[i].after = debugger.GetPointerValue(ids[pointers[i]]);
+      changes[i].after = GetDebugValue(pointers[i]);
 
     // if the pointer we're writing is one of the aliased pointers, be sure we add it even if
     // it's a no-op change
@@ -288,7 +336,7 @@ void ThreadState::WritePointerValue(Id pointer, const ShaderVariable &val)
 
     // always add a change for the base storage variable written itself, even if that's a no-op.
     // This one is not included in any of the pointers lists above
-    basechange.after = debugger.GetPointerValue(ids[ptrid]);
+    basechange.after = GetDebugValue(ptrid);
     m_State->changes.push_back(basechange);
   }
 }
@@ -303,19 +351,28 @@ void ThreadState::SetDst(Id id, const ShaderVariable &val)
   if(m_State && ContainsNaNInf(val))
     m_State->flags |= ShaderEvents::GeneratedNanOrInf;
 
-  ids[id] = val;
-  ids[id].name = debugger.GetRawName(id);
+  SetValue(id, val);
+
+  MarkWritten(id);
+}
 
+void ThreadState::MarkWritten(Id id)
+{
   auto it = std::lower_bound(live.begin(), live.end(), id);
   live.insert(it - live.begin(), id);
 
   if(m_State)
   {
     ShaderVariableChange change;
-    change.after = debugger.GetPointerValue(ids[id]);
+    change.after = GetDebugValue(id);
     m_State->changes.push_back(change);
 
-    debugger.AddSourceVars(sourceVars, change.after, id);
+    if(trackSourceVars)
+      debugger.AddSourceVars(sourceVars, change.after, id);
+  }
+  else if(trackSourceVars && debugger.HasSourceName(id))
+  {
+    debugger.AddSourceVars(sourceVars, GetDebugValue(id), id);
   }
 }
 
@@ -335,7 +392,7 @@ void ThreadState::ProcessScopeChange(const rdcarray<Id> &oldLive, const rdcarray
     if(liveGlobals.contains(id))
       continue;
 
-    m_State->changes.push_back({debugger.GetPointerValue(ids[id])});
+    m_State->changes.push_back({GetDebugValue(id)});
   }
 
   for(const Id id : newLive)
@@ -343,7 +400,7 @@ void ThreadState::ProcessScopeChange(const rdcarray<Id> &oldLive, const rdcarray
     if(liveGlobals.contains(id))
       continue;
 
-    m_State->changes.push_back({ShaderVariable(), debugger.GetPointerValue(ids[id])});
+    m_State->changes.push_back({ShaderVariable(), GetDebugValue(id)});
   }
 }
 
@@ -457,17 +514,15 @@ void ThreadState::JumpToLabel(Id target)
   nextInstruction = debugger.GetInstructionForLabel(target) + 1;
 
   // if jumping to an empty unconditional loop header, continue to the loop block
-  Iter it = debugger.GetIterForInstruction(nextInstruction);
-  if(it.opcode() == Op::LoopMerge)
+  const DecodedInstruction &inst = debugger.GetDecodedInstruction(nextInstruction);
+  if(inst.op == Op::LoopMerge)
   {
-    OpLoopMerge merge(it);
-
-    mergeBlock = merge.mergeBlock;
+    mergeBlock = Id::fromWord(debugger.GetOperands(inst)[0]);
 
-    it++;
-    if(it.opcode() == Op::Branch)
+    const DecodedInstruction &next = debugger.GetDecodedInstruction(nextInstruction + 1);
+    if(next.op == Op::Branch)
     {
-      JumpToLabel(OpBranch(it).targetLabel);
+      JumpToLabel(Id::fromWord(debugger.GetOperands(next)[0]));
     }
   }
 
@@ -476,7 +531,7 @@ void ThreadState::JumpToLabel(Id target)
 
 void ThreadState::ReferencePointer(Id id)
 {
-  if(m_State)
+  if(trackSourceVars)
   {
     StackFrame *frame = callstack.back();
 
@@ -520,39 +575,16 @@ void ThreadState::SkipIgnoredInstructions()
 {
   // skip OpLine/OpNoLine now, so that nextInstruction points to the next real instruction
   // Also for structured control flow we just save the merge block in case we need it for converging
-  // in pixel shaders, but otherwise skip them.
-  while(true)
-  {
-    Iter it = debugger.GetIterForInstruction(nextInstruction);
-    rdcspv::Op op = it.opcode();
-    if(op == Op::Line || op == Op::NoLine)
-    {
-      nextInstruction++;
-      continue;
-    }
-
-    if(op == Op::SelectionMerge)
-    {
-      OpSelectionMerge merge(it);
-
-      mergeBlock = merge.mergeBlock;
-
-      nextInstruction++;
-      continue;
-    }
-
-    if(op == Op::LoopMerge)
-    {
-      OpLoopMerge merge(it);
+  // in pixel shaders, but otherwise skip them. Where to skip to is calculated up front.
+  if(nextInstruction >= debugger.GetNumInstructions())
+    return;
 
-      mergeBlock = merge.mergeBlock;
+  const DecodedInstruction &inst = debugger.GetDecodedInstruction(nextInstruction);
 
-      nextInstruction++;
-      continue;
-    }
+  if(inst.skipMerge != Id())
+    mergeBlock = inst.skipMerge;
 
-    break;
-  }
+  nextInstruction = inst.skipTo;
 }
 
 void ThreadState::EnterEntryPoint(ShaderDebugState *state)
@@ -568,15 +600,17 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 {
   m_State = state;
 
+  // common opcodes read their operands straight from the pre-decoded instruction, the rest still
+  // use the helper structs on the SPIR-V words which is cheap enough for anything fixed-size.
+  const DecodedInstruction &inst = debugger.GetDecodedInstruction(nextInstruction);
+  const uint32_t *ops = debugger.GetOperands(inst);
   Iter it = debugger.GetIterForInstruction(nextInstruction);
   nextInstruction++;
 
-  OpDecoder opdata(it);
-
   // don't skip any instructions here. These should be skipped *after* processing, so that
   // nextInstruction always points to the next real instruction.
 
-  switch(opdata.op)
+  switch(inst.op)
   {
     //////////////////////////////////////////////////////////////////////////////
     //
@@ -585,24 +619,18 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     //////////////////////////////////////////////////////////////////////////////
     case Op::Load:
     {
-      OpLoad load(it);
-
-      // ignore
-      (void)load.memoryAccess;
+      // operands are the pointer, then the memory access which we ignore
 
       // get the pointer value, evaluate it (i.e. dereference) and store the result
-      SetDst(load.result, ReadPointerValue(load.pointer));
+      SetDst(inst.result, ReadPointerValue(Id::fromWord(ops[0])));
 
       break;
     }
     case Op::Store:
     {
-      OpStore store(it);
-
-      // ignore
-      (void)store.memoryAccess;
+      // operands are the pointer and object, then the memory access which we ignore
 
-      WritePointerValue(store.pointer, GetSrc(store.object));
+      WritePointerValue(Id::fromWord(ops[0]), GetSrc(Id::fromWord(ops[1])));
 
       break;
     }
@@ -621,16 +649,25 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::AccessChain:
     case Op::InBoundsAccessChain:
     {
-      OpAccessChain chain(it);
+      // operands are the base, then the index Ids
+      Id base = Id::fromWord(ops[0]);
+
+      // evaluate the indices. Chains are almost always short so avoid allocating if we can
+      uint32_t fixedIndices[8];
+      rdcarray<uint32_t> dynamicIndices;
 
-      rdcarray<uint32_t> indices;
+      uint32_t *indices = fixedIndices;
+      size_t numIndices = inst.numOperands - 1;
+      if(numIndices > ARRAY_COUNT(fixedIndices))
+      {
+        dynamicIndices.resize(numIndices);
+        indices = dynamicIndices.data();
+      }
 
-      // evaluate the indices
-      indices.reserve(chain.indexes.size());
-      for(Id id : chain.indexes)
-        indices.push_back(GetSrc(id).value.uv[0]);
+      for(size_t i = 0; i < numIndices; i++)
+        indices[i] = GetSrc(Id::fromWord(ops[i + 1])).value.uv[0];
 
-      SetDst(chain.result, debugger.MakeCompositePointer(ids[chain.base], chain.base, indices));
+      SetDst(inst.result, debugger.MakeCompositePointer(GetSrc(base), base, indices, numIndices));
 
       break;
     }
@@ -683,7 +720,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       var.rows = var.columns = 1;
       var.type = VarType::Bool;
 
-      if(opdata.op == Op::PtrEqual)
+      if(inst.op == Op::PtrEqual)
         var.value.uv[0] = isEqual ? 1 : 0;
       else
         var.value.uv[0] = isEqual ? 0 : 1;
@@ -712,11 +749,11 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       OpDPdx deriv(it);
 
       DerivDir dir = DDX;
-      if(opdata.op == Op::DPdy || opdata.op == Op::DPdyCoarse || opdata.op == Op::DPdyFine)
+      if(inst.op == Op::DPdy || inst.op == Op::DPdyCoarse || inst.op == Op::DPdyFine)
         dir = DDY;
 
       DerivType type = Coarse;
-      if(opdata.op == Op::DPdxFine || opdata.op == Op::DPdyFine)
+      if(inst.op == Op::DPdxFine || inst.op == Op::DPdyFine)
         type = Fine;
 
       SetDst(deriv.result, CalcDeriv(dir, type, workgroup, deriv.p));
@@ -731,7 +768,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       OpFwidth deriv(it);
 
       DerivType type = Coarse;
-      if(opdata.op == Op::FwidthFine)
+      if(inst.op == Op::FwidthFine)
         type = Fine;
 
       ShaderVariable var = CalcDeriv(DDX, type, workgroup, deriv.p);
@@ -753,15 +790,17 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
     case Op::CompositeExtract:
     {
-      OpCompositeExtract extract(it);
+      // operands are the composite, then literal indices
+      Id compositeId = Id::fromWord(ops[0]);
+      ShaderVariable composite = GetSrc(compositeId);
 
       // to re-use composite/access chain logic, temporarily make a pointer to the composite
       // (illegal in SPIR-V)
       ShaderVariable ptr =
-          debugger.MakeCompositePointer(ids[extract.composite], extract.composite, extract.indexes);
+          debugger.MakeCompositePointer(composite, compositeId, ops + 1, inst.numOperands - 1);
 
       // then evaluate it, to get the extracted value
-      SetDst(extract.result, debugger.ReadFromPointer(ptr));
+      SetDst(inst.result, debugger.ReadFromPointer(ptr));
 
       break;
     }
@@ -834,31 +873,32 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     }
     case Op::CompositeConstruct:
     {
-      OpCompositeConstruct construct(it);
+      // operands are the constituents
+      const size_t numConstituents = inst.numOperands;
 
       ShaderVariable var;
 
-      const DataType &type = debugger.GetType(construct.resultType);
+      const DataType &type = debugger.GetType(inst.resultType);
 
-      RDCASSERT(!construct.constituents.empty());
+      RDCASSERT(numConstituents > 0);
 
       if(type.type == DataType::ArrayType)
       {
-        var.members.resize(construct.constituents.size());
-        for(size_t i = 0; i < construct.constituents.size(); i++)
+        var.members.resize(numConstituents);
+        for(size_t i = 0; i < numConstituents; i++)
         {
-          var.members[i] = GetSrc(construct.constituents[i]);
+          var.members[i] = GetSrc(Id::fromWord(ops[i]));
           var.members[i].name = StringFormat::Fmt("[%zu]", i);
         }
       }
       else if(type.type == DataType::StructType)
       {
-        RDCASSERTEQUAL(type.children.size(), construct.constituents.size());
-        var.members.resize(construct.constituents.size());
-        for(size_t i = 0; i < construct.constituents.size(); i++)
+        RDCASSERTEQUAL(type.children.size(), numConstituents);
+        var.members.resize(numConstituents);
+        for(size_t i = 0; i < numConstituents; i++)
         {
           ShaderVariable &mem = var.members[i];
-          var.members[i] = GetSrc(construct.constituents[i]);
+          var.members[i] = GetSrc(Id::fromWord(ops[i]));
           if(!type.children[i].name.empty())
             var.members[i].name = type.children[i].name;
           else
@@ -867,7 +907,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else if(type.type == DataType::VectorType)
       {
-        RDCASSERT(construct.constituents.size() <= 4);
+        RDCASSERT(numConstituents <= 4);
 
         var.type = type.scalar().Type();
         var.rows = 1;
@@ -876,9 +916,9 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         // it is possible to construct larger vectors from a collection of scalars and smaller
         // vectors.
         size_t dst = 0;
-        for(size_t i = 0; i < construct.constituents.size(); i++)
+        for(size_t i = 0; i < numConstituents; i++)
         {
-          ShaderVariable src = GetSrc(construct.constituents[i]);
+          ShaderVariable src = GetSrc(Id::fromWord(ops[i]));
 
           RDCASSERTEQUAL(src.rows, 1);
 
@@ -898,12 +938,12 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         var.columns = RDCMAX(1U, type.matrix().count);
         var.rows = RDCMAX(1U, type.vector().count);
 
-        RDCASSERTEQUAL(var.columns, construct.constituents.size());
+        RDCASSERTEQUAL(var.columns, numConstituents);
 
         rdcarray<ShaderVariable> columns;
-        columns.resize(construct.constituents.size());
-        for(size_t i = 0; i < construct.constituents.size(); i++)
-          columns[i] = GetSrc(construct.constituents[i]);
+        columns.resize(numConstituents);
+        for(size_t i = 0; i < numConstituents; i++)
+          columns[i] = GetSrc(Id::fromWord(ops[i]));
 
         for(size_t r = 0; r < var.rows; r++)
         {
@@ -917,37 +957,41 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         }
       }
 
-      SetDst(construct.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
     case Op::VectorShuffle:
     {
-      OpVectorShuffle shuffle(it);
+      // operands are the two vectors, then the literal components
+      Id vector1 = Id::fromWord(ops[0]);
+      Id vector2 = Id::fromWord(ops[1]);
+      const uint32_t *components = ops + 2;
+      const size_t numComponents = inst.numOperands - 2;
 
       ShaderVariable var;
 
-      const DataType &type = debugger.GetType(shuffle.resultType);
+      const DataType &type = debugger.GetType(inst.resultType);
 
       var.type = type.scalar().Type();
       var.rows = 1;
-      var.columns = RDCMAX(1U, (uint32_t)shuffle.components.size());
+      var.columns = RDCMAX(1U, (uint32_t)numComponents);
 
-      ShaderVariable src1 = GetSrc(shuffle.vector1);
-      ShaderVariable src2 = GetSrc(shuffle.vector2);
+      ShaderVariable src1 = GetSrc(vector1);
+      ShaderVariable src2 = GetSrc(vector2);
 
       uint32_t vec1Cols = src1.columns;
 
-      for(size_t i = 0; i < shuffle.components.size(); i++)
+      for(size_t i = 0; i < numComponents; i++)
       {
-        uint32_t c = shuffle.components[i];
+        uint32_t c = components[i];
         if(c < vec1Cols)
           var.value.uv[i] = src1.value.uv[c];
         else
           var.value.uv[i] = src2.value.uv[c - vec1Cols];
       }
 
-      SetDst(shuffle.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -1038,25 +1082,25 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       ShaderVariable var = GetSrc(conv.floatValue);
 
-      if(opdata.op == Op::ConvertFToS)
+      if(inst.op == Op::ConvertFToS)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.iv[c] = (int)var.value.fv[c];
         var.type = VarType::SInt;
       }
-      else if(opdata.op == Op::ConvertFToU)
+      else if(inst.op == Op::ConvertFToU)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = var.value.fv[c] > 0.0f ? (uint32_t)var.value.fv[c] : 0U;
         var.type = VarType::UInt;
       }
-      else if(opdata.op == Op::ConvertSToF)
+      else if(inst.op == Op::ConvertSToF)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.fv[c] = (float)var.value.iv[c];
         var.type = VarType::Float;
       }
-      else if(opdata.op == Op::ConvertUToF)
+      else if(inst.op == Op::ConvertUToF)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.fv[c] = (float)var.value.uv[c];
@@ -1208,8 +1252,8 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
     case Op::ExtInst:
     {
-      Id result = Id::fromWord(it.word(2));
-      Id extinst = Id::fromWord(it.word(3));
+      // operands are the set, the instruction, then parameters
+      Id extinst = Id::fromWord(ops[0]);
 
       if(global.extInsts.find(extinst) == global.extInsts.end())
       {
@@ -1223,7 +1267,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       if(dispatch.nonsemantic)
         break;
 
-      uint32_t instruction = it.word(4);
+      uint32_t instruction = ops[1];
 
       if(instruction >= dispatch.functions.size())
       {
@@ -1239,11 +1283,8 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         break;
       }
 
-      rdcarray<Id> params;
-      for(size_t i = 5; i < it.size(); i++)
-        params.push_back(Id::fromWord(it.word(i)));
-
-      SetDst(result, dispatch.functions[instruction](*this, instruction, params));
+      SetDst(inst.result, dispatch.functions[instruction](*this, instruction,
+                                                          debugger.GetExtInstParams(inst)));
       break;
     }
 
@@ -1280,67 +1321,69 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::FUnordLessThan:
     case Op::FUnordLessThanEqual:
     {
-      OpFMul comp(it);
+      // operands are the two sources
+      Id operand1 = Id::fromWord(ops[0]);
+      Id operand2 = Id::fromWord(ops[1]);
 
-      ShaderVariable var = GetSrc(comp.operand1);
-      ShaderVariable b = GetSrc(comp.operand2);
+      ShaderVariable var = GetSrc(operand1);
+      ShaderVariable b = GetSrc(operand2);
 
-      if(opdata.op == Op::IEqual || opdata.op == Op::LogicalEqual)
+      if(inst.op == Op::IEqual || inst.op == Op::LogicalEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.uv[c] == b.value.uv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::INotEqual || opdata.op == Op::LogicalNotEqual)
+      else if(inst.op == Op::INotEqual || inst.op == Op::LogicalNotEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.uv[c] != b.value.uv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::LogicalAnd)
+      else if(inst.op == Op::LogicalAnd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = var.value.uv[c] & b.value.uv[c];
       }
-      else if(opdata.op == Op::LogicalOr)
+      else if(inst.op == Op::LogicalOr)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = var.value.uv[c] | b.value.uv[c];
       }
-      else if(opdata.op == Op::UGreaterThan)
+      else if(inst.op == Op::UGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.uv[c] > b.value.uv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::UGreaterThanEqual)
+      else if(inst.op == Op::UGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.uv[c] >= b.value.uv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::ULessThan)
+      else if(inst.op == Op::ULessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.uv[c] < b.value.uv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::ULessThanEqual)
+      else if(inst.op == Op::ULessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.uv[c] <= b.value.uv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::SGreaterThan)
+      else if(inst.op == Op::SGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.iv[c] > b.value.iv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::SGreaterThanEqual)
+      else if(inst.op == Op::SGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.iv[c] >= b.value.iv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::SLessThan)
+      else if(inst.op == Op::SLessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.iv[c] < b.value.iv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::SLessThanEqual)
+      else if(inst.op == Op::SLessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.iv[c] <= b.value.iv[c]) ? 1 : 0;
@@ -1359,63 +1402,63 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       // always return true. So we negate and invert the actual comparison so that the comparison
       // will be unchanged effectively.
 
-      if(opdata.op == Op::FOrdEqual)
+      if(inst.op == Op::FOrdEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] == b.value.fv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::FOrdNotEqual)
+      else if(inst.op == Op::FOrdNotEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] != b.value.fv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::FOrdGreaterThan)
+      else if(inst.op == Op::FOrdGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] > b.value.fv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::FOrdGreaterThanEqual)
+      else if(inst.op == Op::FOrdGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] >= b.value.fv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::FOrdLessThan)
+      else if(inst.op == Op::FOrdLessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] < b.value.fv[c]) ? 1 : 0;
       }
-      else if(opdata.op == Op::FOrdLessThanEqual)
+      else if(inst.op == Op::FOrdLessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] <= b.value.fv[c]) ? 1 : 0;
       }
 
-      if(opdata.op == Op::FUnordEqual)
+      if(inst.op == Op::FUnordEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] != b.value.fv[c]) ? 0 : 1;
       }
-      else if(opdata.op == Op::FUnordNotEqual)
+      else if(inst.op == Op::FUnordNotEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] == b.value.fv[c]) ? 0 : 1;
       }
-      else if(opdata.op == Op::FUnordGreaterThan)
+      else if(inst.op == Op::FUnordGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] <= b.value.fv[c]) ? 0 : 1;
       }
-      else if(opdata.op == Op::FUnordGreaterThanEqual)
+      else if(inst.op == Op::FUnordGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] < b.value.fv[c]) ? 0 : 1;
       }
-      else if(opdata.op == Op::FUnordLessThan)
+      else if(inst.op == Op::FUnordLessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] >= b.value.fv[c]) ? 0 : 1;
       }
-      else if(opdata.op == Op::FUnordLessThanEqual)
+      else if(inst.op == Op::FUnordLessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = (var.value.fv[c] > b.value.fv[c]) ? 0 : 1;
@@ -1423,7 +1466,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       var.type = VarType::Bool;
 
-      SetDst(comp.result, var);
+      SetDst(inst.result, var);
       break;
     }
     case Op::LogicalNot:
@@ -1449,7 +1492,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       for(uint8_t c = 1; c < var.columns; c++)
       {
-        if(opdata.op == Op::Any)
+        if(inst.op == Op::Any)
           var.value.uv[0] |= var.value.uv[c];
         else
           var.value.uv[0] &= var.value.uv[c];
@@ -1543,7 +1586,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         var.value.uv[c] >>= offset.value.uv[c];
         var.value.uv[c] &= (1u << count.value.uv[c]) - 1;
 
-        if(opdata.op == Op::BitFieldSExtract)
+        if(inst.op == Op::BitFieldSExtract)
         {
           uint32_t topbit = (mask + 1u) >> 1u;
           if(var.value.uv[c] & topbit)
@@ -1581,43 +1624,48 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::ShiftRightArithmetic:
     case Op::ShiftRightLogical:
     {
-      OpBitwiseOr bitwise(it);
+      // operands are the two sources
+      Id operand1 = Id::fromWord(ops[0]);
+      Id operand2 = Id::fromWord(ops[1]);
 
-      ShaderVariable var = GetSrc(bitwise.operand1);
-      ShaderVariable b = GetSrc(bitwise.operand2);
+      ShaderVariable var = GetSrc(operand1);
+      ShaderVariable b = GetSrc(operand2);
 
-      if(opdata.op == Op::BitwiseOr)
+      if(inst.op == Op::BitwiseOr)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = var.value.uv[c] | b.value.uv[c];
       }
-      else if(opdata.op == Op::BitwiseAnd)
+      else if(inst.op == Op::BitwiseAnd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = var.value.uv[c] & b.value.uv[c];
       }
-      else if(opdata.op == Op::BitwiseXor)
+      else if(inst.op == Op::BitwiseXor)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] = var.value.uv[c] ^ b.value.uv[c];
       }
-      else if(opdata.op == Op::ShiftLeftLogical)
+      // the result of shifting by the bit width or more is undefined. Mask the shift the same way
+      // x86 does, so that the result doesn't depend on how the shift is compiled, which matters
+      // when lanes are stepped together
+      else if(inst.op == Op::ShiftLeftLogical)
       {
         for(uint8_t c = 0; c < var.columns; c++)
-          var.value.uv[c] = var.value.uv[c] << b.value.uv[c];
+          var.value.uv[c] = var.value.uv[c] << (b.value.uv[c] & 31);
       }
-      else if(opdata.op == Op::ShiftRightArithmetic)
+      else if(inst.op == Op::ShiftRightArithmetic)
       {
         for(uint8_t c = 0; c < var.columns; c++)
-          var.value.iv[c] = var.value.iv[c] >> b.value.uv[c];
+          var.value.iv[c] = var.value.iv[c] >> (b.value.uv[c] & 31);
       }
-      else if(opdata.op == Op::ShiftRightLogical)
+      else if(inst.op == Op::ShiftRightLogical)
       {
         for(uint8_t c = 0; c < var.columns; c++)
-          var.value.uv[c] = var.value.uv[c] >> b.value.uv[c];
+          var.value.uv[c] = var.value.uv[c] >> (b.value.uv[c] & 31);
       }
 
-      SetDst(bitwise.result, var);
+      SetDst(inst.result, var);
       break;
     }
     case Op::Not:
@@ -1654,22 +1702,24 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::IAdd:
     case Op::ISub:
     {
-      OpFMul math(it);
+      // operands are the two sources
+      Id operand1 = Id::fromWord(ops[0]);
+      Id operand2 = Id::fromWord(ops[1]);
 
-      ShaderVariable var = GetSrc(math.operand1);
-      ShaderVariable b = GetSrc(math.operand2);
+      ShaderVariable var = GetSrc(operand1);
+      ShaderVariable b = GetSrc(operand2);
 
-      if(opdata.op == Op::FMul)
+      if(inst.op == Op::FMul)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.fv[c] *= b.value.fv[c];
       }
-      else if(opdata.op == Op::FDiv)
+      else if(inst.op == Op::FDiv)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.fv[c] /= b.value.fv[c];
       }
-      else if(opdata.op == Op::FMod)
+      else if(inst.op == Op::FMod)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1681,7 +1731,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
             var.value.fv[c] -= fabsf(bf);
         }
       }
-      else if(opdata.op == Op::FRem)
+      else if(inst.op == Op::FRem)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1693,22 +1743,22 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
             var.value.fv[c] -= fabsf(bf);
         }
       }
-      else if(opdata.op == Op::FAdd)
+      else if(inst.op == Op::FAdd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.fv[c] += b.value.fv[c];
       }
-      else if(opdata.op == Op::FSub)
+      else if(inst.op == Op::FSub)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.fv[c] -= b.value.fv[c];
       }
-      else if(opdata.op == Op::IMul)
+      else if(inst.op == Op::IMul)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] *= b.value.uv[c];
       }
-      else if(opdata.op == Op::SDiv)
+      else if(inst.op == Op::SDiv)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1724,7 +1774,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           }
         }
       }
-      else if(opdata.op == Op::UDiv)
+      else if(inst.op == Op::UDiv)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1740,7 +1790,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           }
         }
       }
-      else if(opdata.op == Op::UMod)
+      else if(inst.op == Op::UMod)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1756,7 +1806,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           }
         }
       }
-      else if(opdata.op == Op::SRem || opdata.op == Op::SMod)
+      else if(inst.op == Op::SRem || inst.op == Op::SMod)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1772,18 +1822,18 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           }
         }
       }
-      else if(opdata.op == Op::IAdd)
+      else if(inst.op == Op::IAdd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] += b.value.uv[c];
       }
-      else if(opdata.op == Op::ISub)
+      else if(inst.op == Op::ISub)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.uv[c] -= b.value.uv[c];
       }
 
-      SetDst(math.result, var);
+      SetDst(inst.result, var);
       break;
     }
     // extended math ops
@@ -1800,7 +1850,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable lsb = a;
       ShaderVariable msb = a;
 
-      if(opdata.op == Op::UMulExtended)
+      if(inst.op == Op::UMulExtended)
       {
         // if this is less than 64-bit precision inputs, we can just upcast, do the mul, and then
         // mask off the bits we care about
@@ -1817,7 +1867,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           }
         }
       }
-      else if(opdata.op == Op::SMulExtended)
+      else if(inst.op == Op::SMulExtended)
       {
         if(VarTypeByteSize(a.type) < 8)
         {
@@ -1832,7 +1882,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           }
         }
       }
-      else if(opdata.op == Op::IAddCarry)
+      else if(inst.op == Op::IAddCarry)
       {
         for(uint8_t c = 0; c < a.columns; c++)
         {
@@ -1842,7 +1892,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           msb.value.uv[c] = (lsb.value.uv[c] < b.value.uv[c]) ? 1 : 0;
         }
       }
-      else if(opdata.op == Op::ISubBorrow)
+      else if(inst.op == Op::ISubBorrow)
       {
         for(uint8_t c = 0; c < a.columns; c++)
         {
@@ -1879,12 +1929,12 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       ShaderVariable var = GetSrc(math.operand);
 
-      if(opdata.op == Op::FNegate)
+      if(inst.op == Op::FNegate)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.fv[c] = -var.value.fv[c];
       }
-      else if(opdata.op == Op::SNegate)
+      else if(inst.op == Op::SNegate)
       {
         for(uint8_t c = 0; c < var.columns; c++)
           var.value.iv[c] = -var.value.iv[c];
@@ -2087,7 +2137,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       result.members[0].name = "image";
       result.members[1].name = "sampler";
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::Image:
@@ -2132,7 +2182,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       Id derivId;
 
-      if(opdata.op == Op::ImageFetch)
+      if(inst.op == Op::ImageFetch)
       {
         OpImageFetch image(it);
 
@@ -2140,7 +2190,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         uv = GetSrc(image.coordinate);
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageGather)
+      else if(inst.op == Op::ImageGather)
       {
         OpImageGather image(it);
 
@@ -2149,7 +2199,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         gather = GatherChannel(GetSrc(image.component).value.uv[0]);
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageDrefGather)
+      else if(inst.op == Op::ImageDrefGather)
       {
         OpImageDrefGather image(it);
 
@@ -2159,7 +2209,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         gather = GatherChannel::Red;
         compare = GetSrc(image.dref);
       }
-      else if(opdata.op == Op::ImageQueryLod)
+      else if(inst.op == Op::ImageQueryLod)
       {
         OpImageQueryLod image(it);
 
@@ -2168,7 +2218,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleExplicitLod)
+      else if(inst.op == Op::ImageSampleExplicitLod)
       {
         OpImageSampleExplicitLod image(it);
 
@@ -2176,7 +2226,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         uv = GetSrc(image.coordinate);
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageSampleImplicitLod)
+      else if(inst.op == Op::ImageSampleImplicitLod)
       {
         OpImageSampleImplicitLod image(it);
 
@@ -2186,7 +2236,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleDrefExplicitLod)
+      else if(inst.op == Op::ImageSampleDrefExplicitLod)
       {
         OpImageSampleDrefExplicitLod image(it);
 
@@ -2195,7 +2245,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         operands = image.imageOperands;
         compare = GetSrc(image.dref);
       }
-      else if(opdata.op == Op::ImageSampleDrefImplicitLod)
+      else if(inst.op == Op::ImageSampleDrefImplicitLod)
       {
         OpImageSampleDrefImplicitLod image(it);
 
@@ -2206,7 +2256,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleProjExplicitLod)
+      else if(inst.op == Op::ImageSampleProjExplicitLod)
       {
         OpImageSampleProjExplicitLod image(it);
 
@@ -2214,7 +2264,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         uv = GetSrc(image.coordinate);
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageSampleProjImplicitLod)
+      else if(inst.op == Op::ImageSampleProjImplicitLod)
       {
         OpImageSampleProjImplicitLod image(it);
 
@@ -2224,7 +2274,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleProjDrefExplicitLod)
+      else if(inst.op == Op::ImageSampleProjDrefExplicitLod)
       {
         OpImageSampleProjDrefExplicitLod image(it);
 
@@ -2233,7 +2283,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         operands = image.imageOperands;
         compare = GetSrc(image.dref);
       }
-      else if(opdata.op == Op::ImageSampleProjDrefImplicitLod)
+      else if(inst.op == Op::ImageSampleProjDrefImplicitLod)
       {
         OpImageSampleProjDrefImplicitLod image(it);
 
@@ -2244,15 +2294,15 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageQueryLevels || opdata.op == Op::ImageQuerySamples ||
-              opdata.op == Op::ImageQuerySize)
+      else if(inst.op == Op::ImageQueryLevels || inst.op == Op::ImageQuerySamples ||
+              inst.op == Op::ImageQuerySize)
       {
         // these opcodes are all identical, they just query a property of the image
         OpImageQueryLevels query(it);
 
         img = GetSrc(query.image);
       }
-      else if(opdata.op == Op::ImageQuerySizeLod)
+      else if(inst.op == Op::ImageQuerySizeLod)
       {
         OpImageQuerySizeLod query(it);
 
@@ -2274,7 +2324,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         sampler = sampler.members[1];
       }
 
-      const DataType &resultType = debugger.GetType(opdata.resultType);
+      const DataType &resultType = debugger.GetType(inst.resultType);
 
       RDCASSERT(img.type == VarType::ReadOnlyResource || img.type == VarType::ReadWriteResource);
       RDCASSERT(sampler.type == VarType::Unknown || sampler.type == VarType::ReadOnlyResource ||
@@ -2296,7 +2346,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         samplerIndex = sampler.GetBinding();
 
       if(!debugger.GetAPIWrapper()->CalculateSampleGather(
-             *this, opdata.op, texType, img.GetBinding(), samplerIndex, uv, ddxCalc, ddyCalc,
+             *this, inst.op, texType, img.GetBinding(), samplerIndex, uv, ddxCalc, ddyCalc,
              compare, gather, operands, result))
       {
         // sample failed. Pretend we got 0 columns back
@@ -2316,7 +2366,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       result.rows = 1;
       result.columns = RDCMAX(1U, resultType.vector().count);
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::ImageRead:
@@ -2326,7 +2376,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable img = GetSrc(read.image);
       ShaderVariable coord = GetSrc(read.coordinate);
 
-      const DataType &resultType = debugger.GetType(opdata.resultType);
+      const DataType &resultType = debugger.GetType(inst.resultType);
 
       // only the sample operand should be here
       RDCASSERT((read.imageOperands.flags & ImageOperands::Sample) == read.imageOperands.flags);
@@ -2433,22 +2483,21 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::LoopMerge:
     {
       // we shouldn't process these, we should always jump past them
-      RDCERR("Unexpected %s", ToStr(opdata.op).c_str());
+      RDCERR("Unexpected %s", ToStr(inst.op).c_str());
       break;
     }
     case Op::Switch:
     {
-      OpSwitch switch_(it);
-
-      ShaderVariable selector = GetSrc(switch_.selector);
+      // operands are the selector, the default label, then pairs of literal and label
+      ShaderVariable selector = GetSrc(Id::fromWord(ops[0]));
 
-      Id targetLabel = switch_.def;
+      Id targetLabel = Id::fromWord(ops[1]);
 
-      for(const PairLiteralIntegerIdRef &case_ : switch_.target)
+      for(uint32_t i = 2; i + 1 < inst.numOperands; i += 2)
       {
-        if(selector.value.uv[0] == case_.first)
+        if(selector.value.uv[0] == ops[i])
         {
-          targetLabel = case_.second;
+          targetLabel = Id::fromWord(ops[i + 1]);
           break;
         }
       }
@@ -2458,17 +2507,15 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     }
     case Op::Branch:
     {
-      OpBranch branch(it);
-      JumpToLabel(branch.targetLabel);
+      JumpToLabel(Id::fromWord(ops[0]));
       break;
     }
     case Op::BranchConditional:
     {
-      OpBranchConditional branch(it);
-
-      Id target = branch.falseLabel;
-      if(GetSrc(branch.condition).value.uv[0])
-        target = branch.trueLabel;
+      // operands are the condition, then the true and false labels
+      Id target = Id::fromWord(ops[2]);
+      if(GetSrc(Id::fromWord(ops[0])).value.uv[0])
+        target = Id::fromWord(ops[1]);
 
       JumpToLabel(target);
 
@@ -2476,25 +2523,26 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     }
     case Op::Phi:
     {
-      OpPhi phi(it);
-
       ShaderVariable var;
+      bool found = false;
 
       StackFrame *frame = callstack.back();
 
-      for(const PairIdRefIdRef &parent : phi.parents)
+      // operands are pairs of the value and the parent block it comes from
+      for(uint32_t i = 0; i + 1 < inst.numOperands; i += 2)
       {
-        if(parent.second == frame->lastBlock)
+        if(Id::fromWord(ops[i + 1]) == frame->lastBlock)
         {
-          var = GetSrc(parent.first);
+          var = GetSrc(Id::fromWord(ops[i]));
+          found = true;
           break;
         }
       }
 
       // we should have had a matching for the OpPhi of the block we came from
-      RDCASSERT(!var.name.empty());
+      RDCASSERT(found);
 
-      SetDst(phi.result, var);
+      SetDst(inst.result, var);
       break;
     }
 
@@ -2509,14 +2557,12 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     {
       // for our purposes differences in offset/decoration between types doesn't matter, so we can
       // implement these two the same.
-      OpCopyObject copy(it);
-
-      SetDst(copy.result, GetSrc(copy.operand));
+      SetDst(inst.result, GetSrc(Id::fromWord(ops[0])));
       break;
     }
     case Op::ReadClockKHR:
     {
-      const DataType &resultType = debugger.GetType(opdata.resultType);
+      const DataType &resultType = debugger.GetType(inst.resultType);
 
       ShaderVariable result;
 
@@ -2526,7 +2572,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       result.value.u64v[0] = global.clock;
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::IsHelperInvocationEXT:
@@ -2539,7 +2585,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       result.value.uv[0] = helperInvocation;
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::DemoteToHelperInvocationEXT:
@@ -2556,14 +2602,14 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
     case Op::FunctionCall:
     {
-      OpFunctionCall call(it);
-
       // we hit this twice. The first time we don't have a return value so we jump into the
       // function. The second time we do have a return value so we process it and continue
       if(returnValue.name.empty())
       {
+        OpFunctionCall call(it);
+
         uint32_t returnInstruction = nextInstruction - 1;
-        nextInstruction = debugger.GetInstructionForFunction(call.function);
+        nextInstruction = inst.target;
 
         EnterFunction(call.arguments);
 
@@ -2572,7 +2618,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        SetDst(call.result, returnValue);
+        SetDst(inst.result, returnValue);
         returnValue.name.clear();
       }
       break;
@@ -2600,24 +2646,20 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       {
         // if there's no callstack there's no return address, jump to the function end
 
-        it++;    // see what the next instruction is
         // keep going until it's the end of the function
-
-        while(OpDecoder(it).op != Op::FunctionEnd)
-        {
+        while(debugger.GetDecodedInstruction(nextInstruction).op != Op::FunctionEnd)
           nextInstruction++;
-          it++;
-        }
       }
       else
       {
-        returnValue.name = "<return value>";
-        if(opdata.op == Op::ReturnValue)
+        if(inst.op == Op::ReturnValue)
         {
           OpReturnValue ret(it);
 
           returnValue = GetSrc(ret.value);
         }
+        // values aren't named, so the name marks that we have returned
+        returnValue.name = "<return value>";
 
         nextInstruction = exitingFrame->funcCallInstruction;
 
@@ -2655,7 +2697,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       result.members[1].name = "coord";
       result.members[2].name = "sample";
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::AtomicLoad:
@@ -2675,7 +2717,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -2733,7 +2775,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -2772,7 +2814,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -2820,7 +2862,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -2835,7 +2877,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       SetDst(atomic.result, result);
 
-      if(opdata.op == Op::AtomicIIncrement)
+      if(inst.op == Op::AtomicIIncrement)
         result.value.uv[0]++;
       else
         result.value.uv[0]--;
@@ -2878,7 +2920,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -2893,23 +2935,23 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       SetDst(atomic.result, result);
 
-      if(opdata.op == Op::AtomicIAdd)
+      if(inst.op == Op::AtomicIAdd)
         result.value.uv[0] += value.value.uv[0];
-      else if(opdata.op == Op::AtomicISub)
+      else if(inst.op == Op::AtomicISub)
         result.value.uv[0] -= value.value.uv[0];
-      else if(opdata.op == Op::AtomicSMin)
+      else if(inst.op == Op::AtomicSMin)
         result.value.iv[0] = RDCMIN(result.value.iv[0], value.value.iv[0]);
-      else if(opdata.op == Op::AtomicUMin)
+      else if(inst.op == Op::AtomicUMin)
         result.value.uv[0] = RDCMIN(result.value.uv[0], value.value.uv[0]);
-      else if(opdata.op == Op::AtomicSMax)
+      else if(inst.op == Op::AtomicSMax)
         result.value.iv[0] = RDCMAX(result.value.iv[0], value.value.iv[0]);
-      else if(opdata.op == Op::AtomicUMax)
+      else if(inst.op == Op::AtomicUMax)
         result.value.uv[0] = RDCMAX(result.value.uv[0], value.value.uv[0]);
-      else if(opdata.op == Op::AtomicAnd)
+      else if(inst.op == Op::AtomicAnd)
         result.value.uv[0] &= value.value.uv[0];
-      else if(opdata.op == Op::AtomicOr)
+      else if(inst.op == Op::AtomicOr)
         result.value.uv[0] |= value.value.uv[0];
-      else if(opdata.op == Op::AtomicXor)
+      else if(inst.op == Op::AtomicXor)
         result.value.uv[0] ^= value.value.uv[0];
 
       // write the new value
@@ -2967,7 +3009,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -3031,7 +3073,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -3050,7 +3092,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -3233,12 +3275,12 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::SubgroupAvcSicGetPackedSkcLumaSumThresholdINTEL:
     case Op::SubgroupAvcSicGetInterRawSadsINTEL:
     {
-      RDCERR("Unsupported extension opcode used %s", ToStr(opdata.op).c_str());
+      RDCERR("Unsupported extension opcode used %s", ToStr(inst.op).c_str());
 
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -3299,7 +3341,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::ModuleProcessed:
     case Op::ExecutionModeId:
     {
-      RDCERR("Encountered unexpected global SPIR-V operation %s", ToStr(opdata.op).c_str());
+      RDCERR("Encountered unexpected global SPIR-V operation %s", ToStr(inst.op).c_str());
       break;
     }
 
@@ -3365,7 +3407,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::CreatePipeFromPipeStorage:
     {
       // these are kernel only
-      RDCERR("Encountered unexpected kernel SPIR-V operation %s", ToStr(opdata.op).c_str());
+      RDCERR("Encountered unexpected kernel SPIR-V operation %s", ToStr(inst.op).c_str());
       break;
     }
 
@@ -3377,34 +3419,38 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::Variable:
     {
       // these should be handled elsewhere specially
-      RDCERR("Encountered SPIR-V operation %s in general dispatch loop", ToStr(opdata.op).c_str());
+      RDCERR("Encountered SPIR-V operation %s in general dispatch loop", ToStr(inst.op).c_str());
       break;
     }
 
-    case Op::Max: RDCWARN("Unhandled SPIR-V operation %s", ToStr(opdata.op).c_str()); break;
+    case Op::Max: RDCWARN("Unhandled SPIR-V operation %s", ToStr(inst.op).c_str()); break;
   }
 
-  // skip over any degenerate branches
-  while(true)
-  {
-    it = debugger.GetIterForInstruction(nextInstruction);
-    if(it.opcode() == Op::Branch)
-    {
-      Id target = OpBranch(it).targetLabel;
+  FinishStep();
+}
 
-      it++;
+void ThreadState::CompleteLaneStep(Id result)
+{
+  m_State = NULL;
 
-      while(it.opcode() == Op::Line || it.opcode() == Op::NoLine)
-        it++;
+  nextInstruction++;
 
-      if(target == OpLabel(it).result)
-      {
-        JumpToLabel(target);
-        continue;
-      }
-    }
+  MarkWritten(result);
+
+  FinishStep();
+}
+
+void ThreadState::FinishStep()
+{
+  // skip over any degenerate branches
+  while(nextInstruction < debugger.GetNumInstructions())
+  {
+    const DecodedInstruction &next = debugger.GetDecodedInstruction(nextInstruction);
+
+    if(!next.degenerateBranch)
+      break;
 
-    break;
+    JumpToLabel(Id::fromWord(debugger.GetOperands(next)[0]));
   }
 
   SkipIgnoredInstructions();
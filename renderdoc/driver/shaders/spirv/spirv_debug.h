@@ -115,14 +115,47 @@ static const uint32_t BufferPointerByteOffsetVariableSlot = 9;
 static const uint32_t BufferPointerTypeIdVariableSlot = 10;
 static const uint32_t SSBOVariableSlot = 11;
 
+// one 32-bit word of a register. See Debugger::GetRegisterLanes for how these are laid out.
+union LaneValue
+{
+  uint32_t u;
+  int32_t i;
+  float f;
+};
+
+// calls op(lane) for each of numLanes lanes and writes the result to dst, for lanes where mask is
+// ~0U. Lanes where mask is 0 keep their existing value. This is written as a plain blend with no
+// branches so that the loop can be vectorised.
+template <typename Func>
+inline void ForEachLane(LaneValue *dst, const uint32_t *mask, size_t numLanes, Func op)
+{
+  for(size_t l = 0; l < numLanes; l++)
+  {
+    LaneValue r = op(l);
+    dst[l].u = (r.u & mask[l]) | (dst[l].u & ~mask[l]);
+  }
+}
+
 typedef ShaderVariable (*ExtInstImpl)(ThreadState &, uint32_t, const rdcarray<Id> &);
 
+// an implementation of an extended instruction on one component for many lanes at once, with the
+// same blending as ForEachLane. params has that component of each parameter for every lane. Only
+// instructions whose result is the first parameter with its components replaced can be run this
+// way.
+struct ExtInstLaneImpl
+{
+  void (*func)(LaneValue *dst, const LaneValue *const *params, const uint32_t *mask,
+               size_t numLanes) = NULL;
+  uint32_t numParams = 0;
+};
+
 struct ExtInstDispatcher
 {
   rdcstr name;
   bool nonsemantic = false;
   rdcarray<rdcstr> names;
   rdcarray<ExtInstImpl> functions;
+  rdcarray<ExtInstLaneImpl> laneFunctions;
 };
 
 void ConfigureGLSLStd450(ExtInstDispatcher &extinst);
@@ -174,6 +207,44 @@ private:
 
 class Debugger;
 
+// an instruction decoded once up front, so that stepping doesn't have to re-parse the words each
+// time. Operands are left in place in the SPIR-V words and referenced by offset.
+struct DecodedInstruction
+{
+  Op op = Op::Nop;
+  Id result, resultType;
+  // offset in the SPIR-V of the first operand word after the result type and result (if present)
+  uint32_t operands = 0;
+  uint32_t numOperands = 0;
+  // the first instruction at or after this one that is actually executed, skipping OpLine/OpNoLine
+  // and structured merge instructions. If any merges are skipped, the merge block of the last one.
+  uint32_t skipTo = 0;
+  Id skipMerge;
+  // for OpFunctionCall, the instruction of the called OpFunction
+  uint32_t target = ~0U;
+  // for OpBranch, whether it branches to the label immediately after it
+  bool degenerateBranch = false;
+  // for OpExtInst, the index of the pre-built parameter list
+  uint32_t extInstParams = ~0U;
+  // whether this is a simple arithmetic or logical operation on registers that can be run for
+  // every lane at this instruction at once. See Debugger::StepLanes
+  bool laneParallel = false;
+};
+
+// the type of an SSA value stored in a register, the value itself is stored separately
+struct RegisterInfo
+{
+  bool operator==(const RegisterInfo &o) const
+  {
+    return type == o.type && rows == o.rows && columns == o.columns &&
+           displayAsHex == o.displayAsHex;
+  }
+  bool operator!=(const RegisterInfo &o) const { return !(*this == o); }
+  VarType type = VarType::Unknown;
+  uint8_t rows = 0, columns = 0;
+  bool displayAsHex = false;
+};
+
 struct ThreadState
 {
   ThreadState(uint32_t workgroupIdx, Debugger &debug, const GlobalState &globalState);
@@ -181,6 +252,9 @@ struct ThreadState
 
   void EnterEntryPoint(ShaderDebugState *state);
   void StepNext(ShaderDebugState *state, const rdcarray<ThreadState> &workgroup);
+  // the rest of a step without recording, once the debugger has already executed the next
+  // instruction and written result for this thread along with others. See Debugger::StepLanes
+  void CompleteLaneStep(Id result);
 
   enum DerivDir
   {
@@ -211,8 +285,13 @@ struct ThreadState
   // thread-local private variables
   rdcarray<ShaderVariable> privates;
 
-  // every ID's variable, if a pointer it may be pointing at a ShaderVariable stored elsewhere
-  DenseIdMap<ShaderVariable> ids;
+  // every ID's value, in the slot the debugger assigned to it. Scalars and vectors are stored as
+  // registers in the debugger's register file for all threads, and only expanded to a
+  // ShaderVariable when read. Anything else - pointers, matrices, composites and opaque objects -
+  // is stored here as a full ShaderVariable, and if a pointer it may be pointing at a
+  // ShaderVariable stored elsewhere.
+  // Names are not stored, GetDebugValue() adds them when a value is needed for display.
+  rdcarray<ShaderVariable> variables;
 
   // for any allocated variables, a list of 'extra' pointers pointing to it. By default the actual
   // storage of allocated variables is not directly accessible (it's stored in e.g. inputs, outputs,
@@ -232,18 +311,31 @@ struct ThreadState
 
   rdcarray<SourceVariableMapping> sourceVars;
 
-  // index in the pixel quad
+  // whether sourceVars is kept up to date. Only needed for the active lane, and independent of
+  // whether changes are being recorded so that running to a breakpoint still has the right
+  // source variables at the point it stops.
+  bool trackSourceVars = false;
+
+  // index in the pixel quad or compute workgroup
   uint32_t workgroupIndex;
   bool helperInvocation;
   bool killed;
 
+  // variables are returned directly, registers are read into a temporary which is only valid until
+  // the same ID is read again
   const ShaderVariable &GetSrc(Id id) const;
+  // set an ID's value directly, without any change tracking
+  void SetValue(Id id, const ShaderVariable &val);
+  // the named value of an ID as it should be displayed, with any pointers dereferenced
+  ShaderVariable GetDebugValue(Id id) const;
   void WritePointerValue(Id pointer, const ShaderVariable &val);
   ShaderVariable ReadPointerValue(Id pointer);
 
 private:
   void EnterFunction(const rdcarray<Id> &arguments);
   void SetDst(Id id, const ShaderVariable &val);
+  void MarkWritten(Id id);
+  void FinishStep();
   void ProcessScopeChange(const rdcarray<Id> &oldLive, const rdcarray<Id> &newLive);
   void JumpToLabel(Id target);
   void ReferencePointer(Id id);
@@ -265,16 +357,32 @@ public:
                                const SPIRVPatchData &patchData, uint32_t activeIndex);
 
   rdcarray<ShaderDebugState> ContinueDebug();
+  rdcarray<ShaderDebugState> RunDebug(const rdcarray<uint32_t> &breakpoints);
+
+  // by default only the debugged thread of a compute shader is run. Calling this before BeginDebug
+  // runs every thread of a workgroup this size alongside it, so that workgroup shared memory and
+  // barriers behave as they would on the GPU. activeIndex is then the thread's flat index in the
+  // group.
+  void SetComputeWorkgroup(const uint32_t threadDim[3]);
 
   Iter GetIterForInstruction(uint32_t inst);
-  uint32_t GetInstructionForIter(Iter it);
   uint32_t GetInstructionForFunction(Id id);
   uint32_t GetInstructionForLabel(Id id);
+  const DecodedInstruction &GetDecodedInstruction(uint32_t inst) const { return decoded[inst]; }
+  const uint32_t *GetOperands(const DecodedInstruction &inst) const
+  {
+    return m_SPIRV.data() + inst.operands;
+  }
+  const rdcarray<Id> &GetExtInstParams(const DecodedInstruction &inst) const
+  {
+    return extInstParams[inst.extInstParams];
+  }
   const DataType &GetType(Id typeId);
   const DataType &GetTypeForId(Id ssaId);
   const Decorations &GetDecorations(Id typeId);
   rdcstr GetRawName(Id id) const;
   rdcstr GetHumanName(Id id);
+  bool HasSourceName(Id id) const { return !strings[id].empty() || dynamicNames.count(id) > 0; }
   void AddSourceVars(rdcarray<SourceVariableMapping> &sourceVars, const ShaderVariable &var, Id id);
   void AllocateVariable(Id id, Id typeId, ShaderVariable &outVar);
 
@@ -286,10 +394,23 @@ public:
   bool IsOpaquePointer(const ShaderVariable &v) const;
   bool ArePointersAndEqual(const ShaderVariable &a, const ShaderVariable &b) const;
   void WriteThroughPointer(const ShaderVariable &ptr, const ShaderVariable &val);
-  ShaderVariable MakeCompositePointer(const ShaderVariable &base, Id id, rdcarray<uint32_t> &indices);
+  ShaderVariable MakeCompositePointer(const ShaderVariable &base, Id id, const uint32_t *indices,
+                                      size_t numIndices);
 
   DebugAPIWrapper *GetAPIWrapper() { return apiWrapper; }
   uint32_t GetNumInstructions() { return (uint32_t)instructionOffsets.size(); }
+  // where an ID's value is stored in a thread, see ThreadState::registers. IDs that aren't values,
+  // such as types, labels and functions, have NoSlot.
+  static const uint32_t VariableSlot = 0x80000000U;
+  static const uint32_t NoSlot = ~0U;
+  uint32_t GetValueSlot(Id id) const { return valueSlots[id]; }
+  uint32_t GetNumRegisters() const { return numRegisters; }
+  uint32_t GetNumVariables() const { return numVariables; }
+  // each register is stored as this many 32-bit words, enough for four 64-bit components
+  static const uint32_t RegisterWords = 8;
+  // the returned variable is only valid until the same register is read again
+  const ShaderVariable &ReadRegister(uint32_t slot, uint32_t lane) const;
+  void WriteRegister(uint32_t slot, uint32_t lane, const ShaderVariable &var);
   GlobalState GetGlobal() { return global; }
   const rdcarray<Id> &GetLiveGlobals() { return liveGlobals; }
   const rdcarray<SourceVariableMapping> &GetGlobalSourceVars() { return globalSourceVars; }
@@ -312,6 +433,19 @@ private:
 
   void MakeSignatureNames(const rdcarray<SPIRVInterfaceAccess> &sigList, rdcarray<rdcstr> &sigNames);
 
+  void DecodeInstructions();
+  void AssignValueSlots();
+
+  bool StepWorkgroup(rdcarray<bool> &activeMask, ShaderDebugState *state);
+  void RetireDeadIds(ThreadState &thread, ShaderDebugState *state);
+
+  void FindLaneParallelInstructions();
+  void StepLanes(uint32_t instruction, const uint32_t *lanes, size_t numLanes);
+  LaneValue *GetRegisterLanes(uint32_t slot, uint32_t word)
+  {
+    return registerWords.data() + (slot * RegisterWords + word) * workgroup.size();
+  }
+
   /////////////////////////////////////////////////////////
   // debug data
 
@@ -325,6 +459,20 @@ private:
   uint32_t activeLaneIndex = 0;
   ShaderStage stage;
 
+  // if non-zero, the size of the compute workgroup being simulated
+  uint32_t computeThreadDim[3] = {};
+
+  // the register file for every thread. Each word of a register is stored for all threads
+  // together, at [(slot * RegisterWords + word) * workgroup.size() + lane], so that the same
+  // operation on many threads runs over contiguous memory. The type of each register is stored per
+  // thread at [slot * workgroup.size() + lane].
+  rdcarray<LaneValue> registerWords;
+  rdcarray<RegisterInfo> registerInfo;
+
+  // scratch storage while stepping lanes together
+  rdcarray<rdcpair<uint32_t, uint32_t>> laneSteps;
+  rdcarray<uint32_t> laneMask;
+
   int steps = 0;
 
   /////////////////////////////////////////////////////////
@@ -341,13 +489,13 @@ private:
   rdcarray<MemberName> memberNames;
   std::map<rdcstr, Id> entryLookup;
 
-  SparseIdMap<size_t> idDeathOffset;
+  DenseIdMap<size_t> idDeathOffset;
 
   SparseIdMap<size_t> m_Files;
   LineColumnInfo m_CurLineCol;
   std::map<size_t, LineColumnInfo> m_LineColInfo;
 
-  SparseIdMap<uint32_t> labelInstruction;
+  DenseIdMap<uint32_t> labelInstruction;
 
   // the live mutable global variables, to initialise a stack frame's live list
   rdcarray<Id> liveGlobals;
@@ -355,7 +503,7 @@ private:
 
   struct Function
   {
-    size_t begin = 0;
+    uint32_t instruction = 0;
     rdcarray<Id> parameters;
     rdcarray<Id> variables;
   };
@@ -364,6 +512,13 @@ private:
   Function *curFunction = NULL;
 
   rdcarray<size_t> instructionOffsets;
+  rdcarray<DecodedInstruction> decoded;
+  rdcarray<rdcarray<Id>> extInstParams;
+
+  DenseIdMap<uint32_t> valueSlots;
+  uint32_t numRegisters = 0, numVariables = 0;
+  // where each register is read to, see ReadRegister
+  mutable rdcarray<ShaderVariable> registerReads;
 
   std::set<rdcstr> usedNames;
   std::map<Id, rdcstr> dynamicNames;
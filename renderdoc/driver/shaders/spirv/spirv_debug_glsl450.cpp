@@ -982,6 +982,49 @@ ShaderVariable NClamp(ThreadState &state, uint32_t, const rdcarray<Id> &params)
   return var;
 }
 
+// versions of the simple operations above for many lanes at once, see ExtInstLaneImpl. These only
+// handle 32-bit values, so are only used when the first parameter is 32-bit.
+#define LANE_FUNC(func, member, expr)                                                     \
+  void func##Lanes(LaneValue *dst, const LaneValue *const *params, const uint32_t *mask, \
+                   size_t numLanes)                                                      \
+  {                                                                                      \
+    ForEachLane(dst, mask, numLanes, [=](size_t l) {                                     \
+      LaneValue r;                                                                       \
+      r.member = (expr);                                                                 \
+      return r;                                                                          \
+    });                                                                                  \
+  }
+
+#define X params[0][l]
+#define Y params[1][l]
+#define Z params[2][l]
+
+LANE_FUNC(FAbs, f, fabsf(X.f))
+LANE_FUNC(SAbs, i, abs(X.i))
+LANE_FUNC(FSign, f, X.f > 0.0f ? 1.0f : (X.f < 0.0f ? -1.0f : X.f))
+LANE_FUNC(SSign, i, X.i > 0 ? 1 : (X.i < 0 ? -1 : X.i))
+LANE_FUNC(Trunc, f, truncf(X.f))
+LANE_FUNC(Floor, f, floorf(X.f))
+LANE_FUNC(Ceil, f, ceilf(X.f))
+LANE_FUNC(Fract, f, X.f - floorf(X.f))
+LANE_FUNC(FMin, f, GLSLMin(X.f, Y.f))
+LANE_FUNC(UMin, u, GLSLMin(X.u, Y.u))
+LANE_FUNC(SMin, i, GLSLMin(X.i, Y.i))
+LANE_FUNC(FMax, f, GLSLMax(X.f, Y.f))
+LANE_FUNC(UMax, u, GLSLMax(X.u, Y.u))
+LANE_FUNC(SMax, i, GLSLMax(X.i, Y.i))
+LANE_FUNC(FClamp, f, GLSLMin(GLSLMax(X.f, Y.f), Z.f))
+LANE_FUNC(UClamp, u, GLSLMin(GLSLMax(X.u, Y.u), Z.u))
+LANE_FUNC(SClamp, i, GLSLMin(GLSLMax(X.i, Y.i), Z.i))
+LANE_FUNC(NMin, f, GLSLMin(X.f, Y.f))
+LANE_FUNC(NMax, f, GLSLMax(X.f, Y.f))
+LANE_FUNC(NClamp, f, GLSLMin(GLSLMax(X.f, Y.f), Z.f))
+
+#undef X
+#undef Y
+#undef Z
+#undef LANE_FUNC
+
 ShaderVariable GPUOp(ThreadState &state, uint32_t instruction, const rdcarray<Id> &params)
 {
   rdcarray<ShaderVariable> paramVars;
@@ -1063,6 +1106,34 @@ void ConfigureGLSLStd450(ExtInstDispatcher &extinst)
   EXT(NMax);
   EXT(NClamp);
 
+  extinst.laneFunctions.resize(extinst.names.size());
+
+#define LANE_EXT(name, params)                                                 \
+  extinst.laneFunctions[(uint32_t)GLSLstd450::name].func = &glsl::name##Lanes; \
+  extinst.laneFunctions[(uint32_t)GLSLstd450::name].numParams = params;        \
+  uint32_t noduplicatelane##name;                                              \
+  (void)noduplicatelane##name;
+  LANE_EXT(FAbs, 1);
+  LANE_EXT(SAbs, 1);
+  LANE_EXT(FSign, 1);
+  LANE_EXT(SSign, 1);
+  LANE_EXT(Trunc, 1);
+  LANE_EXT(Floor, 1);
+  LANE_EXT(Ceil, 1);
+  LANE_EXT(Fract, 1);
+  LANE_EXT(FMin, 2);
+  LANE_EXT(UMin, 2);
+  LANE_EXT(SMin, 2);
+  LANE_EXT(FMax, 2);
+  LANE_EXT(UMax, 2);
+  LANE_EXT(SMax, 2);
+  LANE_EXT(FClamp, 3);
+  LANE_EXT(UClamp, 3);
+  LANE_EXT(SClamp, 3);
+  LANE_EXT(NMin, 2);
+  LANE_EXT(NMax, 2);
+  LANE_EXT(NClamp, 3);
+
 // transcendentals and other operations that will likely be less accurate on GPU we run on the GPU
 // to be more faithful to the real execution
 #define GPU_EXT(func)                                           \
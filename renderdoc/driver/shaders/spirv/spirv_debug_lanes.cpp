@@ -0,0 +1,354 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "spirv_debug.h"
+
+namespace rdcspv
+{
+// the number of register sources an instruction has if it can be run for many lanes at once, or 0
+// if it can't. These must give exactly the same results as ThreadState::StepNext, which treats
+// each component as 32-bit regardless of its type.
+static uint32_t LaneSources(Op op)
+{
+  switch(op)
+  {
+    case Op::Not:
+    case Op::LogicalNot:
+    case Op::FNegate:
+    case Op::SNegate: return 1;
+    case Op::IAdd:
+    case Op::ISub:
+    case Op::IMul:
+    case Op::FAdd:
+    case Op::FSub:
+    case Op::FMul:
+    case Op::FDiv:
+    case Op::BitwiseOr:
+    case Op::BitwiseAnd:
+    case Op::BitwiseXor:
+    case Op::ShiftLeftLogical:
+    case Op::ShiftRightArithmetic:
+    case Op::ShiftRightLogical:
+    case Op::LogicalEqual:
+    case Op::LogicalNotEqual:
+    case Op::LogicalOr:
+    case Op::LogicalAnd:
+    case Op::IEqual:
+    case Op::INotEqual:
+    case Op::UGreaterThan:
+    case Op::UGreaterThanEqual:
+    case Op::ULessThan:
+    case Op::ULessThanEqual:
+    case Op::SGreaterThan:
+    case Op::SGreaterThanEqual:
+    case Op::SLessThan:
+    case Op::SLessThanEqual:
+    case Op::FOrdEqual:
+    case Op::FOrdNotEqual:
+    case Op::FOrdGreaterThan:
+    case Op::FOrdGreaterThanEqual:
+    case Op::FOrdLessThan:
+    case Op::FOrdLessThanEqual:
+    case Op::FUnordEqual:
+    case Op::FUnordNotEqual:
+    case Op::FUnordGreaterThan:
+    case Op::FUnordGreaterThanEqual:
+    case Op::FUnordLessThan:
+    case Op::FUnordLessThanEqual: return 2;
+    case Op::Select: return 3;
+    default: break;
+  }
+
+  return 0;
+}
+
+const ShaderVariable &Debugger::ReadRegister(uint32_t slot, uint32_t lane) const
+{
+  const size_t numLanes = workgroup.size();
+
+  ShaderVariable &var = registerReads[slot];
+
+  const RegisterInfo &info = registerInfo[slot * numLanes + lane];
+  var.type = info.type;
+  var.rows = info.rows;
+  var.columns = info.columns;
+  var.displayAsHex = info.displayAsHex;
+
+  const LaneValue *words = registerWords.data() + slot * RegisterWords * numLanes + lane;
+  for(uint32_t w = 0; w < RegisterWords; w++)
+    var.value.uv[w] = words[w * numLanes].u;
+
+  return var;
+}
+
+void Debugger::WriteRegister(uint32_t slot, uint32_t lane, const ShaderVariable &var)
+{
+  const size_t numLanes = workgroup.size();
+
+  RegisterInfo &info = registerInfo[slot * numLanes + lane];
+  info.type = var.type;
+  info.rows = var.rows;
+  info.columns = var.columns;
+  info.displayAsHex = var.displayAsHex;
+
+  LaneValue *words = registerWords.data() + slot * RegisterWords * numLanes + lane;
+  for(uint32_t w = 0; w < RegisterWords; w++)
+    words[w * numLanes].u = var.value.uv[w];
+}
+
+void Debugger::FindLaneParallelInstructions()
+{
+  for(DecodedInstruction &inst : decoded)
+  {
+    if(inst.result == Id() || (valueSlots[inst.result] & VariableSlot))
+      continue;
+
+    const uint32_t *ops = GetOperands(inst);
+
+    rdcarray<Id> sources;
+
+    if(inst.op == Op::ExtInst)
+    {
+      // whether the particular instruction can be run this way is only known once the debugger
+      // has set up the instruction set, see StepLanes
+      if(extSets[Id::fromWord(ops[0])] != "GLSL.std.450")
+        continue;
+
+      sources = extInstParams[inst.extInstParams];
+    }
+    else
+    {
+      const uint32_t numSources = LaneSources(inst.op);
+      if(numSources == 0 || inst.numOperands < numSources)
+        continue;
+
+      for(uint32_t i = 0; i < numSources; i++)
+        sources.push_back(Id::fromWord(ops[i]));
+    }
+
+    bool registers = !sources.empty() && sources.size() <= 3;
+    for(Id id : sources)
+      registers &= !(valueSlots[id] & VariableSlot);
+
+    inst.laneParallel = registers;
+  }
+}
+
+void Debugger::StepLanes(uint32_t instruction, const uint32_t *lanes, size_t numLanes)
+{
+  const DecodedInstruction &inst = decoded[instruction];
+  const uint32_t *ops = GetOperands(inst);
+  const size_t workgroupSize = workgroup.size();
+
+  // running lanes together processes every lane in the workgroup, so it's only worth doing when a
+  // good proportion of them are at this instruction
+  bool together = numLanes * 4 >= workgroupSize;
+
+  uint32_t sources[3] = {};
+  uint32_t numSources = 0;
+  const ExtInstLaneImpl *ext = NULL;
+
+  if(inst.op == Op::ExtInst)
+  {
+    const ExtInstDispatcher &dispatch = global.extInsts[Id::fromWord(ops[0])];
+    const rdcarray<Id> &params = GetExtInstParams(inst);
+
+    if(ops[1] < dispatch.laneFunctions.size() && dispatch.laneFunctions[ops[1]].func &&
+       dispatch.laneFunctions[ops[1]].numParams == params.size())
+      ext = &dispatch.laneFunctions[ops[1]];
+    else
+      together = false;
+
+    for(size_t i = 0; i < params.size() && i < 3; i++)
+      sources[numSources++] = valueSlots[params[i]];
+  }
+  else
+  {
+    numSources = LaneSources(inst.op);
+    for(uint32_t i = 0; i < numSources; i++)
+      sources[i] = valueSlots[Id::fromWord(ops[i])];
+  }
+
+  // the result has the type of the first source, or the objects for OpSelect. Each component is
+  // only handled as a 32-bit value, so that type must be 32-bit and the same in every lane.
+  const bool select = (inst.op == Op::Select);
+  const uint32_t typeSource = select ? sources[1] : sources[0];
+
+  const RegisterInfo info = registerInfo[typeSource * workgroupSize + lanes[0]];
+  const RegisterInfo condInfo = registerInfo[sources[0] * workgroupSize + lanes[0]];
+
+  together &= VarTypeByteSize(info.type) == 4;
+
+  for(size_t i = 0; together && i < numLanes; i++)
+  {
+    together &= registerInfo[typeSource * workgroupSize + lanes[i]] == info;
+
+    // OpSelect with a scalar condition copies the whole of either object
+    if(select)
+      together &= registerInfo[sources[2] * workgroupSize + lanes[i]] == info &&
+                  registerInfo[sources[0] * workgroupSize + lanes[i]] == condInfo;
+  }
+
+  if(!together)
+  {
+    for(size_t i = 0; i < numLanes; i++)
+      workgroup[lanes[i]].StepNext(NULL, workgroup);
+    return;
+  }
+
+  laneMask.resize(workgroupSize);
+  for(size_t l = 0; l < workgroupSize; l++)
+    laneMask[l] = 0;
+  for(size_t i = 0; i < numLanes; i++)
+    laneMask[lanes[i]] = ~0U;
+
+  const uint32_t *mask = laneMask.data();
+  const uint32_t result = valueSlots[inst.result];
+
+  bool boolResult = false;
+
+  for(uint32_t w = 0; w < RegisterWords; w++)
+  {
+    LaneValue *dst = GetRegisterLanes(result, w);
+
+    const LaneValue *a = GetRegisterLanes(sources[0], w);
+    const LaneValue *b = numSources > 1 ? GetRegisterLanes(sources[1], w) : NULL;
+
+    if(select)
+    {
+      const LaneValue *cond = GetRegisterLanes(sources[0], condInfo.columns == 1 ? 0 : w);
+      const LaneValue *x = b;
+      const LaneValue *y = GetRegisterLanes(sources[2], w);
+
+      if(condInfo.columns == 1 || w < condInfo.columns)
+        ForEachLane(dst, mask, workgroupSize, [=](size_t l) { return cond[l].u ? x[l] : y[l]; });
+      else
+        ForEachLane(dst, mask, workgroupSize, [=](size_t l) { return x[l]; });
+
+      continue;
+    }
+
+    // any words past the components are left as they were in the first source
+    if(w >= info.columns)
+    {
+      ForEachLane(dst, mask, workgroupSize, [=](size_t l) { return a[l]; });
+      continue;
+    }
+
+    if(ext)
+    {
+      const LaneValue *params[3] = {};
+      for(uint32_t i = 0; i < numSources; i++)
+        params[i] = GetRegisterLanes(sources[i], w);
+
+      ext->func(dst, params, mask, workgroupSize);
+      continue;
+    }
+
+#define LANE_OP(member, expr)                           \
+  ForEachLane(dst, mask, workgroupSize, [=](size_t l) { \
+    LaneValue r;                                        \
+    r.member = (expr);                                  \
+    return r;                                           \
+  })
+
+// comparisons produce bools, but otherwise have the first source's type
+#define LANE_CMP(expr)                                  \
+  LANE_OP(u, (expr) ? 1U : 0U);                         \
+  boolResult = true
+
+    switch(inst.op)
+    {
+      case Op::Not: LANE_OP(u, ~a[l].u); break;
+      case Op::LogicalNot:
+        LANE_OP(u, 1U - a[l].u);
+        boolResult = true;
+        break;
+      case Op::FNegate: LANE_OP(f, -a[l].f); break;
+      case Op::SNegate: LANE_OP(i, -a[l].i); break;
+      case Op::IAdd: LANE_OP(u, a[l].u + b[l].u); break;
+      case Op::ISub: LANE_OP(u, a[l].u - b[l].u); break;
+      case Op::IMul: LANE_OP(u, a[l].u * b[l].u); break;
+      case Op::FAdd: LANE_OP(f, a[l].f + b[l].f); break;
+      case Op::FSub: LANE_OP(f, a[l].f - b[l].f); break;
+      case Op::FMul: LANE_OP(f, a[l].f * b[l].f); break;
+      case Op::FDiv: LANE_OP(f, a[l].f / b[l].f); break;
+      case Op::BitwiseOr: LANE_OP(u, a[l].u | b[l].u); break;
+      case Op::BitwiseAnd: LANE_OP(u, a[l].u & b[l].u); break;
+      case Op::BitwiseXor: LANE_OP(u, a[l].u ^ b[l].u); break;
+      case Op::ShiftLeftLogical: LANE_OP(u, a[l].u << (b[l].u & 31)); break;
+      case Op::ShiftRightArithmetic: LANE_OP(i, a[l].i >> (b[l].u & 31)); break;
+      case Op::ShiftRightLogical: LANE_OP(u, a[l].u >> (b[l].u & 31)); break;
+      case Op::LogicalAnd:
+        LANE_OP(u, a[l].u & b[l].u);
+        boolResult = true;
+        break;
+      case Op::LogicalOr:
+        LANE_OP(u, a[l].u | b[l].u);
+        boolResult = true;
+        break;
+      case Op::IEqual:
+      case Op::LogicalEqual: LANE_CMP(a[l].u == b[l].u); break;
+      case Op::INotEqual:
+      case Op::LogicalNotEqual: LANE_CMP(a[l].u != b[l].u); break;
+      case Op::UGreaterThan: LANE_CMP(a[l].u > b[l].u); break;
+      case Op::UGreaterThanEqual: LANE_CMP(a[l].u >= b[l].u); break;
+      case Op::ULessThan: LANE_CMP(a[l].u < b[l].u); break;
+      case Op::ULessThanEqual: LANE_CMP(a[l].u <= b[l].u); break;
+      case Op::SGreaterThan: LANE_CMP(a[l].i > b[l].i); break;
+      case Op::SGreaterThanEqual: LANE_CMP(a[l].i >= b[l].i); break;
+      case Op::SLessThan: LANE_CMP(a[l].i < b[l].i); break;
+      case Op::SLessThanEqual: LANE_CMP(a[l].i <= b[l].i); break;
+      // see StepNext for how the ordered and unordered comparisons are handled
+      case Op::FOrdEqual: LANE_CMP(a[l].f == b[l].f); break;
+      case Op::FOrdNotEqual: LANE_CMP(a[l].f != b[l].f); break;
+      case Op::FOrdGreaterThan: LANE_CMP(a[l].f > b[l].f); break;
+      case Op::FOrdGreaterThanEqual: LANE_CMP(a[l].f >= b[l].f); break;
+      case Op::FOrdLessThan: LANE_CMP(a[l].f < b[l].f); break;
+      case Op::FOrdLessThanEqual: LANE_CMP(a[l].f <= b[l].f); break;
+      case Op::FUnordEqual: LANE_CMP(!(a[l].f != b[l].f)); break;
+      case Op::FUnordNotEqual: LANE_CMP(!(a[l].f == b[l].f)); break;
+      case Op::FUnordGreaterThan: LANE_CMP(!(a[l].f <= b[l].f)); break;
+      case Op::FUnordGreaterThanEqual: LANE_CMP(!(a[l].f < b[l].f)); break;
+      case Op::FUnordLessThan: LANE_CMP(!(a[l].f >= b[l].f)); break;
+      case Op::FUnordLessThanEqual: LANE_CMP(!(a[l].f > b[l].f)); break;
+      default: RDCERR("Unexpected lane-parallel operation %s", ToStr(inst.op).c_str()); break;
+    }
+
+#undef LANE_OP
+#undef LANE_CMP
+  }
+
+  RegisterInfo resultInfo = info;
+  if(boolResult)
+    resultInfo.type = VarType::Bool;
+
+  for(size_t i = 0; i < numLanes; i++)
+  {
+    registerInfo[result * workgroupSize + lanes[i]] = resultInfo;
+    workgroup[lanes[i]].CompleteLaneStep(inst.result);
+  }
+}
+
+};    // namespace rdcspv
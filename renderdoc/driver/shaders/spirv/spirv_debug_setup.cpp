@@ -107,14 +107,9 @@ Iter Debugger::GetIterForInstruction(uint32_t inst)
   return Iter(m_SPIRV, instructionOffsets[inst]);
 }
 
-uint32_t Debugger::GetInstructionForIter(Iter it)
-{
-  return instructionOffsets.indexOf(it.offs());
-}
-
 uint32_t Debugger::GetInstructionForFunction(Id id)
 {
-  return instructionOffsets.indexOf(functions[id].begin);
+  return functions[id].instruction;
 }
 
 uint32_t Debugger::GetInstructionForLabel(Id id)
@@ -473,19 +468,36 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
   stage = shaderStage;
   apiWrapper = api;
 
+  const bool simulateWorkgroup = shaderStage == ShaderStage::Compute && computeThreadDim[0] > 0;
+
   uint32_t workgroupSize = shaderStage == ShaderStage::Pixel ? 4 : 1;
+  if(simulateWorkgroup)
+    workgroupSize = computeThreadDim[0] * computeThreadDim[1] * computeThreadDim[2];
+
+  if(activeLaneIndex >= workgroupSize)
+  {
+    RDCERR("Invalid active thread %u in workgroup of %u threads", activeLaneIndex, workgroupSize);
+    activeLaneIndex = 0;
+  }
+
   for(uint32_t i = 0; i < workgroupSize; i++)
     workgroup.push_back(ThreadState(i, *this, global));
 
-  ThreadState &active = GetActiveLane();
+  registerWords.resize(numRegisters * RegisterWords * workgroupSize);
+  registerInfo.resize(numRegisters * workgroupSize);
 
-  active.nextInstruction = instructionOffsets.indexOf(functions[entryId].begin);
+  ThreadState &active = GetActiveLane();
 
-  active.ids.resize(idOffsets.size());
+  active.nextInstruction = GetInstructionForFunction(entryId);
+  active.trackSourceVars = true;
 
   // evaluate all constants
   for(auto it = constants.begin(); it != constants.end(); it++)
-    active.ids[it->first] = EvaluateConstant(it->first, specInfo);
+  {
+    ShaderVariable constant = EvaluateConstant(it->first, specInfo);
+    for(ThreadState &lane : workgroup)
+      lane.SetValue(it->first, constant);
+  }
 
   rdcarray<rdcstr> inputSigNames, outputSigNames;
 
@@ -506,9 +518,9 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
     void Set(Debugger &d, const GlobalState &global, ThreadState &lane) const
     {
       if(globalStorage)
-        lane.ids[id] = d.MakePointerVariable(id, &(global.*globalStorage)[index]);
+        lane.SetValue(id, d.MakePointerVariable(id, &(global.*globalStorage)[index]));
       else
-        lane.ids[id] = d.MakePointerVariable(id, &(lane.*threadStorage)[index]);
+        lane.SetValue(id, d.MakePointerVariable(id, &(lane.*threadStorage)[index]));
     }
 
     Id id;
@@ -942,7 +954,7 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
                                          rdcstr(), uninitialisedCallback);
 
       if(v.initializer != Id())
-        AssignValue(var, active.ids[v.initializer]);
+        AssignValue(var, active.GetSrc(v.initializer));
 
       if(v.storage == StorageClass::Private)
       {
@@ -989,9 +1001,9 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
       lane.inputs = active.inputs;
       lane.outputs = active.outputs;
       lane.privates = active.privates;
-      lane.ids = active.ids;
-      // mark as inactive/helper lane
-      lane.helperInvocation = true;
+      lane.variables = active.variables;
+      // mark as inactive/helper lane, unless it's another thread in a compute workgroup
+      lane.helperInvocation = !simulateWorkgroup;
     }
 
     // now that the globals are allocated and their storage won't move, we can take pointers to them
@@ -1051,10 +1063,71 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
       }
     }
   }
+  else if(simulateWorkgroup)
+  {
+    // every thread started with the debugged thread's inputs, fix up the builtins identifying the
+    // thread within the group. Anything else, like the group ID, is the same for all threads.
+    const uint32_t *dim = computeThreadDim;
+    const uint32_t activeThread[3] = {
+        activeLaneIndex % dim[0], (activeLaneIndex / dim[0]) % dim[1],
+        activeLaneIndex / (dim[0] * dim[1]),
+    };
+
+    for(uint32_t t = 0; t < workgroupSize; t++)
+    {
+      if(t == activeLaneIndex)
+        continue;
+
+      const uint32_t thread[3] = {t % dim[0], (t / dim[0]) % dim[1], t / (dim[0] * dim[1])};
+
+      auto threadCallback = [this, t, &thread, &activeThread](
+          ShaderVariable &var, const Decorations &dec, const DataType &, uint64_t, const rdcstr &) {
+        if(!var.members.empty() || !(dec.flags & Decorations::HasBuiltIn))
+          return;
+
+        ShaderBuiltin builtin = MakeShaderBuiltin(stage, dec.builtIn);
+
+        if(builtin == ShaderBuiltin::GroupFlatIndex)
+        {
+          var.value.uv[0] = t;
+        }
+        else if(builtin == ShaderBuiltin::GroupThreadIndex)
+        {
+          for(int c = 0; c < 3; c++)
+            var.value.uv[c] = thread[c];
+        }
+        else if(builtin == ShaderBuiltin::DispatchThreadIndex)
+        {
+          for(int c = 0; c < 3; c++)
+            var.value.uv[c] = var.value.uv[c] - activeThread[c] + thread[c];
+        }
+      };
+
+      for(size_t i = 0; i < inputIDs.size(); i++)
+      {
+        Id id = inputIDs[i];
+
+        const DataType &type = dataTypes[idTypes[id]];
+
+        // global variables should all be pointers into opaque storage
+        RDCASSERT(type.type == DataType::PointerType);
+
+        WalkVariable<ShaderVariable, false>(decorations[id], dataTypes[type.InnerType()], ~0U,
+                                            workgroup[t].inputs[i], rdcstr(), threadCallback);
+      }
+    }
+  }
 
   return ret;
 }
 
+void Debugger::SetComputeWorkgroup(const uint32_t threadDim[3])
+{
+  computeThreadDim[0] = RDCMAX(1U, threadDim[0]);
+  computeThreadDim[1] = RDCMAX(1U, threadDim[1]);
+  computeThreadDim[2] = RDCMAX(1U, threadDim[2]);
+}
+
 rdcarray<ShaderDebugState> Debugger::ContinueDebug()
 {
   ThreadState &active = GetActiveLane();
@@ -1087,7 +1160,7 @@ rdcarray<ShaderDebugState> Debugger::ContinueDebug()
 
     // globals won't be filled out by entering the entry point, ensure their change is registered.
     for(const Id &v : liveGlobals)
-      initial.changes.push_back({ShaderVariable(), GetPointerValue(active.ids[v])});
+      initial.changes.push_back({ShaderVariable(), active.GetDebugValue(v)});
 
     ret.push_back(initial);
 
@@ -1104,82 +1177,186 @@ rdcarray<ShaderDebugState> Debugger::ContinueDebug()
   // more steps if our target thread is inactive
   for(int stepEnd = steps + 100; steps < stepEnd;)
   {
-    global.clock++;
-
     if(active.Finished())
       break;
 
-    // calculate the current mask of which threads are active
-    CalcActiveMask(activeMask);
+    ShaderDebugState state;
 
-    // step all active members of the workgroup
-    for(size_t lane = 0; lane < workgroup.size(); lane++)
+    if(StepWorkgroup(activeMask, &state))
     {
-      ThreadState &thread = workgroup[lane];
+      state.stepIndex = steps;
+      state.sourceVars = active.sourceVars;
+      active.FillCallstack(state);
+      ret.push_back(state);
 
-      if(activeMask[lane])
-      {
-        if(thread.nextInstruction >= instructionOffsets.size())
-        {
-          if(lane == activeLaneIndex)
-            ret.push_back(ShaderDebugState());
+      steps++;
+    }
+  }
 
-          continue;
-        }
+  return ret;
+}
 
-        if(lane == activeLaneIndex)
-        {
-          ShaderDebugState state;
+rdcarray<ShaderDebugState> Debugger::RunDebug(const rdcarray<uint32_t> &breakpoints)
+{
+  ThreadState &active = GetActiveLane();
 
-          // see if we're retiring any IDs at this state
-          for(size_t l = 0; l < thread.live.size();)
-          {
-            Id id = thread.live[l];
-            if(idDeathOffset[id] < instructionOffsets[thread.nextInstruction])
-            {
-              thread.live.erase(l);
-              ShaderVariableChange change;
-              change.before = GetPointerValue(thread.ids[id]);
-              state.changes.push_back(change);
+  rdcarray<ShaderDebugState> ret;
 
-              rdcstr name = GetRawName(id);
+  // whether the active lane has moved from where it was when we were called. We don't stop on a
+  // breakpoint at the current position, otherwise running again would never make progress.
+  bool moved = false;
 
-              thread.sourceVars.removeIf([name](const SourceVariableMapping &var) {
-                return var.variables[0].name.beginsWith(name);
-              });
+  if(steps == 0)
+  {
+    for(size_t lane = 0; lane < workgroup.size(); lane++)
+      workgroup[lane].EnterEntryPoint(NULL);
 
-              continue;
-            }
+    steps++;
+    moved = true;
+  }
+  else if(active.Finished())
+  {
+    return ret;
+  }
 
-            l++;
-          }
+  const uint32_t numInstructions = GetNumInstructions();
 
-          thread.StepNext(&state, workgroup);
-          state.stepIndex = steps;
-          state.sourceVars = thread.sourceVars;
-          thread.FillCallstack(state);
-          ret.push_back(state);
+  rdcarray<bool> isBreakpoint;
+  isBreakpoint.resize(numInstructions);
+  for(uint32_t inst : breakpoints)
+    if(inst < numInstructions)
+      isBreakpoint[inst] = true;
 
-          steps++;
-        }
-        else
-        {
-          thread.StepNext(NULL, workgroup);
-        }
-      }
+  rdcarray<bool> activeMask;
+
+  // step without recording anything until the active lane finishes or is about to execute a
+  // breakpoint
+  while(!active.Finished())
+  {
+    if(moved && active.nextInstruction < numInstructions && isBreakpoint[active.nextInstruction])
+      break;
+
+    if(StepWorkgroup(activeMask, NULL))
+    {
+      steps++;
+      moved = true;
     }
   }
 
+  // return a single state with the complete set of values at the stop point, as if every live ID
+  // had just been assigned.
+  ShaderDebugState state;
+
+  state.stepIndex = steps - 1;
+  state.nextInstruction = RDCMIN(active.nextInstruction, numInstructions - 1);
+
+  rdcarray<Id> ids = liveGlobals;
+  for(const Id &id : active.live)
+    if(!ids.contains(id))
+      ids.push_back(id);
+
+  for(const Id &id : ids)
+    state.changes.push_back({ShaderVariable(), active.GetDebugValue(id)});
+
+  state.sourceVars = active.sourceVars;
+  active.FillCallstack(state);
+
+  ret.push_back(state);
+
   return ret;
 }
 
+bool Debugger::StepWorkgroup(rdcarray<bool> &activeMask, ShaderDebugState *state)
+{
+  bool activeStepped = false;
+
+  global.clock++;
+
+  // calculate the current mask of which threads are active
+  CalcActiveMask(activeMask);
+
+  laneSteps.clear();
+
+  // step all active members of the workgroup. Any that are at an instruction which can be run for
+  // many lanes at once are set aside, unless it's the active lane and we're recording its changes.
+  for(uint32_t lane = 0; lane < workgroup.size(); lane++)
+  {
+    ThreadState &thread = workgroup[lane];
+
+    if(!activeMask[lane] || thread.nextInstruction >= instructionOffsets.size())
+      continue;
+
+    ShaderDebugState *laneState = NULL;
+
+    if(lane == activeLaneIndex)
+    {
+      RetireDeadIds(thread, state);
+      laneState = state;
+      activeStepped = true;
+    }
+
+    if(workgroup.size() > 1 && !laneState && decoded[thread.nextInstruction].laneParallel)
+      laneSteps.push_back({thread.nextInstruction, lane});
+    else
+      thread.StepNext(laneState, workgroup);
+  }
+
+  // these only write registers belonging to each lane, so it doesn't matter that they're run
+  // after lanes that came later in the workgroup. Group the lanes by instruction and run each
+  // group together
+  std::sort(laneSteps.begin(), laneSteps.end());
+
+  rdcarray<uint32_t> lanes;
+  for(size_t i = 0; i < laneSteps.size();)
+  {
+    const uint32_t instruction = laneSteps[i].first;
+
+    lanes.clear();
+    for(; i < laneSteps.size() && laneSteps[i].first == instruction; i++)
+      lanes.push_back(laneSteps[i].second);
+
+    StepLanes(instruction, lanes.data(), lanes.size());
+  }
+
+  return activeStepped;
+}
+
+void Debugger::RetireDeadIds(ThreadState &thread, ShaderDebugState *state)
+{
+  // see if we're retiring any IDs at this state
+  for(size_t l = 0; l < thread.live.size();)
+  {
+    Id id = thread.live[l];
+    if(idDeathOffset[id] < instructionOffsets[thread.nextInstruction])
+    {
+      thread.live.erase(l);
+
+      if(state)
+      {
+        ShaderVariableChange change;
+        change.before = thread.GetDebugValue(id);
+        state->changes.push_back(change);
+      }
+
+      rdcstr name = GetRawName(id);
+
+      thread.sourceVars.removeIf([name](const SourceVariableMapping &var) {
+        return var.variables[0].name.beginsWith(name);
+      });
+
+      continue;
+    }
+
+    l++;
+  }
+}
+
 ShaderVariable Debugger::MakePointerVariable(Id id, const ShaderVariable *v, uint32_t scalar0,
                                              uint32_t scalar1) const
 {
   ShaderVariable var;
   var.rows = var.columns = 1;
   var.type = VarType::GPUPointer;
-  var.name = GetRawName(id);
   var.value.u64v[PointerVariableSlot] = (uint64_t)(uintptr_t)v;
   var.value.u64v[Scalar0VariableSlot] = scalar0;
   var.value.u64v[Scalar1VariableSlot] = scalar1;
@@ -1188,7 +1365,7 @@ ShaderVariable Debugger::MakePointerVariable(Id id, const ShaderVariable *v, uin
 }
 
 ShaderVariable Debugger::MakeCompositePointer(const ShaderVariable &base, Id id,
-                                              rdcarray<uint32_t> &indices)
+                                              const uint32_t *indices, size_t numIndices)
 {
   const ShaderVariable *leaf = &base;
 
@@ -1230,7 +1407,7 @@ ShaderVariable Debugger::MakeCompositePointer(const ShaderVariable &base, Id id,
 
     Decorations curDecorations = decorations[type->id];
 
-    while(i < indices.size() &&
+    while(i < numIndices &&
           (type->type == DataType::ArrayType || type->type == DataType::StructType))
     {
       if(type->type == DataType::ArrayType)
@@ -1267,7 +1444,7 @@ ShaderVariable Debugger::MakeCompositePointer(const ShaderVariable &base, Id id,
     if(curDecorations.flags & Decorations::RowMajor)
       ret.value.u64v[MajorStrideVariableSlot] |= 0x80000000U;
 
-    size_t remaining = indices.size() - i;
+    size_t remaining = numIndices - i;
     if(remaining == 2)
     {
       // pointer to a scalar in a matrix. indices[i] is column, indices[i + 1] is row
@@ -1329,7 +1506,7 @@ ShaderVariable Debugger::MakeCompositePointer(const ShaderVariable &base, Id id,
   size_t i = 0;
   if(isArray)
     i++;
-  while(i < indices.size() && !leaf->members.empty())
+  while(i < numIndices && !leaf->members.empty())
   {
     uint32_t idx = indices[i++];
     if(idx > leaf->members.size())
@@ -1346,7 +1523,7 @@ ShaderVariable Debugger::MakeCompositePointer(const ShaderVariable &base, Id id,
   // apply any remaining scalar selectors
   uint32_t scalar0 = ~0U, scalar1 = ~0U;
 
-  size_t remaining = indices.size() - i;
+  size_t remaining = numIndices - i;
 
   if(remaining > 2)
   {
@@ -1354,7 +1531,7 @@ ShaderVariable Debugger::MakeCompositePointer(const ShaderVariable &base, Id id,
         MessageCategory::Execution, MessageSeverity::High, MessageSource::RuntimeWarning,
         StringFormat::Fmt("Too many indices left (%zu) at leaf %s. Ignoring all but last two",
                           remaining, leaf->name.c_str()));
-    i = indices.size() - 2;
+    i = numIndices - 2;
   }
 
   if(remaining == 2)
@@ -1821,7 +1998,33 @@ void Debugger::CalcActiveMask(rdcarray<bool> &activeMask)
 
   // only pixel shaders automatically converge workgroups, compute shaders need explicit sync
   if(stage != ShaderStage::Pixel)
+  {
+    // threads wait at a control barrier until every thread that hasn't finished has reached one
+    bool anyAtBarrier = false, allAtBarrier = true;
+    for(size_t i = 0; i < workgroup.size(); i++)
+    {
+      if(!activeMask[i])
+        continue;
+
+      const uint32_t inst = workgroup[i].nextInstruction;
+      const bool atBarrier = inst < decoded.size() && decoded[inst].op == Op::ControlBarrier;
+
+      anyAtBarrier |= atBarrier;
+      allAtBarrier &= atBarrier;
+    }
+
+    if(anyAtBarrier && !allAtBarrier)
+    {
+      for(size_t i = 0; i < workgroup.size(); i++)
+      {
+        const uint32_t inst = workgroup[i].nextInstruction;
+        if(inst < decoded.size() && decoded[inst].op == Op::ControlBarrier)
+          activeMask[i] = false;
+      }
+    }
+
     return;
+  }
 
   // otherwise we need to make sure that control flow which converges stays in lockstep so that
   // derivatives etc are still valid. While diverged, we don't have to keep threads in lockstep
@@ -2003,7 +2206,7 @@ uint32_t Debugger::WalkVariable(
 
       uint32_t childOffset = 0;
 
-      ShaderVariable len = GetActiveLane().ids[type.length];
+      ShaderVariable len = GetActiveLane().GetSrc(type.length);
       for(uint32_t i = 0; i < len.value.u.x; i++)
       {
         if(outVar)
@@ -2229,6 +2432,8 @@ void Debugger::PreParse(uint32_t maxId)
   Processor::PreParse(maxId);
 
   strings.resize(idTypes.size());
+  idDeathOffset.resize(idTypes.size());
+  labelInstruction.resize(idTypes.size());
 }
 
 void Debugger::PostParse()
@@ -2243,6 +2448,128 @@ void Debugger::PostParse()
     idDeathOffset[v.id] = ~0U;
 
   memberNames.clear();
+
+  DecodeInstructions();
+  AssignValueSlots();
+  FindLaneParallelInstructions();
+}
+
+void Debugger::AssignValueSlots()
+{
+  // the type of each ID is fixed, so we know up front which values will fit in a register. Every
+  // thread then uses the same layout.
+  valueSlots.resize(idTypes.size());
+
+  for(size_t i = 0; i < idTypes.size(); i++)
+  {
+    valueSlots[i] = NoSlot;
+
+    // IDs without a result type aren't values
+    auto it = dataTypes.find(idTypes[i]);
+    if(it == dataTypes.end())
+      continue;
+
+    const DataType &type = it->second;
+
+    // nor are functions or the results of calls to functions returning void
+    if(type.type == DataType::ScalarType && type.scalar().type == Op::TypeVoid)
+      continue;
+    if(ConstIter(m_SPIRV, idOffsets[i]).opcode() == Op::Function)
+      continue;
+
+    if(type.type == DataType::ScalarType ||
+       (type.type == DataType::VectorType && type.vector().count <= 4))
+      valueSlots[i] = numRegisters++;
+    else
+      valueSlots[i] = VariableSlot | numVariables++;
+  }
+
+  registerReads.resize(numRegisters);
+}
+
+void Debugger::DecodeInstructions()
+{
+  decoded.resize(instructionOffsets.size());
+
+  for(size_t i = 0; i < instructionOffsets.size(); i++)
+  {
+    ConstIter it(m_SPIRV, instructionOffsets[i]);
+    OpDecoder opdata(it);
+
+    DecodedInstruction &inst = decoded[i];
+    inst.op = opdata.op;
+    inst.result = opdata.result;
+    inst.resultType = opdata.resultType;
+
+    uint32_t header = 1;
+    if(opdata.resultType != Id())
+      header++;
+    if(opdata.result != Id())
+      header++;
+
+    inst.operands = uint32_t(it.offs() + header);
+    inst.numOperands = opdata.wordCount > header ? opdata.wordCount - header : 0;
+
+    if(inst.op == Op::FunctionCall)
+    {
+      inst.target = GetInstructionForFunction(Id::fromWord(it.word(3)));
+    }
+    else if(inst.op == Op::ExtInst)
+    {
+      inst.extInstParams = (uint32_t)extInstParams.size();
+
+      rdcarray<Id> params;
+      for(size_t w = 5; w < it.size(); w++)
+        params.push_back(Id::fromWord(it.word(w)));
+
+      extInstParams.push_back(params);
+    }
+  }
+
+  // walk backwards to find where to skip to from each instruction, so the skip target and merge
+  // block from the next instruction are already known
+  for(size_t i = decoded.size(); i > 0; i--)
+  {
+    DecodedInstruction &inst = decoded[i - 1];
+
+    inst.skipTo = uint32_t(i - 1);
+
+    if(i == decoded.size())
+      continue;
+
+    const DecodedInstruction &next = decoded[i];
+
+    if(inst.op == Op::Line || inst.op == Op::NoLine)
+    {
+      inst.skipTo = next.skipTo;
+      inst.skipMerge = next.skipMerge;
+    }
+    else if(inst.op == Op::SelectionMerge || inst.op == Op::LoopMerge)
+    {
+      inst.skipTo = next.skipTo;
+      // a later merge that's skipped over takes precedence
+      inst.skipMerge = next.skipMerge;
+      if(inst.skipMerge == Id())
+        inst.skipMerge = Id::fromWord(m_SPIRV[inst.operands]);
+    }
+  }
+
+  // a branch is degenerate if it jumps to the label immediately following, ignoring line info
+  for(size_t i = 0; i + 1 < decoded.size(); i++)
+  {
+    DecodedInstruction &inst = decoded[i];
+
+    if(inst.op != Op::Branch)
+      continue;
+
+    size_t next = i + 1;
+    while(next < decoded.size() &&
+          (decoded[next].op == Op::Line || decoded[next].op == Op::NoLine))
+      next++;
+
+    inst.degenerateBranch = next < decoded.size() && decoded[next].op == Op::Label &&
+                            decoded[next].result == Id::fromWord(m_SPIRV[inst.operands]);
+  }
 }
 
 void Debugger::RegisterOp(Iter it)
@@ -2332,7 +2659,7 @@ void Debugger::RegisterOp(Iter it)
 
     curFunction = &functions[func.result];
 
-    curFunction->begin = it.offs();
+    curFunction->instruction = instructionOffsets.count();
   }
   else if(opdata.op == Op::FunctionParameter)
   {
@@ -2386,3 +2713,547 @@ void Debugger::RegisterOp(Iter it)
 }
 
 };    // namespace rdcspv
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+#include "core/core.h"
+#include "replay/shader_debug_store.h"
+#include "spirv_compile.h"
+
+namespace
+{
+// a minimal API wrapper for running compute shaders in tests. Binding 0 in set 0 is a plain byte
+// buffer, and the few operations that would normally be evaluated on the GPU are done on the CPU.
+class TestDebugAPIWrapper : public rdcspv::DebugAPIWrapper
+{
+public:
+  bytebuf buffer;
+  uint32_t threadIndex[3] = {};
+  uint32_t groupThreadIndex[3] = {};
+  uint32_t groupFlatIndex = 0;
+
+  void AddDebugMessage(MessageCategory c, MessageSeverity sv, MessageSource src, rdcstr d) override
+  {
+    messages.push_back(d);
+  }
+
+  uint64_t GetBufferLength(BindpointIndex bind) override { return buffer.size(); }
+  void ReadBufferValue(BindpointIndex bind, uint64_t offset, uint64_t byteSize, void *dst) override
+  {
+    memset(dst, 0, (size_t)byteSize);
+    if(offset < buffer.size())
+      memcpy(dst, buffer.data() + offset, (size_t)RDCMIN(byteSize, buffer.size() - offset));
+  }
+  void WriteBufferValue(BindpointIndex bind, uint64_t offset, uint64_t byteSize,
+                        const void *src) override
+  {
+    if(offset < buffer.size())
+      memcpy(buffer.data() + offset, src, (size_t)RDCMIN(byteSize, buffer.size() - offset));
+  }
+
+  bool ReadTexel(BindpointIndex imageBind, const ShaderVariable &coord, uint32_t sample,
+                 ShaderVariable &output) override
+  {
+    return false;
+  }
+  bool WriteTexel(BindpointIndex imageBind, const ShaderVariable &coord, uint32_t sample,
+                  const ShaderVariable &value) override
+  {
+    return false;
+  }
+
+  void FillInputValue(ShaderVariable &var, ShaderBuiltin builtin, uint32_t location,
+                      uint32_t component) override
+  {
+    memset(var.value.u64v, 0, sizeof(var.value.u64v));
+
+    if(builtin == ShaderBuiltin::DispatchThreadIndex)
+      memcpy(var.value.uv, threadIndex, sizeof(threadIndex));
+    else if(builtin == ShaderBuiltin::GroupThreadIndex)
+      memcpy(var.value.uv, groupThreadIndex, sizeof(groupThreadIndex));
+    else if(builtin == ShaderBuiltin::GroupFlatIndex)
+      var.value.uv[0] = groupFlatIndex;
+  }
+
+  bool CalculateSampleGather(rdcspv::ThreadState &lane, rdcspv::Op opcode, TextureType texType,
+                             BindpointIndex imageBind, BindpointIndex samplerBind,
+                             const ShaderVariable &uv, const ShaderVariable &ddxCalc,
+                             const ShaderVariable &ddyCalc, const ShaderVariable &compare,
+                             rdcspv::GatherChannel gatherChannel,
+                             const rdcspv::ImageOperandsAndParamDatas &operands,
+                             ShaderVariable &output) override
+  {
+    return false;
+  }
+
+  bool CalculateMathOp(rdcspv::ThreadState &lane, rdcspv::GLSLstd450 op,
+                       const rdcarray<ShaderVariable> &params, ShaderVariable &output) override
+  {
+    for(uint8_t c = 0; c < output.columns; c++)
+    {
+      switch(op)
+      {
+        case rdcspv::GLSLstd450::Sqrt: output.value.fv[c] = sqrtf(params[0].value.fv[c]); break;
+        case rdcspv::GLSLstd450::Sin: output.value.fv[c] = sinf(params[0].value.fv[c]); break;
+        case rdcspv::GLSLstd450::Exp2: output.value.fv[c] = exp2f(params[0].value.fv[c]); break;
+        default: return false;
+      }
+    }
+
+    return true;
+  }
+
+  DerivativeDeltas GetDerivative(ShaderBuiltin builtin, uint32_t location,
+                                 uint32_t component) override
+  {
+    return DerivativeDeltas();
+  }
+
+  rdcarray<rdcstr> messages;
+};
+
+rdcarray<uint32_t> CompileCompute(const rdcstr &source)
+{
+  rdcspv::Init();
+  RenderDoc::Inst().RegisterShutdownFunction(&rdcspv::Shutdown);
+
+  rdcarray<uint32_t> spirv;
+  rdcspv::CompilationSettings settings(rdcspv::InputLanguage::VulkanGLSL,
+                                       rdcspv::ShaderStage::Compute);
+  settings.debugInfo = true;
+  rdcstr errors = rdcspv::Compile(settings, {source}, spirv);
+
+  INFO("SPIR-V compile output: " << errors);
+
+  REQUIRE(!spirv.empty());
+
+  return spirv;
+}
+
+// begins debugging the shader, the debugger takes ownership of the API wrapper. If threadDim is
+// specified the whole workgroup is simulated, with the API wrapper's thread as the active one.
+rdcspv::Debugger *BeginComputeDebug(const rdcarray<uint32_t> &spirv, TestDebugAPIWrapper *api,
+                                    ShaderDebugTrace *&trace, const uint32_t *threadDim = NULL)
+{
+  rdcspv::Reflector refl;
+  refl.Parse(spirv);
+
+  ShaderReflection reflection;
+  ShaderBindpointMapping mapping;
+  SPIRVPatchData patchData;
+  refl.MakeReflection(GraphicsAPI::Vulkan, ShaderStage::Compute, "main", {}, reflection, mapping,
+                      patchData);
+
+  rdcspv::Debugger *debugger = new rdcspv::Debugger;
+  debugger->Parse(spirv);
+
+  // only values get a slot, not types, labels, functions and so on. spirv[3] is the ID bound
+  CHECK(debugger->GetNumRegisters() + debugger->GetNumVariables() < spirv[3]);
+
+  uint32_t activeIndex = 0;
+  if(threadDim)
+  {
+    debugger->SetComputeWorkgroup(threadDim);
+    activeIndex = api->groupFlatIndex;
+  }
+
+  trace = debugger->BeginDebug(api, ShaderStage::Compute, "main", {}, {}, patchData, activeIndex);
+
+  return debugger;
+}
+
+// debugs the shader to completion with buffer bound, and returns how many states were generated.
+// If api is specified it's used instead of a default API wrapper, and the debugger takes ownership.
+uint32_t DebugToCompletion(const rdcarray<uint32_t> &spirv, bytebuf &buffer,
+                           TestDebugAPIWrapper *api = NULL, const uint32_t *threadDim = NULL)
+{
+  if(!api)
+    api = new TestDebugAPIWrapper;
+  api->buffer = buffer;
+
+  ShaderDebugTrace *trace = NULL;
+  rdcspv::Debugger *debugger = BeginComputeDebug(spirv, api, trace, threadDim);
+
+  uint32_t numStates = 0;
+  bool allNamed = true;
+
+  // check that every state can be stored compactly and rebuilt exactly
+  ShaderDebugStateStore store(16);
+  rdcarray<ShaderDebugState> allStates;
+
+  for(;;)
+  {
+    rdcarray<ShaderDebugState> states = debugger->ContinueDebug();
+
+    if(states.empty())
+      break;
+
+    numStates += (uint32_t)states.size();
+
+    store.Append(states);
+    allStates.append(states);
+
+    // values are stored unnamed, every change that's displayed must still have a name
+    for(const ShaderDebugState &state : states)
+      for(const ShaderVariableChange &change : state.changes)
+        allNamed &= !change.before.name.empty() || !change.after.name.empty();
+
+    // guard against the debugger never finishing
+    REQUIRE(numStates < 1000000);
+  }
+
+  CHECK(allNamed);
+  bool storedExactly = (store.GetStates(0, numStates) == allStates);
+  CHECK(storedExactly);
+
+  buffer = api->buffer;
+
+  delete trace;
+  delete debugger;
+
+  return numStates;
+}
+
+// returns the value of a source variable in a state returned from RunDebug
+ShaderVariable GetSourceValue(const ShaderDebugState &state, const rdcstr &name)
+{
+  for(const SourceVariableMapping &sourceVar : state.sourceVars)
+  {
+    if(sourceVar.name != name)
+      continue;
+
+    for(const ShaderVariableChange &change : state.changes)
+      if(change.after.name == sourceVar.variables[0].name)
+        return change.after;
+  }
+
+  return ShaderVariable();
+}
+
+uint32_t AsUInt(float f)
+{
+  uint32_t ret;
+  memcpy(&ret, &f, sizeof(ret));
+  return ret;
+}
+
+};    // anonymous namespace
+
+TEST_CASE("Debug SPIR-V compute shaders", "[spirv][debugger]")
+{
+  const rdcstr header = R"(
+#version 450 core
+
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+layout(binding = 0, std430) buffer outbuf
+{
+  uint data[];
+} outBuf;
+
+)";
+
+  bytebuf buffer;
+  buffer.resize(64 * sizeof(uint32_t));
+  uint32_t *data = (uint32_t *)buffer.data();
+
+  SECTION("Integer and float arithmetic, loops, switches and function calls")
+  {
+    rdcarray<uint32_t> spirv = CompileCompute(header + R"(
+uint collatz(uint n)
+{
+  uint steps = 0;
+  while(n != 1u)
+  {
+    if((n & 1u) == 1u)
+      n = n * 3u + 1u;
+    else
+      n /= 2u;
+    steps++;
+  }
+  return steps;
+}
+
+void main()
+{
+  uint acc = outBuf.data[8];
+  float f = 0.0;
+  int s = 5;
+  for(uint i = 0; i < 20u; i++)
+  {
+    acc += collatz(i + 1u) * i;
+    f += float(i) * 0.5;
+    s = (s * 3 + int(i)) % 1000;
+    switch(i % 3u)
+    {
+      case 0u: acc ^= i; break;
+      case 1u: acc += 2u; break;
+      default: break;
+    }
+  }
+  outBuf.data[0] = acc;
+  outBuf.data[1] = floatBitsToUint(f);
+  outBuf.data[2] = uint(s);
+  outBuf.data[3] = outBuf.data[4] + 7u;
+}
+)");
+
+    data[4] = 100;
+    data[8] = 3;
+
+    uint32_t acc = 3;
+    float f = 0.0f;
+    int s = 5;
+    for(uint32_t i = 0; i < 20; i++)
+    {
+      uint32_t n = i + 1, steps = 0;
+      while(n != 1)
+      {
+        n = (n & 1) ? n * 3 + 1 : n / 2;
+        steps++;
+      }
+
+      acc += steps * i;
+      f += float(i) * 0.5f;
+      s = (s * 3 + int(i)) % 1000;
+      if(i % 3 == 0)
+        acc ^= i;
+      else if(i % 3 == 1)
+        acc += 2;
+    }
+
+    uint32_t numStates = DebugToCompletion(spirv, buffer);
+
+    CHECK(numStates > 1000);
+    CHECK(data[0] == acc);
+    CHECK(data[1] == AsUInt(f));
+    CHECK(data[2] == uint32_t(s));
+    CHECK(data[3] == 107);
+  };
+
+  SECTION("Vector, matrix, composite and GLSL.std.450 operations")
+  {
+    rdcarray<uint32_t> spirv = CompileCompute(header + R"(
+struct Item
+{
+  vec2 a;
+  uint b;
+};
+
+void main()
+{
+  Item items[4];
+  for(int i = 0; i < 4; i++)
+  {
+    items[i].a = vec2(float(i), float(i) * 2.0);
+    items[i].b = uint(i * i);
+  }
+
+  vec4 v = vec4(1.0, 2.0, 3.0, 4.0) * uintBitsToFloat(outBuf.data[8]);
+  v = v.wzyx * 2.0 + vec4(items[3].a, items[2].a);
+  mat2 m = mat2(1.0, 2.0, 3.0, 4.0);
+  vec2 mv = m * vec2(1.0, 1.0);
+  float d = dot(v, vec4(1.0));
+  vec3 c = clamp(v.xyz - 5.0, vec3(0.0), vec3(3.0));
+  float mx = max(mix(1.0, 3.0, v.w / 12.0), min(d, 2.5));
+  bvec2 bb = lessThan(mv, vec2(5.0));
+
+  outBuf.data[0] = floatBitsToUint(d);
+  outBuf.data[1] = floatBitsToUint(c.x + c.y * 10.0 + c.z * 100.0);
+  outBuf.data[2] = floatBitsToUint(mx);
+  outBuf.data[3] = items[1].b + items[2].b + items[3].b;
+  outBuf.data[4] = floatBitsToUint(mv.x * 10.0 + mv.y);
+  outBuf.data[5] = floatBitsToUint(sqrt(16.0 + d));
+  outBuf.data[6] = (bb.x ? 1u : 0u) | (bb.y ? 2u : 0u);
+}
+)");
+
+    data[8] = AsUInt(1.0f);
+
+    DebugToCompletion(spirv, buffer);
+
+    // v = (4,3,2,1) * 2 + (3,6,2,4) = (11,12,6,6)
+    CHECK(data[0] == AsUInt(35.0f));
+    // clamp((6,7,1), 0, 3) = (3,3,1)
+    CHECK(data[1] == AsUInt(133.0f));
+    CHECK(data[2] == AsUInt(2.5f));
+    CHECK(data[3] == 14);
+    // column-major (1,2),(3,4) * (1,1) = (4,6)
+    CHECK(data[4] == AsUInt(46.0f));
+    CHECK(data[5] == AsUInt(sqrtf(51.0f)));
+    CHECK(data[6] == 1);
+  };
+
+  SECTION("Running to breakpoints and completion")
+  {
+    const rdcstr source = header + R"(
+void main()
+{
+  uint acc = outBuf.data[8];
+  for(uint i = 0; i < 50u; i++)
+  {
+    acc += i * 3u;
+  }
+  outBuf.data[0] = acc;
+}
+)";
+    rdcarray<uint32_t> spirv = CompileCompute(source);
+
+    data[8] = 10;
+
+    bytebuf stepped = buffer;
+    uint32_t numStates = DebugToCompletion(spirv, stepped);
+
+    TestDebugAPIWrapper *api = new TestDebugAPIWrapper;
+    api->buffer = buffer;
+
+    ShaderDebugTrace *trace = NULL;
+    rdcspv::Debugger *debugger = BeginComputeDebug(spirv, api, trace);
+
+    // break at the start of the loop body's line
+    int32_t ptr = source.find("acc += i");
+    uint32_t line = 1;
+    for(int32_t c = 0; c < ptr; c++)
+      if(source[c] == '\n')
+        line++;
+
+    rdcarray<uint32_t> breakpoints;
+    for(uint32_t i = 0; i < trace->lineInfo.size(); i++)
+      if(trace->lineInfo[i].lineStart == line &&
+         (i == 0 || trace->lineInfo[i - 1].lineStart != line))
+        breakpoints.push_back(i);
+
+    REQUIRE(!breakpoints.empty());
+
+    uint32_t acc = 10;
+    for(uint32_t i = 0; i < 2; i++)
+    {
+      rdcarray<ShaderDebugState> states = debugger->RunDebug(breakpoints);
+
+      REQUIRE(states.size() == 1);
+      CHECK(breakpoints.contains(states[0].nextInstruction));
+      CHECK(GetSourceValue(states[0], "acc").value.uv[0] == acc);
+      CHECK(GetSourceValue(states[0], "i").value.uv[0] == i);
+
+      acc += i * 3;
+    }
+
+    // we can step on from a breakpoint
+    rdcarray<ShaderDebugState> states = debugger->ContinueDebug();
+    REQUIRE(!states.empty());
+
+    // and run the rest of the way from there
+    states = debugger->RunDebug({});
+    REQUIRE(states.size() == 1);
+    CHECK(states[0].stepIndex + 1 == numStates);
+    CHECK(debugger->RunDebug({}).empty());
+    CHECK(debugger->ContinueDebug().empty());
+
+    CHECK(api->buffer == stepped);
+    CHECK(((uint32_t *)stepped.data())[0] == 3685);
+
+    delete trace;
+    delete debugger;
+  };
+
+  SECTION("Simulating a whole workgroup")
+  {
+    rdcarray<uint32_t> spirv = CompileCompute(R"(
+#version 450 core
+
+layout(local_size_x = 8, local_size_y = 4, local_size_z = 2) in;
+
+layout(binding = 0, std430) buffer outbuf
+{
+  uint data[];
+} outBuf;
+
+shared uint partial[64];
+
+void main()
+{
+  uint idx = gl_LocalInvocationIndex;
+  uvec3 id = gl_LocalInvocationID;
+
+  float f = float(idx) * 0.75 - 10.0;
+  float g = clamp(abs(f), 1.5, 12.0) + floor(f) * fract(f + 0.25);
+  uint u = (idx * 2654435761u) ^ (idx << 3u);
+  int s = int(idx) - 32;
+  uint r = max(u >> 7u, 100u) + uint(min(s, 0) * -3) + (id.x | (id.y << 4u) | (id.z << 8u));
+  r += (g > 3.0) ? 1000u : 0u;
+
+  // threads take different amounts of time to get to the barrier
+  for(uint i = 0; i < idx % 7u; i++)
+    r = r * 3u + i;
+
+  // other threads' values are only visible after the barrier
+  partial[idx] = r;
+  barrier();
+
+  uint sum = 0;
+  for(uint i = 0; i < 64u; i++)
+    sum += partial[i];
+
+  outBuf.data[idx] = r;
+  outBuf.data[64u + idx] = floatBitsToUint(g);
+  outBuf.data[128u + idx] = sum;
+  outBuf.data[192u + idx] = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * 100u +
+                            gl_GlobalInvocationID.z * 10000u;
+}
+)");
+
+    buffer.resize(256 * sizeof(uint32_t));
+    data = (uint32_t *)buffer.data();
+
+    const uint32_t threadDim[3] = {8, 4, 2};
+
+    // debug a thread in the middle of the second workgroup along X
+    TestDebugAPIWrapper *api = new TestDebugAPIWrapper;
+    api->groupThreadIndex[0] = 3;
+    api->groupThreadIndex[1] = 2;
+    api->groupThreadIndex[2] = 1;
+    api->threadIndex[0] = 8 + 3;
+    api->threadIndex[1] = 2;
+    api->threadIndex[2] = 1;
+    api->groupFlatIndex = 1 * 32 + 2 * 8 + 3;
+
+    DebugToCompletion(spirv, buffer, api, threadDim);
+
+    uint32_t expected[256] = {};
+    uint32_t sum = 0;
+    for(uint32_t idx = 0; idx < 64; idx++)
+    {
+      uint32_t id[3] = {idx % 8, (idx / 8) % 4, idx / 32};
+
+      float f = float(idx) * 0.75f - 10.0f;
+      float g = RDCCLAMP(fabsf(f), 1.5f, 12.0f) + floorf(f) * ((f + 0.25f) - floorf(f + 0.25f));
+      uint32_t u = (idx * 2654435761u) ^ (idx << 3u);
+      int32_t s = int32_t(idx) - 32;
+      uint32_t r = RDCMAX(u >> 7u, 100u) + uint32_t(RDCMIN(s, 0) * -3) +
+                   (id[0] | (id[1] << 4u) | (id[2] << 8u));
+      r += (g > 3.0f) ? 1000u : 0u;
+
+      for(uint32_t i = 0; i < idx % 7; i++)
+        r = r * 3 + i;
+
+      expected[idx] = r;
+      expected[64 + idx] = AsUInt(g);
+      expected[192 + idx] = (8 + id[0]) + id[1] * 100 + id[2] * 10000;
+
+      sum += r;
+    }
+
+    for(uint32_t idx = 0; idx < 64; idx++)
+      expected[128 + idx] = sum;
+
+    // check every thread's results, not just the one being debugged
+    for(uint32_t i = 0; i < 256; i++)
+    {
+      INFO("output " << i);
+      CHECK(data[i] == expected[i]);
+    }
+  };
+}
+
+#endif
@@ -344,6 +344,10 @@ bool VkInitParams::IsSupportedVersion(uint64_t ver)
   if(ver == CurrentVersion)
     return true;
 
+  // 0x12 -> 0x13 - initial contents may reference identical data earlier in the capture
+  if(ver == 0x12)
+    return true;
+
   // 0x11 -> 0x12 - added inline uniform block support
   if(ver == 0x11)
     return true;
@@ -1062,6 +1066,8 @@ void DescriptorSetSlot::RemoveBindRefs(rdcarray<ResourceId> &ids, VulkanResource
 {
   SCOPED_LOCK(record->descInfo->refLock);
 
+  record->descInfo->refGeneration++;
+
   if(texelBufferView != ResourceId())
   {
     record->RemoveBindFrameRef(ids, texelBufferView);
@@ -1111,6 +1117,8 @@ void DescriptorSetSlot::AddBindRefs(rdcarray<ResourceId> &ids, VkResourceRecord
 {
   SCOPED_LOCK(descSetRecord->descInfo->refLock);
 
+  descSetRecord->descInfo->refGeneration++;
+
   if(bufView)
   {
     descSetRecord->AddBindFrameRef(ids, bufView->GetResourceID(), eFrameRef_Read,
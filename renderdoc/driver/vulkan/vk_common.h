@@ -400,7 +400,8 @@ struct MemoryAllocation
 // path at compile-time, and the second because we might be just struct-serialising in which case we
 // should be doing no work to restore states.
 // Writing is unambiguously during capture mode, so we don't have to check both in that case.
-#define IsReplayingAndReading() (ser.IsReading() && IsReplayMode(m_State))
+#define IsReplayingAndReading() \
+  (ser.IsReading() && IsReplayMode(m_State) && !ser.IsStructureOnly())
 
 struct VkResourceRecord;
 class VulkanResourceManager;
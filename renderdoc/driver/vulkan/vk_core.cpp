@@ -25,6 +25,7 @@
 #include "vk_core.h"
 #include <ctype.h>
 #include <algorithm>
+#include "core/settings.h"
 #include "driver/ihv/amd/amd_rgp.h"
 #include "driver/shaders/spirv/spirv_compile.h"
 #include "jpeg-compressor/jpge.h"
@@ -36,6 +37,14 @@
 
 #include "stb/stb_image_write.h"
 
+RDOC_CONFIG(bool, Vulkan_CacheDecodedChunks, false,
+            "Keep the frame's chunks in decoded form after the first replay, so that replaying "
+            "to a different event doesn't need to deserialise the capture again.");
+
+RDOC_CONFIG(bool, Vulkan_LazyStructuredData, false,
+            "Only read the metadata of the frame's chunks while loading, and decode each chunk's "
+            "structured data the first time it's looked at.");
+
 uint64_t VkInitParams::GetSerialiseSize()
 {
   // misc bytes and fixed integer members
@@ -185,6 +194,10 @@ WrappedVulkan::~WrappedVulkan()
   m_ResourceManager->ClearWithoutReleasing();
   SAFE_DELETE(m_ResourceManager);
 
+  m_DecodeCache.Clear();
+  m_StoredStructuredData.SetChunkSource(NULL);
+  m_LazyChunks.Clear();
+  SAFE_DELETE(m_LazyExporter);
   SAFE_DELETE(m_FrameReader);
 
   for(size_t i = 0; i < m_ThreadSerialisers.size(); i++)
@@ -1576,6 +1589,8 @@ void WrappedVulkan::StartFrameCapture(void *dev, void *wnd)
   GetResourceManager()->ClearReferencedResources();
   GetResourceManager()->ClearReferencedMemory();
 
+  m_CaptureGeneration++;
+
   // need to do all this atomically so that no other commands
   // will check to see if they need to markdirty or markpendingdirty
   // and go into the frame record.
@@ -1613,7 +1628,9 @@ void WrappedVulkan::StartFrameCapture(void *dev, void *wnd)
       RDCASSERTEQUAL(vkr, VK_SUCCESS);
     }
 
+    BeginInitStateBatch();
     GetResourceManager()->PrepareInitialContents();
+    EndInitStateBatch();
     SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
     SubmitCmds();
     FlushQ();
@@ -1739,6 +1756,8 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
         FreeAlignedBuffer((*it)->memMapState->refData);
         (*it)->memMapState->refData = NULL;
         (*it)->memMapState->needRefData = false;
+        MemoryTracking::EndTracking((*it)->memMapState->writeTracking);
+        (*it)->memMapState->writeTracking = NULL;
       }
     }
 
@@ -1946,33 +1965,46 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
     }
   }
 
-  RDCFile *rdc =
-      RenderDoc::Inst().CreateRDC(RDCDriver::Vulkan, m_CapturedFrames.back().frameNumber, fp);
+  SectionProperties props;
 
-  StreamWriter *captureWriter = NULL;
+  // Compress with LZ4 so that it's fast
+  props.flags = SectionFlags::LZ4Compressed;
+  // block-indexed so that initial contents can reference identical data written earlier
+  if(RenderDoc::Inst().IsCaptureBlobDeduplication())
+    props.flags |= SectionFlags::BlockIndexed;
+  props.version = m_SectionVersion;
+  props.type = SectionType::FrameCapture;
 
-  if(rdc)
-  {
-    SectionProperties props;
+  const bool asyncWrite = RenderDoc::Inst().IsCaptureWritingAsync();
+
+  RDCFile *rdc = NULL;
 
-    // Compress with LZ4 so that it's fast
-    props.flags = SectionFlags::LZ4Compressed;
-    props.version = m_SectionVersion;
-    props.type = SectionType::FrameCapture;
+  StreamWriter *captureWriter = NULL;
 
-    captureWriter = rdc->WriteSection(props);
+  if(asyncWrite)
+  {
+    // gather the frame uncompressed in memory, the file is created and written in the background
+    captureWriter = new StreamWriter(StreamWriter::DefaultScratchSize);
   }
   else
   {
-    captureWriter = new StreamWriter(StreamWriter::InvalidStream);
+    rdc = RenderDoc::Inst().CreateRDC(RDCDriver::Vulkan, m_CapturedFrames.back().frameNumber, fp);
+
+    if(rdc)
+      captureWriter = rdc->WriteSection(props);
+    else
+      captureWriter = new StreamWriter(StreamWriter::InvalidStream);
   }
 
+  uint64_t captureSize = 0;
+
   {
-    WriteSerialiser ser(captureWriter, Ownership::Stream);
+    WriteSerialiser ser(captureWriter, asyncWrite ? Ownership::Nothing : Ownership::Stream);
 
     ser.SetChunkMetadataRecording(GetThreadSerialiser().GetChunkMetadataRecording());
 
     ser.SetUserData(GetResourceManager());
+    ser.SetBlobDeduplication(bool(props.flags & SectionFlags::BlockIndexed));
 
     {
       SCOPED_SERIALISE_CHUNK(SystemChunk::DriverInit, m_InitParams.GetSerialiseSize());
@@ -2044,13 +2076,18 @@ bool WrappedVulkan::EndFrameCapture(void *dev, void *wnd)
 
       RDCDEBUG("Done");
     }
+
+    captureSize = captureWriter->GetOffset();
   }
 
   RDCLOG("Captured Vulkan frame with %f MB capture section in %f seconds",
-         double(captureWriter->GetOffset()) / (1024.0 * 1024.0),
-         m_CaptureTimer.GetMilliseconds() / 1000.0);
+         double(captureSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
-  RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
+  if(asyncWrite)
+    RenderDoc::Inst().QueueCaptureWrite(RDCDriver::Vulkan, m_CapturedFrames.back().frameNumber, fp,
+                                        props, captureWriter);
+  else
+    RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
 
   m_HeaderChunk->Delete();
   m_HeaderChunk = NULL;
@@ -2110,6 +2147,8 @@ bool WrappedVulkan::DiscardFrameCapture(void *dev, void *wnd)
         FreeAlignedBuffer((*it)->memMapState->refData);
         (*it)->memMapState->refData = NULL;
         (*it)->memMapState->needRefData = false;
+        MemoryTracking::EndTracking((*it)->memMapState->writeTracking);
+        (*it)->memMapState->writeTracking = NULL;
       }
     }
   }
@@ -2310,7 +2349,7 @@ ReplayStatus WrappedVulkan::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
     {
       GetReplay()->WriteFrameRecord().frameInfo.fileOffset = offsetStart;
 
-      // read the remaining data into memory and pass to immediate context
+      // the remaining data is the frame, which is passed to the immediate context
       frameDataSize = reader->GetSize() - reader->GetOffset();
 
       if(m_Queue == VK_NULL_HANDLE && m_Device != VK_NULL_HANDLE && m_QueueFamilyIdx != ~0U)
@@ -2330,7 +2369,38 @@ ReplayStatus WrappedVulkan::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
         }
       }
 
-      m_FrameReader = new StreamReader(reader, frameDataSize);
+      const bool lazyStructuredData =
+          Vulkan_LazyStructuredData() && !IsStructuredExporting(m_State);
+
+      // if the frame can be seeked without decompressing it from the start, read it from the file
+      // each time it's replayed instead of keeping a decompressed copy in memory. Lazy structured
+      // data decodes chunks from the frame in place, so it still needs a resident copy.
+      if(!lazyStructuredData)
+        m_FrameReader = rdc->ReadSectionRange(sectionIdx, reader->GetOffset(), frameDataSize);
+
+      if(!m_FrameReader)
+        m_FrameReader = new StreamReader(reader, frameDataSize);
+
+      if(lazyStructuredData)
+      {
+        // the frame data stays resident while the capture is open, so chunks can be decoded from
+        // it on demand instead of being exported up front.
+        const byte *frameData = m_FrameReader->ReadInPlace(frameDataSize);
+        m_FrameReader->SetOffset(0);
+
+        if(frameData)
+        {
+          SAFE_DELETE(m_LazyExporter);
+          m_LazyExporter = new WrappedVulkan();
+          m_LazyExporter->SetStructuredExport(m_SectionVersion);
+
+          WrappedVulkan *exporter = m_LazyExporter;
+          m_LazyChunks.SetSource(frameData, frameDataSize, m_SectionVersion, &GetChunkName,
+                                 [exporter](ReadSerialiser &ser, uint32_t chunk) {
+                                   return exporter->ProcessChunk(ser, (VulkanChunk)chunk);
+                                 });
+        }
+      }
 
       ReplayStatus status = ContextReplayLog(m_State, 0, 0, false);
 
@@ -2371,6 +2441,9 @@ ReplayStatus WrappedVulkan::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
   // and in future use this file.
   m_StructuredFile = &m_StoredStructuredData;
 
+  if(m_LazyChunks.IsValid())
+    m_StoredStructuredData.SetChunkSource(&m_LazyChunks);
+
   GetReplay()->WriteFrameRecord().frameInfo.uncompressedFileSize =
       rdc->GetSectionProperties(sectionIdx).uncompressedSize;
   GetReplay()->WriteFrameRecord().frameInfo.compressedFileSize =
@@ -2426,10 +2499,24 @@ ReplayStatus WrappedVulkan::ContextReplayLog(CaptureState readType, uint32_t sta
     ser.ConfigureStructuredExport(&GetChunkName, IsStructuredExporting(m_State), m_TimeBase,
                                   m_TimeFrequency);
 
+    if(IsLoading(m_State) && m_LazyChunks.IsValid())
+      ser.SetLazyChunks(&m_LazyChunks);
+
     ser.GetStructuredFile().Swap(*m_StructuredFile);
 
     m_StructuredFile = &ser.GetStructuredFile();
   }
+  else if(Vulkan_CacheDecodedChunks())
+  {
+    // resources are looked up while decoding, so if they've changed anything cached is stale
+    if(m_DecodeCacheGeneration != GetResourceManager()->GetLiveGeneration())
+    {
+      m_DecodeCache.Clear();
+      m_DecodeCacheGeneration = GetResourceManager()->GetLiveGeneration();
+    }
+
+    ser.SetDecodeCache(&m_DecodeCache);
+  }
 
   SystemChunk header = ser.ReadChunk<SystemChunk>();
   RDCASSERTEQUAL(header, SystemChunk::CaptureBegin);
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "common/timing.h"
+#include "serialise/lazychunks.h"
 #include "serialise/serialiser.h"
 #include "vk_common.h"
 #include "vk_info.h"
@@ -53,7 +54,7 @@ struct VkInitParams
   uint64_t GetSerialiseSize();
 
   // check if a frame capture section version is supported
-  static const uint64_t CurrentVersion = 0x12;
+  static const uint64_t CurrentVersion = 0x13;
   static bool IsSupportedVersion(uint64_t ver);
 };
 
@@ -301,6 +302,10 @@ private:
   bool m_MarkedActive = false;
   uint32_t m_SubmitCounter = 0;
 
+  // incremented for each capture, so descriptor sets can tell if their bind refs have already been
+  // pushed to the resource manager in this capture.
+  uint32_t m_CaptureGeneration = 0;
+
   uint64_t threadSerialiserTLSSlot;
 
   Threading::CriticalSection m_ThreadSerialisersLock;
@@ -324,6 +329,16 @@ private:
 
   StreamReader *m_FrameReader = NULL;
 
+  // decoded chunks from m_FrameReader, valid as long as the live resource generation matches
+  ChunkDecodeCache m_DecodeCache;
+  uint64_t m_DecodeCacheGeneration = 0;
+
+  // structured data for the frame's chunks, decoded from m_FrameReader when first needed
+  LazyChunkSource m_LazyChunks;
+  // decodes the lazy chunks in structured export mode. Chunks can be populated from any thread
+  // while this driver is replaying, so they must never be processed by it.
+  WrappedVulkan *m_LazyExporter = NULL;
+
   std::set<rdcstr> m_StringDB;
 
   VkResourceRecord *m_FrameCaptureRecord;
@@ -447,6 +462,20 @@ private:
   ImageBarrierSequence m_setupImageBarriers;
   ImageBarrierSequence m_cleanupImageBarriers;
 
+  // while preparing initial contents at capture start, the readback copies for each resource are
+  // recorded into a shared command buffer and only submitted and waited on once enough data has
+  // been batched up, instead of a GPU round-trip per resource.
+  struct InitStateBatch
+  {
+    bool active = false;
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+
+    // temporary objects used by the recorded copies, destroyed once the batch has completed
+    rdcarray<VkBuffer> buffers;
+    rdcarray<VkImage> images;
+  } m_InitStateBatch;
+
   // a small amount of helper code during capture for handling resources on different queues in init
   // states
   struct ExternalQueue
@@ -889,6 +918,13 @@ private:
 
   bool Prepare_SparseInitialState(WrappedVkBuffer *buf);
   bool Prepare_SparseInitialState(WrappedVkImage *im);
+
+  void BeginInitStateBatch();
+  void EndInitStateBatch();
+  VkCommandBuffer GetInitStateBatchCmd();
+  void CloseInitStateBatchCmd();
+  void FinishInitStateBatchResource(VkDeviceSize size);
+  void FlushInitStateBatch();
   template <typename SerialiserType>
   bool Serialise_SparseBufferInitialState(SerialiserType &ser, ResourceId id,
                                           const VkInitialContents *contents);
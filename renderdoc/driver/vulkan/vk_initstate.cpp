@@ -29,11 +29,8 @@
 // VKTODOLOW there's a lot of duplicated code in this file for creating a buffer to do
 // a memory copy and saving to disk.
 
-// VKTODOLOW in general we do a lot of "create buffer, use it, flush/sync then destroy".
-// I don't know what the exact cost is, but it would be nice to batch up the buffers/etc
-// used across init state use, and only do a single flush. Also we could then get some
-// nice command buffer reuse (although need to be careful we don't create too large a
-// command buffer that stalls the GPU).
+// VKTODOLOW outside of the initial state readback at capture start (sparse resources, applying
+// initial states on replay) we still do "create buffer, use it, flush/sync then destroy" each time.
 // See INITSTATEBATCH
 
 RDOC_DEBUG_CONFIG(
@@ -41,6 +38,101 @@ RDOC_DEBUG_CONFIG(
     "Hide the initial contents of descriptor sets. "
     "For extremely large descriptor sets this can drastically reduce memory consumption.");
 
+RDOC_CONFIG(uint32_t, Vulkan_InitialStateBatchSizeMB, 256,
+            "The amount of initial contents data in MB to read back in one batch at capture "
+            "start before submitting and waiting. Larger batches mean fewer GPU round-trips but "
+            "longer individual submissions. 0 waits for each resource separately.");
+
+void WrappedVulkan::BeginInitStateBatch()
+{
+  m_InitStateBatch.active = true;
+}
+
+void WrappedVulkan::EndInitStateBatch()
+{
+  FlushInitStateBatch();
+  m_InitStateBatch.active = false;
+}
+
+VkCommandBuffer WrappedVulkan::GetInitStateBatchCmd()
+{
+  if(m_InitStateBatch.cmd == VK_NULL_HANDLE)
+  {
+    VkCommandBuffer cmd = GetNextCmd();
+
+    // keep the command buffer out of the pending list while we're recording into it, so any other
+    // submit in the meantime doesn't pick it up half-recorded.
+    RemovePendingCommandBuffer(cmd);
+
+    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+    VkResult vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+    m_InitStateBatch.cmd = cmd;
+  }
+
+  return m_InitStateBatch.cmd;
+}
+
+void WrappedVulkan::CloseInitStateBatchCmd()
+{
+  VkCommandBuffer cmd = m_InitStateBatch.cmd;
+
+  if(cmd == VK_NULL_HANDLE)
+    return;
+
+  VkResult vkr = ObjDisp(cmd)->EndCommandBuffer(Unwrap(cmd));
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  AddPendingCommandBuffer(cmd);
+  m_InitStateBatch.cmd = VK_NULL_HANDLE;
+}
+
+void WrappedVulkan::FinishInitStateBatchResource(VkDeviceSize size)
+{
+  m_InitStateBatch.size += size;
+
+  // outside of capture start (e.g. postponed resources being prepared mid-frame) we flush
+  // immediately, otherwise only once the batch is large enough.
+  const VkDeviceSize limit = VkDeviceSize(Vulkan_InitialStateBatchSizeMB()) * 1024 * 1024;
+  if(!m_InitStateBatch.active || m_InitStateBatch.size >= limit)
+    FlushInitStateBatch();
+}
+
+void WrappedVulkan::FlushInitStateBatch()
+{
+  if(m_InitStateBatch.cmd == VK_NULL_HANDLE && m_InitStateBatch.buffers.empty() &&
+     m_InitStateBatch.images.empty())
+    return;
+
+  CloseInitStateBatchCmd();
+
+  SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+  SubmitCmds();
+  FlushQ();
+  SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+
+  VkDevice d = GetDev();
+
+  for(VkBuffer buf : m_InitStateBatch.buffers)
+  {
+    ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(buf), NULL);
+    GetResourceManager()->ReleaseWrappedResource(buf);
+  }
+
+  for(VkImage im : m_InitStateBatch.images)
+  {
+    ObjDisp(d)->DestroyImage(Unwrap(d), Unwrap(im), NULL);
+    GetResourceManager()->ReleaseWrappedResource(im);
+  }
+
+  m_InitStateBatch.buffers.clear();
+  m_InitStateBatch.images.clear();
+  m_InitStateBatch.size = 0;
+}
+
 bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
 {
   ResourceId id = GetResourceManager()->GetID(res);
@@ -112,8 +204,6 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
     }
 
     VkDevice d = GetDev();
-    // INITSTATEBATCH
-    VkCommandBuffer cmd = GetNextCmd();
 
     // must ensure offset remains valid. Must be multiple of block size, or 4, depending on format
     VkDeviceSize bufAlignment = 4;
@@ -135,6 +225,10 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
 
     if(imageInfo.sampleCount > 1)
     {
+      // the MSAA decompose does its own submit, so flush anything batched so far to keep its
+      // queue family transitions separate from other resources'.
+      FlushInitStateBatch();
+
       // first decompose to array
       numLayers *= imageInfo.sampleCount;
 
@@ -255,11 +349,7 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
                                        readbackmem.offs);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
-                                          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
-
-    vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+    VkCommandBuffer cmd = GetInitStateBatchCmd();
 
     VkImageAspectFlags aspectFlags = FormatImageAspects(imageInfo.format);
 
@@ -291,17 +381,13 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
 
       DoPipelineBarrier(cmd, 1, &arrayimBarrier);
 
-      vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
-      RDCASSERTEQUAL(vkr, VK_SUCCESS);
+      CloseInitStateBatchCmd();
 
       GetDebugManager()->CopyTex2DMSToArray(Unwrap(arrayIm), realim, imageInfo.extent,
                                             imageInfo.layerCount, imageInfo.sampleCount,
                                             imageInfo.format);
 
-      cmd = GetNextCmd();
-
-      vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
-      RDCASSERTEQUAL(vkr, VK_SUCCESS);
+      cmd = GetInitStateBatchCmd();
 
       arrayimBarrier.srcAccessMask =
           VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
@@ -405,25 +491,15 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
     InlineCleanupImageBarriers(cmd, cleanupBarriers);
     m_cleanupImageBarriers.Merge(cleanupBarriers);
 
-    vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-    SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
-    SubmitCmds();
-    FlushQ();
-    SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
-
-    ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(dstBuf), NULL);
-    GetResourceManager()->ReleaseWrappedResource(dstBuf);
-
+    // the buffer and array image must stay alive until the batch has executed
+    m_InitStateBatch.buffers.push_back(dstBuf);
     if(arrayIm != VK_NULL_HANDLE)
-    {
-      ObjDisp(d)->DestroyImage(Unwrap(d), Unwrap(arrayIm), NULL);
-      GetResourceManager()->ReleaseWrappedResource(arrayIm);
-    }
+      m_InitStateBatch.images.push_back(arrayIm);
 
     GetResourceManager()->SetInitialContents(id, VkInitialContents(type, readbackmem));
 
+    FinishInitStateBatchResource(readbackmem.size);
+
     return true;
   }
   else if(type == eResDeviceMemory)
@@ -431,8 +507,6 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
     VkResult vkr = VK_SUCCESS;
 
     VkDevice d = GetDev();
-    // INITSTATEBATCH
-    VkCommandBuffer cmd = GetNextCmd();
 
     VkResourceRecord *record = GetResourceManager()->GetResourceRecord(id);
     VkDeviceMemory datamem = ToUnwrappedHandle<VkDeviceMemory>(res);
@@ -489,29 +563,19 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
                                        readbackmem.offs);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
-                                          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
-
-    vkr = ObjDisp(d)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+    VkCommandBuffer cmd = GetInitStateBatchCmd();
 
     VkBufferCopy region = {0, 0, datasize};
 
     ObjDisp(d)->CmdCopyBuffer(Unwrap(cmd), Unwrap(record->memMapState->wholeMemBuf), Unwrap(dstBuf),
                               1, &region);
 
-    vkr = ObjDisp(d)->EndCommandBuffer(Unwrap(cmd));
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-    // INITSTATEBATCH
-    SubmitCmds();
-    FlushQ();
-
-    ObjDisp(d)->DestroyBuffer(Unwrap(d), Unwrap(dstBuf), NULL);
-    GetResourceManager()->ReleaseWrappedResource(dstBuf);
+    m_InitStateBatch.buffers.push_back(dstBuf);
 
     GetResourceManager()->SetInitialContents(id, VkInitialContents(type, readbackmem));
 
+    FinishInitStateBatchResource(readbackmem.size);
+
     return true;
   }
   else
@@ -988,7 +1052,7 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
 
     // not using SERIALISE_ELEMENT_ARRAY so we can deliberately avoid allocation - we serialise
     // directly into upload memory
-    ser.Serialise("Contents"_lit, Contents, ContentsSize, SerialiserFlags::NoFlags);
+    ser.Serialise("Contents"_lit, Contents, ContentsSize, SerialiserFlags::Deduplicate);
 
     // unmap the resource we mapped before - we need to do this on read and on write.
     if(!IsStructuredExporting(m_State) && mappedMem.mem != VK_NULL_HANDLE)
@@ -382,6 +382,8 @@ public:
   ShaderDebugTrace *DebugThread(uint32_t eventId, const uint32_t groupid[3],
                                 const uint32_t threadid[3]);
   rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger);
+  rdcarray<ShaderDebugState> RunDebug(ShaderDebugger *debugger,
+                                      const rdcarray<uint32_t> &breakpoints);
   void FreeDebugger(ShaderDebugger *debugger);
 
   uint32_t PickVertex(uint32_t eventId, int32_t width, int32_t height, const MeshDisplay &cfg,
@@ -439,6 +441,8 @@ private:
 
   void RefreshDerivedReplacements();
 
+  void PrepareShaderDebugDescriptors();
+
   bool RenderTextureInternal(TextureDisplay cfg, const ImageState &imageState,
                              VkRenderPassBeginInfo rpbegin, int flags);
 
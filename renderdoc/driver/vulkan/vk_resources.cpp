@@ -3736,6 +3736,7 @@ VkResourceRecord::~VkResourceRecord()
   if(resType == eResDeviceMemory && memMapState)
   {
     FreeAlignedBuffer(memMapState->refData);
+    MemoryTracking::EndTracking(memMapState->writeTracking);
 
     SAFE_DELETE(memMapState);
   }
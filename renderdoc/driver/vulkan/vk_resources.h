@@ -1077,6 +1077,13 @@ struct DescriptorSetData
   rdcflatmap<ResourceId, MemRefs> bindMemRefs;
   rdcflatmap<ResourceId, ImageState> bindImageStates;
 
+  // incremented whenever the bind refs above change. On submit during capture the refs are only
+  // pushed to the resource manager if they haven't already been pushed in this capture at the
+  // current generation. Protected by refLock
+  uint32_t refGeneration = 1;
+  uint32_t pushedCapture = 0;
+  uint32_t pushedGeneration = 0;
+
   void UpdateBackgroundRefCache(const rdcarray<ResourceId> &ids);
 
   rdcflatmap<ResourceId, FrameRefType> backgroundFrameRefs;
@@ -1115,6 +1122,9 @@ struct MemMapState
   byte *mappedPtr = NULL;
   // this is map sized, not memory sized, rebased at the map offset.
   byte *refData = NULL;
+  // while refData is valid for a coherent map, this tracks which pages have been written since it
+  // was last compared, if that's possible. Only the written pages need comparing.
+  MemoryTracking::Region *writeTracking = NULL;
   // this is normally set to mappedPtr, but when readbackOnGPU is true then during a coherent map
   // flush this may point to the readback memory so that we read from that fast copy instead of the
   // slow actual pointer.
@@ -233,6 +233,15 @@ void DoSerialiseViaResourceId(SerialiserType &ser, type &el)
 {
   VulkanResourceManager *rm = (VulkanResourceManager *)ser.GetUserData();
 
+  // a handle being compared may have been unwrapped, so it can't be looked up. Compare its value
+  if(ser.IsWriting() && ser.IsComparisonOnly())
+  {
+    uint64_t handle = 0;
+    memcpy(&handle, &el, sizeof(el));
+    DoSerialise(ser, handle);
+    return;
+  }
+
   ResourceId id;
 
   if(ser.IsWriting() && rm)
@@ -1471,6 +1480,43 @@ void DoSerialise(SerialiserType &ser, VkDebugUtilsObjectTagInfoEXT &el)
   el.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_TAG_INFO_EXT;
 }
 
+// none of the above are ever deserialised with anything allocated
+
+template <>
+void Deserialise(const VkApplicationInfo &el)
+{
+}
+
+template <>
+void Deserialise(const VkInstanceCreateInfo &el)
+{
+}
+
+template <>
+void Deserialise(const VkLayerInstanceCreateInfo &el)
+{
+}
+
+template <>
+void Deserialise(const VkLayerDeviceCreateInfo &el)
+{
+}
+
+template <>
+void Deserialise(const VkDebugMarkerObjectNameInfoEXT &el)
+{
+}
+
+template <>
+void Deserialise(const VkDebugMarkerObjectTagInfoEXT &el)
+{
+}
+
+template <>
+void Deserialise(const VkDebugUtilsObjectTagInfoEXT &el)
+{
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, VkDeviceQueueCreateInfo &el)
 {
@@ -40,6 +40,9 @@ RDOC_DEBUG_CONFIG(bool, Vulkan_Debug_DisableBufferDeviceAddress, false,
                   "Disable use of buffer device address for PS Input fetch.");
 RDOC_DEBUG_CONFIG(bool, Vulkan_Debug_ShaderDebugLogging, false,
                   "Output verbose debug logging messages when debugging shaders.");
+RDOC_CONFIG(bool, Vulkan_ShaderDebugSimulateWorkgroup, false,
+            "When debugging a compute thread, run every thread in its workgroup alongside it so "
+            "that workgroup shared memory and barriers behave as they do on the GPU.");
 
 struct DescSetBindingSnapshot
 {
@@ -4391,22 +4394,25 @@ ShaderDebugTrace *VulkanReplay::DebugThread(uint32_t eventId, const uint32_t gro
 
   rdcspv::Debugger *debugger = new rdcspv::Debugger;
   debugger->Parse(shader.spirv.GetSPIRV());
-  ShaderDebugTrace *ret = debugger->BeginDebug(apiWrapper, ShaderStage::Compute, entryPoint, spec,
-                                               shadRefl.instructionLines, shadRefl.patchData, 0);
+
+  // only the debugged thread is run, unless the whole workgroup is being simulated
+  uint32_t activeIndex = 0;
+  if(Vulkan_ShaderDebugSimulateWorkgroup())
+  {
+    debugger->SetComputeWorkgroup(threadDim);
+    activeIndex = builtins[ShaderBuiltin::GroupFlatIndex].value.uv[0];
+  }
+
+  ShaderDebugTrace *ret =
+      debugger->BeginDebug(apiWrapper, ShaderStage::Compute, entryPoint, spec,
+                           shadRefl.instructionLines, shadRefl.patchData, activeIndex);
   apiWrapper->ResetReplay();
 
   return ret;
 }
 
-rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
+void VulkanReplay::PrepareShaderDebugDescriptors()
 {
-  rdcspv::Debugger *spvDebugger = (rdcspv::Debugger *)debugger;
-
-  if(!spvDebugger)
-    return {};
-
-  VkMarkerRegion region("ContinueDebug Simulation Loop");
-
   for(size_t fmt = 0; fmt < ARRAY_COUNT(m_TexRender.DummyImageViews); fmt++)
   {
     for(size_t dim = 0; dim < ARRAY_COUNT(m_TexRender.DummyImageViews[0]); dim++)
@@ -4442,6 +4448,18 @@ rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
     m_ShaderDebugData.DummyWrites[fmt][6].pTexelBufferView =
         UnwrapPtr(m_TexRender.DummyBufferView[fmt]);
   }
+}
+
+rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
+{
+  rdcspv::Debugger *spvDebugger = (rdcspv::Debugger *)debugger;
+
+  if(!spvDebugger)
+    return {};
+
+  VkMarkerRegion region("ContinueDebug Simulation Loop");
+
+  PrepareShaderDebugDescriptors();
 
   rdcarray<ShaderDebugState> ret = spvDebugger->ContinueDebug();
 
@@ -4451,6 +4469,26 @@ rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
   return ret;
 }
 
+rdcarray<ShaderDebugState> VulkanReplay::RunDebug(ShaderDebugger *debugger,
+                                                  const rdcarray<uint32_t> &breakpoints)
+{
+  rdcspv::Debugger *spvDebugger = (rdcspv::Debugger *)debugger;
+
+  if(!spvDebugger)
+    return {};
+
+  VkMarkerRegion region("RunDebug Simulation Loop");
+
+  PrepareShaderDebugDescriptors();
+
+  rdcarray<ShaderDebugState> ret = spvDebugger->RunDebug(breakpoints);
+
+  VulkanAPIWrapper *api = (VulkanAPIWrapper *)spvDebugger->GetAPIWrapper();
+  api->ResetReplay();
+
+  return ret;
+}
+
 void VulkanReplay::FreeDebugger(ShaderDebugger *debugger)
 {
   delete debugger;
@@ -3199,7 +3199,7 @@ bool WrappedVulkan::Serialise_vkCmdUpdateBuffer(SerialiserType &ser, VkCommandBu
 
   // serialise as void* so it goes through as a buffer, not an actual array of integers.
   const void *Data = (const void *)pData;
-  SERIALISE_ELEMENT_ARRAY(Data, dataSize);
+  SERIALISE_ELEMENT_ARRAY_INPLACE(Data, dataSize);
 
   Serialise_DebugMessages(ser);
 
@@ -4601,7 +4601,10 @@ bool WrappedVulkan::Serialise_vkCmdPushDescriptorSetKHR(SerialiserType &ser,
       ApplyPushDescriptorWrites(pipelineBindPoint, layout, set, descriptorWriteCount,
                                 pDescriptorWrites);
 
-      // now unwrap everything in-place to save on temp allocs.
+      // now unwrap everything in-place to save on temp allocs. This means the decoded writes can't
+      // be re-used for the next replay.
+      ser.SetChunkUncacheable();
+
       VkWriteDescriptorSet *writes = (VkWriteDescriptorSet *)pDescriptorWrites;
 
       for(uint32_t i = 0; i < descriptorWriteCount; i++)
@@ -4878,7 +4881,10 @@ bool WrappedVulkan::Serialise_vkCmdPushDescriptorSetWithTemplateKHR(
       ApplyPushDescriptorWrites(bindPoint, layout, set, (uint32_t)apply.writes.size(),
                                 apply.writes.data());
 
-      // now unwrap everything in-place to save on temp allocs.
+      // now unwrap everything in-place to save on temp allocs. This means the decoded writes can't
+      // be re-used for the next replay.
+      ser.SetChunkUncacheable();
+
       VkWriteDescriptorSet *writes = (VkWriteDescriptorSet *)apply.writes.data();
 
       for(size_t i = 0; i < apply.writes.size(); i++)
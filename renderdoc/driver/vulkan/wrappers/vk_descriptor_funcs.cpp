@@ -693,6 +693,7 @@ VkResult WrappedVulkan::vkResetDescriptorPool(VkDevice device, VkDescriptorPool
           (*it)->descInfo->bindMemRefs.clear();
           (*it)->descInfo->bindImageStates.clear();
           (*it)->descInfo->backgroundFrameRefs.clear();
+          (*it)->descInfo->refGeneration++;
         }
 
         record->descPoolInfo->freelist.assign(record->pooledChildren);
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include "../vk_core.h"
 #include "../vk_debug.h"
+#include "common/memory_diff.h"
 
 template <typename SerialiserType>
 bool WrappedVulkan::Serialise_vkGetDeviceQueue(SerialiserType &ser, VkDevice device,
@@ -807,6 +808,19 @@ void WrappedVulkan::InsertDrawsAndRefreshIDs(BakedCmdBufferInfo &cmdBufInfo)
   }
 }
 
+static bool IsBoundInSets(const std::set<VkResourceRecord *> &sets, ResourceId id)
+{
+  for(VkResourceRecord *setrecord : sets)
+  {
+    SCOPED_LOCK(setrecord->descInfo->refLock);
+
+    if(setrecord->descInfo->bindFrameRefs.find(id) != setrecord->descInfo->bindFrameRefs.end())
+      return true;
+  }
+
+  return false;
+}
+
 VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
                                       const VkSubmitInfo *pSubmits, VkFence fence)
 {
@@ -850,6 +864,10 @@ VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
 
     std::set<ResourceId> refdIDs;
 
+    // descriptor sets whose refs were already pushed earlier in the capture and are unchanged. We
+    // skip re-marking everything bound in them, but they still count for which maps we flush below
+    std::set<VkResourceRecord *> unchangedSets;
+
     for(uint32_t s = 0; s < submitCount; s++)
     {
       for(uint32_t i = 0; i < pSubmits[s].commandBufferCount; i++)
@@ -871,8 +889,19 @@ VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
             GetResourceManager()->MarkResourceFrameReferenced(GetResID(*it), eFrameRef_Read);
 
             VkResourceRecord *setrecord = GetRecord(*it);
+            DescriptorSetData &descInfo = *setrecord->descInfo;
 
-            SCOPED_LOCK(setrecord->descInfo->refLock);
+            SCOPED_LOCK(descInfo.refLock);
+
+            if(descInfo.pushedCapture == m_CaptureGeneration &&
+               descInfo.pushedGeneration == descInfo.refGeneration)
+            {
+              unchangedSets.insert(setrecord);
+              continue;
+            }
+
+            descInfo.pushedCapture = m_CaptureGeneration;
+            descInfo.pushedGeneration = descInfo.refGeneration;
 
             for(auto refit = setrecord->descInfo->bindFrameRefs.begin();
                 refit != setrecord->descInfo->bindFrameRefs.end(); ++refit)
@@ -1004,15 +1033,39 @@ VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
         if(state.mapCoherent && state.mappedPtr && !state.mapFlushed)
         {
           // only need to flush memory that could affect this submitted batch of work
-          if(refdIDs.find(record->GetResourceID()) == refdIDs.end())
+          if(refdIDs.find(record->GetResourceID()) == refdIDs.end() &&
+             !IsBoundInSets(unchangedSets, record->GetResourceID()))
           {
             RDCDEBUG("Map of memory %s not referenced in this queue - not flushing",
                      ToStr(record->GetResourceID()).c_str());
             continue;
           }
 
-          size_t diffStart = 0, diffEnd = 0;
-          bool found = true;
+          // if we're tracking writes to the map, we only need to look at the pages written since
+          // the last time we compared against refData.
+          rdcarray<rdcpair<size_t, size_t>> searchRanges;
+          if(state.refData && state.writeTracking)
+          {
+            MemoryTracking::GetAndResetDirtyRanges(state.writeTracking, searchRanges);
+
+            if(searchRanges.empty())
+            {
+              RDCDEBUG("Persistent map flush not needed for %s, no pages written",
+                       ToStr(record->GetResourceID()).c_str());
+              continue;
+            }
+          }
+          else if(state.refData)
+          {
+            searchRanges.push_back({0, (size_t)state.mapSize});
+          }
+          else if(!state.writeTracking)
+          {
+            // we're about to serialise the whole map and start comparing against it. Start
+            // tracking now, before it's serialised, so that no write after the snapshot is missed.
+            state.writeTracking = MemoryTracking::BeginTracking(
+                state.mappedPtr + state.mapOffset, (size_t)state.mapSize);
+          }
 
           // this causes vkFlushMappedMemoryRanges call to allocate and copy to refData
           // from serialised buffer. We want to copy *precisely* the serialised data,
@@ -1104,35 +1157,47 @@ VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
 
           // if we have a previous set of data, compare.
           // otherwise just serialise it all
+          rdcarray<rdcpair<size_t, size_t>> diffRanges;
           if(state.refData)
-            found = FindDiffRange(((byte *)state.cpuReadPtr) + state.mapOffset, state.refData,
-                                  (size_t)state.mapSize, diffStart, diffEnd);
+          {
+            rdcarray<rdcpair<size_t, size_t>> found;
+            for(const rdcpair<size_t, size_t> &search : searchRanges)
+            {
+              // since the mapped pointer might be written on another thread (or even the GPU) a
+              // difference could appear and disappear transiently, and it may not be found. In
+              // that case we don't need to write the difference (the application is responsible
+              // for ensuring it's not writing to memory the GPU might need)
+              FindDiffRanges(((byte *)state.cpuReadPtr) + state.mapOffset + search.first,
+                             state.refData + search.first, search.second - search.first, found);
+
+              for(const rdcpair<size_t, size_t> &diff : found)
+                diffRanges.push_back({search.first + diff.first, search.first + diff.second});
+            }
+          }
           else
-            diffEnd = (size_t)state.mapSize;
-
-          // sanitise diff start/end. Since the mapped pointer might be written on another thread
-          // (or even the GPU) this could cause a difference to appear and disappear transiently. In
-          // this case FindDiffRange could find the difference when locating the start but not find
-          // it when locating the end. In this case we don't need to write the difference (the
-          // application is responsible for ensuring it's not writing to memory the GPU might need)
-          if(diffEnd <= diffStart)
-            found = false;
+          {
+            diffRanges.push_back({0, (size_t)state.mapSize});
+          }
 
-          if(found)
+          if(!diffRanges.empty())
           {
+            RDCLOG("Persistent map flush forced for %s (%llu -> %llu in %zu ranges)",
+                   ToStr(record->GetResourceID()).c_str(), (uint64_t)diffRanges.front().first,
+                   (uint64_t)diffRanges.back().second, diffRanges.size());
+
             // MULTIDEVICE should find the device for this queue.
             // MULTIDEVICE only want to flush maps associated with this queue
             VkDevice dev = GetDev();
 
+            // each range is flushed separately so only the bytes that changed are serialised
+            for(const rdcpair<size_t, size_t> &diff : diffRanges)
             {
-              RDCLOG("Persistent map flush forced for %s (%llu -> %llu)",
-                     ToStr(record->GetResourceID()).c_str(), (uint64_t)diffStart, (uint64_t)diffEnd);
               VkMappedMemoryRange range = {
                   VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
                   &internalMemoryFlushMarker,
                   (VkDeviceMemory)(uint64_t)record->Resource,
-                  state.mapOffset + diffStart,
-                  diffEnd - diffStart,
+                  state.mapOffset + diff.first,
+                  diff.second - diff.first,
               };
               vkFlushMappedMemoryRanges(dev, 1, &range);
             }
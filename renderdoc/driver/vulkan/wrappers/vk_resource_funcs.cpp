@@ -608,6 +608,9 @@ void WrappedVulkan::vkFreeMemory(VkDevice device, VkDeviceMemory memory,
         memMapState->refData = NULL;
       }
 
+      MemoryTracking::EndTracking(memMapState->writeTracking);
+      memMapState->writeTracking = NULL;
+
       // destroy the wholeMemBuf
       {
         ObjDisp(device)->DestroyBuffer(Unwrap(device), Unwrap(memMapState->wholeMemBuf), NULL);
@@ -887,6 +890,9 @@ void WrappedVulkan::vkUnmapMemory(VkDevice device, VkDeviceMemory mem)
 
     FreeAlignedBuffer(state.refData);
     state.refData = NULL;
+
+    MemoryTracking::EndTracking(state.writeTracking);
+    state.writeTracking = NULL;
   }
 
   ObjDisp(device)->UnmapMemory(Unwrap(device), Unwrap(mem));
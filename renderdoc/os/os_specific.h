@@ -88,6 +88,21 @@ uint32_t GetCurrentPID();
 void Shutdown();
 };
 
+// tracks which pages of a range of memory are written by the CPU, so that large mappings which are
+// shadowed for comparison only need comparing where they were actually written.
+namespace MemoryTracking
+{
+struct Region;
+
+// starts tracking writes to the given range. Returns NULL if that isn't possible on this platform
+// or for this memory, in which case callers must assume any part of the range may have changed.
+Region *BeginTracking(void *base, size_t size);
+// returns the [start, end) byte ranges relative to base, at page granularity but clamped to the
+// tracked range, that were written since tracking began or since the last call.
+void GetAndResetDirtyRanges(Region *region, rdcarray<rdcpair<size_t, size_t>> &ranges);
+void EndTracking(Region *region);
+};
+
 namespace Timing
 {
 double GetTickFrequency();
@@ -137,6 +152,25 @@ public:
   data m_Data;
 };
 
+template <class data>
+class SemaphoreTemplate
+{
+public:
+  SemaphoreTemplate();
+  ~SemaphoreTemplate();
+
+  // blocks until the semaphore count is non-zero, then decrements it
+  void Acquire();
+  // increments the semaphore count, waking up to count waiting threads
+  void Release(uint32_t count);
+
+  // no copying
+  SemaphoreTemplate &operator=(const SemaphoreTemplate &other) = delete;
+  SemaphoreTemplate(const SemaphoreTemplate &other) = delete;
+
+  data m_Data;
+};
+
 void Init();
 void Shutdown();
 uint64_t AllocateTLSSlot();
@@ -144,7 +178,8 @@ uint64_t AllocateTLSSlot();
 void *GetTLSValue(uint64_t slot);
 void SetTLSValue(uint64_t slot, void *value);
 
-// must typedef CriticalSectionTemplate<X> CriticalSection
+// must typedef CriticalSectionTemplate<X> CriticalSection, RWLockTemplate<Y> RWLock and
+// SemaphoreTemplate<Z> Semaphore
 
 void SetCurrentThreadName(const rdcstr &name);
 
@@ -156,6 +191,9 @@ void DetachThread(ThreadHandle handle);
 void CloseThread(ThreadHandle handle);
 void Sleep(uint32_t milliseconds);
 
+// the number of logical processors available to run threads on
+uint32_t NumberOfCores();
+
 // kind of windows specific, to handle this case:
 // http://blogs.msdn.com/b/oldnewthing/archive/2013/11/05/10463645.aspx
 void KeepModuleAlive();
@@ -230,6 +268,8 @@ int64_t Inc64(int64_t *i);
 int64_t Dec64(int64_t *i);
 int64_t ExchAdd64(int64_t *i, int64_t a);
 int32_t CmpExch32(int32_t *dest, int32_t oldVal, int32_t newVal);
+int64_t CmpExch64(int64_t *dest, int64_t oldVal, int64_t newVal);
+void *CmpExchPtr(void **dest, void *oldVal, void *newVal);
 };
 
 namespace Callstack
@@ -259,6 +299,17 @@ class StackResolver
 public:
   virtual ~StackResolver() {}
   virtual AddressDetails GetAddr(uint64_t addr) = 0;
+
+  // resolves a batch of addresses together, which resolvers can implement more efficiently than
+  // one at a time
+  virtual rdcarray<AddressDetails> GetAddrs(const rdcarray<uint64_t> &addrs)
+  {
+    rdcarray<AddressDetails> ret;
+    ret.reserve(addrs.size());
+    for(uint64_t addr : addrs)
+      ret.push_back(GetAddr(addr));
+    return ret;
+  }
 };
 
 void Init();
@@ -318,6 +369,12 @@ bool feof(FILE *f);
 
 int fclose(FILE *f);
 
+// map [offset, offset+length) of an open file into memory as a private copy-on-write view, so
+// that reading it only pulls in pages as they're touched and shares them with the OS file cache.
+// Returns NULL if the range can't be mapped, in which case the file should be read normally.
+byte *MapFileRange(FILE *f, uint64_t offset, uint64_t length);
+void UnmapFileRange(byte *data, uint64_t offset, uint64_t length);
+
 // functions for atomically appending to a log that may be in use in multiple
 // processes
 struct LogFileHandle;
@@ -0,0 +1,1233 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "elf_symbolizer.h"
+#include <cxxabi.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include "common/common.h"
+#include "common/formatting.h"
+#include "miniz/miniz.h"
+#include "strings/string_utils.h"
+
+// DWARF constants we need, not all systems have dwarf.h
+enum
+{
+  DW_LNS_copy = 1,
+  DW_LNS_advance_pc = 2,
+  DW_LNS_advance_line = 3,
+  DW_LNS_set_file = 4,
+  DW_LNS_set_column = 5,
+  DW_LNS_negate_stmt = 6,
+  DW_LNS_set_basic_block = 7,
+  DW_LNS_const_add_pc = 8,
+  DW_LNS_fixed_advance_pc = 9,
+
+  DW_LNE_end_sequence = 1,
+  DW_LNE_set_address = 2,
+  DW_LNE_define_file = 3,
+
+  DW_LNCT_path = 1,
+  DW_LNCT_directory_index = 2,
+
+  DW_FORM_block2 = 0x03,
+  DW_FORM_block4 = 0x04,
+  DW_FORM_data2 = 0x05,
+  DW_FORM_data4 = 0x06,
+  DW_FORM_data8 = 0x07,
+  DW_FORM_string = 0x08,
+  DW_FORM_block = 0x09,
+  DW_FORM_block1 = 0x0a,
+  DW_FORM_data1 = 0x0b,
+  DW_FORM_sdata = 0x0d,
+  DW_FORM_strp = 0x0e,
+  DW_FORM_udata = 0x0f,
+  DW_FORM_data16 = 0x1e,
+  DW_FORM_line_strp = 0x1f,
+};
+
+// bounds-checked reading of DWARF data. Reading past the end sets the error flag and returns zeros
+// so callers can check once after reading a structure.
+struct DwarfReader
+{
+  DwarfReader(const byte *data, size_t size) : cur(data), end(data + size) {}
+  const byte *cur;
+  const byte *end;
+  bool error = false;
+
+  size_t Remaining() const { return size_t(end - cur); }
+  template <typename T>
+  T Read()
+  {
+    T ret = T();
+    if(Remaining() < sizeof(T))
+    {
+      error = true;
+      cur = end;
+      return ret;
+    }
+    memcpy(&ret, cur, sizeof(T));
+    cur += sizeof(T);
+    return ret;
+  }
+
+  void Skip(uint64_t bytes)
+  {
+    if(Remaining() < bytes)
+    {
+      error = true;
+      cur = end;
+      return;
+    }
+    cur += bytes;
+  }
+
+  uint64_t ReadULEB()
+  {
+    uint64_t ret = 0;
+    uint32_t shift = 0;
+    while(cur < end)
+    {
+      byte b = *(cur++);
+      if(shift < 64)
+        ret |= uint64_t(b & 0x7f) << shift;
+      shift += 7;
+      if((b & 0x80) == 0)
+        return ret;
+    }
+    error = true;
+    return ret;
+  }
+
+  int64_t ReadSLEB()
+  {
+    int64_t ret = 0;
+    uint32_t shift = 0;
+    while(cur < end)
+    {
+      byte b = *(cur++);
+      if(shift < 64)
+        ret |= int64_t(b & 0x7f) << shift;
+      shift += 7;
+      if((b & 0x80) == 0)
+      {
+        if(shift < 64 && (b & 0x40))
+          ret |= -(int64_t(1) << shift);
+        return ret;
+      }
+    }
+    error = true;
+    return ret;
+  }
+
+  uint64_t ReadOffset(bool dwarf64) { return dwarf64 ? Read<uint64_t>() : Read<uint32_t>(); }
+  uint64_t ReadSized(uint64_t size)
+  {
+    switch(size)
+    {
+      case 1: return Read<uint8_t>();
+      case 2: return Read<uint16_t>();
+      case 4: return Read<uint32_t>();
+      case 8: return Read<uint64_t>();
+      default: Skip(size); return 0;
+    }
+  }
+
+  const char *ReadString()
+  {
+    const byte *nul = (const byte *)memchr(cur, 0, Remaining());
+    if(nul == NULL)
+    {
+      error = true;
+      cur = end;
+      return "";
+    }
+    const char *ret = (const char *)cur;
+    cur = nul + 1;
+    return ret;
+  }
+};
+
+struct DwarfSection
+{
+  const byte *data = NULL;
+  size_t size = 0;
+
+  const char *GetString(uint64_t offset) const
+  {
+    if(offset >= size || memchr(data + offset, 0, size_t(size - offset)) == NULL)
+      return NULL;
+    return (const char *)(data + offset);
+  }
+};
+
+// a range of addresses that map to one line in a source file
+struct LineRange
+{
+  uint64_t start;
+  uint64_t end;
+  uint32_t file;
+  uint32_t line;
+
+  bool operator<(const LineRange &o) const { return start < o.start; }
+};
+
+struct LineTable
+{
+  rdcarray<rdcstr> files;
+  rdcarray<LineRange> ranges;
+};
+
+// reads one attribute in a DWARF 5 directory or file entry, returning either a string or a value
+static void ReadLineEntryForm(DwarfReader &reader, uint64_t form, bool dwarf64,
+                              const DwarfSection &debugStr, const DwarfSection &debugLineStr,
+                              const char *&str, uint64_t &value)
+{
+  str = NULL;
+  value = 0;
+
+  switch(form)
+  {
+    case DW_FORM_string: str = reader.ReadString(); break;
+    case DW_FORM_line_strp: str = debugLineStr.GetString(reader.ReadOffset(dwarf64)); break;
+    case DW_FORM_strp: str = debugStr.GetString(reader.ReadOffset(dwarf64)); break;
+    case DW_FORM_udata: value = reader.ReadULEB(); break;
+    case DW_FORM_sdata: value = (uint64_t)reader.ReadSLEB(); break;
+    case DW_FORM_data1: value = reader.Read<uint8_t>(); break;
+    case DW_FORM_data2: value = reader.Read<uint16_t>(); break;
+    case DW_FORM_data4: value = reader.Read<uint32_t>(); break;
+    case DW_FORM_data8: value = reader.Read<uint64_t>(); break;
+    case DW_FORM_data16: reader.Skip(16); break;
+    case DW_FORM_block1: reader.Skip(reader.Read<uint8_t>()); break;
+    case DW_FORM_block2: reader.Skip(reader.Read<uint16_t>()); break;
+    case DW_FORM_block4: reader.Skip(reader.Read<uint32_t>()); break;
+    case DW_FORM_block: reader.Skip(reader.ReadULEB()); break;
+    default:
+      // any other form (e.g. strx, which needs .debug_info to interpret) can't be skipped safely
+      reader.error = true;
+      break;
+  }
+}
+
+static rdcstr JoinPath(const char *dir, const char *name)
+{
+  if(name[0] == '/' || dir == NULL || dir[0] == 0)
+    return name;
+
+  rdcstr ret = dir;
+  if(ret.back() != '/')
+    ret.push_back('/');
+  ret += name;
+  return ret;
+}
+
+// parses one line number program, starting at the unit header. Returns false if the unit couldn't
+// be parsed, in which case the reader is left at the end of the unit if its length was readable.
+static bool ParseLineProgram(DwarfReader &section, const DwarfSection &debugStr,
+                             const DwarfSection &debugLineStr, LineTable &table)
+{
+  bool dwarf64 = false;
+  uint64_t unitLength = section.Read<uint32_t>();
+  if(unitLength == 0xffffffffU)
+  {
+    dwarf64 = true;
+    unitLength = section.Read<uint64_t>();
+  }
+
+  if(section.error || unitLength > section.Remaining())
+  {
+    section.error = true;
+    return false;
+  }
+
+  DwarfReader unit(section.cur, size_t(unitLength));
+  section.Skip(unitLength);
+
+  uint16_t version = unit.Read<uint16_t>();
+  if(version < 2 || version > 5)
+    return false;
+
+  uint8_t addressSize = sizeof(uint64_t);
+  if(version >= 5)
+  {
+    addressSize = unit.Read<uint8_t>();
+    // segment selector size
+    unit.Read<uint8_t>();
+  }
+
+  uint64_t headerLength = unit.ReadOffset(dwarf64);
+  if(unit.error || headerLength > unit.Remaining())
+    return false;
+
+  const byte *program = unit.cur + headerLength;
+
+  uint8_t minInstLength = unit.Read<uint8_t>();
+  if(version >= 4)
+  {
+    // maximum operations per instruction, only relevant for VLIW architectures
+    unit.Read<uint8_t>();
+  }
+  bool defaultIsStmt = unit.Read<uint8_t>() != 0;
+  int8_t lineBase = unit.Read<int8_t>();
+  uint8_t lineRange = unit.Read<uint8_t>();
+  uint8_t opcodeBase = unit.Read<uint8_t>();
+
+  if(unit.error || lineRange == 0 || opcodeBase == 0)
+    return false;
+
+  uint8_t standardLengths[256] = {};
+  for(uint8_t i = 1; i < opcodeBase; i++)
+    standardLengths[i] = unit.Read<uint8_t>();
+
+  // file indices in the program are relative to the first file of this unit in the table
+  uint32_t firstFile = (uint32_t)table.files.size();
+
+  rdcarray<const char *> dirs;
+
+  if(version >= 5)
+  {
+    rdcarray<rdcpair<uint64_t, uint64_t>> format;
+
+    uint8_t formatCount = unit.Read<uint8_t>();
+    for(uint8_t i = 0; i < formatCount; i++)
+    {
+      uint64_t type = unit.ReadULEB();
+      format.push_back({type, unit.ReadULEB()});
+    }
+
+    uint64_t dirCount = unit.ReadULEB();
+    for(uint64_t d = 0; d < dirCount && !unit.error; d++)
+    {
+      const char *dir = "";
+      for(const rdcpair<uint64_t, uint64_t> &f : format)
+      {
+        const char *str;
+        uint64_t value;
+        ReadLineEntryForm(unit, f.second, dwarf64, debugStr, debugLineStr, str, value);
+        if(f.first == DW_LNCT_path && str)
+          dir = str;
+      }
+      dirs.push_back(dir);
+    }
+
+    format.clear();
+    formatCount = unit.Read<uint8_t>();
+    for(uint8_t i = 0; i < formatCount; i++)
+    {
+      uint64_t type = unit.ReadULEB();
+      format.push_back({type, unit.ReadULEB()});
+    }
+
+    uint64_t fileCount = unit.ReadULEB();
+    for(uint64_t f = 0; f < fileCount && !unit.error; f++)
+    {
+      const char *name = "";
+      uint64_t dir = 0;
+      for(const rdcpair<uint64_t, uint64_t> &fmt : format)
+      {
+        const char *str;
+        uint64_t value;
+        ReadLineEntryForm(unit, fmt.second, dwarf64, debugStr, debugLineStr, str, value);
+        if(fmt.first == DW_LNCT_path && str)
+          name = str;
+        else if(fmt.first == DW_LNCT_directory_index)
+          dir = value;
+      }
+      table.files.push_back(JoinPath(dir < dirs.size() ? dirs[size_t(dir)] : NULL, name));
+    }
+  }
+  else
+  {
+    // directory 0 is the compilation directory, which is only in .debug_info. Files relative to it
+    // are left relative.
+    dirs.push_back("");
+    for(;;)
+    {
+      const char *dir = unit.ReadString();
+      if(unit.error || dir[0] == 0)
+        break;
+      dirs.push_back(dir);
+    }
+
+    // file numbering starts at 1 before DWARF 5, add a dummy entry so indices line up
+    table.files.push_back(rdcstr());
+
+    for(;;)
+    {
+      const char *name = unit.ReadString();
+      if(unit.error || name[0] == 0)
+        break;
+      uint64_t dir = unit.ReadULEB();
+      // modification time and length
+      unit.ReadULEB();
+      unit.ReadULEB();
+      table.files.push_back(JoinPath(dir < dirs.size() ? dirs[size_t(dir)] : NULL, name));
+    }
+  }
+
+  if(unit.error || program < unit.cur || program > unit.end)
+    return false;
+
+  unit.cur = program;
+
+  // state machine registers
+  uint64_t address = 0;
+  uint64_t file = 1;
+  int64_t line = 1;
+  bool isStmt = defaultIsStmt;
+
+  // the previous row in the current sequence, which a range runs from
+  bool havePrev = false;
+  uint64_t prevAddress = 0;
+  uint64_t prevFile = 0;
+  int64_t prevLine = 0;
+
+  // linkers mark code that was discarded with an address of 0 or -1, skip those sequences
+  bool discarded = false;
+
+  rdcarray<LineRange> &ranges = table.ranges;
+
+  auto emitRow = [&](bool endSequence) {
+    if(havePrev && address > prevAddress && !discarded)
+    {
+      LineRange range;
+      range.start = prevAddress;
+      range.end = address;
+      range.file = firstFile + uint32_t(prevFile);
+      range.line = uint32_t(prevLine);
+      ranges.push_back(range);
+    }
+
+    havePrev = !endSequence;
+    prevAddress = address;
+    prevFile = file;
+    prevLine = line;
+  };
+
+  while(unit.cur < unit.end && !unit.error)
+  {
+    uint8_t opcode = unit.Read<uint8_t>();
+
+    if(opcode >= opcodeBase)
+    {
+      uint8_t adjusted = opcode - opcodeBase;
+      address += (adjusted / lineRange) * minInstLength;
+      line += lineBase + (adjusted % lineRange);
+      emitRow(false);
+      continue;
+    }
+
+    switch(opcode)
+    {
+      case 0:
+      {
+        uint64_t length = unit.ReadULEB();
+        if(length == 0 || length > unit.Remaining())
+        {
+          unit.error = true;
+          break;
+        }
+
+        const byte *next = unit.cur + length;
+        uint8_t extended = unit.Read<uint8_t>();
+
+        if(extended == DW_LNE_end_sequence)
+        {
+          emitRow(true);
+
+          address = 0;
+          file = 1;
+          line = 1;
+          isStmt = defaultIsStmt;
+          discarded = false;
+        }
+        else if(extended == DW_LNE_set_address)
+        {
+          address = unit.ReadSized(length - 1);
+          if(length - 1 < addressSize && length - 1 != 4)
+            address = 0;
+
+          discarded = address == 0 || address >= 0xfffffffffffffffeULL ||
+                      (length - 1 == 4 && address >= 0xfffffffeU);
+        }
+        else if(extended == DW_LNE_define_file)
+        {
+          const char *name = unit.ReadString();
+          uint64_t dir = unit.ReadULEB();
+          table.files.push_back(JoinPath(dir < dirs.size() ? dirs[size_t(dir)] : NULL, name));
+        }
+
+        unit.cur = next;
+        break;
+      }
+      case DW_LNS_copy: emitRow(false); break;
+      case DW_LNS_advance_pc: address += unit.ReadULEB() * minInstLength; break;
+      case DW_LNS_advance_line: line += unit.ReadSLEB(); break;
+      case DW_LNS_set_file: file = unit.ReadULEB(); break;
+      case DW_LNS_set_column: unit.ReadULEB(); break;
+      case DW_LNS_negate_stmt: isStmt = !isStmt; break;
+      case DW_LNS_set_basic_block: break;
+      case DW_LNS_const_add_pc: address += ((255 - opcodeBase) / lineRange) * minInstLength; break;
+      case DW_LNS_fixed_advance_pc: address += unit.Read<uint16_t>(); break;
+      default:
+        // unknown standard opcodes declare how many ULEB operands they take
+        for(uint8_t i = 0; i < standardLengths[opcode]; i++)
+          unit.ReadULEB();
+        break;
+    }
+  }
+
+  // any file indices out of range point at the dummy entry or are dropped
+  for(LineRange &range : ranges)
+  {
+    if(range.file >= table.files.size())
+      range.file = firstFile;
+  }
+
+  return !unit.error;
+}
+
+static void ParseDebugLine(const DwarfSection &debugLine, const DwarfSection &debugStr,
+                           const DwarfSection &debugLineStr, LineTable &table)
+{
+  DwarfReader section(debugLine.data, debugLine.size);
+
+  while(section.Remaining() > 0 && !section.error)
+    ParseLineProgram(section, debugStr, debugLineStr, table);
+
+  std::sort(table.ranges.begin(), table.ranges.end());
+}
+
+struct ElfSymbol
+{
+  uint64_t addr;
+  uint64_t size;
+  const char *name;
+
+  bool operator<(const ElfSymbol &o) const { return addr < o.addr; }
+};
+
+// a memory-mapped ELF file and the sections in it
+class ElfFile
+{
+public:
+  ~ElfFile()
+  {
+    for(byte *buf : m_Decompressed)
+      delete[] buf;
+    if(m_Map)
+      munmap(m_Map, m_MapSize);
+  }
+
+  bool Open(const rdcstr &path)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      return false;
+
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > EI_NIDENT)
+    {
+      void *map = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if(map != MAP_FAILED)
+      {
+        m_Map = (byte *)map;
+        m_MapSize = size_t(st.st_size);
+      }
+    }
+
+    close(fd);
+
+    if(!m_Map || memcmp(m_Map, ELFMAG, SELFMAG) != 0)
+      return false;
+
+    // we only read files with the host's byte order
+    const uint16_t endianCheck = 1;
+    const byte hostData = *(const byte *)&endianCheck ? ELFDATA2LSB : ELFDATA2MSB;
+    if(m_Map[EI_DATA] != hostData)
+      return false;
+
+    if(m_Map[EI_CLASS] == ELFCLASS64)
+      return ReadSections<Elf64_Ehdr, Elf64_Shdr>();
+    else if(m_Map[EI_CLASS] == ELFCLASS32)
+      return ReadSections<Elf32_Ehdr, Elf32_Shdr>();
+
+    return false;
+  }
+
+  // returns the contents of a section, decompressing it if necessary
+  DwarfSection GetSection(const char *name)
+  {
+    DwarfSection ret;
+
+    auto it = m_Sections.find(name);
+    if(it == m_Sections.end())
+      return ret;
+
+    Section &sec = it->second;
+
+    if(sec.type == SHT_NOBITS || sec.offset > m_MapSize || sec.size > m_MapSize - sec.offset)
+      return ret;
+
+    ret.data = m_Map + sec.offset;
+    ret.size = size_t(sec.size);
+
+    if(sec.flags & SHF_COMPRESSED)
+    {
+      if(sec.decompressed.data == NULL)
+      {
+        if(m_Is64)
+          Decompress<Elf64_Chdr>(ret, sec.decompressed);
+        else
+          Decompress<Elf32_Chdr>(ret, sec.decompressed);
+      }
+
+      return sec.decompressed;
+    }
+
+    return ret;
+  }
+
+  bool HasSection(const char *name) const { return m_Sections.find(name) != m_Sections.end(); }
+  void GetFunctionSymbols(rdcarray<ElfSymbol> &symbols)
+  {
+    ReadSymbols(".symtab", symbols);
+    ReadSymbols(".dynsym", symbols);
+  }
+
+  rdcstr GetBuildID()
+  {
+    DwarfSection note = GetSection(".note.gnu.build-id");
+    DwarfReader reader(note.data, note.size);
+
+    uint32_t nameSize = reader.Read<uint32_t>();
+    uint32_t descSize = reader.Read<uint32_t>();
+    uint32_t type = reader.Read<uint32_t>();
+    reader.Skip(AlignUp4(nameSize));
+
+    if(reader.error || type != NT_GNU_BUILD_ID || descSize > reader.Remaining())
+      return rdcstr();
+
+    rdcstr ret;
+    for(uint32_t i = 0; i < descSize; i++)
+      ret += StringFormat::Fmt("%02x", reader.cur[i]);
+    return ret;
+  }
+
+  rdcstr GetDebugLink()
+  {
+    DwarfSection link = GetSection(".gnu_debuglink");
+    if(link.data && memchr(link.data, 0, link.size))
+      return (const char *)link.data;
+    return rdcstr();
+  }
+
+private:
+  struct Section
+  {
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    rdcstr name;
+    DwarfSection decompressed;
+  };
+
+  template <typename Ehdr, typename Shdr>
+  bool ReadSections()
+  {
+    m_Is64 = sizeof(Ehdr) == sizeof(Elf64_Ehdr);
+
+    if(m_MapSize < sizeof(Ehdr))
+      return false;
+
+    Ehdr ehdr;
+    memcpy(&ehdr, m_Map, sizeof(ehdr));
+
+    if(ehdr.e_shentsize != sizeof(Shdr) || ehdr.e_shoff > m_MapSize ||
+       uint64_t(ehdr.e_shnum) * sizeof(Shdr) > m_MapSize - ehdr.e_shoff)
+      return false;
+
+    rdcarray<Shdr> shdrs;
+    shdrs.resize(ehdr.e_shnum);
+    memcpy(shdrs.data(), m_Map + ehdr.e_shoff, shdrs.byteSize());
+
+    if(ehdr.e_shstrndx >= shdrs.size())
+      return false;
+
+    DwarfSection names;
+    const Shdr &strhdr = shdrs[ehdr.e_shstrndx];
+    if(strhdr.sh_offset > m_MapSize || strhdr.sh_size > m_MapSize - strhdr.sh_offset)
+      return false;
+    names.data = m_Map + strhdr.sh_offset;
+    names.size = size_t(strhdr.sh_size);
+
+    m_SectionList.resize(shdrs.size());
+
+    for(size_t i = 0; i < shdrs.size(); i++)
+    {
+      Section &sec = m_SectionList[i];
+      sec.type = shdrs[i].sh_type;
+      sec.flags = shdrs[i].sh_flags;
+      sec.offset = shdrs[i].sh_offset;
+      sec.size = shdrs[i].sh_size;
+      sec.link = shdrs[i].sh_link;
+
+      const char *name = names.GetString(shdrs[i].sh_name);
+      if(name && name[0])
+      {
+        sec.name = name;
+        m_Sections[sec.name] = sec;
+      }
+    }
+
+    return true;
+  }
+
+  template <typename Chdr>
+  void Decompress(const DwarfSection &compressed, DwarfSection &decompressed)
+  {
+    if(compressed.size < sizeof(Chdr))
+      return;
+
+    Chdr chdr;
+    memcpy(&chdr, compressed.data, sizeof(chdr));
+
+    if(chdr.ch_type != ELFCOMPRESS_ZLIB || chdr.ch_size == 0 || chdr.ch_size > (1ULL << 32))
+      return;
+
+    byte *buf = new byte[size_t(chdr.ch_size)];
+
+    size_t size = tinfl_decompress_mem_to_mem(
+        buf, size_t(chdr.ch_size), compressed.data + sizeof(Chdr), compressed.size - sizeof(Chdr),
+        TINFL_FLAG_PARSE_ZLIB_HEADER);
+
+    if(size != size_t(chdr.ch_size))
+    {
+      delete[] buf;
+      return;
+    }
+
+    m_Decompressed.push_back(buf);
+    decompressed.data = buf;
+    decompressed.size = size;
+  }
+
+  template <typename Sym>
+  void ReadSymbolsFrom(const DwarfSection &symtab, const DwarfSection &strtab,
+                       rdcarray<ElfSymbol> &symbols)
+  {
+    for(size_t offs = 0; offs + sizeof(Sym) <= symtab.size; offs += sizeof(Sym))
+    {
+      Sym sym;
+      memcpy(&sym, symtab.data + offs, sizeof(sym));
+
+      uint8_t type = sym.st_info & 0xf;
+      if((type != STT_FUNC && type != STT_GNU_IFUNC) || sym.st_shndx == SHN_UNDEF ||
+         sym.st_value == 0)
+        continue;
+
+      const char *name = strtab.GetString(sym.st_name);
+      if(name == NULL || name[0] == 0)
+        continue;
+
+      ElfSymbol s;
+      s.addr = sym.st_value;
+      s.size = sym.st_size;
+      s.name = name;
+      symbols.push_back(s);
+    }
+  }
+
+  void ReadSymbols(const char *name, rdcarray<ElfSymbol> &symbols)
+  {
+    auto it = m_Sections.find(name);
+    if(it == m_Sections.end() || it->second.link >= m_SectionList.size())
+      return;
+
+    DwarfSection symtab = GetSection(name);
+    DwarfSection strtab = GetSection(m_SectionList[it->second.link].name.c_str());
+
+    if(m_Is64)
+      ReadSymbolsFrom<Elf64_Sym>(symtab, strtab, symbols);
+    else
+      ReadSymbolsFrom<Elf32_Sym>(symtab, strtab, symbols);
+  }
+
+  static uint32_t AlignUp4(uint32_t x) { return (x + 3) & ~3U; }
+  byte *m_Map = NULL;
+  size_t m_MapSize = 0;
+  bool m_Is64 = false;
+
+  rdcarray<Section> m_SectionList;
+  std::map<rdcstr, Section> m_Sections;
+  rdcarray<byte *> m_Decompressed;
+};
+
+// a module with its symbols and line table, loaded on first use
+struct ElfModule
+{
+  ~ElfModule()
+  {
+    delete file;
+    delete debugFile;
+  }
+
+  rdcstr path;
+  bool loaded = false;
+
+  ElfFile *file = NULL;
+  // separate debug info, if the module was stripped
+  ElfFile *debugFile = NULL;
+
+  rdcarray<ElfSymbol> symbols;
+  LineTable lines;
+
+  void Load()
+  {
+    loaded = true;
+
+    file = new ElfFile;
+    if(!file->Open(path))
+    {
+      RDCWARN("Couldn't read symbols from %s", path.c_str());
+      SAFE_DELETE(file);
+      return;
+    }
+
+    if(!file->HasSection(".debug_line"))
+      LoadDebugFile();
+
+    // prefer the separate debug file's full symbol table if it has one
+    if(debugFile)
+      debugFile->GetFunctionSymbols(symbols);
+    if(symbols.empty())
+      file->GetFunctionSymbols(symbols);
+
+    // symbols with the same address are aliases, keep the first (from .symtab)
+    std::stable_sort(symbols.begin(), symbols.end());
+    size_t count = 0;
+    for(size_t i = 0; i < symbols.size(); i++)
+    {
+      if(count > 0 && symbols[count - 1].addr == symbols[i].addr)
+        continue;
+      symbols[count++] = symbols[i];
+    }
+    symbols.resize(count);
+
+    ElfFile *lineFile = debugFile ? debugFile : file;
+    ParseDebugLine(lineFile->GetSection(".debug_line"), lineFile->GetSection(".debug_str"),
+                   lineFile->GetSection(".debug_line_str"), lines);
+
+    RDCLOG("Loaded %zu symbols and %zu line ranges for %s", symbols.size(), lines.ranges.size(),
+           path.c_str());
+  }
+
+  void LoadDebugFile()
+  {
+    rdcarray<rdcstr> candidates;
+
+    rdcstr buildID = file->GetBuildID();
+    if(buildID.size() > 2)
+      candidates.push_back(StringFormat::Fmt("/usr/lib/debug/.build-id/%s/%s.debug",
+                                             buildID.substr(0, 2).c_str(),
+                                             buildID.substr(2).c_str()));
+
+    rdcstr link = file->GetDebugLink();
+    if(!link.empty())
+    {
+      rdcstr dir = get_dirname(path);
+      candidates.push_back(dir + "/" + link);
+      candidates.push_back(dir + "/.debug/" + link);
+      candidates.push_back("/usr/lib/debug" + dir + "/" + link);
+    }
+
+    for(const rdcstr &candidate : candidates)
+    {
+      if(candidate == path)
+        continue;
+
+      debugFile = new ElfFile;
+      if(debugFile->Open(candidate) && debugFile->HasSection(".debug_line"))
+      {
+        RDCLOG("Using separate debug info %s for %s", candidate.c_str(), path.c_str());
+        return;
+      }
+
+      SAFE_DELETE(debugFile);
+    }
+  }
+
+  // addrs must be sorted. Fills in details for each address that can be resolved
+  void Resolve(const uint64_t *addrs, size_t count, Callstack::AddressDetails *details)
+  {
+    ElfSymbol *sym = symbols.begin();
+    LineRange *range = lines.ranges.begin();
+
+    for(size_t i = 0; i < count; i++)
+    {
+      uint64_t addr = addrs[i];
+
+      // since the addresses are sorted, each search starts from where the last one left off
+      ElfSymbol key = {addr, 0, NULL};
+      sym = std::upper_bound(sym, symbols.end(), key);
+      if(sym != symbols.begin())
+      {
+        const ElfSymbol &s = *(sym - 1);
+        if(s.size == 0 || addr < s.addr + s.size)
+          details[i].function = Demangle(s.name);
+      }
+
+      LineRange lineKey = {addr, 0, 0, 0};
+      range = std::upper_bound(range, lines.ranges.end(), lineKey);
+      if(range != lines.ranges.begin())
+      {
+        // ranges from different units can overlap, look back for one containing the address
+        for(const LineRange *r = range - 1; r >= lines.ranges.begin() && r >= range - 4; r--)
+        {
+          if(addr < r->end)
+          {
+            details[i].filename = lines.files[r->file];
+            details[i].line = r->line;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  static rdcstr Demangle(const char *name)
+  {
+    if(name[0] != '_' || name[1] != 'Z')
+      return name;
+
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+    if(status != 0 || demangled == NULL)
+      return name;
+
+    rdcstr ret = demangled;
+    free(demangled);
+    return ret;
+  }
+};
+
+class ElfResolver : public Callstack::StackResolver
+{
+public:
+  ElfResolver(const rdcarray<Callstack::ElfModuleMapping> &mappings)
+  {
+    std::map<rdcstr, ElfModule *> modules;
+
+    for(const Callstack::ElfModuleMapping &m : mappings)
+    {
+      ElfModule *&mod = modules[m.path];
+      if(mod == NULL)
+      {
+        mod = new ElfModule;
+        mod->path = m.path;
+        m_Modules.push_back(mod);
+      }
+
+      Mapping mapping = {m.base, m.end, m.offset, mod};
+      m_Mappings.push_back(mapping);
+    }
+
+    std::sort(m_Mappings.begin(), m_Mappings.end());
+  }
+
+  ~ElfResolver()
+  {
+    for(ElfModule *mod : m_Modules)
+      delete mod;
+  }
+
+  Callstack::AddressDetails GetAddr(uint64_t addr)
+  {
+    rdcarray<uint64_t> addrs = {addr};
+    return GetAddrs(addrs)[0];
+  }
+
+  rdcarray<Callstack::AddressDetails> GetAddrs(const rdcarray<uint64_t> &addrs)
+  {
+    // gather the addresses we haven't seen before, sorted so that each module is resolved once in
+    // a single pass over its tables
+    rdcarray<uint64_t> uncached;
+    for(uint64_t addr : addrs)
+    {
+      if(m_Cache.find(addr) == m_Cache.end())
+        uncached.push_back(addr);
+    }
+
+    std::sort(uncached.begin(), uncached.end());
+    uncached.resize(std::unique(uncached.begin(), uncached.end()) - uncached.begin());
+
+    Resolve(uncached);
+
+    rdcarray<Callstack::AddressDetails> ret;
+    ret.reserve(addrs.size());
+    for(uint64_t addr : addrs)
+      ret.push_back(m_Cache[addr]);
+    return ret;
+  }
+
+private:
+  struct Mapping
+  {
+    uint64_t base;
+    uint64_t end;
+    uint64_t offset;
+    ElfModule *module;
+
+    bool operator<(const Mapping &o) const { return base < o.base; }
+  };
+
+  void Resolve(const rdcarray<uint64_t> &addrs)
+  {
+    rdcarray<Callstack::AddressDetails> details;
+    details.resize(addrs.size());
+
+    for(size_t i = 0; i < addrs.size(); i++)
+    {
+      details[i].filename = "Unknown";
+      details[i].line = 0;
+      details[i].function = StringFormat::Fmt("0x%08llx", addrs[i]);
+    }
+
+    rdcarray<uint64_t> relative;
+
+    size_t i = 0;
+    while(i < addrs.size())
+    {
+      Mapping key = {addrs[i], 0, 0, NULL};
+      const Mapping *m = std::upper_bound(m_Mappings.begin(), m_Mappings.end(), key);
+
+      if(m == m_Mappings.begin() || addrs[i] >= (m - 1)->end)
+      {
+        i++;
+        continue;
+      }
+
+      m--;
+
+      // resolve every address in this mapping together, they're contiguous since addrs is sorted
+      size_t first = i;
+      relative.clear();
+      while(i < addrs.size() && addrs[i] < m->end)
+        relative.push_back(addrs[i++] - m->base + m->offset);
+
+      if(!m->module->loaded)
+        m->module->Load();
+
+      m->module->Resolve(relative.data(), relative.size(), details.data() + first);
+    }
+
+    for(size_t a = 0; a < addrs.size(); a++)
+      m_Cache[addrs[a]] = details[a];
+  }
+
+  rdcarray<Mapping> m_Mappings;
+  rdcarray<ElfModule *> m_Modules;
+  std::unordered_map<uint64_t, Callstack::AddressDetails> m_Cache;
+};
+
+namespace Callstack
+{
+StackResolver *MakeElfResolver(const rdcarray<ElfModuleMapping> &modules)
+{
+  return new ElfResolver(modules);
+}
+};
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include <dlfcn.h>
+#include "catch/catch.hpp"
+
+TEST_CASE("Check DWARF line table parsing", "[callstack]")
+{
+  rdcarray<byte> data;
+
+  auto bytes = [&data](std::initializer_list<byte> b) { data.append(b.begin(), b.size()); };
+  auto str = [&data](const char *s) { data.append((const byte *)s, strlen(s) + 1); };
+  auto u32 = [&data](uint32_t v) { data.append((const byte *)&v, sizeof(v)); };
+  auto u64 = [&data](uint64_t v) { data.append((const byte *)&v, sizeof(v)); };
+
+  // unit length, filled in below
+  u32(0);
+  // version 4
+  bytes({4, 0});
+  // header length, filled in below
+  u32(0);
+  size_t headerStart = data.size();
+  // min instruction length, max ops, default_is_stmt, line_base, line_range, opcode_base
+  bytes({1, 1, 1, byte(-5), 14, 13});
+  // standard opcode lengths
+  bytes({0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1});
+  // include directories
+  str("/src");
+  str("");
+  // files: name, directory, mtime, length
+  str("a.cpp");
+  bytes({1, 0, 0});
+  str("b.h");
+  bytes({0, 0, 0});
+  str("");
+
+  uint32_t headerLength = uint32_t(data.size() - headerStart);
+  memcpy(&data[headerStart - 4], &headerLength, 4);
+
+  // set address 0x1000
+  bytes({0, 9, DW_LNE_set_address});
+  u64(0x1000);
+  // line 10, emit a row
+  bytes({DW_LNS_advance_line, 9, DW_LNS_copy});
+  // special opcode: address += 4, line += 1
+  bytes({13 + 4 * 14 + (1 + 5)});
+  // file 2, address += 8, emit a row
+  bytes({DW_LNS_set_file, 2, DW_LNS_advance_pc, 8, DW_LNS_copy});
+  // address += 4, end the sequence
+  bytes({DW_LNS_advance_pc, 4, 0, 1, DW_LNE_end_sequence});
+
+  // a sequence for code the linker discarded, which should be skipped
+  bytes({0, 9, DW_LNE_set_address});
+  u64(0);
+  bytes({DW_LNS_copy, DW_LNS_advance_pc, 16, 0, 1, DW_LNE_end_sequence});
+
+  uint32_t unitLength = uint32_t(data.size() - 4);
+  memcpy(&data[0], &unitLength, 4);
+
+  DwarfSection debugLine, empty;
+  debugLine.data = data.data();
+  debugLine.size = data.size();
+
+  LineTable table;
+  ParseDebugLine(debugLine, empty, empty, table);
+
+  REQUIRE(table.ranges.size() == 3);
+
+  CHECK(table.ranges[0].start == 0x1000);
+  CHECK(table.ranges[0].end == 0x1004);
+  CHECK(table.files[table.ranges[0].file] == "/src/a.cpp");
+  CHECK(table.ranges[0].line == 10);
+
+  CHECK(table.ranges[1].start == 0x1004);
+  CHECK(table.ranges[1].end == 0x100c);
+  CHECK(table.files[table.ranges[1].file] == "/src/a.cpp");
+  CHECK(table.ranges[1].line == 11);
+
+  CHECK(table.ranges[2].start == 0x100c);
+  CHECK(table.ranges[2].end == 0x1010);
+  CHECK(table.files[table.ranges[2].file] == "b.h");
+  CHECK(table.ranges[2].line == 11);
+
+  SECTION("Truncated data")
+  {
+    for(size_t len = 0; len < data.size(); len++)
+    {
+      debugLine.size = len;
+
+      LineTable truncated;
+      ParseDebugLine(debugLine, empty, empty, truncated);
+
+      for(const LineRange &r : truncated.ranges)
+        CHECK(r.file < truncated.files.size());
+    }
+  };
+
+  SECTION("Resolving against symbols and lines")
+  {
+    ElfModule mod;
+    mod.loaded = true;
+    mod.lines = table;
+
+    ElfSymbol sym = {0x1000, 0x10, "_Z3fooi"};
+    mod.symbols.push_back(sym);
+    sym = {0x2000, 0, "bar"};
+    mod.symbols.push_back(sym);
+
+    uint64_t addrs[] = {0x800, 0x1002, 0x100e, 0x1800, 0x2100};
+    Callstack::AddressDetails details[ARRAY_COUNT(addrs)];
+
+    mod.Resolve(addrs, ARRAY_COUNT(addrs), details);
+
+    CHECK(details[0].function == "");
+    CHECK(details[1].function == "foo(int)");
+    CHECK(details[1].filename == "/src/a.cpp");
+    CHECK(details[1].line == 10);
+    CHECK(details[2].function == "foo(int)");
+    CHECK(details[2].filename == "b.h");
+    CHECK(details[2].line == 11);
+    // past the end of foo and outside any line range
+    CHECK(details[3].function == "");
+    CHECK(details[3].line == 0);
+    // symbols with no size cover everything up to the next symbol
+    CHECK(details[4].function == "bar");
+  };
+};
+
+TEST_CASE("Check resolving symbols in a loaded module", "[callstack]")
+{
+  Dl_info info = {};
+  REQUIRE(dladdr((void *)&Callstack::MakeElfResolver, &info) != 0);
+  REQUIRE(info.dli_fname != NULL);
+
+  uint64_t base = (uint64_t)info.dli_fbase;
+  uint64_t func = (uint64_t)(void *)&Callstack::MakeElfResolver;
+
+  rdcarray<Callstack::ElfModuleMapping> modules;
+  Callstack::ElfModuleMapping mod;
+  mod.base = base;
+  mod.end = func + 0x1000;
+  mod.offset = 0;
+  mod.path = FileIO::GetFullPathname(info.dli_fname);
+  modules.push_back(mod);
+
+  Callstack::StackResolver *resolver = Callstack::MakeElfResolver(modules);
+
+  rdcarray<uint64_t> addrs = {func + 1, base - 16, func + 1};
+  rdcarray<Callstack::AddressDetails> details = resolver->GetAddrs(addrs);
+
+  REQUIRE(details.size() == 3);
+  CHECK(details[0].function.find("Callstack::MakeElfResolver") >= 0);
+  CHECK(details[1].function == StringFormat::Fmt("0x%08llx", base - 16));
+  CHECK(details[1].filename == "Unknown");
+  CHECK(details[2].function == details[0].function);
+
+  // single lookups go through the same cache
+  CHECK(resolver->GetAddr(func + 1).function == details[0].function);
+
+  delete resolver;
+};
+
+#endif
@@ -0,0 +1,47 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/rdcarray.h"
+#include "api/replay/rdcstr.h"
+#include "os/os_specific.h"
+
+namespace Callstack
+{
+// an executable segment of an ELF module that was loaded at [base, end), where offset is the
+// segment's virtual address in the file
+struct ElfModuleMapping
+{
+  uint64_t base;
+  uint64_t end;
+  uint64_t offset;
+  rdcstr path;
+};
+
+// Creates a resolver that reads each module's ELF symbol table and DWARF line table directly. Each
+// module is only parsed the first time an address inside it is resolved, and results are cached
+// for the lifetime of the resolver.
+StackResolver *MakeElfResolver(const rdcarray<ElfModuleMapping> &modules);
+};
@@ -25,10 +25,10 @@
 #include <execinfo.h>
 #include <stdio.h>
 #include <string.h>
-#include <map>
 #include "common/common.h"
 #include "common/formatting.h"
 #include "os/os_specific.h"
+#include "os/posix/elf_symbolizer.h"
 
 void *renderdocBase = NULL;
 void *renderdocEnd = NULL;
@@ -141,95 +141,6 @@ bool GetLoadedModules(byte *buf, size_t &size)
   return true;
 }
 
-struct LookupModule
-{
-  uint64_t base;
-  uint64_t end;
-  uint64_t offset;
-  char path[2048];
-};
-
-class GgpResolver : public Callstack::StackResolver
-{
-public:
-  GgpResolver(rdcarray<LookupModule> modules) { m_Modules = modules; }
-  Callstack::AddressDetails GetAddr(uint64_t addr)
-  {
-    EnsureCached(addr);
-
-    return m_Cache[addr];
-  }
-
-private:
-  void EnsureCached(uint64_t addr)
-  {
-    auto it = m_Cache.insert(
-        std::pair<uint64_t, Callstack::AddressDetails>(addr, Callstack::AddressDetails()));
-    if(!it.second)
-      return;
-
-    Callstack::AddressDetails &ret = it.first->second;
-
-    ret.filename = "Unknown";
-    ret.line = 0;
-    ret.function = StringFormat::Fmt("0x%08llx", addr);
-
-    for(size_t i = 0; i < m_Modules.size(); i++)
-    {
-      if(addr >= m_Modules[i].base && addr < m_Modules[i].end)
-      {
-        uint64_t relative = addr - m_Modules[i].base + m_Modules[i].offset;
-        rdcstr cmd = StringFormat::Fmt("addr2line -fCe \"%s\" 0x%llx", m_Modules[i].path, relative);
-
-        FILE *f = ::popen(cmd.c_str(), "r");
-
-        char result[2048] = {0};
-        fread(result, 1, 2047, f);
-
-        fclose(f);
-
-        char *line2 = strchr(result, '\n');
-        if(line2)
-        {
-          *line2 = 0;
-          line2++;
-        }
-
-        ret.function = result;
-
-        if(line2)
-        {
-          char *linenum = line2 + strlen(line2) - 1;
-          while(linenum > line2 && *linenum != ':')
-            linenum--;
-
-          ret.line = 0;
-
-          if(*linenum == ':')
-          {
-            *linenum = 0;
-            linenum++;
-
-            while(*linenum >= '0' && *linenum <= '9')
-            {
-              ret.line *= 10;
-              ret.line += (uint32_t(*linenum) - uint32_t('0'));
-              linenum++;
-            }
-          }
-
-          ret.filename = line2;
-        }
-
-        break;
-      }
-    }
-  }
-
-  rdcarray<LookupModule> m_Modules;
-  std::map<uint64_t, Callstack::AddressDetails> m_Cache;
-};
-
 StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
                             RENDERDOC_ProgressCallback progress)
 {
@@ -248,7 +159,7 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
   char *search = start;
   char *dbend = (char *)(moduleDB + DBSize);
 
-  rdcarray<LookupModule> modules;
+  rdcarray<ElfModuleMapping> modules;
 
   while(search && search < dbend)
   {
@@ -269,7 +180,7 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
       // we read all 4 params (and so perms == r-xp)
       if(num == 4 && offs > 0)
       {
-        LookupModule mod = {0};
+        ElfModuleMapping mod;
 
         mod.base = (uint64_t)base;
         mod.end = (uint64_t)end;
@@ -281,22 +192,11 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
 
         if(search < dbend && *search != '[' && *search != 0 && *search != '\n')
         {
-          size_t n = ARRAY_COUNT(mod.path) - 1;
-          mod.path[n] = 0;
-          for(size_t i = 0; i < n; i++)
-          {
-            if(search[i] == 0 || search[i] == '\n')
-            {
-              mod.path[i] = 0;
-              break;
-            }
-            if(search + i >= dbend)
-            {
-              mod.path[i] = 0;
-              break;
-            }
-            mod.path[i] = search[i];
-          }
+          char *pathEnd = search;
+          while(pathEnd < dbend && *pathEnd != 0 && *pathEnd != '\n')
+            pathEnd++;
+
+          mod.path.assign(search, pathEnd - search);
 
           modules.push_back(mod);
         }
@@ -314,6 +214,6 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
       search++;
   }
 
-  return new GgpResolver(modules);
+  return MakeElfResolver(modules);
 }
 };
@@ -0,0 +1,444 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "common/common.h"
+#include "common/threading.h"
+#include "core/settings.h"
+#include "os/os_specific.h"
+
+RDOC_CONFIG(bool, Capture_TrackMappedMemoryWrites, false,
+            "While capturing a frame, write-protect persistently mapped memory and catch the "
+            "resulting faults to find which pages were written, so only those pages need to be "
+            "compared against the previous contents. This installs a SIGSEGV handler, and system "
+            "calls such as read() that write directly into mapped memory will fail with EFAULT "
+            "while a frame is being captured, so only enable it for applications that don't.");
+
+// We track writes by write-protecting the pages and catching the SIGSEGV on first write to each
+// page, at which point the page is marked dirty and made writeable again. Resetting a region
+// re-protects only the pages that were dirty.
+//
+// The kernel's soft-dirty bits in /proc/self/pagemap can't be used for this: they can only be
+// cleared for the whole process at once, and any write landing between reading the bits and
+// clearing them is lost. They are also never cleared for VM_PFNMAP mappings, which is what GPU
+// memory mappings usually are. Likewise userfaultfd write-protection is limited to anonymous and
+// shmem memory.
+
+#if ENABLED(RDOC_APPLE)
+
+// Apple platforms can report write faults to mapped memory as SIGBUS, which we don't try to
+// disambiguate, so tracking is unavailable and callers compare the whole range.
+
+MemoryTracking::Region *MemoryTracking::BeginTracking(void *base, size_t size)
+{
+  return NULL;
+}
+
+void MemoryTracking::GetAndResetDirtyRanges(Region *region,
+                                            rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  ranges.clear();
+}
+
+void MemoryTracking::EndTracking(Region *region)
+{
+}
+
+#else
+
+namespace MemoryTracking
+{
+struct Region
+{
+  // the tracked range rounded out to whole pages
+  byte *pageBase;
+  size_t numPages;
+
+  // the range as it was passed in, relative to pageBase
+  size_t offset;
+  size_t size;
+
+  // one entry per page, set by the fault handler when the page is written
+  rdcarray<byte> dirty;
+
+  bool Contains(const byte *addr, size_t pageSize) const
+  {
+    return addr >= pageBase && addr < pageBase + numPages * pageSize;
+  }
+};
+
+// protects everything below. This is taken in the signal handler, so nothing that could fault on a
+// tracked page may be done while it's held.
+static Threading::SpinLock regionLock;
+static rdcarray<Region *> regions;
+static size_t pageSize = 0;
+
+static Threading::CriticalSection installLock;
+static struct sigaction prevHandler;
+
+static void WriteFaultHandler(int sig, siginfo_t *info, void *context)
+{
+  byte *addr = (byte *)info->si_addr;
+  bool handled = false;
+
+  // only write-protection faults can be ours. Anything else (e.g. the mapping having been removed)
+  // would fault again forever if we returned.
+  if(info->si_code == SEGV_ACCERR)
+  {
+    Threading::ScopedSpinLock lock(regionLock);
+
+    byte *page = (byte *)(uintptr_t(addr) & ~uintptr_t(pageSize - 1));
+
+    // a page can be shared between two regions that don't start or end on page boundaries, so mark
+    // it in every region that contains it.
+    for(Region *r : regions)
+    {
+      if(r->Contains(addr, pageSize))
+      {
+        r->dirty[size_t(page - r->pageBase) / pageSize] = 1;
+        handled = true;
+      }
+    }
+
+    if(handled)
+      handled = (mprotect(page, pageSize, PROT_READ | PROT_WRITE) == 0);
+  }
+
+  if(handled)
+    return;
+
+  // not ours, pass it on to whoever was installed before us
+  if(prevHandler.sa_flags & SA_SIGINFO)
+  {
+    prevHandler.sa_sigaction(sig, info, context);
+  }
+  else if(prevHandler.sa_handler != SIG_DFL && prevHandler.sa_handler != SIG_IGN)
+  {
+    prevHandler.sa_handler(sig);
+  }
+  else
+  {
+    // restore the default handling and return, the faulting instruction will run again and fault
+    // as if we were never here.
+    struct sigaction def = {};
+    def.sa_handler = SIG_DFL;
+    sigaction(sig, &def, NULL);
+  }
+}
+
+static bool InstallHandler()
+{
+  SCOPED_LOCK(installLock);
+
+  pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+  // the handler is left installed once it's been needed, as uninstalling it could clobber a
+  // handler installed after us. If someone else has since replaced ours, install it again on top
+  // and pass on to theirs.
+  struct sigaction cur = {};
+  if(sigaction(SIGSEGV, NULL, &cur) == 0 && (cur.sa_flags & SA_SIGINFO) &&
+     cur.sa_sigaction == &WriteFaultHandler)
+    return true;
+
+  struct sigaction act = {};
+  act.sa_sigaction = &WriteFaultHandler;
+  act.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+  sigemptyset(&act.sa_mask);
+
+  if(sigaction(SIGSEGV, &act, &prevHandler) != 0)
+  {
+    RDCWARN("Couldn't install fault handler for tracking mapped memory writes: %d", errno);
+    return false;
+  }
+
+  return true;
+}
+
+Region *BeginTracking(void *base, size_t size)
+{
+  if(!Capture_TrackMappedMemoryWrites() || base == NULL || size == 0)
+    return NULL;
+
+  if(!InstallHandler())
+    return NULL;
+
+  Region *region = new Region;
+
+  uintptr_t start = uintptr_t(base) & ~uintptr_t(pageSize - 1);
+  uintptr_t end = AlignUp(uintptr_t(base) + size, uintptr_t(pageSize));
+
+  region->pageBase = (byte *)start;
+  region->numPages = (end - start) / pageSize;
+  region->offset = uintptr_t(base) - start;
+  region->size = size;
+  region->dirty.resize(region->numPages);
+
+  bool success = false;
+
+  {
+    Threading::ScopedSpinLock lock(regionLock);
+
+    // register before protecting, so the handler can find the region as soon as writes fault
+    regions.push_back(region);
+
+    success = (mprotect(region->pageBase, region->numPages * pageSize, PROT_READ) == 0);
+
+    if(!success)
+      regions.removeOne(region);
+  }
+
+  if(!success)
+  {
+    // most likely this is memory that can't have its protection changed, fall back to comparing
+    RDCDEBUG("Can't write-protect mapped memory at %p: %d", base, errno);
+    delete region;
+    return NULL;
+  }
+
+  return region;
+}
+
+void GetAndResetDirtyRanges(Region *region, rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  ranges.clear();
+
+  if(region == NULL)
+    return;
+
+  rdcarray<rdcpair<size_t, size_t>> pageRuns;
+
+  {
+    Threading::ScopedSpinLock lock(regionLock);
+
+    // clear the dirty flags before re-protecting. Any write that faulted before this is in a page
+    // we're returning, which the caller compares after we return, and any write after this faults
+    // again and is returned next time.
+    for(size_t p = 0; p < region->numPages; p++)
+    {
+      if(!region->dirty[p])
+        continue;
+
+      size_t first = p;
+      while(p < region->numPages && region->dirty[p])
+        region->dirty[p++] = 0;
+
+      pageRuns.push_back({first, p});
+
+      mprotect(region->pageBase + first * pageSize, (p - first) * pageSize, PROT_READ);
+    }
+  }
+
+  // convert from pages to bytes relative to the range that was passed in
+  for(const rdcpair<size_t, size_t> &run : pageRuns)
+  {
+    size_t start = run.first * pageSize;
+    size_t end = run.second * pageSize;
+
+    start = start > region->offset ? start - region->offset : 0;
+    end = RDCMIN(end - region->offset, region->size);
+
+    if(end > start)
+      ranges.push_back({start, end});
+  }
+}
+
+void EndTracking(Region *region)
+{
+  if(region == NULL)
+    return;
+
+  {
+    Threading::ScopedSpinLock lock(regionLock);
+
+    // make it writeable again while still registered, so nothing can fault on it without finding
+    // the region.
+    mprotect(region->pageBase, region->numPages * pageSize, PROT_READ | PROT_WRITE);
+
+    regions.removeOne(region);
+
+    // unprotecting may have unprotected a page shared with another region, which would then miss
+    // writes. Mark it dirty there so it's always compared.
+    for(Region *r : regions)
+    {
+      for(size_t p = 0; p < region->numPages; p++)
+      {
+        byte *page = region->pageBase + p * pageSize;
+        if(r->Contains(page, pageSize))
+          r->dirty[size_t(page - r->pageBase) / pageSize] = 1;
+      }
+    }
+  }
+
+  delete region;
+}
+};
+
+#endif
+
+#if ENABLED(ENABLE_UNIT_TESTS) && DISABLED(RDOC_APPLE)
+
+#include "api/replay/structured_data.h"
+#include "catch/catch.hpp"
+#include "core/core.h"
+
+TEST_CASE("Test mapped memory write tracking", "[osspecific]")
+{
+  // tracking is opt-in, enable it for the duration of the test
+  SDObject *enabled = RenderDoc::Inst().SetConfigSetting("Capture_TrackMappedMemoryWrites");
+  REQUIRE(enabled);
+  const bool wasEnabled = enabled->data.basic.b;
+  enabled->data.basic.b = true;
+
+  const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t numPages = 16;
+
+  byte *mem = (byte *)mmap(NULL, pageSize * numPages, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  REQUIRE(mem != MAP_FAILED);
+
+  memset(mem, 0, pageSize * numPages);
+
+  rdcarray<rdcpair<size_t, size_t>> ranges;
+
+  SECTION("Whole pages")
+  {
+    MemoryTracking::Region *region = MemoryTracking::BeginTracking(mem, pageSize * numPages);
+    REQUIRE(region);
+
+    // nothing written yet
+    MemoryTracking::GetAndResetDirtyRanges(region, ranges);
+    CHECK(ranges.empty());
+
+    mem[pageSize * 3 + 10] = 1;
+    mem[pageSize * 4] = 2;
+    mem[pageSize * 9 + pageSize - 1] = 3;
+
+    MemoryTracking::GetAndResetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].first == pageSize * 3);
+    CHECK(ranges[0].second == pageSize * 5);
+    CHECK(ranges[1].first == pageSize * 9);
+    CHECK(ranges[1].second == pageSize * 10);
+
+    // the writes landed
+    CHECK(mem[pageSize * 3 + 10] == 1);
+    CHECK(mem[pageSize * 4] == 2);
+    CHECK(mem[pageSize * 9 + pageSize - 1] == 3);
+
+    // after a reset, pages are tracked again
+    MemoryTracking::GetAndResetDirtyRanges(region, ranges);
+    CHECK(ranges.empty());
+
+    mem[pageSize * 4 + 5] = 4;
+
+    MemoryTracking::GetAndResetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].first == pageSize * 4);
+    CHECK(ranges[0].second == pageSize * 5);
+
+    MemoryTracking::EndTracking(region);
+
+    // writing after tracking has ended is fine
+    mem[0] = 5;
+    CHECK(mem[0] == 5);
+  };
+
+  SECTION("Unaligned ranges sharing a page")
+  {
+    // region A ends half way into page 4, region B starts there
+    size_t split = pageSize * 4 + pageSize / 2;
+
+    MemoryTracking::Region *a = MemoryTracking::BeginTracking(mem + 100, split - 100);
+    MemoryTracking::Region *b = MemoryTracking::BeginTracking(mem + split, pageSize * 8 - split);
+    REQUIRE(a);
+    REQUIRE(b);
+
+    mem[200] = 1;
+    mem[split + 8] = 2;
+
+    // offsets are clamped to the range that was passed in
+    MemoryTracking::GetAndResetDirtyRanges(a, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].first == 0);
+    CHECK(ranges[0].second == pageSize - 100);
+    CHECK(ranges[1].first == pageSize * 4 - 100);
+    CHECK(ranges[1].second == split - 100);
+
+    MemoryTracking::GetAndResetDirtyRanges(b, ranges);
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].first == 0);
+    CHECK(ranges[0].second == pageSize * 5 - split);
+
+    // ending A must leave B still seeing writes to the shared page
+    MemoryTracking::EndTracking(a);
+
+    mem[split + 16] = 3;
+
+    MemoryTracking::GetAndResetDirtyRanges(b, ranges);
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].first == 0);
+
+    MemoryTracking::EndTracking(b);
+  };
+
+  SECTION("Writes from other threads")
+  {
+    MemoryTracking::Region *region = MemoryTracking::BeginTracking(mem, pageSize * numPages);
+    REQUIRE(region);
+
+    Threading::ThreadHandle threads[4];
+    for(size_t t = 0; t < 4; t++)
+    {
+      threads[t] = Threading::CreateThread([mem, pageSize, t]() {
+        for(size_t p = t; p < numPages; p += 8)
+          mem[p * pageSize + t] = byte(t + 1);
+      });
+    }
+
+    for(Threading::ThreadHandle t : threads)
+    {
+      Threading::JoinThread(t);
+      Threading::CloseThread(t);
+    }
+
+    rdcarray<size_t> written;
+    MemoryTracking::GetAndResetDirtyRanges(region, ranges);
+    for(const rdcpair<size_t, size_t> &r : ranges)
+      for(size_t offs = r.first; offs < r.second; offs += pageSize)
+        written.push_back(offs / pageSize);
+
+    CHECK((written == rdcarray<size_t>({0, 1, 2, 3, 8, 9, 10, 11})));
+
+    MemoryTracking::EndTracking(region);
+  };
+
+  munmap(mem, pageSize * numPages);
+
+  enabled->data.basic.b = wasEnabled;
+}
+
+#endif
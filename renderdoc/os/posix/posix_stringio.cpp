@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -447,6 +448,46 @@ int fclose(FILE *f)
   return ::fclose(f);
 }
 
+byte *MapFileRange(FILE *f, uint64_t offset, uint64_t length)
+{
+  if(f == NULL || length == 0)
+    return NULL;
+
+  int fd = ::fileno(f);
+
+  // don't map past the end of the file, touching those pages would fault rather than fail a read
+  struct ::stat st;
+  if(::fstat(fd, &st) != 0 || offset + length > (uint64_t)st.st_size)
+    return NULL;
+
+  // mmap offsets must be page aligned, so map from the start of the page and skip the padding
+  const uint64_t padding = offset % (uint64_t)::sysconf(_SC_PAGESIZE);
+
+  if(length + padding > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  void *ptr = ::mmap(NULL, size_t(length + padding), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                     off_t(offset - padding));
+
+  if(ptr == MAP_FAILED)
+  {
+    RDCWARN("Couldn't map %llu bytes of file: %s", length, ErrorString().c_str());
+    return NULL;
+  }
+
+  return (byte *)ptr + padding;
+}
+
+void UnmapFileRange(byte *data, uint64_t offset, uint64_t length)
+{
+  if(data == NULL)
+    return;
+
+  const uint64_t padding = offset % (uint64_t)::sysconf(_SC_PAGESIZE);
+
+  ::munmap(data - padding, size_t(length + padding));
+}
+
 bool exists(const char *filename)
 {
   struct ::stat st;
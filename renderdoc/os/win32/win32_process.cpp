@@ -1649,3 +1649,20 @@ void Process::Shutdown()
 {
   // nothing to do
 }
+
+// write watching is only available for memory allocated with MEM_WRITE_WATCH, which mapped GPU
+// memory never is, so tracking is unavailable and callers compare the whole range.
+MemoryTracking::Region *MemoryTracking::BeginTracking(void *base, size_t size)
+{
+  return NULL;
+}
+
+void MemoryTracking::GetAndResetDirtyRanges(Region *region,
+                                            rdcarray<rdcpair<size_t, size_t>> &ranges)
+{
+  ranges.clear();
+}
+
+void MemoryTracking::EndTracking(Region *region)
+{
+}
@@ -653,6 +653,63 @@ int fclose(FILE *f)
   return ::fclose(f);
 }
 
+byte *MapFileRange(FILE *f, uint64_t offset, uint64_t length)
+{
+  if(f == NULL || length == 0)
+    return NULL;
+
+  HANDLE file = (HANDLE)::_get_osfhandle(::_fileno(f));
+
+  if(file == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  // don't map past the end of the file, touching those pages would fault rather than fail a read
+  LARGE_INTEGER fileSize = {};
+  if(!GetFileSizeEx(file, &fileSize) || offset + length > (uint64_t)fileSize.QuadPart)
+    return NULL;
+
+  SYSTEM_INFO sysInfo = {};
+  GetSystemInfo(&sysInfo);
+
+  // view offsets must be aligned to the allocation granularity, so map from there and skip the
+  // padding
+  const uint64_t padding = offset % sysInfo.dwAllocationGranularity;
+  const uint64_t alignedOffset = offset - padding;
+
+  if(length + padding > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+  if(mapping == NULL)
+    return NULL;
+
+  void *ptr = MapViewOfFile(mapping, FILE_MAP_COPY, DWORD(alignedOffset >> 32),
+                            DWORD(alignedOffset & 0xffffffff), SIZE_T(length + padding));
+
+  // the view keeps the mapping alive, we don't need the handle any more
+  CloseHandle(mapping);
+
+  if(ptr == NULL)
+  {
+    RDCWARN("Couldn't map %llu bytes of file: %u", length, GetLastError());
+    return NULL;
+  }
+
+  return (byte *)ptr + padding;
+}
+
+void UnmapFileRange(byte *data, uint64_t offset, uint64_t length)
+{
+  if(data == NULL)
+    return;
+
+  SYSTEM_INFO sysInfo = {};
+  GetSystemInfo(&sysInfo);
+
+  UnmapViewOfFile(data - (offset % sysInfo.dwAllocationGranularity));
+}
+
 LogFileHandle *logfile_open(const char *filename)
 {
   rdcwstr wfn = StringFormat::UTF82Wide(filename);
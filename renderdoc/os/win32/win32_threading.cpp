@@ -83,6 +83,16 @@ int32_t CmpExch32(int32_t *dest, int32_t oldVal, int32_t newVal)
 {
   return (int32_t)InterlockedCompareExchange((volatile LONG *)dest, newVal, oldVal);
 }
+
+int64_t CmpExch64(int64_t *dest, int64_t oldVal, int64_t newVal)
+{
+  return (int64_t)InterlockedCompareExchange64((volatile LONG64 *)dest, newVal, oldVal);
+}
+
+void *CmpExchPtr(void **dest, void *oldVal, void *newVal)
+{
+  return InterlockedCompareExchangePointer((volatile PVOID *)dest, newVal, oldVal);
+}
 };
 
 namespace Threading
@@ -151,6 +161,26 @@ void RWLock::ReadUnlock()
   ReleaseSRWLockShared(&m_Data);
 }
 
+Semaphore::SemaphoreTemplate()
+{
+  m_Data = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+}
+
+Semaphore::~SemaphoreTemplate()
+{
+  CloseHandle(m_Data);
+}
+
+void Semaphore::Acquire()
+{
+  WaitForSingleObject(m_Data, INFINITE);
+}
+
+void Semaphore::Release(uint32_t count)
+{
+  ReleaseSemaphore(m_Data, (LONG)count, NULL);
+}
+
 struct ThreadInitData
 {
   std::function<void()> entryFunc;
@@ -355,4 +385,11 @@ void Sleep(uint32_t milliseconds)
 {
   ::Sleep((DWORD)milliseconds);
 }
+
+uint32_t NumberOfCores()
+{
+  SYSTEM_INFO info = {};
+  GetSystemInfo(&info);
+  return RDCMAX(1U, (uint32_t)info.dwNumberOfProcessors);
+}
 };
@@ -471,7 +471,7 @@ ReplayStatus CaptureFile::Convert(const char *filename, const char *filetype, co
     }
 
     SectionProperties frameCapture;
-    frameCapture.flags = SectionFlags::ZstdCompressed;
+    frameCapture.flags = SectionFlags::ZstdCompressed | SectionFlags::BlockIndexed;
     frameCapture.type = SectionType::FrameCapture;
     frameCapture.name = ToStr(frameCapture.type);
     frameCapture.version = file->version;
@@ -490,9 +490,10 @@ ReplayStatus CaptureFile::Convert(const char *filename, const char *filetype, co
   }
   else
   {
-    // otherwise write it straight, but compress it to zstd
+    // otherwise write it straight, but compress it to zstd. Block-indexing allows seeking within
+    // the section without decompressing it all
     SectionProperties props = m_RDC->GetSectionProperties(frameCaptureIndex);
-    props.flags = SectionFlags::ZstdCompressed;
+    props.flags = SectionFlags::ZstdCompressed | SectionFlags::BlockIndexed;
 
     StreamWriter *writer = output.WriteSection(props);
     StreamReader *reader = m_RDC->ReadSection(frameCaptureIndex);
@@ -806,12 +807,11 @@ rdcarray<rdcstr> CaptureFile::GetResolve(const rdcarray<uint64_t> &callstack)
     return ret;
   }
 
-  ret.reserve(callstack.size());
-  for(uint64_t frame : callstack)
-  {
-    Callstack::AddressDetails info = m_Resolver->GetAddr(frame);
+  rdcarray<Callstack::AddressDetails> details = m_Resolver->GetAddrs(callstack);
+
+  ret.reserve(details.size());
+  for(Callstack::AddressDetails &info : details)
     ret.push_back(info.formattedString());
-  }
 
   return ret;
 }
@@ -1622,15 +1622,54 @@ rdcarray<ShaderDebugState> ReplayController::ContinueDebug(ShaderDebugger *debug
 
   rdcarray<ShaderDebugState> ret = m_pDevice->ContinueDebug(debugger);
 
+  auto it = m_DebugStates.find(debugger);
+  if(it != m_DebugStates.end())
+    it->second.Append(ret);
+
+  return ret;
+}
+
+rdcarray<ShaderDebugState> ReplayController::RunDebug(ShaderDebugger *debugger,
+                                                      const rdcarray<uint32_t> &breakpoints)
+{
+  CHECK_REPLAY_THREAD();
+
+  rdcarray<ShaderDebugState> ret = m_pDevice->RunDebug(debugger, breakpoints);
+
+  auto it = m_DebugStates.find(debugger);
+  if(it != m_DebugStates.end())
+    it->second.Append(ret);
+
   return ret;
 }
 
+void ReplayController::RecordDebugStates(ShaderDebugger *debugger)
+{
+  CHECK_REPLAY_THREAD();
+
+  if(debugger)
+    m_DebugStates[debugger];
+}
+
+rdcarray<ShaderDebugState> ReplayController::GetDebugStates(ShaderDebugger *debugger,
+                                                            uint32_t firstStep, uint32_t count)
+{
+  CHECK_REPLAY_THREAD();
+
+  auto it = m_DebugStates.find(debugger);
+  if(it == m_DebugStates.end())
+    return {};
+
+  return it->second.GetStates(firstStep, count);
+}
+
 void ReplayController::FreeTrace(ShaderDebugTrace *trace)
 {
   CHECK_REPLAY_THREAD();
 
   if(trace)
   {
+    m_DebugStates.erase(trace->debugger);
     m_pDevice->FreeDebugger(trace->debugger);
     delete trace;
   }
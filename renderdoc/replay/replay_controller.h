@@ -25,11 +25,13 @@
 
 #pragma once
 
+#include <map>
 #include <set>
 #include "api/replay/renderdoc_replay.h"
 #include "common/common.h"
 #include "core/core.h"
 #include "replay/replay_driver.h"
+#include "replay/shader_debug_store.h"
 
 #define CHECK_REPLAY_THREAD() RDCASSERT(Threading::GetCurrentID() == m_ThreadID);
 
@@ -189,6 +191,11 @@ public:
   ShaderDebugTrace *DebugPixel(uint32_t x, uint32_t y, uint32_t sample, uint32_t primitive);
   ShaderDebugTrace *DebugThread(const uint32_t groupid[3], const uint32_t threadid[3]);
   rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger);
+  rdcarray<ShaderDebugState> RunDebug(ShaderDebugger *debugger,
+                                      const rdcarray<uint32_t> &breakpoints);
+  void RecordDebugStates(ShaderDebugger *debugger);
+  rdcarray<ShaderDebugState> GetDebugStates(ShaderDebugger *debugger, uint32_t firstStep,
+                                            uint32_t count);
   void FreeTrace(ShaderDebugTrace *trace);
 
   MeshFormat GetPostVSData(uint32_t instID, uint32_t viewID, MeshDataStage stage);
@@ -257,5 +264,8 @@ private:
   std::set<ResourceId> m_TargetResources;
   std::set<ResourceId> m_CustomShaders;
 
+  // states returned for each shader debugger that is recording them, so they can be fetched again
+  std::map<ShaderDebugger *, ShaderDebugStateStore> m_DebugStates;
+
   friend struct ReplayOutput;
 };
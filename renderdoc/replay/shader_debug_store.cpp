@@ -0,0 +1,487 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "shader_debug_store.h"
+#include <algorithm>
+#include "common/common.h"
+
+namespace
+{
+// the flags stored before each change, saying how its before and after values are stored
+enum ChangeFlags
+{
+  BeforeNone = 0x0,
+  // the value is the current value of the variable with the same name, only the name is stored
+  BeforeCurrent = 0x1,
+  BeforeStored = 0x2,
+  BeforeMask = 0x3,
+
+  AfterNone = 0x0,
+  AfterSameAsBefore = 0x4,
+  AfterStored = 0x8,
+  AfterMask = 0xC,
+};
+
+// unsigned integers are stored 7 bits at a time, with the top bit set if more bytes follow
+void WriteUInt(bytebuf &buf, uint64_t val)
+{
+  while(val >= 0x80)
+  {
+    buf.push_back(byte(val & 0x7f) | 0x80);
+    val >>= 7;
+  }
+
+  buf.push_back(byte(val));
+}
+
+uint64_t ReadUInt(const byte *&cur)
+{
+  uint64_t ret = 0;
+
+  for(uint32_t shift = 0;; shift += 7)
+  {
+    byte b = *(cur++);
+    ret |= uint64_t(b & 0x7f) << shift;
+
+    if((b & 0x80) == 0)
+      return ret;
+  }
+}
+
+template <typename T>
+size_t CommonPrefix(const rdcarray<T> &a, const rdcarray<T> &b)
+{
+  size_t ret = 0;
+  while(ret < a.size() && ret < b.size() && a[ret] == b[ret])
+    ret++;
+  return ret;
+}
+
+// the number of debug variable references from start that refer to consecutive components of the
+// same variable
+size_t ComponentRun(const rdcarray<DebugVariableReference> &refs, size_t start)
+{
+  size_t end = start + 1;
+  while(end < refs.size() && refs[end].type == refs[start].type &&
+        refs[end].component == refs[end - 1].component + 1 && refs[end].name == refs[start].name)
+    end++;
+  return end - start;
+}
+};
+
+ShaderDebugStateStore::ShaderDebugStateStore(uint32_t keyframeInterval)
+    : m_KeyframeInterval(RDCMAX(1U, keyframeInterval))
+{
+}
+
+void ShaderDebugStateStore::Append(const rdcarray<ShaderDebugState> &states)
+{
+  for(const ShaderDebugState &state : states)
+  {
+    if(m_NumStates > 0 && state.stepIndex <= m_LastStep)
+      continue;
+
+    // if we skipped any steps, the variables we were tracking are no longer meaningful. Start again
+    // with a new keyframe
+    bool contiguous = (m_NumStates > 0 && state.stepIndex == m_LastStep + 1);
+
+    if(!contiguous)
+      m_Encode = Context();
+
+    if(!contiguous || m_Keyframes.back().numSteps >= m_KeyframeInterval)
+    {
+      Keyframe key;
+      key.firstStep = state.stepIndex;
+      key.numSteps = 0;
+      key.offset = m_Deltas.size();
+      EncodeContext(key.context, m_Encode);
+      m_Keyframes.push_back(key);
+    }
+
+    EncodeStep(m_Deltas, m_Encode, state);
+
+    m_Keyframes.back().numSteps++;
+    m_LastStep = state.stepIndex;
+    m_NumStates++;
+  }
+}
+
+rdcarray<ShaderDebugState> ShaderDebugStateStore::GetStates(uint32_t firstStep,
+                                                             uint32_t count) const
+{
+  rdcarray<ShaderDebugState> ret;
+
+  const uint64_t endStep = uint64_t(firstStep) + count;
+
+  // find the last keyframe starting at or before the first step
+  const Keyframe *it = std::upper_bound(
+      m_Keyframes.begin(), m_Keyframes.end(), firstStep,
+      [](uint32_t step, const Keyframe &key) { return step < key.firstStep; });
+
+  size_t k = it == m_Keyframes.begin() ? 0 : size_t(it - m_Keyframes.begin()) - 1;
+
+  for(; k < m_Keyframes.size() && m_Keyframes[k].firstStep < endStep; k++)
+  {
+    const Keyframe &key = m_Keyframes[k];
+
+    // skip keyframes that end before the first step
+    if(uint64_t(key.firstStep) + key.numSteps <= firstStep)
+      continue;
+
+    Context ctx;
+    const byte *cur = key.context.data();
+    DecodeContext(cur, ctx);
+
+    cur = m_Deltas.data() + key.offset;
+
+    for(uint32_t s = 0; s < key.numSteps; s++)
+    {
+      uint32_t step = key.firstStep + s;
+
+      if(step >= endStep)
+        break;
+
+      ShaderDebugState state;
+      DecodeStep(cur, ctx, state);
+
+      if(step >= firstStep)
+      {
+        state.stepIndex = step;
+        ret.push_back(state);
+      }
+    }
+  }
+
+  return ret;
+}
+
+size_t ShaderDebugStateStore::GetByteSize() const
+{
+  size_t ret = m_Deltas.size();
+  for(const Keyframe &key : m_Keyframes)
+    ret += key.context.size();
+  for(const rdcstr &str : m_Strings)
+    ret += str.size();
+  return ret;
+}
+
+uint32_t ShaderDebugStateStore::Intern(const rdcstr &str)
+{
+  auto it = m_StringLookup.find(str);
+  if(it != m_StringLookup.end())
+    return it->second;
+
+  uint32_t ret = (uint32_t)m_Strings.size();
+  m_Strings.push_back(str);
+  m_StringLookup[str] = ret;
+  return ret;
+}
+
+uint32_t ShaderDebugStateStore::EncodeVariable(bytebuf &buf, const ShaderVariable &var)
+{
+  uint32_t name = Intern(var.name);
+
+  WriteUInt(buf, name);
+  buf.push_back((byte)var.type);
+  buf.push_back(var.rows);
+  buf.push_back(var.columns);
+  buf.push_back(byte(var.displayAsHex ? 0x1 : 0x0) | byte(var.isStruct ? 0x2 : 0x0) |
+                byte(var.rowMajor ? 0x4 : 0x0));
+
+  // most values only use the first few components, only store up to the last non-zero byte
+  const byte *value = (const byte *)&var.value;
+  size_t valueSize = sizeof(var.value);
+  while(valueSize > 0 && value[valueSize - 1] == 0)
+    valueSize--;
+
+  WriteUInt(buf, valueSize);
+  buf.append(value, valueSize);
+
+  WriteUInt(buf, var.members.size());
+  for(const ShaderVariable &member : var.members)
+    EncodeVariable(buf, member);
+
+  return name;
+}
+
+uint32_t ShaderDebugStateStore::DecodeVariable(const byte *&cur, ShaderVariable &var) const
+{
+  uint32_t name = (uint32_t)ReadUInt(cur);
+
+  var.name = m_Strings[name];
+  var.type = (VarType)*(cur++);
+  var.rows = *(cur++);
+  var.columns = *(cur++);
+
+  byte bits = *(cur++);
+  var.displayAsHex = (bits & 0x1) != 0;
+  var.isStruct = (bits & 0x2) != 0;
+  var.rowMajor = (bits & 0x4) != 0;
+
+  size_t valueSize = (size_t)ReadUInt(cur);
+  memset(&var.value, 0, sizeof(var.value));
+  memcpy(&var.value, cur, valueSize);
+  cur += valueSize;
+
+  var.members.resize((size_t)ReadUInt(cur));
+  for(ShaderVariable &member : var.members)
+    DecodeVariable(cur, member);
+
+  return name;
+}
+
+void ShaderDebugStateStore::EncodeSourceVar(bytebuf &buf, const SourceVariableMapping &sourceVar)
+{
+  WriteUInt(buf, Intern(sourceVar.name));
+  buf.push_back((byte)sourceVar.type);
+  WriteUInt(buf, sourceVar.rows);
+  WriteUInt(buf, sourceVar.columns);
+  WriteUInt(buf, sourceVar.offset);
+  WriteUInt(buf, uint32_t(sourceVar.signatureIndex + 1));
+
+  // debug variables are referenced per-component, store them as runs of consecutive components
+  size_t numRuns = 0;
+  for(size_t i = 0; i < sourceVar.variables.size(); i += ComponentRun(sourceVar.variables, i))
+    numRuns++;
+
+  WriteUInt(buf, numRuns);
+
+  for(size_t i = 0; i < sourceVar.variables.size();)
+  {
+    const DebugVariableReference &ref = sourceVar.variables[i];
+    size_t run = ComponentRun(sourceVar.variables, i);
+
+    WriteUInt(buf, Intern(ref.name));
+    buf.push_back((byte)ref.type);
+    WriteUInt(buf, ref.component);
+    WriteUInt(buf, run);
+
+    i += run;
+  }
+}
+
+void ShaderDebugStateStore::DecodeSourceVar(const byte *&cur,
+                                            SourceVariableMapping &sourceVar) const
+{
+  sourceVar.name = m_Strings[(size_t)ReadUInt(cur)];
+  sourceVar.type = (VarType)*(cur++);
+  sourceVar.rows = (uint32_t)ReadUInt(cur);
+  sourceVar.columns = (uint32_t)ReadUInt(cur);
+  sourceVar.offset = (uint32_t)ReadUInt(cur);
+  sourceVar.signatureIndex = int32_t(uint32_t(ReadUInt(cur)) - 1);
+
+  size_t numRuns = (size_t)ReadUInt(cur);
+
+  sourceVar.variables.clear();
+  for(size_t r = 0; r < numRuns; r++)
+  {
+    DebugVariableReference ref;
+    ref.name = m_Strings[(size_t)ReadUInt(cur)];
+    ref.type = (DebugVariableType)*(cur++);
+    ref.component = (uint32_t)ReadUInt(cur);
+
+    size_t run = (size_t)ReadUInt(cur);
+    for(size_t i = 0; i < run; i++)
+    {
+      sourceVar.variables.push_back(ref);
+      ref.component++;
+    }
+  }
+}
+
+void ShaderDebugStateStore::EncodeContext(bytebuf &buf, const Context &ctx)
+{
+  WriteUInt(buf, ctx.variables.size());
+  for(auto it = ctx.variables.begin(); it != ctx.variables.end(); ++it)
+    EncodeVariable(buf, it->second);
+
+  WriteUInt(buf, ctx.sourceVars.size());
+  for(const SourceVariableMapping &sourceVar : ctx.sourceVars)
+    EncodeSourceVar(buf, sourceVar);
+
+  WriteUInt(buf, ctx.callstack.size());
+  for(const rdcstr &func : ctx.callstack)
+    WriteUInt(buf, Intern(func));
+}
+
+void ShaderDebugStateStore::DecodeContext(const byte *&cur, Context &ctx) const
+{
+  size_t numVariables = (size_t)ReadUInt(cur);
+  for(size_t i = 0; i < numVariables; i++)
+  {
+    ShaderVariable var;
+    uint32_t name = DecodeVariable(cur, var);
+    ctx.variables[name] = var;
+  }
+
+  ctx.sourceVars.resize((size_t)ReadUInt(cur));
+  for(SourceVariableMapping &sourceVar : ctx.sourceVars)
+    DecodeSourceVar(cur, sourceVar);
+
+  ctx.callstack.resize((size_t)ReadUInt(cur));
+  for(rdcstr &func : ctx.callstack)
+    func = m_Strings[(size_t)ReadUInt(cur)];
+}
+
+void ShaderDebugStateStore::EncodeStep(bytebuf &buf, Context &ctx, const ShaderDebugState &state)
+{
+  WriteUInt(buf, state.nextInstruction);
+  WriteUInt(buf, (uint32_t)state.flags);
+
+  // source variables and the callstack mostly change at the end, if at all. Store how much is the
+  // same as the previous step and then anything after that.
+  size_t prefix = CommonPrefix(ctx.sourceVars, state.sourceVars);
+  WriteUInt(buf, prefix);
+  WriteUInt(buf, state.sourceVars.size() - prefix);
+
+  ctx.sourceVars.resize(prefix);
+  for(size_t i = prefix; i < state.sourceVars.size(); i++)
+  {
+    EncodeSourceVar(buf, state.sourceVars[i]);
+    ctx.sourceVars.push_back(state.sourceVars[i]);
+  }
+
+  prefix = CommonPrefix(ctx.callstack, state.callstack);
+  WriteUInt(buf, prefix);
+  WriteUInt(buf, state.callstack.size() - prefix);
+
+  ctx.callstack.resize(prefix);
+  for(size_t i = prefix; i < state.callstack.size(); i++)
+  {
+    WriteUInt(buf, Intern(state.callstack[i]));
+    ctx.callstack.push_back(state.callstack[i]);
+  }
+
+  // a before value is almost always the variable's current value, which we don't need to store.
+  // Likewise the after value is often the same as the before value for no-op changes.
+  static const ShaderVariable empty;
+
+  WriteUInt(buf, state.changes.size());
+  for(const ShaderVariableChange &change : state.changes)
+  {
+    size_t flagsOffset = buf.size();
+    buf.push_back(0);
+
+    byte flags = 0;
+    uint32_t beforeName = 0;
+
+    if(!change.before.name.empty())
+    {
+      beforeName = Intern(change.before.name);
+
+      auto it = ctx.variables.find(beforeName);
+      if(it != ctx.variables.end() && it->second == change.before)
+      {
+        flags |= BeforeCurrent;
+        WriteUInt(buf, beforeName);
+      }
+    }
+
+    if(flags == 0 && !(change.before == empty))
+    {
+      flags |= BeforeStored;
+      EncodeVariable(buf, change.before);
+    }
+
+    if(change.after == empty)
+    {
+      flags |= AfterNone;
+    }
+    else if(change.after == change.before)
+    {
+      flags |= AfterSameAsBefore;
+    }
+    else
+    {
+      flags |= AfterStored;
+      EncodeVariable(buf, change.after);
+    }
+
+    buf[flagsOffset] = flags;
+
+    // apply the change the same way a client stepping forward would
+    if(!change.after.name.empty())
+      ctx.variables[Intern(change.after.name)] = change.after;
+    else if(!change.before.name.empty())
+      ctx.variables.erase(beforeName);
+  }
+}
+
+void ShaderDebugStateStore::DecodeStep(const byte *&cur, Context &ctx,
+                                       ShaderDebugState &state) const
+{
+  state.nextInstruction = (uint32_t)ReadUInt(cur);
+  state.flags = (ShaderEvents)ReadUInt(cur);
+
+  size_t prefix = (size_t)ReadUInt(cur);
+  size_t count = (size_t)ReadUInt(cur);
+
+  ctx.sourceVars.resize(prefix + count);
+  for(size_t i = prefix; i < prefix + count; i++)
+    DecodeSourceVar(cur, ctx.sourceVars[i]);
+
+  state.sourceVars = ctx.sourceVars;
+
+  prefix = (size_t)ReadUInt(cur);
+  count = (size_t)ReadUInt(cur);
+
+  ctx.callstack.resize(prefix + count);
+  for(size_t i = prefix; i < prefix + count; i++)
+    ctx.callstack[i] = m_Strings[(size_t)ReadUInt(cur)];
+
+  state.callstack = ctx.callstack;
+
+  state.changes.resize((size_t)ReadUInt(cur));
+  for(ShaderVariableChange &change : state.changes)
+  {
+    byte flags = *(cur++);
+
+    uint32_t beforeName = 0, afterName = 0;
+
+    if((flags & BeforeMask) == BeforeCurrent)
+    {
+      beforeName = (uint32_t)ReadUInt(cur);
+      change.before = ctx.variables[beforeName];
+    }
+    else if((flags & BeforeMask) == BeforeStored)
+    {
+      beforeName = DecodeVariable(cur, change.before);
+    }
+
+    if((flags & AfterMask) == AfterSameAsBefore)
+    {
+      change.after = change.before;
+      afterName = beforeName;
+    }
+    else if((flags & AfterMask) == AfterStored)
+    {
+      afterName = DecodeVariable(cur, change.after);
+    }
+
+    if(!change.after.name.empty())
+      ctx.variables[afterName] = change.after;
+    else if(!change.before.name.empty())
+      ctx.variables.erase(beforeName);
+  }
+}
@@ -0,0 +1,101 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include "api/replay/rdcarray.h"
+#include "api/replay/shader_types.h"
+
+// Stores the states of a shader debug trace compactly, and rebuilds any of them on demand.
+//
+// Each state is encoded as a binary delta against the states before it. A change only stores the
+// values that can't be recovered from the running set of variables, and source variables and the
+// callstack only store what differs from the previous state. Every few steps a keyframe stores the
+// running set of variables in full, so any state can be rebuilt by decoding forward from the
+// keyframe before it. Fetching a state costs at most one keyframe interval of decoding, however
+// long the trace is.
+class ShaderDebugStateStore
+{
+public:
+  ShaderDebugStateStore(uint32_t keyframeInterval = 64);
+
+  // add states in step order. Steps don't have to be contiguous, e.g. if the debugger ran ahead
+  // without returning states, but any state at or before the last one added is ignored.
+  void Append(const rdcarray<ShaderDebugState> &states);
+
+  // rebuild up to count states starting from firstStep. Steps that were never added are skipped.
+  rdcarray<ShaderDebugState> GetStates(uint32_t firstStep, uint32_t count) const;
+
+  uint32_t GetNumStates() const { return m_NumStates; }
+  // the number of bytes used by encoded states and keyframes
+  size_t GetByteSize() const;
+
+private:
+  // the state needed to encode or decode the next step
+  struct Context
+  {
+    // every current variable, by the index of its name
+    std::map<uint32_t, ShaderVariable> variables;
+    rdcarray<SourceVariableMapping> sourceVars;
+    rdcarray<rdcstr> callstack;
+  };
+
+  struct Keyframe
+  {
+    uint32_t firstStep;
+    uint32_t numSteps;
+    // offset in m_Deltas of the first step
+    size_t offset;
+    // the encoded context before the first step
+    bytebuf context;
+  };
+
+  uint32_t Intern(const rdcstr &str);
+
+  // variables are encoded and decoded along with their name's index
+  uint32_t EncodeVariable(bytebuf &buf, const ShaderVariable &var);
+  void EncodeSourceVar(bytebuf &buf, const SourceVariableMapping &sourceVar);
+  void EncodeContext(bytebuf &buf, const Context &ctx);
+  void EncodeStep(bytebuf &buf, Context &ctx, const ShaderDebugState &state);
+
+  uint32_t DecodeVariable(const byte *&cur, ShaderVariable &var) const;
+  void DecodeSourceVar(const byte *&cur, SourceVariableMapping &sourceVar) const;
+  void DecodeContext(const byte *&cur, Context &ctx) const;
+  void DecodeStep(const byte *&cur, Context &ctx, ShaderDebugState &state) const;
+
+  uint32_t m_KeyframeInterval;
+
+  // all names and strings are stored once and referenced by index
+  rdcarray<rdcstr> m_Strings;
+  std::map<rdcstr, uint32_t> m_StringLookup;
+
+  rdcarray<Keyframe> m_Keyframes;
+  bytebuf m_Deltas;
+
+  // the context after the last step added
+  Context m_Encode;
+  uint32_t m_LastStep = 0;
+  uint32_t m_NumStates = 0;
+};
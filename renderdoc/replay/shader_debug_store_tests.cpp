@@ -0,0 +1,239 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/globalconfig.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "common/common.h"
+#include "common/formatting.h"
+#include "shader_debug_store.h"
+
+#include "catch/catch.hpp"
+
+namespace
+{
+ShaderVariable MakeVar(uint32_t idx, uint32_t value)
+{
+  ShaderVariable ret(StringFormat::Fmt("var%u", idx), value, value * 2, 0U, 0U);
+  ret.columns = uint8_t(1 + (value % 4));
+  return ret;
+}
+
+SourceVariableMapping MakeSourceVar(uint32_t idx, uint32_t components)
+{
+  SourceVariableMapping ret;
+  ret.name = StringFormat::Fmt("source%u", idx);
+  ret.type = VarType::UInt;
+  ret.rows = 1;
+  ret.columns = components;
+  ret.offset = 0;
+  for(uint32_t c = 0; c < components; c++)
+    ret.variables.push_back(
+        DebugVariableReference(DebugVariableType::Variable, StringFormat::Fmt("var%u", idx), c));
+  return ret;
+}
+
+// generates a trace shaped like a real one - variables coming into and out of existence and being
+// modified, with no-op changes, callstack pushes and pops, and source variables added and removed
+rdcarray<ShaderDebugState> MakeTrace(uint32_t numSteps)
+{
+  rdcarray<ShaderDebugState> ret;
+
+  rdcarray<ShaderVariable> live;
+  rdcarray<SourceVariableMapping> sourceVars;
+  rdcarray<rdcstr> callstack = {"main"};
+
+  uint32_t rand = 12345;
+  auto next = [&rand]() {
+    rand = rand * 1103515245U + 12345U;
+    return (rand >> 16) & 0x7fff;
+  };
+
+  for(uint32_t step = 0; step < numSteps; step++)
+  {
+    ShaderDebugState state;
+    state.stepIndex = step;
+    state.nextInstruction = next() % 200;
+    if(next() % 50 == 0)
+      state.flags = ShaderEvents::GeneratedNanOrInf;
+
+    uint32_t numChanges = next() % 4;
+    for(uint32_t c = 0; c < numChanges; c++)
+    {
+      uint32_t op = next() % 10;
+      ShaderVariableChange change;
+
+      if(live.empty() || op < 3)
+      {
+        // a new variable
+        change.after = MakeVar(next() % 1000, next());
+        if(next() % 8 == 0)
+        {
+          change.after.members.push_back(MakeVar(next() % 10, next()));
+          change.after.isStruct = true;
+        }
+        live.push_back(change.after);
+
+        if(next() % 2)
+          sourceVars.push_back(MakeSourceVar(next() % 1000, 1 + next() % 4));
+      }
+      else
+      {
+        size_t idx = next() % live.size();
+        change.before = live[idx];
+
+        if(op == 3)
+        {
+          // a variable going away
+          live.erase(idx);
+        }
+        else if(op == 4)
+        {
+          // a no-op change
+          change.after = change.before;
+        }
+        else if(op == 5)
+        {
+          // a before value that isn't the last value seen, which has to be stored
+          change.before.value.u.w++;
+          change.after = MakeVar(0, next());
+          change.after.name = change.before.name;
+          live[idx] = change.after;
+        }
+        else
+        {
+          change.after = live[idx];
+          change.after.value.u.x = next();
+          live[idx] = change.after;
+        }
+      }
+
+      state.changes.push_back(change);
+    }
+
+    if(!sourceVars.empty() && next() % 10 == 0)
+      sourceVars.erase(next() % sourceVars.size());
+
+    if(next() % 30 == 0)
+      callstack.push_back(StringFormat::Fmt("func%u", next() % 5));
+    else if(callstack.size() > 1 && next() % 30 == 0)
+      callstack.pop_back();
+
+    state.sourceVars = sourceVars;
+    state.callstack = callstack;
+
+    ret.push_back(state);
+  }
+
+  return ret;
+}
+
+void CheckStates(const rdcarray<ShaderDebugState> &actual, const ShaderDebugState *expected,
+                 size_t count)
+{
+  REQUIRE(actual.size() == count);
+
+  for(size_t i = 0; i < count; i++)
+  {
+    bool same = (actual[i] == expected[i]);
+    CHECK(same);
+    CHECK(actual[i].callstack == expected[i].callstack);
+  }
+}
+};
+
+TEST_CASE("Shader debug state storage", "[shaderdebug]")
+{
+  const uint32_t numSteps = 2000;
+  rdcarray<ShaderDebugState> trace = MakeTrace(numSteps);
+
+  SECTION("States are rebuilt exactly from any point")
+  {
+    ShaderDebugStateStore store(16);
+
+    // add in chunks the way they come back from ContinueDebug
+    for(uint32_t i = 0; i < numSteps; i += 100)
+    {
+      rdcarray<ShaderDebugState> chunk;
+      chunk.append(trace.data() + i, RDCMIN(100U, numSteps - i));
+      store.Append(chunk);
+    }
+
+    CHECK(store.GetNumStates() == numSteps);
+
+    CheckStates(store.GetStates(0, numSteps), trace.data(), numSteps);
+
+    for(uint32_t step : {0U, 1U, 15U, 16U, 17U, 500U, 1023U, 1999U})
+      CheckStates(store.GetStates(step, 1), trace.data() + step, 1);
+
+    CheckStates(store.GetStates(90, 50), trace.data() + 90, 50);
+
+    // ranges past the end are clipped
+    CheckStates(store.GetStates(1990, 100), trace.data() + 1990, 10);
+    CHECK(store.GetStates(numSteps, 1).empty());
+    CHECK(store.GetStates(~0U, ~0U).empty());
+
+    // adding states that are already stored does nothing
+    store.Append({trace[5]});
+    CHECK(store.GetNumStates() == numSteps);
+
+    size_t fullSize = 0;
+    for(const ShaderDebugState &state : trace)
+      fullSize += state.changes.size() * sizeof(ShaderVariableChange) +
+                  state.sourceVars.size() * sizeof(SourceVariableMapping);
+
+    CHECK(store.GetByteSize() < fullSize / 10);
+  };
+
+  SECTION("Steps skipped over are omitted")
+  {
+    ShaderDebugStateStore store(16);
+
+    store.Append({trace.data(), 10});
+
+    // jump ahead like RunDebug, with a state listing every variable
+    ShaderDebugState snapshot = trace[500];
+    snapshot.changes.clear();
+    for(const ShaderVariableChange &change : trace[499].changes)
+      if(!change.after.name.empty())
+        snapshot.changes.push_back({ShaderVariable(), change.after});
+
+    store.Append({snapshot});
+    store.Append({trace.data() + 501, 40});
+
+    CHECK(store.GetNumStates() == 51);
+
+    rdcarray<ShaderDebugState> states = store.GetStates(0, numSteps);
+    REQUIRE(states.size() == 51);
+    CheckStates({states.data(), 10}, trace.data(), 10);
+    CheckStates({states.data() + 10, 1}, &snapshot, 1);
+    CheckStates({states.data() + 11, 40}, trace.data() + 501, 40);
+
+    CHECK(store.GetStates(10, 490).empty());
+    CheckStates(store.GetStates(505, 1), trace.data() + 505, 1);
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -0,0 +1,757 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <algorithm>
+#include <functional>
+#include "api/replay/renderdoc_replay.h"
+#include "common/common.h"
+#include "common/formatting.h"
+#include "common/timing.h"
+#include "os/os_specific.h"
+#include "strings/string_utils.h"
+#include "lz4io.h"
+#include "parallelio.h"
+#include "rdcfile.h"
+#include "serialiser.h"
+#include "streamio.h"
+#include "zstdio.h"
+
+// The micro-benchmarks are developer tooling alongside the unit tests, so they're only compiled in
+// when those are.
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+struct BenchmarkResult
+{
+  rdcstr name;
+  uint32_t iterations = 0;
+  // bytes processed per iteration, used to calculate throughput
+  uint64_t bytes = 0;
+  // bytes produced per iteration, for benchmarks where that's interesting (e.g. compressed size)
+  uint64_t outputBytes = 0;
+  double minMS = 0.0;
+  double medianMS = 0.0;
+  double meanMS = 0.0;
+};
+
+struct BenchmarkContext
+{
+  rdcstr filter;
+  rdcstr capture;
+  rdcstr jsonPath;
+  double minTime = 250.0;
+  uint32_t minIterations = 3;
+  bool list = false;
+
+  rdcarray<BenchmarkResult> results;
+
+  bool Matches(const rdcstr &name) const { return filter.empty() || name.contains(filter); }
+  // run func repeatedly until it's been run at least minIterations times and for at least minTime
+  // milliseconds in total. If set, setup is called before each iteration outside of the timing.
+  void Run(const rdcstr &name, uint64_t bytes, std::function<void()> func,
+           std::function<void()> setup = std::function<void()>(), uint64_t outputBytes = 0);
+};
+
+void BenchmarkContext::Run(const rdcstr &name, uint64_t bytes, std::function<void()> func,
+                           std::function<void()> setup, uint64_t outputBytes)
+{
+  if(!Matches(name))
+    return;
+
+  if(list)
+  {
+    OSUtility::WriteOutput(OSUtility::Output_StdOut, (name + "\n").c_str());
+    return;
+  }
+
+  rdcarray<double> times;
+  double total = 0.0;
+
+  // one untimed warm-up iteration, so that we're not measuring first-touch page faults and
+  // allocator growth
+  if(setup)
+    setup();
+  func();
+
+  PerformanceTimer timer;
+
+  while(times.size() < minIterations || total < minTime)
+  {
+    if(setup)
+      setup();
+
+    timer.Restart();
+    func();
+    double ms = timer.GetMilliseconds();
+
+    times.push_back(ms);
+    total += ms;
+  }
+
+  std::sort(times.begin(), times.end());
+
+  BenchmarkResult result;
+  result.name = name;
+  result.iterations = (uint32_t)times.size();
+  result.bytes = bytes;
+  result.outputBytes = outputBytes;
+  result.minMS = times[0];
+  result.medianMS = times[times.size() / 2];
+  result.meanMS = total / double(times.size());
+
+  rdcstr line = StringFormat::Fmt("%-44s %6u iters  min %9.3f ms  median %9.3f ms  mean %9.3f ms",
+                                  name.c_str(), result.iterations, result.minMS, result.medianMS,
+                                  result.meanMS);
+  if(bytes > 0 && result.medianMS > 0.0)
+    line += StringFormat::Fmt("  %9.1f MB/s", double(bytes) / (result.medianMS * 1000.0));
+  if(outputBytes > 0 && bytes > 0)
+    line += StringFormat::Fmt("  ratio %.3f", double(outputBytes) / double(bytes));
+  line += "\n";
+
+  // don't interleave the human-readable results with JSON on stdout
+  if(jsonPath != "-")
+    OSUtility::WriteOutput(OSUtility::Output_StdOut, line.c_str());
+
+  results.push_back(result);
+}
+
+// a simple deterministic generator, so that results are comparable between runs and machines
+struct BenchmarkRandom
+{
+  uint32_t state = 0x12345678U;
+  uint32_t Next()
+  {
+    state = state * 1664525U + 1013904223U;
+    return state >> 8;
+  }
+};
+
+static const uint32_t SyntheticChunkID = (uint32_t)SystemChunk::FirstDriverChunk;
+static const uint32_t SyntheticChunkCount = 4096;
+static const uint64_t SyntheticContentsSize = 4096;
+
+// fill a buffer with data that's roughly representative of captured resource contents - part of it
+// regular vertex-like data that compresses well, part of it noise that doesn't.
+static void FillContents(byte *data, uint64_t size, BenchmarkRandom &rng)
+{
+  float *f = (float *)data;
+  for(uint64_t i = 0; i < size / 2 / sizeof(float); i++)
+    f[i] = float(i % 64) * 0.25f + float(i / 64);
+
+  for(uint64_t i = size / 2; i < size; i++)
+    data[i] = byte(rng.Next() & 0x3f);
+}
+
+// a chunk with a mix of the kinds of elements a driver chunk contains, so serialisation costs
+// are spread across strings, arrays, fixed-size arrays and byte buffers like a real capture.
+template <typename SerialiserType>
+static void SerialiseSyntheticChunk(SerialiserType &ser, uint32_t idx, byte *contents)
+{
+  uint64_t resourceId = 0;
+  uint32_t flags = 0;
+  rdcstr name;
+  float transform[16] = {};
+  rdcarray<uint32_t> indices;
+
+  if(ser.IsWriting())
+  {
+    resourceId = 1000 + idx;
+    flags = idx * 7;
+    name = StringFormat::Fmt("Resource %u", idx);
+    for(uint32_t i = 0; i < 16; i++)
+      transform[i] = float(idx + i) * 0.5f;
+    indices.resize(64);
+    for(uint32_t i = 0; i < 64; i++)
+      indices[i] = idx * 3 + i;
+  }
+
+  SERIALISE_ELEMENT(resourceId);
+  SERIALISE_ELEMENT(flags);
+  SERIALISE_ELEMENT(name);
+  SERIALISE_ELEMENT(transform);
+  SERIALISE_ELEMENT(indices);
+  ser.Serialise("Contents"_lit, contents, SyntheticContentsSize, SerialiserFlags::NoFlags);
+}
+
+static void WriteSyntheticChunks(WriteSerialiser &ser, const bytebuf &contents)
+{
+  for(uint32_t i = 0; i < SyntheticChunkCount; i++)
+  {
+    byte *data = (byte *)contents.data() + (i % 16) * SyntheticContentsSize;
+    ser.WriteChunk(SyntheticChunkID);
+    SerialiseSyntheticChunk(ser, i, data);
+    ser.EndChunk();
+  }
+}
+
+static void ReadSyntheticChunks(ReadSerialiser &ser, byte *scratch)
+{
+  for(uint32_t i = 0; i < SyntheticChunkCount; i++)
+  {
+    ser.ReadChunk<uint32_t>();
+    SerialiseSyntheticChunk(ser, i, scratch);
+    ser.EndChunk();
+  }
+}
+
+static void BenchmarkSerialiser(BenchmarkContext &ctx, const bytebuf &contents,
+                                const bytebuf &stream)
+{
+  StreamWriter *writer = new StreamWriter(stream.size() + 1024);
+
+  ctx.Run("serialise/write/synthetic", stream.size(), [&]() {
+    writer->Rewind();
+    WriteSerialiser ser(writer, Ownership::Nothing);
+    WriteSyntheticChunks(ser, contents);
+  });
+
+  delete writer;
+
+  ctx.Run("serialise/write/synthetic-lz4", stream.size(), [&]() {
+    StreamWriter *compressed = new StreamWriter(stream.size());
+    WriteSerialiser ser(
+        new StreamWriter(new LZ4Compressor(compressed, Ownership::Stream), Ownership::Stream),
+        Ownership::Stream);
+    WriteSyntheticChunks(ser, contents);
+  });
+
+  bytebuf scratch;
+  scratch.resize((size_t)SyntheticContentsSize);
+
+  ctx.Run("serialise/read/synthetic", stream.size(), [&]() {
+    ReadSerialiser ser(new StreamReader(stream), Ownership::Stream);
+    ReadSyntheticChunks(ser, scratch.data());
+  });
+
+  ChunkLookup lookup = [](uint32_t) -> rdcstr { return "SyntheticChunk"; };
+
+  // reading with structured export includes building the SDFile, but its destruction is measured
+  // separately below.
+  SDFile *structured = NULL;
+
+  ctx.Run("serialise/read/synthetic-structured", stream.size(),
+          [&]() {
+            ReadSerialiser ser(new StreamReader(stream), Ownership::Stream);
+            ser.ConfigureStructuredExport(lookup, true, 0, 1.0);
+            ReadSyntheticChunks(ser, scratch.data());
+            structured->Swap(ser.GetStructuredFile());
+          },
+          [&]() {
+            delete structured;
+            structured = new SDFile;
+          });
+
+  delete structured;
+  structured = NULL;
+
+  ctx.Run("sdfile/destroy", stream.size(), [&]() { delete structured; },
+          [&]() {
+            ReadSerialiser ser(new StreamReader(stream), Ownership::Stream);
+            ser.ConfigureStructuredExport(lookup, true, 0, 1.0);
+            ReadSyntheticChunks(ser, scratch.data());
+            structured = new SDFile;
+            structured->Swap(ser.GetStructuredFile());
+          });
+
+  ctx.Run("sdfile/destroy-no-buffers", stream.size(), [&]() { delete structured; },
+          [&]() {
+            ReadSerialiser ser(new StreamReader(stream), Ownership::Stream);
+            ser.ConfigureStructuredExport(lookup, false, 0, 1.0);
+            ReadSyntheticChunks(ser, scratch.data());
+            structured = new SDFile;
+            structured->Swap(ser.GetStructuredFile());
+          });
+}
+
+static void ReadAll(StreamReader &reader, bytebuf &out, uint64_t readSize)
+{
+  const uint64_t size = out.size();
+  for(uint64_t offs = 0; offs < size; offs += readSize)
+    reader.Read(out.data() + offs, RDCMIN(readSize, size - offs));
+}
+
+static void WriteAll(StreamWriter &writer, const bytebuf &data, uint64_t writeSize)
+{
+  const uint64_t size = data.size();
+  for(uint64_t offs = 0; offs < size; offs += writeSize)
+    writer.Write(data.data() + offs, RDCMIN(writeSize, size - offs));
+}
+
+enum class CompressionMethod
+{
+  LZ4,
+  Zstd,
+  ParallelLZ4,
+  ParallelZstd,
+};
+
+// the compressor doesn't take ownership of writer, so the output can be retrieved afterwards
+static Compressor *MakeCompressor(StreamWriter *writer, CompressionMethod method, bool blockIndexed)
+{
+  SectionFlags indexFlag = blockIndexed ? SectionFlags::BlockIndexed : SectionFlags::NoFlags;
+
+  switch(method)
+  {
+    case CompressionMethod::LZ4:
+      return new LZ4Compressor(writer, Ownership::Nothing, blockIndexed);
+    case CompressionMethod::Zstd:
+      return new ZSTDCompressor(writer, Ownership::Nothing, blockIndexed);
+    case CompressionMethod::ParallelLZ4:
+      return new ParallelCompressor(writer, Ownership::Nothing,
+                                    SectionFlags::LZ4Compressed | indexFlag);
+    case CompressionMethod::ParallelZstd:
+      return new ParallelCompressor(writer, Ownership::Nothing,
+                                    SectionFlags::ZstdCompressed | indexFlag);
+  }
+
+  return NULL;
+}
+
+static bytebuf Compress(const bytebuf &data, CompressionMethod method, bool blockIndexed,
+                        uint64_t writeSize)
+{
+  StreamWriter *compressed = new StreamWriter(data.size() / 2);
+
+  {
+    StreamWriter writer(MakeCompressor(compressed, method, blockIndexed), Ownership::Stream);
+
+    WriteAll(writer, data, writeSize);
+
+    writer.Finish();
+  }
+
+  bytebuf ret;
+  ret.assign(compressed->GetData(), (size_t)compressed->GetOffset());
+  delete compressed;
+
+  return ret;
+}
+
+static void Decompress(const bytebuf &compressed, bytebuf &out, bool zstd, bool blockIndexed,
+                uint64_t readSize)
+{
+  StreamReader *source = new StreamReader(compressed.data(), compressed.size());
+  Decompressor *decompressor = NULL;
+  if(zstd)
+    decompressor = new ZSTDDecompressor(source, Ownership::Stream, blockIndexed);
+  else
+    decompressor = new LZ4Decompressor(source, Ownership::Stream, blockIndexed);
+
+  StreamReader reader(decompressor, out.size(), Ownership::Stream);
+
+  ReadAll(reader, out, readSize);
+}
+
+static void BenchmarkCompression(BenchmarkContext &ctx, const bytebuf &data)
+{
+  // block sizes are fixed by the on-disk formats, so what varies here is the size of the writes
+  // and reads the compressors see, and whether a block index is maintained.
+  const uint64_t writeSizes[] = {256, 16 * 1024, 1024 * 1024};
+
+  struct
+  {
+    const char *name;
+    CompressionMethod method;
+    bool zstd;
+  } methods[] = {
+      {"lz4", CompressionMethod::LZ4, false},
+      {"zstd", CompressionMethod::Zstd, true},
+      {"parallel-lz4", CompressionMethod::ParallelLZ4, false},
+      {"parallel-zstd", CompressionMethod::ParallelZstd, true},
+  };
+
+  bytebuf out;
+  out.resize(data.size());
+
+  for(const auto &m : methods)
+  {
+    for(bool blockIndexed : {false, true})
+    {
+      rdcstr variant = m.name;
+      if(blockIndexed)
+        variant += "-indexed";
+
+      for(uint64_t writeSize : writeSizes)
+      {
+        rdcstr name = StringFormat::Fmt("compress/%s/write-%llu", variant.c_str(), writeSize);
+
+        // only compute the ratio when we're going to run it, it costs a full compression
+        uint64_t compressedSize = 0;
+        if(ctx.Matches(name) && !ctx.list)
+          compressedSize = Compress(data, m.method, blockIndexed, writeSize).size();
+
+        ctx.Run(name, data.size(), [&]() { Compress(data, m.method, blockIndexed, writeSize); },
+                std::function<void()>(), compressedSize);
+      }
+
+      // the parallel compressors produce the same format, so decompressing them only differs in
+      // ratio.
+      if(m.method == CompressionMethod::ParallelLZ4 || m.method == CompressionMethod::ParallelZstd)
+        continue;
+
+      bytebuf compressed;
+
+      for(uint64_t readSize : writeSizes)
+      {
+        rdcstr name = StringFormat::Fmt("decompress/%s/read-%llu", variant.c_str(), readSize);
+
+        if(compressed.empty() && ctx.Matches(name) && !ctx.list)
+          compressed = Compress(data, m.method, blockIndexed, 1024 * 1024);
+
+        ctx.Run(name, data.size(),
+                [&]() { Decompress(compressed, out, m.zstd, blockIndexed, readSize); });
+      }
+    }
+  }
+}
+
+static void BenchmarkStreams(BenchmarkContext &ctx, const bytebuf &data)
+{
+  const uint64_t readSize = 64 * 1024;
+
+  bytebuf out;
+  out.resize(data.size());
+
+  ctx.Run("streamio/read/memory", data.size(), [&]() {
+    StreamReader reader(data.data(), data.size());
+    ReadAll(reader, out, readSize);
+  });
+
+  ctx.Run("streamio/write/memory", data.size(), [&]() {
+    StreamWriter writer(StreamWriter::DefaultScratchSize);
+    WriteAll(writer, data, readSize);
+  });
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/renderdoc_benchmark_stream.bin";
+
+  ctx.Run("streamio/write/file", data.size(), [&]() {
+    FILE *f = FileIO::fopen(filename.c_str(), "wb");
+    if(!f)
+      return;
+    StreamWriter writer(f, Ownership::Stream);
+    WriteAll(writer, data, readSize);
+  });
+
+  if(ctx.Matches("streamio/read/file") && !ctx.list)
+  {
+    FILE *f = FileIO::fopen(filename.c_str(), "wb");
+    if(f)
+    {
+      FileIO::fwrite(data.data(), 1, data.size(), f);
+      FileIO::fclose(f);
+    }
+  }
+
+  // this mostly measures reading from the OS file cache, since the file was just written
+  ctx.Run("streamio/read/file", data.size(), [&]() {
+    FILE *f = FileIO::fopen(filename.c_str(), "rb");
+    if(!f)
+      return;
+    StreamReader reader(f, data.size(), Ownership::Stream);
+    ReadAll(reader, out, readSize);
+  });
+
+  FileIO::Delete(filename.c_str());
+
+  if(!ctx.Matches("streamio/read/socket"))
+    return;
+
+  if(ctx.list)
+  {
+    ctx.Run("streamio/read/socket", data.size(), []() {});
+    return;
+  }
+
+  uint16_t port = 8235;
+  Network::Socket *server = NULL;
+
+  for(uint16_t probe = 0; probe < 20; probe++)
+  {
+    server = Network::CreateServerSocket("localhost", port, 2);
+
+    if(server)
+      break;
+
+    port++;
+  }
+
+  Network::Socket *sender = server ? Network::CreateClientSocket("localhost", port, 10) : NULL;
+  Network::Socket *receiver = sender ? server->AcceptClient(250) : NULL;
+
+  if(receiver)
+  {
+    StreamWriter writer(sender, Ownership::Nothing);
+    StreamReader reader(receiver, Ownership::Nothing);
+
+    // sending has to be on another thread since both ends block
+    ctx.Run("streamio/read/socket", data.size(), [&]() {
+      Threading::ThreadHandle sendThread = Threading::CreateThread([&]() {
+        WriteAll(writer, data, readSize);
+        writer.Flush();
+      });
+
+      ReadAll(reader, out, readSize);
+
+      Threading::JoinThread(sendThread);
+      Threading::CloseThread(sendThread);
+    });
+  }
+  else
+  {
+    OSUtility::WriteOutput(OSUtility::Output_StdErr,
+                           "Couldn't create local socket pair, skipping socket benchmark\n");
+  }
+
+  SAFE_DELETE(receiver);
+  SAFE_DELETE(sender);
+  SAFE_DELETE(server);
+}
+
+static void BenchmarkCapture(BenchmarkContext &ctx)
+{
+  if(ctx.capture.empty())
+    return;
+
+  rdcstr filename = get_basename(ctx.capture);
+
+  RDCFile *rdc = new RDCFile;
+  rdc->Open(ctx.capture.c_str());
+
+  if(rdc->ErrorCode() != ContainerError::NoError)
+  {
+    OSUtility::WriteOutput(OSUtility::Output_StdErr,
+                           StringFormat::Fmt("Couldn't open '%s' for benchmarking: %s\n",
+                                             ctx.capture.c_str(), rdc->ErrorString().c_str())
+                               .c_str());
+    delete rdc;
+    return;
+  }
+
+  int sectionIdx = rdc->SectionIndex(SectionType::FrameCapture);
+
+  if(sectionIdx < 0)
+  {
+    OSUtility::WriteOutput(
+        OSUtility::Output_StdErr,
+        StringFormat::Fmt("'%s' has no frame capture section\n", ctx.capture.c_str()).c_str());
+    delete rdc;
+    return;
+  }
+
+  uint64_t sectionSize = rdc->GetSectionProperties(sectionIdx).uncompressedSize;
+
+  delete rdc;
+
+  ctx.Run("capture/open/" + filename, 0, [&]() {
+    RDCFile file;
+    file.Open(ctx.capture.c_str());
+  });
+
+  RDCFile file;
+  file.Open(ctx.capture.c_str());
+
+  bytebuf out;
+  out.resize((size_t)sectionSize);
+
+  ctx.Run("capture/read-section/" + filename, sectionSize, [&]() {
+    StreamReader *reader = file.ReadSection(sectionIdx);
+    ReadAll(*reader, out, 64 * 1024);
+    delete reader;
+  });
+
+  ctx.Run("capture/read-chunks/" + filename, sectionSize, [&]() {
+    ReadSerialiser ser(file.ReadSection(sectionIdx), Ownership::Stream);
+    StreamReader *reader = ser.GetReader();
+    while(!reader->AtEnd() && !reader->IsErrored())
+    {
+      ser.ReadChunk<uint32_t>();
+      ser.SkipCurrentChunk();
+      ser.EndChunk();
+    }
+  });
+
+  // this goes through the driver's structured export, so includes processing every chunk in the
+  // capture.
+  ctx.Run("capture/structured-export/" + filename, sectionSize, [&]() {
+    ICaptureFile *capfile = RENDERDOC_OpenCaptureFile();
+    if(capfile->OpenFile(ctx.capture.c_str(), "rdc", NULL) == ReplayStatus::Succeeded)
+      capfile->GetStructuredData();
+    capfile->Shutdown();
+  });
+}
+
+static rdcstr EscapeJSON(const rdcstr &str)
+{
+  rdcstr ret;
+  for(char c : str)
+  {
+    if(c == '"' || c == '\\')
+      ret.push_back('\\');
+    ret.push_back(c);
+  }
+  return ret;
+}
+
+static bool WriteJSON(const BenchmarkContext &ctx)
+{
+  rdcstr json = "{\n  \"results\": [\n";
+
+  for(size_t i = 0; i < ctx.results.size(); i++)
+  {
+    const BenchmarkResult &r = ctx.results[i];
+
+    json += StringFormat::Fmt(
+        "    {\"name\": \"%s\", \"iterations\": %u, \"bytes\": %llu, \"output_bytes\": %llu, "
+        "\"min_ms\": %f, \"median_ms\": %f, \"mean_ms\": %f}",
+        EscapeJSON(r.name).c_str(), r.iterations, r.bytes, r.outputBytes, r.minMS, r.medianMS,
+        r.meanMS);
+
+    if(i + 1 < ctx.results.size())
+      json += ",";
+    json += "\n";
+  }
+
+  json += "  ]\n}\n";
+
+  if(ctx.jsonPath == "-")
+  {
+    OSUtility::WriteOutput(OSUtility::Output_StdOut, json.c_str());
+    return true;
+  }
+
+  FILE *f = FileIO::fopen(ctx.jsonPath.c_str(), "wb");
+
+  if(!f)
+  {
+    rdcstr error =
+        StringFormat::Fmt("Couldn't open '%s' for writing results\n", ctx.jsonPath.c_str());
+    OSUtility::WriteOutput(OSUtility::Output_StdErr, error.c_str());
+    return false;
+  }
+
+  FileIO::fwrite(json.c_str(), 1, json.size(), f);
+  FileIO::fclose(f);
+
+  return true;
+}
+
+static void PrintUsage()
+{
+  OSUtility::WriteOutput(
+      OSUtility::Output_StdOut,
+      "Options:\n"
+      "  --filter <text>         Only run benchmarks whose name contains <text>.\n"
+      "  --list                  List the benchmarks that would be run, without running them.\n"
+      "  --min-time <ms>         Minimum total time to spend on each benchmark (default 250).\n"
+      "  --min-iterations <n>    Minimum number of iterations of each benchmark (default 3).\n"
+      "  --capture <file.rdc>    Also benchmark reading the given capture.\n"
+      "  --json <file>           Write machine-readable results to <file>, or stdout for '-'.\n");
+}
+
+extern "C" RENDERDOC_API int RENDERDOC_CC RENDERDOC_RunBenchmarks(const rdcarray<rdcstr> &args)
+{
+  BenchmarkContext ctx;
+
+  for(size_t i = 0; i < args.size(); i++)
+  {
+    const rdcstr &arg = args[i];
+    bool hasValue = i + 1 < args.size();
+
+    if(arg == "--help" || arg == "-h")
+    {
+      PrintUsage();
+      return 0;
+    }
+    else if(arg == "--list")
+    {
+      ctx.list = true;
+    }
+    else if(arg == "--filter" && hasValue)
+    {
+      ctx.filter = args[++i];
+    }
+    else if(arg == "--min-time" && hasValue)
+    {
+      ctx.minTime = atof(args[++i].c_str());
+    }
+    else if(arg == "--min-iterations" && hasValue)
+    {
+      ctx.minIterations = RDCMAX(1, atoi(args[++i].c_str()));
+    }
+    else if(arg == "--capture" && hasValue)
+    {
+      ctx.capture = args[++i];
+    }
+    else if(arg == "--json" && hasValue)
+    {
+      ctx.jsonPath = args[++i];
+    }
+    else
+    {
+      OSUtility::WriteOutput(OSUtility::Output_StdOut,
+                             ("Unrecognised argument '" + arg + "'\n").c_str());
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  // build the synthetic data once. The serialised chunk stream doubles as the input data for the
+  // compression and stream benchmarks, as it's a reasonable stand-in for a capture's contents.
+  BenchmarkRandom rng;
+
+  bytebuf contents;
+  contents.resize(size_t(SyntheticContentsSize * 16));
+  FillContents(contents.data(), contents.size(), rng);
+
+  bytebuf stream;
+  {
+    StreamWriter *writer = new StreamWriter(StreamWriter::DefaultScratchSize);
+    {
+      WriteSerialiser ser(writer, Ownership::Nothing);
+      WriteSyntheticChunks(ser, contents);
+    }
+    stream.assign(writer->GetData(), (size_t)writer->GetOffset());
+    delete writer;
+  }
+
+  BenchmarkSerialiser(ctx, contents, stream);
+  BenchmarkCompression(ctx, stream);
+  BenchmarkStreams(ctx, stream);
+  BenchmarkCapture(ctx);
+
+  if(!ctx.jsonPath.empty() && !ctx.list)
+    return WriteJSON(ctx) ? 0 : 1;
+
+  return 0;
+}
+
+#else
+
+extern "C" RENDERDOC_API int RENDERDOC_CC RENDERDOC_RunBenchmarks(const rdcarray<rdcstr> &args)
+{
+  OSUtility::WriteOutput(OSUtility::Output_StdOut,
+                         "Benchmarks are only available in builds with unit tests enabled.\n");
+  return 1;
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
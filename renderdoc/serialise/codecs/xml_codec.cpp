@@ -274,9 +274,8 @@ static void Obj2XML(pugi::xml_node &parent, SDObject &child)
   }
 }
 
-static ReplayStatus Structured2XML(const char *filename, const RDCFile &file, uint64_t version,
-                                   const StructuredChunkList &chunks,
-                                   RENDERDOC_ProgressCallback progress)
+static ReplayStatus Structured2XML(const char *filename, const RDCFile &file,
+                                   const SDFile &structData, RENDERDOC_ProgressCallback progress)
 {
   pugi::xml_document doc;
 
@@ -376,6 +375,8 @@ static ReplayStatus Structured2XML(const char *filename, const RDCFile &file, ui
       xSection.append_attribute("lz4");
     if(props.flags & SectionFlags::ZstdCompressed)
       xSection.append_attribute("zstd");
+    if(props.flags & SectionFlags::BlockIndexed)
+      xSection.append_attribute("blockindexed");
 
     pugi::xml_node name = xSection.append_child("name");
     name.text() = props.name.c_str();
@@ -414,13 +415,17 @@ static ReplayStatus Structured2XML(const char *filename, const RDCFile &file, ui
 
   pugi::xml_node xChunks = xRoot.append_child("chunks");
 
-  xChunks.append_attribute("version") = version;
+  xChunks.append_attribute("version") = structData.version;
+
+  const StructuredChunkList &chunks = structData.chunks;
 
   for(size_t c = 0; c < chunks.size(); c++)
   {
     pugi::xml_node xChunk = xChunks.append_child("chunk");
     SDChunk *chunk = chunks[c];
 
+    structData.PopulateChunk(chunk);
+
     xChunk.append_attribute("id") = chunk->metadata.chunkID;
     xChunk.append_attribute("name") = chunk->name.c_str();
     xChunk.append_attribute("length") = chunk->metadata.length;
@@ -698,6 +703,8 @@ static ReplayStatus XML2Structured(const char *xml, const ThumbTypeAndData &thum
       props.flags |= SectionFlags::LZ4Compressed;
     if(xSection.attribute("zstd"))
       props.flags |= SectionFlags::ZstdCompressed;
+    if(xSection.attribute("blockindexed"))
+      props.flags |= SectionFlags::BlockIndexed;
 
     pugi::xml_node name = xSection.child("name");
     if(!name)
@@ -1043,13 +1050,13 @@ ReplayStatus exportXMLZ(const char *filename, const RDCFile &rdc, const SDFile &
   if(ret != ReplayStatus::Succeeded)
     return ret;
 
-  return Structured2XML(filename, rdc, structData.version, structData.chunks, progress);
+  return Structured2XML(filename, rdc, structData, progress);
 }
 
 ReplayStatus exportXMLOnly(const char *filename, const RDCFile &rdc, const SDFile &structData,
                            RENDERDOC_ProgressCallback progress)
 {
-  return Structured2XML(filename, rdc, structData.version, structData.chunks, progress);
+  return Structured2XML(filename, rdc, structData, progress);
 }
 
 static ConversionRegistration XMLZIPConversionRegistration(
@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "lz4io.h"
+#include "parallelio.h"
 #include "serialiser.h"
 #include "zstdio.h"
 
@@ -190,4 +191,201 @@ TEST_CASE("Test ZSTD compression/decompression", "[streamio][zstd]")
   delete[] randomData;
 };
 
+TEST_CASE("Test block-indexed compression and seeking", "[streamio][lz4][zstd]")
+{
+  const uint64_t dataSize = 3 * 1024 * 1024 + 1234;
+
+  byte *srcData = new byte[(size_t)dataSize];
+
+  // mix some compressible and random data
+  for(uint64_t i = 0; i < dataSize; i++)
+    srcData[i] = (i / 4096) % 2 ? byte(rand() & 0xff) : byte(i & 0xff);
+
+  for(bool zstd : {false, true})
+  {
+    StreamWriter buf(StreamWriter::DefaultScratchSize);
+
+    {
+      Compressor *comp = NULL;
+      if(zstd)
+        comp = new ZSTDCompressor(&buf, Ownership::Nothing, true);
+      else
+        comp = new LZ4Compressor(&buf, Ownership::Nothing, true);
+
+      StreamWriter writer(comp, Ownership::Stream);
+
+      writer.Write(srcData, dataSize);
+
+      CHECK(writer.GetOffset() == dataSize);
+
+      writer.Finish();
+
+      CHECK_FALSE(writer.IsErrored());
+    }
+
+    Decompressor *decomp = NULL;
+    StreamReader *compReader = new StreamReader(buf.GetData(), buf.GetOffset());
+    if(zstd)
+      decomp = new ZSTDDecompressor(compReader, Ownership::Stream, true);
+    else
+      decomp = new LZ4Decompressor(compReader, Ownership::Stream, true);
+
+    StreamReader reader(decomp, dataSize, Ownership::Stream);
+
+    byte *readData = new byte[1024 * 1024];
+
+    // sequential reads work as normal
+    reader.Read(readData, 1024 * 1024);
+    CHECK_FALSE(memcmp(readData, srcData, 1024 * 1024));
+
+    // seek backwards, forwards and across block boundaries
+    uint64_t offsets[] = {0, 100, 2 * 1024 * 1024 + 17, 65536 - 10, 1024 * 1024 + 1, 128 * 1024 - 5};
+
+    for(uint64_t offs : offsets)
+    {
+      reader.SetOffset(offs);
+      CHECK(reader.GetOffset() == offs);
+
+      reader.Read(readData, 300 * 1024);
+      CHECK_FALSE(memcmp(readData, srcData + offs, 300 * 1024));
+    }
+
+    // read right up to the end after seeking
+    reader.SetOffset(dataSize - 5000);
+    reader.Read(readData, 5000);
+    CHECK_FALSE(memcmp(readData, srcData + dataSize - 5000, 5000));
+
+    CHECK_FALSE(reader.IsErrored());
+    CHECK(reader.AtEnd());
+
+    // the compressed data should still be readable by a decompressor that doesn't know about the
+    // index, since it's stored after all the blocks
+    {
+      if(zstd)
+        decomp = new ZSTDDecompressor(new StreamReader(buf.GetData(), buf.GetOffset()),
+                                      Ownership::Stream);
+      else
+        decomp = new LZ4Decompressor(new StreamReader(buf.GetData(), buf.GetOffset()),
+                                     Ownership::Stream);
+
+      StreamReader seqReader(decomp, dataSize, Ownership::Stream);
+
+      bytebuf seqData;
+      seqData.resize((size_t)dataSize);
+      seqReader.Read(seqData.data(), dataSize);
+
+      CHECK_FALSE(seqReader.IsErrored());
+      CHECK_FALSE(memcmp(seqData.data(), srcData, (size_t)dataSize));
+    }
+
+    // a reader can start part way into the data, and then reads and seeks relative to that
+    {
+      if(zstd)
+        decomp = new ZSTDDecompressor(new StreamReader(buf.GetData(), buf.GetOffset()),
+                                      Ownership::Stream, true);
+      else
+        decomp = new LZ4Decompressor(new StreamReader(buf.GetData(), buf.GetOffset()),
+                                     Ownership::Stream, true);
+
+      const uint64_t base = 1024 * 1024 + 300;
+
+      StreamReader rangeReader(decomp, dataSize - base, Ownership::Stream, base);
+
+      CHECK(rangeReader.GetOffset() == 0);
+      CHECK(rangeReader.GetSize() == dataSize - base);
+
+      rangeReader.Read(readData, 100 * 1024);
+      CHECK_FALSE(memcmp(readData, srcData + base, 100 * 1024));
+
+      rangeReader.SetOffset(5000);
+      rangeReader.Read(readData, 300 * 1024);
+      CHECK_FALSE(memcmp(readData, srcData + base + 5000, 300 * 1024));
+
+      rangeReader.SetOffset(0);
+      rangeReader.Read(readData, 1000);
+      CHECK_FALSE(memcmp(readData, srcData + base, 1000));
+
+      rangeReader.SetOffset(dataSize - base - 5000);
+      rangeReader.Read(readData, 5000);
+      CHECK_FALSE(memcmp(readData, srcData + dataSize - 5000, 5000));
+
+      CHECK_FALSE(rangeReader.IsErrored());
+      CHECK(rangeReader.AtEnd());
+    }
+
+    delete[] readData;
+  }
+
+  delete[] srcData;
+};
+
+TEST_CASE("Test parallel compression", "[streamio][lz4][zstd]")
+{
+  const uint64_t dataSize = 5 * 1024 * 1024 + 4321;
+
+  byte *srcData = new byte[(size_t)dataSize];
+
+  for(uint64_t i = 0; i < dataSize; i++)
+    srcData[i] = (i / 8192) % 3 ? byte(i & 0xff) : byte(rand() & 0xff);
+
+  for(SectionFlags flags : {SectionFlags::LZ4Compressed, SectionFlags::ZstdCompressed,
+                            SectionFlags::LZ4Compressed | SectionFlags::BlockIndexed,
+                            SectionFlags::ZstdCompressed | SectionFlags::BlockIndexed})
+  {
+    for(uint32_t numThreads : {1U, 4U})
+    {
+      StreamWriter buf(StreamWriter::DefaultScratchSize);
+
+      {
+        StreamWriter writer(new ParallelCompressor(&buf, Ownership::Nothing, flags, numThreads),
+                            Ownership::Stream);
+
+        // write in uneven pieces to exercise blocks being split across writes
+        uint64_t offs = 0;
+        while(offs < dataSize)
+        {
+          uint64_t len = RDCMIN(dataSize - offs, uint64_t(offs % 100000) + 1000);
+          writer.Write(srcData + offs, len);
+          offs += len;
+        }
+
+        CHECK(writer.GetOffset() == dataSize);
+
+        writer.Finish();
+
+        CHECK_FALSE(writer.IsErrored());
+      }
+
+      const bool blockIndexed = bool(flags & SectionFlags::BlockIndexed);
+
+      Decompressor *decomp = NULL;
+      StreamReader *compReader = new StreamReader(buf.GetData(), buf.GetOffset());
+      if(flags & SectionFlags::ZstdCompressed)
+        decomp = new ZSTDDecompressor(compReader, Ownership::Stream, blockIndexed);
+      else
+        decomp = new LZ4Decompressor(compReader, Ownership::Stream, blockIndexed);
+
+      StreamReader reader(decomp, dataSize, Ownership::Stream);
+
+      bytebuf readData;
+      readData.resize((size_t)dataSize);
+      reader.Read(readData.data(), dataSize);
+
+      CHECK_FALSE(reader.IsErrored());
+      CHECK(reader.AtEnd());
+      CHECK_FALSE(memcmp(readData.data(), srcData, (size_t)dataSize));
+
+      if(blockIndexed)
+      {
+        reader.SetOffset(4 * 1024 * 1024 + 7);
+        reader.Read(readData.data(), 1024);
+        CHECK_FALSE(memcmp(readData.data(), srcData + 4 * 1024 * 1024 + 7, 1024));
+        CHECK_FALSE(reader.IsErrored());
+      }
+    }
+  }
+
+  delete[] srcData;
+};
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
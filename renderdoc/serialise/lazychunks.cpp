@@ -0,0 +1,176 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "lazychunks.h"
+#include "common/threading.h"
+#include "core/settings.h"
+
+RDOC_CONFIG(uint32_t, Serialise_LazyChunkBudget, 4096,
+            "The number of lazily decoded chunks to keep in memory, before the least recently "
+            "used ones are released again.");
+
+void LazyChunkSource::SetSource(const byte *data, uint64_t size, uint64_t version,
+                                ChunkLookup lookup, DecodeCallback decode)
+{
+  SCOPED_LOCK(m_Lock);
+
+  m_Data = data;
+  m_Size = size;
+  m_Version = version;
+  m_ChunkLookup = lookup;
+  m_Decode = decode;
+}
+
+void LazyChunkSource::AddChunk(SDChunk *chunk, uint64_t offset, uint64_t length)
+{
+  SCOPED_LOCK(m_Lock);
+
+  m_Chunks[chunk] = {chunk, offset, length, NULL, NULL};
+}
+
+void LazyChunkSource::PopulateChunk(SDChunk *chunk)
+{
+  SCOPED_LOCK(m_Lock);
+
+  auto it = m_Chunks.find(chunk);
+  if(it == m_Chunks.end())
+    return;
+
+  LazyChunk *lazy = &it->second;
+
+  if(!(chunk->metadata.flags & SDChunkFlags::Lazy))
+  {
+    // already resident, move it to the front as the most recently used
+    if(lazy != m_MostRecent)
+    {
+      Unlink(lazy);
+      LinkFront(lazy);
+    }
+    return;
+  }
+
+  chunk->metadata.flags &= ~SDChunkFlags::Lazy;
+
+  if(!Decode(chunk, *lazy))
+  {
+    // leave the chunk empty rather than trying again every time it's looked at
+    m_Chunks.erase(it);
+    return;
+  }
+
+  LinkFront(lazy);
+
+  const size_t budget = RDCMAX(1U, Serialise_LazyChunkBudget());
+
+  while(m_NumResident > budget)
+  {
+    LazyChunk *oldest = m_LeastRecent;
+    Unlink(oldest);
+    Release(oldest->chunk);
+  }
+}
+
+void LazyChunkSource::Clear()
+{
+  SCOPED_LOCK(m_Lock);
+
+  m_Chunks.clear();
+  m_MostRecent = m_LeastRecent = NULL;
+  m_NumResident = 0;
+}
+
+void LazyChunkSource::LinkFront(LazyChunk *lazy)
+{
+  lazy->prev = NULL;
+  lazy->next = m_MostRecent;
+
+  if(m_MostRecent)
+    m_MostRecent->prev = lazy;
+  else
+    m_LeastRecent = lazy;
+
+  m_MostRecent = lazy;
+  m_NumResident++;
+}
+
+void LazyChunkSource::Unlink(LazyChunk *lazy)
+{
+  if(lazy->prev)
+    lazy->prev->next = lazy->next;
+  else
+    m_MostRecent = lazy->next;
+
+  if(lazy->next)
+    lazy->next->prev = lazy->prev;
+  else
+    m_LeastRecent = lazy->prev;
+
+  lazy->prev = lazy->next = NULL;
+  m_NumResident--;
+}
+
+bool LazyChunkSource::Decode(SDChunk *chunk, const LazyChunk &lazy)
+{
+  if(!m_Data || !m_Decode || lazy.offset + lazy.length > m_Size)
+  {
+    RDCERR("Lazy chunk at %llu is outside of the source data", lazy.offset);
+    return false;
+  }
+
+  StreamReader reader(m_Data + lazy.offset, lazy.length);
+
+  ReadSerialiser ser(&reader, Ownership::Nothing);
+
+  ser.SetVersion(m_Version);
+  ser.ConfigureStructuredExport(m_ChunkLookup, false, 0, 1.0);
+  ser.SetStructureOnly(true);
+
+  uint32_t chunkID = ser.ReadChunk<uint32_t>();
+
+  bool success = m_Decode(ser, chunkID);
+
+  ser.EndChunk();
+
+  SDFile &file = ser.GetStructuredFile();
+
+  if(!success || reader.IsErrored() || file.chunks.empty())
+  {
+    RDCERR("Failed to decode lazy chunk %s at %llu", chunk->name.c_str(), lazy.offset);
+    return false;
+  }
+
+  SDChunk *decoded = file.chunks.back();
+
+  chunk->data.basic = decoded->data.basic;
+  chunk->data.children.swap(decoded->data.children);
+
+  return true;
+}
+
+void LazyChunkSource::Release(SDChunk *chunk)
+{
+  chunk->DeleteChildren();
+  chunk->data.basic.u = 0;
+  chunk->metadata.flags |= SDChunkFlags::Lazy;
+}
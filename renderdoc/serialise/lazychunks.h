@@ -0,0 +1,90 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <unordered_map>
+#include "serialiser.h"
+
+class ReadSerialiser;
+
+// Remembers where each chunk of a lazily exported structured file was read from, so that the
+// chunk's contents can be decoded the first time something looks at them. Decoded chunks are
+// released again in least-recently-used order once too many are resident.
+class LazyChunkSource : public ISDChunkSource
+{
+public:
+  typedef std::function<bool(ReadSerialiser &ser, uint32_t chunkID)> DecodeCallback;
+
+  LazyChunkSource() = default;
+  LazyChunkSource(const LazyChunkSource &) = delete;
+  LazyChunkSource &operator=(const LazyChunkSource &) = delete;
+  ~LazyChunkSource() = default;
+
+  // data is the stream the chunks are read from, and must stay resident while chunks can still be
+  // populated. The callback processes a chunk's contents without replaying it, and can be called
+  // from any thread that looks at a chunk.
+  void SetSource(const byte *data, uint64_t size, uint64_t version, ChunkLookup lookup,
+                 DecodeCallback decode);
+  void AddChunk(SDChunk *chunk, uint64_t offset, uint64_t length);
+
+  void PopulateChunk(SDChunk *chunk) override;
+
+  // forget all chunks, e.g. when the file that owns them is destroyed
+  void Clear();
+
+  bool IsValid() const { return m_Data != NULL; }
+  size_t NumChunks() const { return m_Chunks.size(); }
+  size_t NumResident() const { return m_NumResident; }
+private:
+  struct LazyChunk
+  {
+    SDChunk *chunk;
+    uint64_t offset;
+    uint64_t length;
+    // neighbours in the list of resident chunks, from most to least recently used
+    LazyChunk *prev;
+    LazyChunk *next;
+  };
+
+  bool Decode(SDChunk *chunk, const LazyChunk &lazy);
+  void Release(SDChunk *chunk);
+
+  void LinkFront(LazyChunk *lazy);
+  void Unlink(LazyChunk *lazy);
+
+  Threading::CriticalSection m_Lock;
+
+  const byte *m_Data = NULL;
+  uint64_t m_Size = 0;
+  uint64_t m_Version = 0;
+  ChunkLookup m_ChunkLookup = NULL;
+  DecodeCallback m_Decode;
+
+  // elements are never moved by the map, so the resident list can point into it
+  std::unordered_map<SDChunk *, LazyChunk> m_Chunks;
+  LazyChunk *m_MostRecent = NULL;
+  LazyChunk *m_LeastRecent = NULL;
+  size_t m_NumResident = 0;
+};
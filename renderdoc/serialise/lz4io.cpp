@@ -24,9 +24,8 @@
 
 #include "lz4io.h"
 
-static const uint64_t lz4BlockSize = 64 * 1024;
-
-LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own) : Compressor(write, own)
+LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own, bool blockIndexed)
+    : Compressor(write, own)
 {
   m_Page[0] = AllocAlignedBuffer(lz4BlockSize);
   m_Page[1] = AllocAlignedBuffer(lz4BlockSize);
@@ -34,6 +33,9 @@ LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own) : Compressor(wr
 
   m_PageOffset = 0;
 
+  m_BlockIndexed = blockIndexed;
+  m_BaseOffset = write->GetOffset();
+
   m_LZ4Comp = LZ4_createStream();
 }
 
@@ -115,7 +117,13 @@ bool LZ4Compressor::Finish()
   // precisely 64kb in size
   // only the last one can be smaller, so we only write a partial page when finishing.
   // Calling Write() after Finish() is illegal
-  return FlushPage0();
+  bool success = FlushPage0();
+
+  // block-indexed streams then have the index of each block's offset appended
+  if(success && m_BlockIndexed)
+    success &= WriteBlockIndex(m_Write, m_BlockOffsets, lz4BlockSize);
+
+  return success;
 }
 
 bool LZ4Compressor::FlushPage0()
@@ -124,6 +132,14 @@ bool LZ4Compressor::FlushPage0()
   if(!m_CompressBuffer)
     return false;
 
+  // when block-indexed, reset the stream so that this block doesn't reference any history from the
+  // previous block and can be decompressed on its own.
+  if(m_BlockIndexed)
+  {
+    LZ4_resetStream_fast(m_LZ4Comp);
+    m_BlockOffsets.push_back(m_Write->GetOffset() - m_BaseOffset);
+  }
+
   // m_PageOffset is the amount written, usually equal to lz4BlockSize except the last block.
   int32_t compSize =
       LZ4_compress_fast_continue(m_LZ4Comp, (const char *)m_Page[0], (char *)m_CompressBuffer,
@@ -153,7 +169,8 @@ bool LZ4Compressor::FlushPage0()
   return success;
 }
 
-LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own) : Decompressor(read, own)
+LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own, bool blockIndexed)
+    : Decompressor(read, own)
 {
   m_Page[0] = AllocAlignedBuffer(lz4BlockSize);
   m_Page[1] = AllocAlignedBuffer(lz4BlockSize);
@@ -162,9 +179,20 @@ LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own) : Decompress
   m_PageOffset = 0;
   m_PageLength = 0;
 
+  m_NextBlock = 0;
+
   m_LZ4Decomp = LZ4_createStreamDecode();
 
   LZ4_setStreamDecode(m_LZ4Decomp, NULL, 0);
+
+  if(blockIndexed && !ReadBlockIndex(m_Read, m_BlockOffsets, lz4BlockSize))
+  {
+    RDCERR("Couldn't read block index for LZ4 stream");
+    FreeAlignedBuffer(m_Page[0]);
+    FreeAlignedBuffer(m_Page[1]);
+    FreeAlignedBuffer(m_CompressBuffer);
+    m_Page[0] = m_Page[1] = m_CompressBuffer = NULL;
+  }
 }
 
 LZ4Decompressor::~LZ4Decompressor()
@@ -180,7 +208,8 @@ bool LZ4Decompressor::Recompress(Compressor *comp)
 {
   bool success = true;
 
-  while(success && !m_Read->AtEnd())
+  // block-indexed streams have the index after the last block, so we stop based on the block count
+  while(success && (m_BlockOffsets.empty() ? !m_Read->AtEnd() : m_NextBlock < m_BlockOffsets.size()))
   {
     success &= FillPage0();
     if(success)
@@ -251,6 +280,51 @@ bool LZ4Decompressor::Read(void *data, uint64_t numBytes)
   return success;
 }
 
+bool LZ4Decompressor::Seek(uint64_t offs)
+{
+  // if we encountered a stream error this will be NULL
+  if(!m_CompressBuffer || m_BlockOffsets.empty())
+    return false;
+
+  // every block except the last is a full page, so we can calculate which block we need
+  uint64_t block = offs / lz4BlockSize;
+
+  // if the offset is in the block we already have decompressed, just move within it
+  if(block + 1 == m_NextBlock && offs % lz4BlockSize <= m_PageLength)
+  {
+    m_PageOffset = offs % lz4BlockSize;
+    return true;
+  }
+
+  // seeking to the very end of the stream when it's an exact multiple of the block size
+  if(block == m_BlockOffsets.size() && offs % lz4BlockSize == 0)
+  {
+    m_NextBlock = block;
+    m_PageOffset = m_PageLength = 0;
+    return true;
+  }
+
+  if(block >= m_BlockOffsets.size())
+  {
+    RDCERR("Seeking to %llu outside of the %llu blocks in stream", offs,
+           (uint64_t)m_BlockOffsets.size());
+    return false;
+  }
+
+  m_Read->SetOffset(m_BlockOffsets[block]);
+  m_NextBlock = block;
+
+  // each block is independent, so decompress without any history
+  LZ4_setStreamDecode(m_LZ4Decomp, NULL, 0);
+
+  if(!FillPage0())
+    return false;
+
+  m_PageOffset = offs % lz4BlockSize;
+
+  return true;
+}
+
 bool LZ4Decompressor::FillPage0()
 {
   // swap pages
@@ -260,6 +334,21 @@ bool LZ4Decompressor::FillPage0()
 
   bool success = true;
 
+  if(!m_BlockOffsets.empty())
+  {
+    if(m_NextBlock >= m_BlockOffsets.size())
+    {
+      RDCERR("Reading past the last block %llu in stream", (uint64_t)m_BlockOffsets.size());
+      FreeAlignedBuffer(m_Page[0]);
+      FreeAlignedBuffer(m_Page[1]);
+      FreeAlignedBuffer(m_CompressBuffer);
+      m_Page[0] = m_Page[1] = m_CompressBuffer = NULL;
+      return false;
+    }
+
+    m_NextBlock++;
+  }
+
   success &= m_Read->Read(compSize);
   if(!success || compSize < 0 || compSize > (int)LZ4_COMPRESSBOUND(lz4BlockSize))
   {
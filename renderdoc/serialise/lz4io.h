@@ -27,10 +27,12 @@
 #include "lz4/lz4.h"
 #include "streamio.h"
 
+static const uint64_t lz4BlockSize = 64 * 1024;
+
 class LZ4Compressor : public Compressor
 {
 public:
-  LZ4Compressor(StreamWriter *write, Ownership own);
+  LZ4Compressor(StreamWriter *write, Ownership own, bool blockIndexed = false);
   ~LZ4Compressor();
 
   bool Write(const void *data, uint64_t numBytes);
@@ -43,17 +45,24 @@ private:
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
 
+  // if block-indexed, each block is compressed independently and its offset is recorded so that
+  // the index can be written on Finish()
+  bool m_BlockIndexed;
+  uint64_t m_BaseOffset;
+  rdcarray<uint64_t> m_BlockOffsets;
+
   LZ4_stream_t *m_LZ4Comp;
 };
 
 class LZ4Decompressor : public Decompressor
 {
 public:
-  LZ4Decompressor(StreamReader *read, Ownership own);
+  LZ4Decompressor(StreamReader *read, Ownership own, bool blockIndexed = false);
   ~LZ4Decompressor();
 
   bool Recompress(Compressor *comp);
   bool Read(void *data, uint64_t numBytes);
+  bool Seek(uint64_t offs);
 
 private:
   bool FillPage0();
@@ -63,5 +72,9 @@ private:
   uint64_t m_PageOffset;
   uint64_t m_PageLength;
 
+  // the block index if the stream is block-indexed, and the index of the next block to decompress
+  rdcarray<uint64_t> m_BlockOffsets;
+  uint64_t m_NextBlock;
+
   LZ4_streamDecode_t *m_LZ4Decomp;
 };
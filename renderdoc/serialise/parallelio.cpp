@@ -0,0 +1,270 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "parallelio.h"
+#include "core/settings.h"
+#include "lz4io.h"
+#include "zstdio.h"
+
+RDOC_CONFIG(uint32_t, Serialise_CompressionThreads, 0,
+            "The number of threads to use when compressing captures and other data. 0 uses as "
+            "many as the job system has workers, 1 compresses on the calling thread only.");
+
+ParallelCompressor::ParallelCompressor(StreamWriter *write, Ownership own, SectionFlags flags,
+                                       uint32_t numThreads)
+    : Compressor(write, own)
+{
+  RDCASSERT(flags & (SectionFlags::LZ4Compressed | SectionFlags::ZstdCompressed), flags);
+
+  // LZ4 takes precedence if both are set, matching RDCFile::ReadSection
+  m_ZSTD = !(flags & SectionFlags::LZ4Compressed);
+  m_BlockIndexed = bool(flags & SectionFlags::BlockIndexed);
+
+  if(m_ZSTD)
+  {
+    m_BlockSize = zstdBlockSize;
+    m_CompressBound = ZSTD_compressBound(zstdBlockSize);
+  }
+  else
+  {
+    m_BlockSize = lz4BlockSize;
+    m_CompressBound = LZ4_COMPRESSBOUND(lz4BlockSize);
+  }
+
+  if(numThreads == 0)
+    numThreads = Serialise_CompressionThreads();
+  if(numThreads == 0)
+    numThreads = Threading::GetJobConcurrency();
+
+  m_NumThreads = numThreads;
+
+  // allow enough blocks in flight to keep every thread busy while the completed blocks are written.
+  // Compressing serially we only need the one block being filled. The buffers themselves are
+  // allocated the first time each block is used, so small streams don't pay for the whole ring.
+  m_Blocks.resize(m_NumThreads > 1 ? m_NumThreads * 2 : 1);
+
+  m_BaseOffset = write->GetOffset();
+}
+
+ParallelCompressor::~ParallelCompressor()
+{
+  for(Block &block : m_Blocks)
+  {
+    // if we errored out there may still be jobs in flight using the buffers
+    if(block.job)
+      block.job->Wait();
+    SAFE_DELETE(block.job);
+
+    if(block.context)
+      DestroyContext(block.context);
+
+    FreeAlignedBuffer(block.data);
+    FreeAlignedBuffer(block.compressed);
+  }
+}
+
+bool ParallelCompressor::Write(const void *data, uint64_t numBytes)
+{
+  if(m_Error)
+    return false;
+
+  const byte *src = (const byte *)data;
+
+  while(numBytes > 0)
+  {
+    // we only submit a full block once there's more data for the next one. That way the final
+    // block is always submitted by Finish(), the same as the serial compressors.
+    if(m_PageOffset == m_BlockSize && !SubmitBlock())
+      return false;
+
+    Block &block = CurrentBlock();
+
+    // copy as much as will fit in the current block
+    uint64_t partialBytes = RDCMIN(m_BlockSize - m_PageOffset, numBytes);
+    memcpy(block.data + m_PageOffset, src, (size_t)partialBytes);
+
+    m_PageOffset += partialBytes;
+    numBytes -= partialBytes;
+    src += partialBytes;
+  }
+
+  return true;
+}
+
+bool ParallelCompressor::Finish()
+{
+  if(m_Error)
+    return false;
+
+  // submit whatever is in the last block, even if it's empty, then wait for everything
+  if(!SubmitBlock())
+    return false;
+
+  if(!WriteCompleted(true, true))
+    return false;
+
+  if(m_BlockIndexed)
+    return WriteBlockIndex(m_Write, m_BlockOffsets, m_BlockSize);
+
+  return true;
+}
+
+ParallelCompressor::Block &ParallelCompressor::CurrentBlock()
+{
+  Block &block = m_Blocks[m_Submitted % m_Blocks.size()];
+
+  if(block.data == NULL)
+  {
+    block.data = AllocAlignedBuffer(m_BlockSize);
+    block.compressed = AllocAlignedBuffer(m_CompressBound);
+    block.job = new Threading::JobGroup;
+  }
+
+  return block;
+}
+
+bool ParallelCompressor::SubmitBlock()
+{
+  Block &block = CurrentBlock();
+
+  block.size = m_PageOffset;
+  m_PageOffset = 0;
+
+  m_Submitted++;
+
+  // compressing serially, compress and write immediately
+  if(m_NumThreads <= 1)
+  {
+    if(!CompressBlock(block) || !WriteBlock(block))
+    {
+      m_Error = true;
+      return false;
+    }
+
+    m_Written++;
+
+    return true;
+  }
+
+  Block *b = &block;
+  block.job->Submit([this, b]() { b->success = CompressBlock(*b); });
+
+  // write whatever is ready. If every block in the ring is now in use we must wait for the oldest
+  // to complete so that the next block is free to be filled.
+  return WriteCompleted(m_Submitted - m_Written == m_Blocks.size(), false);
+}
+
+bool ParallelCompressor::WriteCompleted(bool waitForOldest, bool waitForAll)
+{
+  while(m_Written < m_Submitted)
+  {
+    Block &block = m_Blocks[m_Written % m_Blocks.size()];
+
+    if(!block.job->IsComplete() && !waitForOldest && !waitForAll)
+      break;
+
+    // waiting runs other queued jobs on this thread, then sleeps until the block is compressed. If
+    // the job is already complete it ensures we see its results.
+    block.job->Wait();
+
+    if(!block.success || !WriteBlock(block))
+    {
+      m_Error = true;
+      return false;
+    }
+
+    m_Written++;
+    waitForOldest = false;
+  }
+
+  return true;
+}
+
+bool ParallelCompressor::WriteBlock(Block &block)
+{
+  if(m_BlockIndexed)
+    m_BlockOffsets.push_back(m_Write->GetOffset() - m_BaseOffset);
+
+  // both LZ4Compressor and ZSTDCompressor prefix each block with its 32-bit compressed size
+  bool success = true;
+  success &= m_Write->Write((uint32_t)block.compressedSize);
+  success &= m_Write->Write(block.compressed, block.compressedSize);
+  return success;
+}
+
+void *ParallelCompressor::CreateContext()
+{
+  if(m_ZSTD)
+    return ZSTD_createCCtx();
+
+  return AllocAlignedBuffer(LZ4_sizeofState());
+}
+
+void ParallelCompressor::DestroyContext(void *context)
+{
+  if(m_ZSTD)
+    ZSTD_freeCCtx((ZSTD_CCtx *)context);
+  else
+    FreeAlignedBuffer((byte *)context);
+}
+
+bool ParallelCompressor::CompressBlock(Block &block)
+{
+  if(!block.context)
+    block.context = CreateContext();
+
+  void *context = block.context;
+
+  if(m_ZSTD)
+  {
+    // same compression level as ZSTDCompressor
+    size_t ret = ZSTD_compressCCtx((ZSTD_CCtx *)context, block.compressed, (size_t)m_CompressBound,
+                                   block.data, (size_t)block.size, 7);
+
+    if(ZSTD_isError(ret))
+    {
+      RDCERR("Error compressing: %s", ZSTD_getErrorName(ret));
+      return false;
+    }
+
+    block.compressedSize = ret;
+  }
+  else
+  {
+    // same acceleration as LZ4Compressor. This resets the state so the block is independent
+    int ret = LZ4_compress_fast_extState(context, (const char *)block.data,
+                                         (char *)block.compressed, (int)block.size,
+                                         (int)m_CompressBound, 20);
+
+    if(ret <= 0)
+    {
+      RDCERR("Error compressing: %i", ret);
+      return false;
+    }
+
+    block.compressedSize = (uint64_t)ret;
+  }
+
+  return true;
+}
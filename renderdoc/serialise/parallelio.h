@@ -0,0 +1,92 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/replay_enums.h"
+#include "common/jobsystem.h"
+#include "streamio.h"
+
+// A compressor that splits the stream into independent blocks and compresses them as jobs on the
+// shared job system, writing the results out in order as they complete. The output is in the same
+// format as LZ4Compressor or ZSTDCompressor - optionally with a block index - so it can be read
+// with the matching decompressor.
+// Since LZ4 blocks are compressed independently rather than chained, the compression ratio is
+// slightly worse than LZ4Compressor.
+class ParallelCompressor : public Compressor
+{
+public:
+  // flags selects the codec (LZ4Compressed or ZstdCompressed) and whether to write a block index.
+  // numThreads is how many blocks may be compressing at once. If it's 0 the configured number of
+  // compression threads is used, if it's 1 blocks are compressed on the calling thread.
+  ParallelCompressor(StreamWriter *write, Ownership own, SectionFlags flags, uint32_t numThreads = 0);
+  ~ParallelCompressor();
+
+  bool Write(const void *data, uint64_t numBytes);
+  bool Finish();
+
+private:
+  struct Block
+  {
+    byte *data = NULL;
+    byte *compressed = NULL;
+    // compression context, kept with the block so a context is only ever used by one job at once
+    void *context = NULL;
+    // tracks the compression job while the block is in flight
+    Threading::JobGroup *job = NULL;
+    uint64_t size = 0;
+    uint64_t compressedSize = 0;
+    bool success = false;
+  };
+
+  Block &CurrentBlock();
+  bool SubmitBlock();
+  bool WriteCompleted(bool waitForOldest, bool waitForAll);
+  bool WriteBlock(Block &block);
+
+  void *CreateContext();
+  void DestroyContext(void *context);
+  bool CompressBlock(Block &block);
+
+  bool m_ZSTD;
+  bool m_BlockIndexed;
+  uint64_t m_BlockSize;
+  uint64_t m_CompressBound;
+
+  // ring of blocks, either being filled, in flight on the job system or waiting to be written
+  rdcarray<Block> m_Blocks;
+
+  // number of blocks submitted for compression, and number written out. The block being filled is
+  // always m_Blocks[m_Submitted % m_Blocks.size()]
+  uint64_t m_Submitted = 0;
+  uint64_t m_Written = 0;
+  uint64_t m_PageOffset = 0;
+
+  uint64_t m_BaseOffset;
+  rdcarray<uint64_t> m_BlockOffsets;
+
+  bool m_Error = false;
+
+  uint32_t m_NumThreads;
+};
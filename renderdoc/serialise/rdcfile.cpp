@@ -30,6 +30,7 @@
 #include "jpeg-compressor/jpge.h"
 #include "stb/stb_image.h"
 #include "lz4io.h"
+#include "parallelio.h"
 #include "zstdio.h"
 
 // not provided by tinyexr, just do by hand
@@ -831,20 +832,31 @@ StreamReader *RDCFile::ReadSection(int index) const
   SectionLocation offsetSize = m_SectionLocations[index];
   FileIO::fseek64(m_File, offsetSize.dataOffset, SEEK_SET);
 
-  StreamReader *fileReader = new StreamReader(m_File, offsetSize.diskLength, Ownership::Nothing);
+  // only the frame capture is worth mapping. It comes first in the file so rewriting any other
+  // section never moves or truncates it, see WriteSection
+  const bool allowMapping = (props.type == SectionType::FrameCapture);
+
+  StreamReader *fileReader =
+      new StreamReader(m_File, offsetSize.diskLength, Ownership::Nothing, allowMapping);
+
+  if(fileReader->IsMapped())
+    m_FrameCaptureInUse = true;
 
   StreamReader *compReader = NULL;
 
+  // block-indexed sections can be seeked to any offset, decompressing only the block containing it
+  const bool blockIndexed = bool(props.flags & SectionFlags::BlockIndexed);
+
   if(props.flags & SectionFlags::LZ4Compressed)
   {
     // the user will delete the compressed reader, and then it will delete the compressor and the
     // file reader
-    compReader = new StreamReader(new LZ4Decompressor(fileReader, Ownership::Stream),
+    compReader = new StreamReader(new LZ4Decompressor(fileReader, Ownership::Stream, blockIndexed),
                                   props.uncompressedSize, Ownership::Stream);
   }
   else if(props.flags & SectionFlags::ZstdCompressed)
   {
-    compReader = new StreamReader(new ZSTDDecompressor(fileReader, Ownership::Stream),
+    compReader = new StreamReader(new ZSTDDecompressor(fileReader, Ownership::Stream, blockIndexed),
                                   props.uncompressedSize, Ownership::Stream);
   }
 
@@ -852,6 +864,63 @@ StreamReader *RDCFile::ReadSection(int index) const
   return compReader ? compReader : fileReader;
 }
 
+StreamReader *RDCFile::ReadSectionRange(int index, uint64_t offset, uint64_t size) const
+{
+  if(m_Error != ContainerError::NoError || m_File == NULL || index < 0 || index >= NumSections())
+    return NULL;
+
+  const SectionProperties &props = m_Sections[index];
+  SectionLocation offsetSize = m_SectionLocations[index];
+
+  if(props.type != SectionType::FrameCapture || offset + size > props.uncompressedSize)
+    return NULL;
+
+  const bool compressed =
+      bool(props.flags & (SectionFlags::LZ4Compressed | SectionFlags::ZstdCompressed));
+
+  if(compressed && !(props.flags & SectionFlags::BlockIndexed))
+    return NULL;
+
+  FILE *file = FileIO::fopen(m_Filename.c_str(), "rb");
+
+  if(file == NULL)
+    return NULL;
+
+  StreamReader *ret = NULL;
+
+  if(!compressed)
+  {
+    FileIO::fseek64(file, offsetSize.dataOffset + offset, SEEK_SET);
+
+    ret = new StreamReader(file, size, Ownership::Stream, true);
+  }
+  else
+  {
+    FileIO::fseek64(file, offsetSize.dataOffset, SEEK_SET);
+
+    StreamReader *fileReader = new StreamReader(file, offsetSize.diskLength, Ownership::Stream);
+
+    Decompressor *decompressor = NULL;
+
+    if(props.flags & SectionFlags::LZ4Compressed)
+      decompressor = new LZ4Decompressor(fileReader, Ownership::Stream, true);
+    else
+      decompressor = new ZSTDDecompressor(fileReader, Ownership::Stream, true);
+
+    ret = new StreamReader(decompressor, size, Ownership::Stream, offset);
+  }
+
+  if(ret->IsErrored())
+  {
+    delete ret;
+    return NULL;
+  }
+
+  m_FrameCaptureInUse = true;
+
+  return ret;
+}
+
 StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
 {
   if(m_Error != ContainerError::NoError)
@@ -935,8 +1004,9 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
     if(type == SectionType::FrameCapture || name == ToStr(SectionType::FrameCapture))
     {
       // simple case - if there are no other sections then we can just overwrite the existing frame
-      // capture.
-      if(NumSections() == 1)
+      // capture. We can't if it's mapped or still being read though, since that would change or
+      // truncate the file underneath the mapping or reader.
+      if(NumSections() == 1 && !m_FrameCaptureInUse)
       {
         // seek to the start of where the section is.
         FileIO::fseek64(m_File, m_SectionLocations[0].headerOffset, SEEK_SET);
@@ -1019,8 +1089,10 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
           // close the file writing to the temp location
           FileIO::fclose(m_File);
 
-          // move the temp file over the original
-          FileIO::Move(tempFilename.c_str(), m_Filename.c_str(), true);
+          // move the temp file over the original. Any mapping or reader of the old frame capture
+          // keeps referring to the original file's data, and nothing in the new file is in use yet
+          if(FileIO::Move(tempFilename.c_str(), m_Filename.c_str(), true))
+            m_FrameCaptureInUse = false;
 
           // re-open the file after it's been overwritten.
           m_File = FileIO::fopen(m_Filename.c_str(), "r+b");
@@ -1158,17 +1230,13 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
 
   StreamWriter *compWriter = NULL;
 
-  if(props.flags & SectionFlags::LZ4Compressed)
+  if(props.flags & (SectionFlags::LZ4Compressed | SectionFlags::ZstdCompressed))
   {
-    // the user will delete the compressed writer, and then it will delete the compressor and the
+    // compress blocks on worker threads, the output is readable by the LZ4/Zstd decompressors.
+    // The user will delete the compressed writer, and then it will delete the compressor and the
     // file writer
-    compWriter =
-        new StreamWriter(new LZ4Compressor(fileWriter, Ownership::Stream), Ownership::Stream);
-  }
-  else if(props.flags & SectionFlags::ZstdCompressed)
-  {
-    compWriter =
-        new StreamWriter(new ZSTDCompressor(fileWriter, Ownership::Stream), Ownership::Stream);
+    compWriter = new StreamWriter(new ParallelCompressor(fileWriter, Ownership::Stream, props.flags),
+                                  Ownership::Stream);
   }
 
   uint64_t dataOffset = FileIO::ftell64(m_File);
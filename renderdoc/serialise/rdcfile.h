@@ -96,6 +96,12 @@ public:
   int NumSections() const { return int(m_Sections.size()); }
   const SectionProperties &GetSectionProperties(int index) const { return m_Sections[index]; }
   StreamReader *ReadSection(int index) const;
+  // reads a range of a section through a new handle to the file, so the stream can be kept for as
+  // long as needed and read independently of anything else. Only the frame capture can be read like
+  // this, since other sections move when the file is modified, and only if it's uncompressed or
+  // block-indexed so the range can be read without decompressing from the start. Otherwise this
+  // returns NULL.
+  StreamReader *ReadSectionRange(int index, uint64_t offset, uint64_t size) const;
   StreamWriter *WriteSection(const SectionProperties &props);
 
   // Only valid if GetDriver returns RDCDriver::Image, passes over the underlying FILE * for use
@@ -106,6 +112,11 @@ private:
   void Init(StreamReader &reader);
 
   FILE *m_File = NULL;
+
+  // set once the frame capture section has been handed out as a memory-mapped reader, or a reader
+  // with its own file handle. Either can outlive this file, so from then on the section must never
+  // be rewritten in place.
+  mutable bool m_FrameCaptureInUse = false;
   rdcstr m_Filename;
   bytebuf m_Buffer;
 
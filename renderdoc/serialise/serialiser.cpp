@@ -27,7 +27,19 @@
 
 #include "serialiser.h"
 #include "core/core.h"
+#include "core/settings.h"
 #include "strings/string_utils.h"
+#include "lazychunks.h"
+#include "zstd/xxhash.h"
+
+RDOC_CONFIG(bool, Serialise_StructuredDataArena, true,
+            "Allocate exported structured data objects from per-file slabs rather than "
+            "individually on the heap.");
+
+RDOC_DEBUG_CONFIG(bool, Replay_Debug_VerifyDecodeCache, false,
+                  "Check every value handed out from the decoded chunk cache against a fresh "
+                  "decode, to find chunks that modify their decoded data in place. This is slower "
+                  "than not caching at all.");
 
 #if ENABLED(RDOC_DEVEL)
 
@@ -83,6 +95,216 @@ void DumpChunk(bool reading, FileIO::LogFileHandle *log, SDChunk *chunk)
   DumpObject(log, "  ", chunk);
 }
 
+/////////////////////////////////////////////////////////////
+// Decode cache functions
+
+template <>
+void Serialiser<SerialiserMode::Reading>::AbandonDecodeCache()
+{
+  if(!m_DecodeChunk || !m_DecodeChunk->cacheable)
+    return;
+
+  rdcarray<DecodedElement> &elements = m_DecodeChunk->elements;
+
+  // any values already handed out are now owned by the caller, who will deserialise them as normal.
+  // Anything we still hold must be freed here.
+  size_t handedOut = elements.size();
+
+  if(m_DecodeReplaying)
+  {
+    handedOut = m_DecodeIndex;
+
+    // continue reading the stream from just after the last element handed out
+    m_Read->SetOffset(handedOut > 0 ? elements[handedOut - 1].endOffset
+                                    : m_DecodeChunk->bodyOffset);
+    m_DecodeReplaying = false;
+  }
+
+  for(size_t i = 0; i < elements.size(); i++)
+  {
+    if(elements[i].destroy)
+      elements[i].destroy(elements[i].data, elements[i].count, i >= handedOut);
+  }
+
+  elements.clear();
+  m_DecodeChunk->complete = false;
+  m_DecodeChunk->cacheable = false;
+}
+
+template <>
+DecodedElement *Serialiser<SerialiserMode::Reading>::NextDecodedElement(const rdcliteral &name,
+                                                                        const void *type)
+{
+  if(!m_DecodeReplaying)
+    return NULL;
+
+  if(m_DecodeIndex < m_DecodeChunk->elements.size())
+  {
+    DecodedElement &el = m_DecodeChunk->elements[m_DecodeIndex];
+
+    if(el.type == type && (el.name == name.c_str() || !strcmp(el.name, name.c_str())))
+    {
+      m_DecodeIndex++;
+      return &el;
+    }
+  }
+
+  // the chunk didn't serialise the same thing as when it was cached, so we can't trust any of it.
+  RDCWARN("Decoded chunk mismatch at '%s' in %s, reading from stream", name.c_str(),
+          GetCurChunkName().c_str());
+
+  AbandonDecodeCache();
+
+  return NULL;
+}
+
+template <>
+void *Serialiser<SerialiserMode::Reading>::AllocDecoded(size_t size, size_t align)
+{
+  return m_DecodeCache->Allocate(size, align);
+}
+
+template <>
+void Serialiser<SerialiserMode::Reading>::PushDecoded(const rdcliteral &name, const void *type,
+                                                      void (*destroy)(void *, uint64_t, bool),
+                                                      void *data, uint64_t count)
+{
+  m_DecodeChunk->elements.push_back(
+      {name.c_str(), type, destroy, data, count, m_Read->GetOffset()});
+}
+
+template <>
+bool Serialiser<SerialiserMode::Reading>::VerifyingDecodeCache() const
+{
+  return m_DecodeReplaying && Replay_Debug_VerifyDecodeCache();
+}
+
+template <>
+uint64_t Serialiser<SerialiserMode::Reading>::BeginDecodeVerify()
+{
+  uint64_t offset = m_Read->GetOffset();
+
+  // the element was just handed out, so it's the one before m_DecodeIndex
+  const rdcarray<DecodedElement> &elements = m_DecodeChunk->elements;
+  size_t idx = m_DecodeIndex - 1;
+  m_Read->SetOffset(idx > 0 ? elements[idx - 1].endOffset : m_DecodeChunk->bodyOffset);
+
+  // decode below the top level so nothing is looked up in or added to the cache
+  m_DecodeDepth++;
+
+  return offset;
+}
+
+// the decode cache is only used when reading, these are never called
+
+template <>
+DecodedElement *Serialiser<SerialiserMode::Writing>::NextDecodedElement(const rdcliteral &,
+                                                                        const void *)
+{
+  return NULL;
+}
+
+template <>
+void *Serialiser<SerialiserMode::Writing>::AllocDecoded(size_t, size_t)
+{
+  return NULL;
+}
+
+template <>
+void Serialiser<SerialiserMode::Writing>::PushDecoded(const rdcliteral &, const void *,
+                                                      void (*)(void *, uint64_t, bool), void *,
+                                                      uint64_t)
+{
+}
+
+template <>
+void Serialiser<SerialiserMode::Writing>::AbandonDecodeCache()
+{
+}
+
+template <>
+bool Serialiser<SerialiserMode::Writing>::VerifyingDecodeCache() const
+{
+  return false;
+}
+
+template <>
+uint64_t Serialiser<SerialiserMode::Writing>::BeginDecodeVerify()
+{
+  return 0;
+}
+
+template <>
+Serialiser<SerialiserMode::Writing> *Serialiser<SerialiserMode::Writing>::MakeDecodeVerifyEncoder()
+{
+  return NULL;
+}
+
+template <>
+void Serialiser<SerialiserMode::Writing>::EndDecodeVerify(uint64_t, const rdcliteral &,
+                                                          Serialiser<SerialiserMode::Writing> *,
+                                                          Serialiser<SerialiserMode::Writing> *)
+{
+}
+
+/////////////////////////////////////////////////////////////
+// Blob deduplication functions
+
+template <>
+Serialiser<SerialiserMode::Writing>::BlobKey Serialiser<SerialiserMode::Writing>::HashBlob(
+    const byte *data, uint64_t size)
+{
+  // two independently seeded hashes and the size, so that a collision would need to be
+  // astronomically unlucky before it could corrupt a capture
+  BlobKey ret;
+  ret.hash[0] = XXH64(data, (size_t)size, 0);
+  ret.hash[1] = XXH64(data, (size_t)size, 0x9e3779b97f4a7c15ULL);
+  ret.size = size;
+  return ret;
+}
+
+template <>
+Serialiser<SerialiserMode::Reading>::BlobKey Serialiser<SerialiserMode::Reading>::HashBlob(
+    const byte *, uint64_t)
+{
+  // blobs are only hashed when writing
+  return BlobKey();
+}
+
+template <>
+void Serialiser<SerialiserMode::Writing>::ReadBlobReference(byte *, uint64_t, uint64_t)
+{
+}
+
+template <>
+void Serialiser<SerialiserMode::Reading>::ReadBlobReference(byte *el, uint64_t byteSize,
+                                                           uint64_t blobOffset)
+{
+  if(m_Dummy || m_Read->IsErrored())
+    return;
+
+  uint64_t offs = m_Read->GetOffset();
+
+  if(blobOffset + byteSize > offs)
+  {
+    RDCERR("Invalid blob reference to %llu bytes at %llu, from %llu", byteSize, blobOffset, offs);
+    m_Read->SetErrored();
+    return;
+  }
+
+  m_Read->SetOffset(blobOffset);
+
+  if(m_Read->GetOffset() != blobOffset)
+  {
+    RDCERR("Can't resolve blob reference at %llu, stream isn't seekable", blobOffset);
+    m_Read->SetErrored();
+    return;
+  }
+
+  m_Read->Read(el, byteSize);
+  m_Read->SetOffset(offs);
+}
+
 /////////////////////////////////////////////////////////////
 // Read Serialiser functions
 
@@ -113,6 +335,8 @@ uint32_t Serialiser<SerialiserMode::Reading>::BeginChunk(uint32_t, uint64_t)
 
   m_ChunkMetadata = SDChunkMetaData();
 
+  uint64_t chunkOffset = m_Read->GetOffset();
+
   {
     uint32_t c = 0;
     bool success = m_Read->Read(c);
@@ -181,6 +405,28 @@ uint32_t Serialiser<SerialiserMode::Reading>::BeginChunk(uint32_t, uint64_t)
     m_LastChunkOffset = m_Read->GetOffset();
   }
 
+  m_DecodeChunk = NULL;
+  m_DecodeReplaying = false;
+  m_DecodeIndex = 0;
+
+  // the cache is never used for structured export, which needs to see every element as it's read
+  if(m_DecodeCache && !m_ExportStructured && !m_DataStreaming && !m_Read->IsErrored())
+  {
+    DecodedChunk *chunk = m_DecodeCache->Find(chunkOffset);
+
+    if(!chunk)
+    {
+      chunk = m_DecodeCache->Add(chunkOffset);
+      chunk->bodyOffset = m_LastChunkOffset;
+    }
+
+    if(chunk->cacheable)
+    {
+      m_DecodeChunk = chunk;
+      m_DecodeReplaying = chunk->complete;
+    }
+  }
+
   if(ExportStructure())
   {
     rdcstr name = m_ChunkLookup ? m_ChunkLookup(chunkID) : "";
@@ -188,13 +434,35 @@ uint32_t Serialiser<SerialiserMode::Reading>::BeginChunk(uint32_t, uint64_t)
     if(name.empty())
       name = "<Unknown Chunk>";
 
-    SDChunk *chunk = new SDChunk(name.c_str());
+    // lazily decoded contents are moved into a different file's chunk, so can't be allocated
+    // from this file's arena
+    m_StructuredArena = Serialise_StructuredDataArena() && !m_StructureOnly
+                            ? m_StructuredFile->GetArena()
+                            : NULL;
+
+    SDChunk *chunk = new(m_StructuredArena) SDChunk(name.c_str());
     chunk->metadata = m_ChunkMetadata;
 
     m_StructuredFile->chunks.push_back(chunk);
-    m_StructureStack.push_back(chunk);
 
-    m_InternalElement = 0;
+    // system chunks are few and small, and can have side-effects when processed so are always
+    // exported up front
+    if(m_LazyChunks && chunkID >= (uint32_t)SystemChunk::FirstDriverChunk)
+    {
+      chunk->metadata.flags |= SDChunkFlags::Lazy;
+
+      m_LazyChunk = chunk;
+      m_LazyChunkOffset = chunkOffset;
+
+      // suppress export of the contents until EndChunk
+      m_InternalElement = 1;
+    }
+    else
+    {
+      m_StructureStack.push_back(chunk);
+
+      m_InternalElement = 0;
+    }
   }
 
   return chunkID;
@@ -203,6 +471,8 @@ uint32_t Serialiser<SerialiserMode::Reading>::BeginChunk(uint32_t, uint64_t)
 template <>
 void Serialiser<SerialiserMode::Reading>::SkipCurrentChunk()
 {
+  AbandonDecodeCache();
+
   if(ExportStructure())
   {
     RDCASSERTMSG("Skipping chunk after we've begun serialising!", m_StructureStack.size() == 1,
@@ -211,7 +481,8 @@ void Serialiser<SerialiserMode::Reading>::SkipCurrentChunk()
     SDObject &current = *m_StructureStack.back();
 
     current.data.basic.numChildren++;
-    current.data.children.push_back(new SDObject("Opaque chunk"_lit, "Byte Buffer"_lit));
+    current.data.children.push_back(
+        new(m_StructuredArena) SDObject("Opaque chunk"_lit, "Byte Buffer"_lit));
 
     SDObject &obj = *current.data.children.back();
     obj.type.basetype = SDBasic::Buffer;
@@ -264,6 +535,22 @@ void Serialiser<SerialiserMode::Reading>::SkipCurrentChunk()
 template <>
 void Serialiser<SerialiserMode::Reading>::EndChunk()
 {
+  if(m_DecodeChunk && m_DecodeReplaying)
+  {
+    // nothing was read from the stream, jump straight past the chunk
+    m_Read->SetOffset(m_DecodeChunk->endOffset);
+
+    m_DecodeChunk = NULL;
+    m_DecodeReplaying = false;
+    return;
+  }
+
+  if(m_LazyChunk)
+  {
+    m_LazyChunk->type.byteSize = m_ChunkMetadata.length;
+    m_InternalElement = 0;
+  }
+
   if(ExportStructure())
   {
     RDCASSERTMSG("Object Stack is imbalanced!", m_StructureStack.size() <= 1,
@@ -307,6 +594,31 @@ void Serialiser<SerialiserMode::Reading>::EndChunk()
 
   // align to the natural chunk alignment
   m_Read->AlignTo<ChunkAlignment>();
+
+  if(m_LazyChunk)
+  {
+    if(m_Read->IsErrored())
+      m_LazyChunk->metadata.flags &= ~SDChunkFlags::Lazy;
+    else
+      m_LazyChunks->AddChunk(m_LazyChunk, m_LazyChunkOffset,
+                             m_Read->GetOffset() - m_LazyChunkOffset);
+
+    m_LazyChunk = NULL;
+  }
+
+  if(m_DecodeChunk)
+  {
+    if(m_Read->IsErrored())
+      AbandonDecodeCache();
+
+    if(m_DecodeChunk->cacheable)
+    {
+      m_DecodeChunk->endOffset = m_Read->GetOffset();
+      m_DecodeChunk->complete = true;
+    }
+
+    m_DecodeChunk = NULL;
+  }
 }
 
 /////////////////////////////////////////////////////////////
@@ -329,6 +641,47 @@ Serialiser<SerialiserMode::Writing>::~Serialiser()
     m_Write->Finish();
     delete m_Write;
   }
+
+  SAFE_DELETE(m_ChunkBuffer);
+}
+
+// the decode cache verification encodes with writers, so it must follow their specialisations
+
+template <>
+Serialiser<SerialiserMode::Writing> *Serialiser<SerialiserMode::Reading>::MakeDecodeVerifyEncoder()
+{
+  Serialiser<SerialiserMode::Writing> *ret =
+      new Serialiser<SerialiserMode::Writing>(new StreamWriter(1024), Ownership::Stream);
+  ret->SetUserData(m_pUserData);
+  ret->SetComparisonOnly(true);
+  return ret;
+}
+
+template <>
+void Serialiser<SerialiserMode::Reading>::EndDecodeVerify(
+    uint64_t offset, const rdcliteral &name, Serialiser<SerialiserMode::Writing> *fresh,
+    Serialiser<SerialiserMode::Writing> *cached)
+{
+  m_DecodeDepth--;
+  m_Read->SetOffset(offset);
+
+  StreamWriter *a = fresh->GetWriter();
+  StreamWriter *b = cached->GetWriter();
+
+  bool match = a->GetOffset() == b->GetOffset() &&
+               memcmp(a->GetData(), b->GetData(), (size_t)a->GetOffset()) == 0;
+
+  delete fresh;
+  delete cached;
+
+  if(!match)
+  {
+    RDCERR("Cached decode of '%s' in %s no longer matches the stream. The chunk modifies its "
+           "decoded data in place and must call SetChunkUncacheable().",
+           name.c_str(), GetCurChunkName().c_str());
+
+    AbandonDecodeCache();
+  }
 }
 
 template <>
@@ -357,6 +710,25 @@ uint32_t Serialiser<SerialiserMode::Writing>::BeginChunk(uint32_t chunkID, uint6
 
       m_ChunkMetadata.chunkID = chunkID;
 
+      // the estimate includes the full size of any buffers that end up deduplicated, so write the
+      // chunk to memory first and fix up the length once we know it.
+      if(m_DeduplicateBlobs && byteLength > 0 && !m_DataStreaming)
+      {
+        if(!m_ChunkBuffer)
+          m_ChunkBuffer = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+        m_ChunkBuffer->Rewind();
+
+        // data aligned within the buffer must still be aligned once it's copied to the stream
+        byte skip[ChunkAlignment] = {};
+        m_ChunkBufferSkip = m_Write->GetOffset() % ChunkAlignment;
+        m_ChunkBuffer->Write(skip, m_ChunkBufferSkip);
+
+        m_ChunkBufferBase = m_Write->GetOffset() - m_ChunkBufferSkip;
+        m_ChunkStream = m_Write;
+        m_Write = m_ChunkBuffer;
+      }
+
       /////////////////
 
       m_Write->Write(c);
@@ -448,7 +820,9 @@ uint32_t Serialiser<SerialiserMode::Writing>::BeginChunk(uint32_t chunkID, uint6
     if(name.empty())
       name = "<Unknown Chunk>";
 
-    SDChunk *chunk = new SDChunk(name.c_str());
+    m_StructuredArena = Serialise_StructuredDataArena() ? m_StructuredFile->GetArena() : NULL;
+
+    SDChunk *chunk = new(m_StructuredArena) SDChunk(name.c_str());
     chunk->metadata = m_ChunkMetadata;
 
     m_StructuredFile->chunks.push_back(chunk);
@@ -490,6 +864,38 @@ void Serialiser<SerialiserMode::Writing>::EndChunk()
 
     m_ChunkMetadata.length = chunkLength;
   }
+  else if(m_ChunkStream)
+  {
+    uint64_t writtenLength = (m_Write->GetOffset() - m_LastChunkOffset);
+
+    if(writtenLength > m_ChunkMetadata.length)
+    {
+      RDCERR(
+          "!!! "
+          "ESTIMATED UPPER BOUND CHUNK LENGTH %llu EXCEEDED: %llu. "
+          "CAPTURE WILL BE CORRUPTED. "
+          "!!!",
+          m_ChunkMetadata.length, writtenLength);
+    }
+    else
+    {
+      // the length was written just before m_LastChunkOffset, as 64-bit if the estimate needed it
+      if(m_ChunkMetadata.length > 0xffffffff)
+        m_Write->WriteAt(m_LastChunkOffset - sizeof(uint64_t), writtenLength);
+      else
+        m_Write->WriteAt(m_LastChunkOffset - sizeof(uint32_t), uint32_t(writtenLength));
+
+      m_ChunkMetadata.length = writtenLength;
+    }
+
+    m_Write = m_ChunkStream;
+    m_ChunkStream = NULL;
+
+    m_Write->Write(m_ChunkBuffer->GetData() + m_ChunkBufferSkip,
+                   m_ChunkBuffer->GetOffset() - m_ChunkBufferSkip);
+
+    m_ChunkBufferBase = 0;
+  }
   else
   {
     uint64_t writtenLength = (m_Write->GetOffset() - m_LastChunkOffset);
@@ -499,11 +905,10 @@ void Serialiser<SerialiserMode::Writing>::EndChunk()
       uint64_t numPadBytes = m_ChunkMetadata.length - writtenLength;
 
       // need to write some padding bytes so that the length is accurate
-      for(uint64_t i = 0; i < numPadBytes; i++)
-      {
-        byte padByte = 0xbb;
-        m_Write->Write(padByte);
-      }
+      byte padBytes[256];
+      memset(padBytes, 0xbb, sizeof(padBytes));
+      for(uint64_t i = 0; i < numPadBytes; i += sizeof(padBytes))
+        m_Write->Write(padBytes, RDCMIN(numPadBytes - i, (uint64_t)sizeof(padBytes)));
 
       RDCDEBUG("Chunk estimated at %llu bytes, actual length %llu. Added %llu bytes padding.",
                m_ChunkMetadata.length, writtenLength, numPadBytes);
@@ -560,6 +965,8 @@ void Serialiser<SerialiserMode::Writing>::WriteStructuredFile(const SDFile &file
 
   for(size_t i = 0; i < file.chunks.size(); i++)
   {
+    file.PopulateChunk(file.chunks[i]);
+
     const SDChunk &chunk = *file.chunks[i];
 
     m_ChunkMetadata = chunk.metadata;
@@ -653,6 +1060,7 @@ rdcstr DoStringise(const SDChunkFlags &el)
 
     STRINGISE_BITFIELD_CLASS_BIT(OpaqueChunk);
     STRINGISE_BITFIELD_CLASS_BIT(HasCallstack);
+    STRINGISE_BITFIELD_CLASS_BIT(Lazy);
   }
   END_BITFIELD_STRINGISE();
 }
@@ -997,6 +1405,64 @@ Chunk::Chunk(Serialiser<SerialiserMode::Writing> &ser, uint16_t chunkType, Chunk
 #endif
 }
 
+DecodedChunk *ChunkDecodeCache::Find(uint64_t offset)
+{
+  auto it = m_Chunks.find(offset);
+  if(it == m_Chunks.end())
+    return NULL;
+  return &it->second;
+}
+
+DecodedChunk *ChunkDecodeCache::Add(uint64_t offset)
+{
+  return &m_Chunks[offset];
+}
+
+void *ChunkDecodeCache::Allocate(size_t size, size_t align)
+{
+  if(size > PageSize / 4)
+  {
+    byte *ret = AllocAlignedBuffer(size);
+    m_LargeAllocs.push_back(ret);
+    return ret;
+  }
+
+  m_PageHead = AlignUp(m_PageHead, align);
+
+  if(m_Pages.empty() || m_PageHead + size > PageSize)
+  {
+    m_Pages.push_back(AllocAlignedBuffer(PageSize));
+    m_PageHead = 0;
+  }
+
+  byte *ret = m_Pages.back() + m_PageHead;
+  m_PageHead += size;
+  return ret;
+}
+
+void ChunkDecodeCache::Clear()
+{
+  for(auto it = m_Chunks.begin(); it != m_Chunks.end(); ++it)
+  {
+    for(DecodedElement &el : it->second.elements)
+    {
+      if(el.destroy)
+        el.destroy(el.data, el.count, true);
+    }
+  }
+
+  m_Chunks.clear();
+
+  for(byte *page : m_Pages)
+    FreeAlignedBuffer(page);
+  for(byte *alloc : m_LargeAllocs)
+    FreeAlignedBuffer(alloc);
+
+  m_Pages.clear();
+  m_LargeAllocs.clear();
+  m_PageHead = 0;
+}
+
 ChunkAllocator::~ChunkAllocator()
 {
   for(Page &p : freePages)
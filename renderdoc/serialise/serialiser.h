@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <map>
 #include <set>
 #include "api/replay/structured_data.h"
 #include "common/formatting.h"
@@ -55,6 +56,13 @@ enum class SerialiserFlags
 {
   NoFlags = 0x0,
   AllocateMemory = 0x1,
+  // for byte buffers - when reading, if the stream holds the data resident in memory then point at
+  // it in place instead of allocating or copying. The data is read-only and owned by the stream.
+  InPlace = 0x2,
+  // for byte buffers - when the writer has blob deduplication enabled (see SetBlobDeduplication),
+  // contents identical to a buffer written earlier in the stream are replaced by a reference to
+  // that first copy. References are resolved when reading by seeking back to the original.
+  Deduplicate = 0x4,
 };
 
 BITMASK_OPERATORS(SerialiserFlags);
@@ -80,6 +88,51 @@ enum class SerialiserMode
 
 struct CompressedFileIO;
 
+// a copy of one top-level element decoded in a chunk, see ChunkDecodeCache.
+struct DecodedElement
+{
+  const char *name;
+  // unique per C++ type, so that a chunk serialising something different can be detected
+  const void *type;
+  // destroys count elements at data. If deep is true, anything the values own is freed as well
+  void (*destroy)(void *data, uint64_t count, bool deep);
+  void *data;
+  uint64_t count;
+  // stream offset just after this element
+  uint64_t endOffset;
+};
+
+struct DecodedChunk
+{
+  uint64_t bodyOffset = 0;
+  uint64_t endOffset = 0;
+  bool complete = false;
+  bool cacheable = true;
+  rdcarray<DecodedElement> elements;
+};
+
+// types that can be copied out of the decode cache. Anything else is always read from the stream
+template <typename T>
+struct IsDecodeCacheable
+    : std::integral_constant<bool, std::is_copy_constructible<T>::value &&
+                                       std::is_copy_assignable<T>::value>
+{
+};
+
+template <typename U>
+struct IsDecodeCacheable<rdcarray<U>> : IsDecodeCacheable<U>
+{
+};
+
+template <typename U, typename V>
+struct IsDecodeCacheable<rdcpair<U, V>>
+    : std::integral_constant<bool, IsDecodeCacheable<U>::value && IsDecodeCacheable<V>::value>
+{
+};
+
+class ChunkDecodeCache;
+class LazyChunkSource;
+
 template <SerialiserMode sertype>
 class Serialiser
 {
@@ -117,6 +170,8 @@ public:
   bool IsErrored() { return IsReading() ? m_Read->IsErrored() : m_Write->IsErrored(); }
   void SetErrored() { IsReading() ? m_Read->SetErrored() : m_Write->SetErrored(); }
   bool IsDummy() { return m_Dummy; }
+  // returns true if ptr was serialised with SerialiserFlags::InPlace and points into the stream
+  bool IsInPlace(const void *ptr) const { return IsReading() && m_Read->IsInPlace(ptr); }
   StreamWriter *GetWriter() { return m_Write; }
   StreamReader *GetReader() { return m_Read; }
   uint32_t GetChunkMetadataRecording() { return m_ChunkFlags; }
@@ -140,6 +195,43 @@ public:
   // jumps to the byte after the current chunk, can be called any time after BeginChunk
   void SkipCurrentChunk();
 
+  // when reading the same stream repeatedly, chunks are decoded once into the cache and then
+  // handed out from there on subsequent reads. See ChunkDecodeCache
+  void SetDecodeCache(ChunkDecodeCache *cache) { m_DecodeCache = cache; }
+  // returns true if the values serialised in the current chunk are owned by the decode cache, in
+  // which case they must not be deserialised by the caller.
+  bool IsDecodeCacheOwned() const
+  {
+    return IsReading() && m_DecodeChunk && m_DecodeChunk->cacheable;
+  }
+  // for chunks that modify their decoded data in place, so it can't be re-used next time.
+  void SetChunkUncacheable()
+  {
+    if(IsReading())
+      AbandonDecodeCache();
+  }
+
+  // set on a writing serialiser that only encodes values to compare them, never to be read back.
+  // Object handles may not be valid to look up, so they can be encoded by value instead.
+  void SetComparisonOnly(bool comparison) { m_ComparisonOnly = comparison; }
+  bool IsComparisonOnly() const { return m_ComparisonOnly; }
+
+  // while exporting structure, only keep each chunk's metadata and register it with the source so
+  // its contents can be decoded when they're first needed. See LazyChunkSource
+  void SetLazyChunks(LazyChunkSource *lazy) { m_LazyChunks = lazy; }
+  // set when a chunk is only being read to build its structured data, so it must not be replayed
+  void SetStructureOnly(bool structureOnly) { m_StructureOnly = structureOnly; }
+  bool IsStructureOnly() const { return m_StructureOnly; }
+
+  // when writing, store byte buffers serialised with SerialiserFlags::Deduplicate only once and
+  // reference the first copy from then on. The stream must be seekable when it's read back, e.g. an
+  // uncompressed or SectionFlags::BlockIndexed section.
+  // Chunks begun with a size estimate are buffered in memory while this is enabled, so their header
+  // can hold the real size instead of the estimate being padded out.
+  void SetBlobDeduplication(bool dedup) { m_DeduplicateBlobs = dedup; }
+  // the number of bytes that were replaced by references instead of being written
+  uint64_t GetDeduplicatedBytes() const { return m_DeduplicatedBytes; }
+
   //////////////////////////////////////////
   // Version checking
 
@@ -216,6 +308,9 @@ public:
   Serialiser &Serialise(const rdcliteral &name, T &el,
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecoded(name, el, flags, IsDecodeCacheable<T>());
+
     if(ExportStructure())
     {
       if(m_StructureStack.empty())
@@ -227,7 +322,7 @@ public:
       SDObject &current = *m_StructureStack.back();
 
       current.data.basic.numChildren++;
-      current.data.children.push_back(new SDObject(name, TypeName<T>()));
+      current.data.children.push_back(new(m_StructuredArena) SDObject(name, TypeName<T>()));
       m_StructureStack.push_back(current.data.children.back());
 
       SDObject &obj = *m_StructureStack.back();
@@ -248,19 +343,44 @@ public:
   Serialiser &Serialise(const rdcliteral &name, byte *&el, uint64_t byteSize,
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecodedBuffer(name, el, byteSize, flags);
+
     // silently handle NULL buffers
     if(IsWriting() && el == NULL)
       byteSize = 0;
 
+    // if non-zero, the offset of an identical buffer earlier in the stream
+    uint64_t blobOffset = 0;
+    BlobKey blobKey = {};
+
+    if(IsWriting() && m_DeduplicateBlobs && (flags & SerialiserFlags::Deduplicate) &&
+       byteSize >= MinDeduplicatedBlobSize)
+    {
+      blobKey = HashBlob(el, byteSize);
+
+      auto it = m_BlobOffsets.find(blobKey);
+      if(it != m_BlobOffsets.end())
+        blobOffset = it->second;
+    }
+
     {
       m_InternalElement++;
-      DoSerialise(*this, byteSize);
+      uint64_t serialisedSize = byteSize | (blobOffset ? BlobReferenceBit : 0);
+      DoSerialise(*this, serialisedSize);
+      if((flags & SerialiserFlags::Deduplicate) && (serialisedSize & BlobReferenceBit))
+      {
+        serialisedSize &= ~BlobReferenceBit;
+        DoSerialise(*this, blobOffset);
+      }
+      byteSize = serialisedSize;
       m_InternalElement--;
     }
 
     if(IsReading())
     {
       VerifyArraySize(byteSize);
+      m_LastArrayCount = byteSize;
     }
 
     if(ExportStructure())
@@ -274,7 +394,7 @@ public:
       SDObject &current = *m_StructureStack.back();
 
       current.data.basic.numChildren++;
-      current.data.children.push_back(new SDObject(name, "Byte Buffer"_lit));
+      current.data.children.push_back(new(m_StructuredArena) SDObject(name, "Byte Buffer"_lit));
       m_StructureStack.push_back(current.data.children.back());
 
       SDObject &obj = *m_StructureStack.back();
@@ -285,46 +405,81 @@ public:
     byte *tempAlloc = NULL;
 
     {
-      if(IsWriting())
+      if(IsWriting() && blobOffset)
+      {
+        // the data was already written, the reference above is all that's needed
+        m_DeduplicatedBytes += byteSize;
+      }
+      else if(IsWriting())
       {
         // ensure byte alignment
         m_Write->AlignTo<ChunkAlignment>();
 
+        if(blobKey.size > 0)
+          m_BlobOffsets[blobKey] = m_ChunkBufferBase + m_Write->GetOffset();
+
         if(el)
           m_Write->Write(el, byteSize);
         else
           RDCASSERT(byteSize == 0);
       }
+      else if(IsReading() && blobOffset)
+      {
+// see below for why coverity builds don't allocate
+#if !defined(__COVERITY__)
+        if(!m_Dummy && (flags & SerialiserFlags::AllocateMemory))
+          el = AllocAlignedBuffer(byteSize);
+
+        if(el == NULL && ExportStructure() && m_ExportBuffers)
+          el = tempAlloc = AllocAlignedBuffer(byteSize);
+#endif
+
+        // nothing to do if no-one wants the data, the reference takes no space in the stream
+        if(el)
+          ReadBlobReference(el, byteSize, blobOffset);
+      }
       else if(IsReading())
       {
         // ensure byte alignment
         m_Read->AlignTo<ChunkAlignment>();
 
+        const byte *inplace = NULL;
+
+        if(!m_Dummy && (flags & SerialiserFlags::InPlace))
+          inplace = m_Read->ReadInPlace(byteSize);
+
+        if(inplace)
+        {
+          el = (byte *)inplace;
+        }
+        else
+        {
 // Coverity is unable to tie this allocation together with the automatic scoped deallocation in the
 // ScopedDeseralise* classes. We can verify with e.g. valgrind that there are no leaks, so to keep
 // the analysis non-spammy we just don't allocate for coverity builds
 #if !defined(__COVERITY__)
-        if(!m_Dummy && (flags & SerialiserFlags::AllocateMemory))
-        {
-          if(byteSize > 0)
-            el = AllocAlignedBuffer(byteSize);
-          else
-            el = NULL;
-        }
-
-        // if we're exporting the buffers, make sure to always alloc space to read the data, so we
-        // can save it out, even if the external code has no use for it and has asked for no
-        // allocation.
-        if(el == NULL && ExportStructure() && m_ExportBuffers)
-        {
-          if(byteSize > 0)
-            el = tempAlloc = AllocAlignedBuffer(byteSize);
-          else
-            el = NULL;
-        }
+          if(!m_Dummy && (flags & SerialiserFlags::AllocateMemory))
+          {
+            if(byteSize > 0)
+              el = AllocAlignedBuffer(byteSize);
+            else
+              el = NULL;
+          }
+
+          // if we're exporting the buffers, make sure to always alloc space to read the data, so
+          // we can save it out, even if the external code has no use for it and has asked for no
+          // allocation.
+          if(el == NULL && ExportStructure() && m_ExportBuffers)
+          {
+            if(byteSize > 0)
+              el = tempAlloc = AllocAlignedBuffer(byteSize);
+            else
+              el = NULL;
+          }
 #endif
 
-        m_Read->Read(el, byteSize);
+          m_Read->Read(el, byteSize);
+        }
       }
     }
 
@@ -361,6 +516,9 @@ public:
   Serialiser &Serialise(const rdcliteral &name, bytebuf &el,
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecoded(name, el, flags, std::true_type());
+
     uint64_t count = (uint64_t)el.size();
 
     {
@@ -385,7 +543,7 @@ public:
       SDObject &current = *m_StructureStack.back();
 
       current.data.basic.numChildren++;
-      current.data.children.push_back(new SDObject(name, "Byte Buffer"_lit));
+      current.data.children.push_back(new(m_StructuredArena) SDObject(name, "Byte Buffer"_lit));
       m_StructureStack.push_back(current.data.children.back());
 
       SDObject &obj = *m_StructureStack.back();
@@ -476,6 +634,9 @@ public:
   Serialiser &Serialise(const rdcliteral &name, T (&el)[N],
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecodedFixed(name, el, flags, IsDecodeCacheable<T>());
+
     // for consistency with other arrays, even though this is redundant, we serialise out and in the
     // size
     uint64_t count = N;
@@ -498,7 +659,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
       parent.data.basic.numChildren++;
-      parent.data.children.push_back(new SDObject(name, TypeName<T>()));
+      parent.data.children.push_back(new(m_StructuredArena) SDObject(name, TypeName<T>()));
       m_StructureStack.push_back(parent.data.children.back());
 
       SDObject &arr = *m_StructureStack.back();
@@ -511,7 +672,7 @@ public:
 
       for(size_t i = 0; i < N; i++)
       {
-        arr.data.children[i] = new SDObject("$el"_lit, TypeName<T>());
+        arr.data.children[i] = new(m_StructuredArena) SDObject("$el"_lit, TypeName<T>());
         m_StructureStack.push_back(arr.data.children[i]);
 
         SDObject &obj = *m_StructureStack.back();
@@ -569,6 +730,9 @@ public:
   Serialiser &Serialise(const rdcliteral &name, char (&el)[N],
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecodedFixed(name, el, flags, std::true_type());
+
     rdcstr str;
     if(IsWriting())
       str = el;
@@ -594,6 +758,9 @@ public:
   Serialiser &Serialise(const rdcliteral &name, T *&el, uint64_t arrayCount,
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecodedArray(name, el, arrayCount, flags, IsDecodeCacheable<T>());
+
     // silently handle NULL arrays
     if(IsWriting() && el == NULL)
       arrayCount = 0;
@@ -607,6 +774,7 @@ public:
     if(IsReading())
     {
       VerifyArraySize(arrayCount);
+      m_LastArrayCount = arrayCount;
     }
 
     if(ExportStructure())
@@ -619,7 +787,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
       parent.data.basic.numChildren++;
-      parent.data.children.push_back(new SDObject(name, TypeName<T>()));
+      parent.data.children.push_back(new(m_StructuredArena) SDObject(name, TypeName<T>()));
       m_StructureStack.push_back(parent.data.children.back());
 
       SDObject &arr = *m_StructureStack.back();
@@ -644,7 +812,7 @@ public:
 
       for(uint64_t i = 0; el && i < arrayCount; i++)
       {
-        arr.data.children[(size_t)i] = new SDObject("$el"_lit, TypeName<T>());
+        arr.data.children[(size_t)i] = new(m_StructuredArena) SDObject("$el"_lit, TypeName<T>());
         m_StructureStack.push_back(arr.data.children[(size_t)i]);
 
         SDObject &obj = *m_StructureStack.back();
@@ -689,6 +857,9 @@ public:
   Serialiser &Serialise(const rdcliteral &name, rdcarray<U> &el,
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecoded(name, el, flags, IsDecodeCacheable<rdcarray<U>>());
+
     uint64_t size = (uint64_t)el.size();
 
     {
@@ -712,7 +883,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
       parent.data.basic.numChildren++;
-      parent.data.children.push_back(new SDObject(name, TypeName<U>()));
+      parent.data.children.push_back(new(m_StructuredArena) SDObject(name, TypeName<U>()));
       m_StructureStack.push_back(parent.data.children.back());
 
       SDObject &arr = *m_StructureStack.back();
@@ -727,7 +898,7 @@ public:
 
       for(size_t i = 0; i < (size_t)size; i++)
       {
-        arr.data.children[i] = new SDObject("$el"_lit, TypeName<U>());
+        arr.data.children[i] = new(m_StructuredArena) SDObject("$el"_lit, TypeName<U>());
         m_StructureStack.push_back(arr.data.children[i]);
 
         SDObject &obj = *m_StructureStack.back();
@@ -759,6 +930,9 @@ public:
   Serialiser &Serialise(const rdcliteral &name, rdcpair<U, V> &el,
                         SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecoded(name, el, flags, IsDecodeCacheable<rdcpair<U, V>>());
+
     if(ExportStructure())
     {
       if(m_StructureStack.empty())
@@ -769,7 +943,7 @@ public:
 
       SDObject &parent = *m_StructureStack.back();
       parent.data.basic.numChildren++;
-      parent.data.children.push_back(new SDObject(name, "pair"_lit));
+      parent.data.children.push_back(new(m_StructuredArena) SDObject(name, "pair"_lit));
       m_StructureStack.push_back(parent.data.children.back());
 
       SDObject &arr = *m_StructureStack.back();
@@ -780,7 +954,7 @@ public:
       arr.data.children.resize(2);
 
       {
-        arr.data.children[0] = new SDObject("first"_lit, TypeName<U>());
+        arr.data.children[0] = new(m_StructuredArena) SDObject("first"_lit, TypeName<U>());
         m_StructureStack.push_back(arr.data.children[0]);
 
         SDObject &obj = *m_StructureStack.back();
@@ -795,7 +969,7 @@ public:
       }
 
       {
-        arr.data.children[1] = new SDObject("second"_lit, TypeName<V>());
+        arr.data.children[1] = new(m_StructuredArena) SDObject("second"_lit, TypeName<V>());
         m_StructureStack.push_back(arr.data.children[1]);
 
         SDObject &obj = *m_StructureStack.back();
@@ -842,6 +1016,9 @@ public:
   Serialiser &SerialiseNullable(const rdcliteral &name, T *&el,
                                 SerialiserFlags flags = SerialiserFlags::NoFlags)
   {
+    if(DecodeCacheActive())
+      return SerialiseDecodedNullable(name, el, flags, IsDecodeCacheable<T>());
+
     bool present = (el != NULL);
 
     {
@@ -887,7 +1064,7 @@ public:
       {
         SDObject &parent = *m_StructureStack.back();
         parent.data.basic.numChildren++;
-        parent.data.children.push_back(new SDObject(name, TypeName<T>()));
+        parent.data.children.push_back(new(m_StructuredArena) SDObject(name, TypeName<T>()));
 
         SDObject &nullable = *parent.data.children.back();
         nullable.type.basetype = SDBasic::Null;
@@ -952,6 +1129,9 @@ public:
   {
     RDCCOMPILE_ASSERT(IsReading(), "Can't write from a StreamWriter");
 
+    // streams are read straight through, they can't be cached
+    AbandonDecodeCache();
+
     uint64_t totalSize = 0;
 
     {
@@ -975,7 +1155,8 @@ public:
       SDObject &current = *m_StructureStack.back();
 
       current.data.basic.numChildren++;
-      current.data.children.push_back(new SDObject(name.c_str(), "Byte Buffer"_lit));
+      current.data.children.push_back(
+          new(m_StructuredArena) SDObject(name.c_str(), "Byte Buffer"_lit));
       m_StructureStack.push_back(current.data.children.back());
 
       SDObject &obj = *m_StructureStack.back();
@@ -1252,6 +1433,10 @@ protected:
 
   void SetDummy(bool dummy) { m_Dummy = dummy; }
 private:
+  // a reading serialiser creates writers to compare decoded values, see MakeDecodeVerifyEncoder
+  template <SerialiserMode>
+  friend class Serialiser;
+
   static const uint64_t ChunkAlignment = 64;
   template <class SerialiserMode, typename T, bool isEnum = std::is_enum<T>::value>
   struct SerialiseDispatch
@@ -1301,6 +1486,344 @@ private:
     }
   }
 
+  // only top-level elements in a chunk are cached, anything nested is serialised as normal as part
+  // of its parent
+  bool DecodeCacheActive() const
+  {
+    return IsReading() && m_DecodeChunk && m_DecodeChunk->cacheable && m_DecodeDepth == 0;
+  }
+
+  // returns the cached element if we're replaying a decoded chunk, or NULL if the element must be
+  // read from the stream. If the chunk doesn't match what was cached, falls back to the stream.
+  DecodedElement *NextDecodedElement(const rdcliteral &name, const void *type);
+  void *AllocDecoded(size_t size, size_t align);
+  void PushDecoded(const rdcliteral &name, const void *type,
+                   void (*destroy)(void *, uint64_t, bool), void *data, uint64_t count);
+  // stops caching the current chunk and continues reading it from the stream
+  void AbandonDecodeCache();
+
+  // with Replay_Debug_VerifyDecodeCache, each cached element handed out is compared against a fresh
+  // decode from the stream to catch chunks that modify their decoded data in place. Both are
+  // encoded with a comparison-only writer and the bytes compared. If they differ the chunk stops
+  // being cached.
+  bool VerifyingDecodeCache() const;
+  // seeks to the start of the element just handed out and returns the offset to restore
+  uint64_t BeginDecodeVerify();
+  Serialiser<SerialiserMode::Writing> *MakeDecodeVerifyEncoder();
+  void EndDecodeVerify(uint64_t offset, const rdcliteral &name,
+                       Serialiser<SerialiserMode::Writing> *fresh,
+                       Serialiser<SerialiserMode::Writing> *cached);
+
+  template <class T>
+  void VerifyDecoded(const rdcliteral &name, T &cached, SerialiserFlags flags)
+  {
+    uint64_t offset = BeginDecodeVerify();
+
+    T fresh = T();
+    Serialise(name, fresh, flags);
+
+    Serialiser<SerialiserMode::Writing> *a = MakeDecodeVerifyEncoder();
+    Serialiser<SerialiserMode::Writing> *b = MakeDecodeVerifyEncoder();
+    a->Serialise(name, fresh, flags);
+    b->Serialise(name, cached, flags);
+
+    Deserialise(fresh);
+
+    EndDecodeVerify(offset, name, a, b);
+  }
+
+  template <class T, size_t N>
+  void VerifyDecodedFixed(const rdcliteral &name, T (&cached)[N], SerialiserFlags flags)
+  {
+    uint64_t offset = BeginDecodeVerify();
+
+    T fresh[N] = {};
+    Serialise(name, fresh, flags);
+
+    Serialiser<SerialiserMode::Writing> *a = MakeDecodeVerifyEncoder();
+    Serialiser<SerialiserMode::Writing> *b = MakeDecodeVerifyEncoder();
+    a->Serialise(name, fresh, flags);
+    b->Serialise(name, cached, flags);
+
+    for(size_t i = 0; i < N; i++)
+      Deserialise(fresh[i]);
+
+    EndDecodeVerify(offset, name, a, b);
+  }
+
+  template <class T>
+  void VerifyDecodedArray(const rdcliteral &name, T *cached, uint64_t cachedCount,
+                          uint64_t arrayCount, SerialiserFlags flags)
+  {
+    uint64_t offset = BeginDecodeVerify();
+
+    T *fresh = NULL;
+    Serialise(name, fresh, arrayCount, flags | SerialiserFlags::AllocateMemory);
+    uint64_t freshCount = fresh ? m_LastArrayCount : 0;
+
+    Serialiser<SerialiserMode::Writing> *a = MakeDecodeVerifyEncoder();
+    Serialiser<SerialiserMode::Writing> *b = MakeDecodeVerifyEncoder();
+    a->Serialise(name, fresh, freshCount, flags);
+    b->Serialise(name, cached, cachedCount, flags);
+
+    for(uint64_t i = 0; i < freshCount; i++)
+      Deserialise(fresh[i]);
+    delete[] fresh;
+
+    EndDecodeVerify(offset, name, a, b);
+  }
+
+  template <class T>
+  void VerifyDecodedNullable(const rdcliteral &name, T *cached, SerialiserFlags flags)
+  {
+    uint64_t offset = BeginDecodeVerify();
+
+    T *fresh = NULL;
+    SerialiseNullable(name, fresh, flags);
+
+    Serialiser<SerialiserMode::Writing> *a = MakeDecodeVerifyEncoder();
+    Serialiser<SerialiserMode::Writing> *b = MakeDecodeVerifyEncoder();
+    a->SerialiseNullable(name, fresh, flags);
+    b->SerialiseNullable(name, cached, flags);
+
+    if(fresh)
+    {
+      Deserialise(*fresh);
+      delete fresh;
+    }
+
+    EndDecodeVerify(offset, name, a, b);
+  }
+
+  template <class T>
+  static const void *DecodedTypeTag()
+  {
+    static const char tag = 0;
+    return &tag;
+  }
+
+  template <class T>
+  static void DestroyDecoded(void *data, uint64_t count, bool deep)
+  {
+    T *el = (T *)data;
+    for(uint64_t i = 0; i < count; i++)
+    {
+      if(deep)
+        Deserialise(el[i]);
+      el[i].~T();
+    }
+  }
+
+  // the value is serialised as normal the first time and a copy stored, which then owns anything
+  // the value points to. Later reads copy it out again sharing the same pointers.
+  template <class T>
+  Serialiser &SerialiseDecoded(const rdcliteral &name, T &el, SerialiserFlags flags,
+                               std::true_type)
+  {
+    DecodedElement *cached = NextDecodedElement(name, DecodedTypeTag<T>());
+    if(cached)
+    {
+      el = *(T *)cached->data;
+      if(VerifyingDecodeCache())
+        VerifyDecoded(name, *(T *)cached->data, flags);
+      return *this;
+    }
+
+    m_DecodeDepth++;
+    Serialise(name, el, flags);
+    m_DecodeDepth--;
+
+    if(DecodeCacheActive())
+    {
+      T *copy = ::new(AllocDecoded(sizeof(T), alignof(T))) T(el);
+      PushDecoded(name, DecodedTypeTag<T>(), &DestroyDecoded<T>, copy, 1);
+    }
+
+    return *this;
+  }
+
+  template <class T>
+  Serialiser &SerialiseDecoded(const rdcliteral &name, T &el, SerialiserFlags flags,
+                               std::false_type)
+  {
+    AbandonDecodeCache();
+    return Serialise(name, el, flags);
+  }
+
+  template <class T, size_t N>
+  Serialiser &SerialiseDecodedFixed(const rdcliteral &name, T (&el)[N], SerialiserFlags flags,
+                                    std::true_type)
+  {
+    DecodedElement *cached = NextDecodedElement(name, DecodedTypeTag<T[N]>());
+    if(cached)
+    {
+      for(size_t i = 0; i < N; i++)
+        el[i] = ((T *)cached->data)[i];
+      if(VerifyingDecodeCache())
+        VerifyDecodedFixed(name, *(T(*)[N])cached->data, flags);
+      return *this;
+    }
+
+    m_DecodeDepth++;
+    Serialise(name, el, flags);
+    m_DecodeDepth--;
+
+    if(DecodeCacheActive())
+    {
+      T *copy = (T *)AllocDecoded(sizeof(T) * N, alignof(T));
+      for(size_t i = 0; i < N; i++)
+        ::new(copy + i) T(el[i]);
+      PushDecoded(name, DecodedTypeTag<T[N]>(), &DestroyDecoded<T>, copy, N);
+    }
+
+    return *this;
+  }
+
+  template <class T, size_t N>
+  Serialiser &SerialiseDecodedFixed(const rdcliteral &name, T (&el)[N], SerialiserFlags flags,
+                                    std::false_type)
+  {
+    AbandonDecodeCache();
+    return Serialise(name, el, flags);
+  }
+
+  template <class T>
+  Serialiser &SerialiseDecodedArray(const rdcliteral &name, T *&el, uint64_t arrayCount,
+                                    SerialiserFlags flags, std::true_type)
+  {
+    DecodedElement *cached = NextDecodedElement(name, DecodedTypeTag<T[]>());
+    if(cached)
+    {
+      uint64_t count = cached->count;
+
+      if(flags & SerialiserFlags::AllocateMemory)
+      {
+        if(count > 0)
+          el = new T[(size_t)count];
+        else
+          el = NULL;
+      }
+
+      for(uint64_t i = 0; el && i < count; i++)
+        el[i] = ((T *)cached->data)[i];
+
+      if(VerifyingDecodeCache())
+        VerifyDecodedArray(name, (T *)cached->data, count, arrayCount, flags);
+
+      return *this;
+    }
+
+    m_DecodeDepth++;
+    Serialise(name, el, arrayCount, flags);
+    m_DecodeDepth--;
+
+    if(DecodeCacheActive())
+    {
+      uint64_t count = el ? m_LastArrayCount : 0;
+      T *copy = count > 0 ? (T *)AllocDecoded(sizeof(T) * (size_t)count, alignof(T)) : NULL;
+      for(uint64_t i = 0; i < count; i++)
+        ::new(copy + i) T(el[i]);
+      PushDecoded(name, DecodedTypeTag<T[]>(), &DestroyDecoded<T>, copy, count);
+    }
+
+    return *this;
+  }
+
+  template <class T>
+  Serialiser &SerialiseDecodedArray(const rdcliteral &name, T *&el, uint64_t arrayCount,
+                                    SerialiserFlags flags, std::false_type)
+  {
+    AbandonDecodeCache();
+    return Serialise(name, el, arrayCount, flags);
+  }
+
+  template <class T>
+  Serialiser &SerialiseDecodedNullable(const rdcliteral &name, T *&el, SerialiserFlags flags,
+                                       std::true_type)
+  {
+    DecodedElement *cached = NextDecodedElement(name, DecodedTypeTag<T *>());
+    if(cached)
+    {
+      el = cached->data ? new T(*(T *)cached->data) : NULL;
+      if(VerifyingDecodeCache())
+        VerifyDecodedNullable(name, (T *)cached->data, flags);
+      return *this;
+    }
+
+    m_DecodeDepth++;
+    SerialiseNullable(name, el, flags);
+    m_DecodeDepth--;
+
+    if(DecodeCacheActive())
+    {
+      T *copy = el ? ::new(AllocDecoded(sizeof(T), alignof(T))) T(*el) : NULL;
+      PushDecoded(name, DecodedTypeTag<T *>(), &DestroyDecoded<T>, copy, el ? 1 : 0);
+    }
+
+    return *this;
+  }
+
+  template <class T>
+  Serialiser &SerialiseDecodedNullable(const rdcliteral &name, T *&el, SerialiserFlags flags,
+                                       std::false_type)
+  {
+    AbandonDecodeCache();
+    return SerialiseNullable(name, el, flags);
+  }
+
+  // byte buffers aren't copied, the cache points at the data where it is resident in the stream.
+  Serialiser &SerialiseDecodedBuffer(const rdcliteral &name, byte *&el, uint64_t byteSize,
+                                     SerialiserFlags flags)
+  {
+    DecodedElement *cached = NextDecodedElement(name, DecodedTypeTag<byte[]>());
+    if(cached)
+    {
+      uint64_t size = cached->count;
+
+      if(flags & SerialiserFlags::InPlace)
+      {
+        el = (byte *)cached->data;
+      }
+      else if(flags & SerialiserFlags::AllocateMemory)
+      {
+        if(size > 0)
+          el = AllocAlignedBuffer(size);
+        else
+          el = NULL;
+      }
+
+      if(el && el != cached->data)
+        memcpy(el, cached->data, (size_t)size);
+
+      return *this;
+    }
+
+    m_DecodeDepth++;
+    Serialise(name, el, byteSize, flags);
+    m_DecodeDepth--;
+
+    if(DecodeCacheActive())
+    {
+      uint64_t size = m_LastArrayCount;
+      uint64_t end = m_Read->GetOffset();
+
+      m_Read->SetOffset(end - size);
+      const byte *data = m_Read->ReadInPlace(size);
+
+      if(data)
+      {
+        PushDecoded(name, DecodedTypeTag<byte[]>(), NULL, (void *)data, size);
+      }
+      else
+      {
+        m_Read->SetOffset(end);
+        AbandonDecodeCache();
+      }
+    }
+
+    return *this;
+  }
+
   void *m_pUserData = NULL;
   uint64_t m_Version = 0;
 
@@ -1322,6 +1845,57 @@ private:
   bool m_ExportStructured = false;
   bool m_ExportBuffers = false;
   int m_InternalElement = 0;
+
+  ChunkDecodeCache *m_DecodeCache = NULL;
+  DecodedChunk *m_DecodeChunk = NULL;
+  bool m_DecodeReplaying = false;
+  size_t m_DecodeIndex = 0;
+  int m_DecodeDepth = 0;
+  bool m_ComparisonOnly = false;
+  uint64_t m_LastArrayCount = 0;
+  LazyChunkSource *m_LazyChunks = NULL;
+  SDChunk *m_LazyChunk = NULL;
+  uint64_t m_LazyChunkOffset = 0;
+  bool m_StructureOnly = false;
+  SDObjectArena *m_StructuredArena = NULL;
+
+  // buffers smaller than this aren't worth the hashing or the reference
+  static const uint64_t MinDeduplicatedBlobSize = 1024;
+  // set in the serialised size of a byte buffer that refers to an earlier copy of the same data,
+  // followed by the offset of that copy in the stream
+  static const uint64_t BlobReferenceBit = 1ULL << 63;
+
+  struct BlobKey
+  {
+    uint64_t hash[2];
+    uint64_t size;
+
+    bool operator<(const BlobKey &o) const
+    {
+      if(size != o.size)
+        return size < o.size;
+      if(hash[0] != o.hash[0])
+        return hash[0] < o.hash[0];
+      return hash[1] < o.hash[1];
+    }
+  };
+
+  static BlobKey HashBlob(const byte *data, uint64_t size);
+  void ReadBlobReference(byte *el, uint64_t byteSize, uint64_t blobOffset);
+
+  bool m_DeduplicateBlobs = false;
+  uint64_t m_DeduplicatedBytes = 0;
+  // offset in the stream of the first copy of each distinct buffer written
+  std::map<BlobKey, uint64_t> m_BlobOffsets;
+
+  // while a chunk with a size estimate is buffered, m_Write points to m_ChunkBuffer and this is the
+  // real stream. The buffer starts with m_ChunkBufferSkip bytes so it has the same alignment as the
+  // stream, and m_ChunkBufferBase is the stream offset corresponding to the start of the buffer.
+  StreamWriter *m_ChunkStream = NULL;
+  StreamWriter *m_ChunkBuffer = NULL;
+  uint64_t m_ChunkBufferBase = 0;
+  uint64_t m_ChunkBufferSkip = 0;
+
   SDFile m_StructData;
   SDFile *m_StructuredFile = &m_StructData;
   rdcarray<SDObject *> m_StructureStack;
@@ -1530,6 +2104,43 @@ private:
   byte *AllocateFromPages(bool chunkAlloc, size_t size);
 };
 
+// When the same stream is read over and over - e.g. replaying a frame up to different events -
+// most of the time goes in deserialising the same chunks each time. This caches the top-level
+// elements of each chunk by the chunk's offset in the stream the first time it's read, and then a
+// ReadSerialiser with the cache set hands out copies of those instead of reading the stream.
+//
+// The cached copies own any memory that was allocated while deserialising them, so the caller must
+// not free it (see IsDecodeCacheOwned()). Byte buffers are referenced where they lie in the stream,
+// so the stream must be in memory and outlive the cache.
+//
+// The cache must be cleared if anything that affects how chunks are decoded changes, such as the
+// live resources that serialised IDs map to.
+class ChunkDecodeCache
+{
+public:
+  ChunkDecodeCache() = default;
+  ChunkDecodeCache(const ChunkDecodeCache &) = delete;
+  ChunkDecodeCache &operator=(const ChunkDecodeCache &) = delete;
+  ~ChunkDecodeCache() { Clear(); }
+  DecodedChunk *Find(uint64_t offset);
+  DecodedChunk *Add(uint64_t offset);
+  void *Allocate(size_t size, size_t align);
+
+  // frees all decoded chunks and the memory they own
+  void Clear();
+
+  size_t NumChunks() const { return m_Chunks.size(); }
+private:
+  static const size_t PageSize = 1024 * 1024;
+
+  std::map<uint64_t, DecodedChunk> m_Chunks;
+
+  rdcarray<byte *> m_Pages;
+  size_t m_PageHead = 0;
+  // allocations too large to sub-allocate from pages
+  rdcarray<byte *> m_LargeAllocs;
+};
+
 // holds the memory, length and type for a given chunk, so that it can be
 // passed around and moved between owners before being serialised out
 class Chunk
@@ -1664,7 +2275,7 @@ struct ScopedDeserialise
   ScopedDeserialise(const SerialiserType &ser, const T &el) : m_Ser(ser), m_El(el) {}
   ~ScopedDeserialise()
   {
-    if(m_Ser.IsReading())
+    if(m_Ser.IsReading() && !m_Ser.IsDecodeCacheOwned())
       Deserialise(m_El);
   }
   const SerialiserType &m_Ser;
@@ -1681,7 +2292,8 @@ struct ScopedDeserialiseNullable
   {
     if(m_Ser.IsReading() && *m_El != NULL)
     {
-      Deserialise(**m_El);
+      if(!m_Ser.IsDecodeCacheOwned())
+        Deserialise(**m_El);
       delete *m_El;
     }
   }
@@ -1702,7 +2314,7 @@ struct ScopedDeserialiseArray
   {
     if(m_Ser.IsReading())
     {
-      for(uint64_t i = 0; i < count; i++)
+      for(uint64_t i = 0; !m_Ser.IsDecodeCacheOwned() && i < count; i++)
         Deserialise((*m_El)[i]);
       delete[] * m_El;
     }
@@ -1718,7 +2330,7 @@ struct ScopedDeserialiseArray<SerialiserType, void *>
   ScopedDeserialiseArray(const SerialiserType &ser, void **el, uint64_t) : m_Ser(ser), m_El(el) {}
   ~ScopedDeserialiseArray()
   {
-    if(m_Ser.IsReading())
+    if(m_Ser.IsReading() && !m_Ser.IsInPlace(*m_El))
       FreeAlignedBuffer((byte *)*m_El);
   }
   const SerialiserType &m_Ser;
@@ -1734,7 +2346,7 @@ struct ScopedDeserialiseArray<SerialiserType, const void *>
   }
   ~ScopedDeserialiseArray()
   {
-    if(m_Ser.IsReading())
+    if(m_Ser.IsReading() && !m_Ser.IsInPlace(*m_El))
       FreeAlignedBuffer((byte *)*m_El);
   }
   const SerialiserType &m_Ser;
@@ -1747,7 +2359,7 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
   ScopedDeserialiseArray(const SerialiserType &ser, byte **el, uint64_t) : m_Ser(ser), m_El(el) {}
   ~ScopedDeserialiseArray()
   {
-    if(m_Ser.IsReading())
+    if(m_Ser.IsReading() && !m_Ser.IsInPlace(*m_El))
       FreeAlignedBuffer(*m_El);
   }
   const SerialiserType &m_Ser;
@@ -1786,6 +2398,16 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
       GET_SERIALISER, &obj, count);                                                               \
   GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj, count, SerialiserFlags::AllocateMemory)
 
+// for read-only byte buffers, this references the data in place when the stream has it resident
+// in memory (e.g. a memory-mapped capture) instead of allocating and copying it.
+#define SERIALISE_ELEMENT_ARRAY_INPLACE(obj, count)                                               \
+  uint64_t CONCAT(dummy_array_count, __LINE__) = 0;                                               \
+  (void)CONCAT(dummy_array_count, __LINE__);                                                      \
+  ScopedDeserialiseArray<decltype(GET_SERIALISER), decltype(obj)> CONCAT(deserialise_, __LINE__)( \
+      GET_SERIALISER, &obj, count);                                                               \
+  GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj, count,                                      \
+                           SerialiserFlags::AllocateMemory | SerialiserFlags::InPlace)
+
 #define SERIALISE_ELEMENT_OPT(obj)                                           \
   ScopedDeserialiseNullable<decltype(GET_SERIALISER), decltype(obj)> CONCAT( \
       deserialise_, __LINE__)(GET_SERIALISER, &obj);                         \
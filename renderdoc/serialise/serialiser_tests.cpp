@@ -23,6 +23,11 @@
  ******************************************************************************/
 
 #include "serialiser.h"
+#include "api/replay/structured_data.h"
+#include "api/replay/version.h"
+#include "core/core.h"
+#include "lazychunks.h"
+#include "lz4io.h"
 
 #if ENABLED(ENABLE_UNIT_TESTS)
 
@@ -1386,6 +1391,828 @@ TEST_CASE("Read/write complex types", "[serialiser][structured]")
   delete buf;
 };
 
+static int struct3Decodes = 0;
+static int struct3Frees = 0;
+
+// owns allocated memory after deserialising, and counts how often it's decoded and freed
+struct struct3
+{
+  uint32_t count;
+  uint32_t *values;
+};
+
+DECLARE_REFLECTION_STRUCT(struct3);
+DECLARE_DESERIALISE_TYPE(struct3);
+
+template <class SerialiserType>
+void DoSerialise(SerialiserType &ser, struct3 &el)
+{
+  if(ser.IsReading())
+    struct3Decodes++;
+
+  SERIALISE_MEMBER(count);
+  SERIALISE_MEMBER_ARRAY(values, count);
+}
+
+template <>
+void Deserialise(const struct3 &el)
+{
+  struct3Frees++;
+  delete[] el.values;
+}
+
+TEST_CASE("Read chunks through a decode cache", "[serialiser]")
+{
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    {
+      SCOPED_SERIALISE_CHUNK(1);
+
+      uint32_t a = 5;
+      rdcstr name = "hello";
+      uint32_t values[] = {1, 2, 3};
+      struct3 s = {3, values};
+      byte blob[200];
+      for(byte i = 0; i < 200; i++)
+        blob[i] = i;
+      byte *data = blob;
+      uint64_t dataSize = sizeof(blob);
+      const struct1 *opt = new struct1(1.0f, 2.0f, 3.0f, 4.0f);
+      float fixed[4] = {5.0f, 6.0f, 7.0f, 8.0f};
+
+      SERIALISE_ELEMENT(a);
+      SERIALISE_ELEMENT(name);
+      SERIALISE_ELEMENT(s);
+      SERIALISE_ELEMENT(dataSize);
+      SERIALISE_ELEMENT_ARRAY_INPLACE(data, dataSize);
+      SERIALISE_ELEMENT_OPT(opt);
+      SERIALISE_ELEMENT(fixed);
+
+      delete opt;
+    }
+
+    {
+      SCOPED_SERIALISE_CHUNK(2);
+
+      rdcarray<struct1> viewports = {struct1(0.0f, 0.0f, 256.0f, 128.0f)};
+
+      SERIALISE_ELEMENT(viewports);
+    }
+
+    REQUIRE_FALSE(ser.IsErrored());
+  }
+
+  struct3Decodes = struct3Frees = 0;
+
+  ChunkDecodeCache cache;
+
+  StreamReader *reader = new StreamReader(buf->GetData(), buf->GetOffset());
+
+  // the first pass decodes into the cache, the rest are handed out from it
+  for(int pass = 0; pass < 3; pass++)
+  {
+    reader->SetOffset(0);
+
+    ReadSerialiser ser(reader, Ownership::Nothing);
+    ser.SetDecodeCache(&cache);
+
+    CHECK(ser.ReadChunk<uint32_t>() == 1);
+    {
+      uint32_t a = 0;
+      rdcstr name;
+      struct3 s = {};
+      uint64_t dataSize = 0;
+      byte *data = NULL;
+      const struct1 *opt = NULL;
+      float fixed[4] = {};
+
+      SERIALISE_ELEMENT(a);
+      SERIALISE_ELEMENT(name);
+      SERIALISE_ELEMENT(s);
+      SERIALISE_ELEMENT(dataSize);
+      SERIALISE_ELEMENT_ARRAY_INPLACE(data, dataSize);
+      SERIALISE_ELEMENT_OPT(opt);
+      SERIALISE_ELEMENT(fixed);
+
+      CHECK(ser.IsDecodeCacheOwned());
+
+      CHECK(a == 5);
+      CHECK(name == "hello");
+      REQUIRE(s.count == 3);
+      CHECK(s.values[0] == 1);
+      CHECK(s.values[1] == 2);
+      CHECK(s.values[2] == 3);
+      REQUIRE(dataSize == 200);
+      CHECK(ser.IsInPlace(data));
+      for(byte i = 0; i < 200; i++)
+        CHECK(data[i] == i);
+      REQUIRE(opt);
+      CHECK(opt->x == 1.0f);
+      CHECK(opt->height == 4.0f);
+      CHECK(fixed[0] == 5.0f);
+      CHECK(fixed[3] == 8.0f);
+    }
+    ser.EndChunk();
+
+    CHECK(ser.ReadChunk<uint32_t>() == 2);
+    {
+      rdcarray<struct1> viewports;
+
+      SERIALISE_ELEMENT(viewports);
+
+      REQUIRE(viewports.size() == 1);
+      CHECK(viewports[0].width == 256.0f);
+      CHECK(viewports[0].height == 128.0f);
+    }
+    ser.EndChunk();
+
+    REQUIRE_FALSE(ser.IsErrored());
+    CHECK(reader->AtEnd());
+  }
+
+  CHECK(cache.NumChunks() == 2);
+  CHECK(struct3Decodes == 1);
+  CHECK(struct3Frees == 0);
+
+  // reading something different to what was cached falls back to reading from the stream
+  {
+    reader->SetOffset(0);
+
+    ReadSerialiser ser(reader, Ownership::Nothing);
+    ser.SetDecodeCache(&cache);
+
+    ser.ReadChunk<uint32_t>();
+    {
+      uint32_t a = 0;
+      rdcstr otherName;
+      struct3 s = {};
+
+      SERIALISE_ELEMENT(a);
+      SERIALISE_ELEMENT(otherName);
+      SERIALISE_ELEMENT(s);
+
+      CHECK_FALSE(ser.IsDecodeCacheOwned());
+
+      CHECK(a == 5);
+      CHECK(otherName == "hello");
+      REQUIRE(s.count == 3);
+      CHECK(s.values[2] == 3);
+    }
+    ser.EndChunk();
+
+    CHECK(ser.ReadChunk<uint32_t>() == 2);
+    ser.SkipCurrentChunk();
+    ser.EndChunk();
+
+    REQUIRE_FALSE(ser.IsErrored());
+    CHECK(reader->AtEnd());
+  }
+
+  // the cached copy was freed when the chunk was abandoned, and ours at the end of the scope
+  CHECK(struct3Decodes == 2);
+  CHECK(struct3Frees == 2);
+
+  cache.Clear();
+
+  CHECK(cache.NumChunks() == 0);
+  CHECK(struct3Frees == 2);
+
+  delete reader;
+  delete buf;
+};
+
+// debug configs are constant in stable builds, so the check can't be enabled there
+#if !RENDERDOC_STABLE_BUILD
+
+TEST_CASE("Verify cached decodes against the stream", "[serialiser]")
+{
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    SCOPED_SERIALISE_CHUNK(1);
+
+    uint32_t values[] = {1, 2, 3};
+    struct3 s = {3, values};
+
+    SERIALISE_ELEMENT(s);
+  }
+
+  bool &verify =
+      RenderDoc::Inst().SetConfigSetting("Replay_Debug_VerifyDecodeCache")->data.basic.b;
+  bool prevVerify = verify;
+
+  ChunkDecodeCache cache;
+
+  StreamReader *reader = new StreamReader(buf->GetData(), buf->GetOffset());
+
+  for(int pass = 0; pass < 4; pass++)
+  {
+    // the first pass decodes into the cache, then it's modified in place without being made
+    // uncacheable. The check catches that on the next pass
+    verify = (pass >= 2);
+
+    reader->SetOffset(0);
+
+    ReadSerialiser ser(reader, Ownership::Nothing);
+    ser.SetDecodeCache(&cache);
+
+    CHECK(ser.ReadChunk<uint32_t>() == 1);
+    {
+      struct3 s = {};
+
+      SERIALISE_ELEMENT(s);
+
+      REQUIRE(s.count == 3);
+
+      if(pass < 2)
+      {
+        CHECK(ser.IsDecodeCacheOwned());
+        CHECK(s.values[0] == 1);
+      }
+
+      if(pass == 1)
+        s.values[0] = 100;
+
+      // the modification is still visible when it's found, but the chunk is no longer cached
+      if(pass == 2)
+        CHECK_FALSE(ser.IsDecodeCacheOwned());
+
+      if(pass == 3)
+        CHECK(s.values[0] == 1);
+    }
+    ser.EndChunk();
+
+    REQUIRE_FALSE(ser.IsErrored());
+  }
+
+  verify = prevVerify;
+
+  cache.Clear();
+
+  delete reader;
+  delete buf;
+};
+
+#endif    // !RENDERDOC_STABLE_BUILD
+
+TEST_CASE("Lazily export structured data", "[serialiser][structured]")
+{
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  const uint32_t numChunks = 5000;
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    {
+      SCOPED_SERIALISE_CHUNK(1001);
+
+      uint32_t a = 5;
+      rdcstr name = "hello";
+
+      SERIALISE_ELEMENT(a);
+      SERIALISE_ELEMENT(name);
+    }
+
+    {
+      SCOPED_SERIALISE_CHUNK(1002);
+
+      rdcarray<struct1> viewports = {struct1(0.0f, 0.0f, 256.0f, 128.0f)};
+
+      SERIALISE_ELEMENT(viewports);
+    }
+
+    // system chunks are always exported immediately
+    {
+      SCOPED_SERIALISE_CHUNK(5);
+
+      uint32_t x = 7;
+
+      SERIALISE_ELEMENT(x);
+    }
+
+    for(uint32_t i = 0; i < numChunks; i++)
+    {
+      SCOPED_SERIALISE_CHUNK(1003);
+
+      SERIALISE_ELEMENT(i);
+    }
+
+    REQUIRE_FALSE(ser.IsErrored());
+  }
+
+  int structureOnlyDecodes = 0;
+
+  auto process = [&structureOnlyDecodes](ReadSerialiser &ser, uint32_t chunkID) {
+    if(ser.IsStructureOnly())
+      structureOnlyDecodes++;
+
+    if(chunkID == 1001)
+    {
+      uint32_t a = 0;
+      rdcstr name;
+
+      SERIALISE_ELEMENT(a);
+      SERIALISE_ELEMENT(name);
+
+      return a == 5 && name == "hello";
+    }
+    else if(chunkID == 1002)
+    {
+      rdcarray<struct1> viewports;
+
+      SERIALISE_ELEMENT(viewports);
+
+      return viewports.size() == 1;
+    }
+    else if(chunkID == 5)
+    {
+      uint32_t x = 0;
+
+      SERIALISE_ELEMENT(x);
+
+      return x == 7;
+    }
+    else if(chunkID == 1003)
+    {
+      uint32_t i = 0;
+
+      SERIALISE_ELEMENT(i);
+
+      return true;
+    }
+
+    return false;
+  };
+
+  ChunkLookup testChunkLoop = [](uint32_t) -> rdcstr { return "TestChunk"; };
+
+  LazyChunkSource lazy;
+  lazy.SetSource(buf->GetData(), buf->GetOffset(), 0, testChunkLoop, process);
+
+  SDFile file;
+
+  {
+    StreamReader *reader = new StreamReader(buf->GetData(), buf->GetOffset());
+
+    ReadSerialiser ser(reader, Ownership::Stream);
+
+    ser.ConfigureStructuredExport(testChunkLoop, false, 0, 1.0);
+    ser.SetLazyChunks(&lazy);
+
+    while(!reader->AtEnd())
+    {
+      uint32_t chunkID = ser.ReadChunk<uint32_t>();
+      CHECK(process(ser, chunkID));
+      ser.EndChunk();
+    }
+
+    REQUIRE_FALSE(ser.IsErrored());
+
+    ser.GetStructuredFile().Swap(file);
+  }
+
+  CHECK(structureOnlyDecodes == 0);
+  CHECK(lazy.NumChunks() == numChunks + 2);
+  CHECK(lazy.NumResident() == 0);
+
+  REQUIRE(file.chunks.size() == numChunks + 3);
+
+  SDChunk *first = file.chunks[0];
+  SDChunk *second = file.chunks[1];
+  SDChunk *system = file.chunks[2];
+
+  CHECK(first->name == "TestChunk");
+  CHECK(first->metadata.chunkID == 1001);
+  CHECK(bool(first->metadata.flags & SDChunkFlags::Lazy));
+  CHECK(first->type.byteSize == first->metadata.length);
+  CHECK(first->NumChildren() == 0);
+
+  CHECK_FALSE(bool(system->metadata.flags & SDChunkFlags::Lazy));
+  REQUIRE(system->NumChildren() == 1);
+  CHECK(system->GetChild(0)->name == "x");
+  CHECK(system->GetChild(0)->AsUInt32() == 7);
+
+  // without a source populating does nothing
+  file.PopulateChunk(first);
+  CHECK(first->NumChildren() == 0);
+
+  file.SetChunkSource(&lazy);
+
+  file.PopulateChunk(first);
+
+  CHECK(structureOnlyDecodes == 1);
+  CHECK_FALSE(bool(first->metadata.flags & SDChunkFlags::Lazy));
+  REQUIRE(first->NumChildren() == 2);
+  CHECK(first->GetChild(0)->name == "a");
+  CHECK(first->GetChild(0)->AsUInt32() == 5);
+  CHECK(first->GetChild(1)->name == "name");
+  CHECK(first->GetChild(1)->AsString() == "hello");
+
+  // populating again is a no-op
+  file.PopulateChunk(first);
+  CHECK(structureOnlyDecodes == 1);
+
+  file.PopulateChunk(second);
+
+  REQUIRE(second->NumChildren() == 1);
+  CHECK(second->GetChild(0)->IsArray());
+  REQUIRE(second->GetChild(0)->NumChildren() == 1);
+  CHECK(second->GetChild(0)->GetChild(0)->FindChild("width")->AsFloat() == 256.0f);
+
+  // system chunks aren't handled by the source
+  file.PopulateChunk(system);
+  CHECK(structureOnlyDecodes == 2);
+
+  for(uint32_t i = 0; i < numChunks; i++)
+    file.PopulateChunk(file.chunks[3 + i]);
+
+  const size_t budget = lazy.NumResident();
+
+  // older chunks were released once too many were resident
+  REQUIRE(budget < numChunks);
+  CHECK(bool(first->metadata.flags & SDChunkFlags::Lazy));
+  CHECK(first->NumChildren() == 0);
+
+  SDChunk *last = file.chunks.back();
+  REQUIRE(last->NumChildren() == 1);
+  CHECK(last->GetChild(0)->AsUInt32() == numChunks - 1);
+
+  // the least recently used chunk is released when a released chunk is populated again
+  SDChunk *oldest = file.chunks[3 + numChunks - budget];
+  CHECK_FALSE(bool(oldest->metadata.flags & SDChunkFlags::Lazy));
+
+  file.PopulateChunk(first);
+
+  CHECK(lazy.NumResident() == budget);
+  REQUIRE(first->NumChildren() == 2);
+  CHECK(first->GetChild(0)->AsUInt32() == 5);
+  CHECK(bool(oldest->metadata.flags & SDChunkFlags::Lazy));
+
+  // looking at a resident chunk makes it the most recently used, so the next one is released
+  SDChunk *touched = file.chunks[3 + numChunks - budget + 1];
+  SDChunk *untouched = file.chunks[3 + numChunks - budget + 2];
+  file.PopulateChunk(touched);
+  file.PopulateChunk(second);
+
+  CHECK(lazy.NumResident() == budget);
+  CHECK_FALSE(bool(touched->metadata.flags & SDChunkFlags::Lazy));
+  CHECK(bool(untouched->metadata.flags & SDChunkFlags::Lazy));
+  CHECK_FALSE(bool(second->metadata.flags & SDChunkFlags::Lazy));
+
+  file.SetChunkSource(NULL);
+  lazy.Clear();
+
+  CHECK(lazy.NumChunks() == 0);
+
+  delete buf;
+};
+
+TEST_CASE("Export structured data into a file's arena", "[serialiser][structured]")
+{
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  const uint32_t numChunks = 2000;
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    for(uint32_t i = 0; i < numChunks; i++)
+    {
+      SCOPED_SERIALISE_CHUNK(1001);
+
+      rdcstr name = "a string long enough that it won't be stored in-line";
+      rdcarray<struct1> viewports = {struct1(0.0f, 0.0f, 256.0f, 128.0f),
+                                     struct1(1.0f, 2.0f, 3.0f, float(i))};
+
+      SERIALISE_ELEMENT(i);
+      SERIALISE_ELEMENT(name);
+      SERIALISE_ELEMENT(viewports);
+    }
+
+    REQUIRE_FALSE(ser.IsErrored());
+  }
+
+  ChunkLookup testChunkLoop = [](uint32_t) -> rdcstr { return "TestChunk"; };
+
+  SDFile file;
+
+  {
+    StreamReader *reader = new StreamReader(buf->GetData(), buf->GetOffset());
+
+    ReadSerialiser ser(reader, Ownership::Stream);
+
+    ser.ConfigureStructuredExport(testChunkLoop, false, 0, 1.0);
+
+    while(!reader->AtEnd())
+    {
+      ser.ReadChunk<uint32_t>();
+
+      uint32_t i = 0;
+      rdcstr name;
+      rdcarray<struct1> viewports;
+
+      SERIALISE_ELEMENT(i);
+      SERIALISE_ELEMENT(name);
+      SERIALISE_ELEMENT(viewports);
+
+      ser.EndChunk();
+    }
+
+    REQUIRE_FALSE(ser.IsErrored());
+
+    // the arena moves along with the chunks
+    ser.GetStructuredFile().Swap(file);
+
+    CHECK(ser.GetStructuredFile().chunks.empty());
+  }
+
+  REQUIRE(file.chunks.size() == numChunks);
+
+  // all chunks and their objects come out of the same arena, in a handful of slabs
+  const uint64_t reserved = file.GetArena()->GetReservedSize();
+  CHECK(reserved > 0);
+
+  SDChunk *last = file.chunks.back();
+
+  REQUIRE(last->NumChildren() == 3);
+  CHECK(last->GetChild(0)->AsUInt32() == numChunks - 1);
+  CHECK(last->GetChild(1)->AsString() == "a string long enough that it won't be stored in-line");
+  REQUIRE(last->GetChild(2)->NumChildren() == 2);
+  CHECK(last->GetChild(2)->GetChild(1)->FindChild("height")->AsFloat() == float(numChunks - 1));
+
+  // objects can be deleted individually and replaced with heap allocated objects
+  SDObject *dup = last->GetChild(2)->Duplicate();
+
+  last->GetChild(2)->DeleteChildren();
+  CHECK(last->GetChild(2)->NumChildren() == 0);
+
+  last->GetChild(2)->AddChild(dup->GetChild(0));
+
+  CHECK(last->GetChild(2)->NumChildren() == 1);
+  CHECK(file.GetArena()->GetReservedSize() == reserved);
+
+  // duplicates are independent of the arena and can outlive the file
+  {
+    SDFile *tempFile = new SDFile;
+    tempFile->Swap(file);
+    delete tempFile;
+  }
+
+  CHECK(file.chunks.empty());
+  REQUIRE(dup->NumChildren() == 2);
+  CHECK(dup->GetChild(1)->FindChild("height")->AsFloat() == float(numChunks - 1));
+
+  delete dup;
+  delete buf;
+};
+
+TEST_CASE("Deduplicate identical byte buffers", "[serialiser]")
+{
+  bytebuf first, second;
+  first.resize(64 * 1024);
+  second.resize(64 * 1024);
+  for(size_t i = 0; i < first.size(); i++)
+  {
+    first[i] = byte((rand() & 0xff0) >> 4);
+    second[i] = byte(i & 0xff);
+  }
+
+  // the first and third chunks share contents, as do the second and fourth
+  rdcarray<byte *> contents = {first.data(), second.data(), first.data(), second.data()};
+
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+  uint64_t deduplicated = 0;
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    ser.SetBlobDeduplication(true);
+
+    for(size_t i = 0; i < contents.size(); i++)
+    {
+      ser.WriteChunk(1);
+      ser.Serialise("Contents"_lit, contents[i], first.size(), SerialiserFlags::Deduplicate);
+      ser.EndChunk();
+    }
+
+    // small buffers aren't worth deduplicating
+    byte *small = first.data();
+    for(int i = 0; i < 2; i++)
+    {
+      ser.WriteChunk(2);
+      ser.Serialise("Contents"_lit, small, 16, SerialiserFlags::Deduplicate);
+      ser.EndChunk();
+    }
+
+    deduplicated = ser.GetDeduplicatedBytes();
+  }
+
+  CHECK(deduplicated == first.size() * 2);
+  CHECK(buf->GetOffset() < first.size() * 3);
+
+  SECTION("Reading resolves references")
+  {
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+    for(size_t i = 0; i < contents.size(); i++)
+    {
+      CHECK(ser.ReadChunk<uint32_t>() == 1);
+
+      bytebuf readback;
+      readback.resize(first.size());
+      byte *data = readback.data();
+      ser.Serialise("Contents"_lit, data, 0, SerialiserFlags::Deduplicate);
+      ser.EndChunk();
+
+      CHECK(!ser.IsErrored());
+      CHECK(memcmp(data, contents[i], first.size()) == 0);
+    }
+
+    for(int i = 0; i < 2; i++)
+    {
+      CHECK(ser.ReadChunk<uint32_t>() == 2);
+
+      byte *data = NULL;
+      ser.Serialise("Contents"_lit, data, 0,
+                    SerialiserFlags::Deduplicate | SerialiserFlags::AllocateMemory);
+      ser.EndChunk();
+
+      CHECK(memcmp(data, first.data(), 16) == 0);
+      FreeAlignedBuffer(data);
+    }
+
+    CHECK(ser.GetReader()->AtEnd());
+  };
+
+  SECTION("Structured export contains the full contents")
+  {
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+    ChunkLookup testChunkLoop = [](uint32_t) -> rdcstr { return "TestChunk"; };
+
+    ser.ConfigureStructuredExport(testChunkLoop, true, 0, 1.0);
+
+    for(size_t i = 0; i < contents.size(); i++)
+    {
+      ser.ReadChunk<uint32_t>();
+      byte *data = NULL;
+      ser.Serialise("Contents"_lit, data, 0, SerialiserFlags::Deduplicate);
+      ser.EndChunk();
+    }
+
+    const SDFile &file = ser.GetStructuredFile();
+
+    REQUIRE(file.chunks.size() == contents.size());
+    REQUIRE(file.buffers.size() == contents.size());
+
+    for(size_t i = 0; i < contents.size(); i++)
+    {
+      const SDObject *obj = file.chunks[i]->GetChild(0);
+      CHECK(obj->type.byteSize == first.size());
+
+      const bytebuf &data = *file.buffers[(size_t)obj->data.basic.u];
+      REQUIRE(data.size() == first.size());
+      CHECK(memcmp(data.data(), contents[i], first.size()) == 0);
+    }
+  };
+
+  SECTION("References need a seekable compressed stream")
+  {
+    for(bool blockIndexed : {true, false})
+    {
+      StreamWriter compressed(StreamWriter::DefaultScratchSize);
+
+      {
+        StreamWriter writer(new LZ4Compressor(&compressed, Ownership::Nothing, blockIndexed),
+                            Ownership::Stream);
+        writer.Write(buf->GetData(), buf->GetOffset());
+        writer.Finish();
+      }
+
+      StreamReader *reader =
+          new StreamReader(new LZ4Decompressor(new StreamReader(compressed.GetData(),
+                                                                compressed.GetOffset()),
+                                               Ownership::Stream, blockIndexed),
+                           buf->GetOffset(), Ownership::Stream);
+
+      ReadSerialiser ser(reader, Ownership::Stream);
+
+      bytebuf readback;
+      readback.resize(first.size());
+
+      for(size_t i = 0; i < contents.size(); i++)
+      {
+        ser.ReadChunk<uint32_t>();
+        byte *data = readback.data();
+        ser.Serialise("Contents"_lit, data, 0, SerialiserFlags::Deduplicate);
+        ser.EndChunk();
+      }
+
+      // only the block-indexed stream could seek back to the earlier copy
+      CHECK(ser.IsErrored() == !blockIndexed);
+      if(blockIndexed)
+        CHECK(memcmp(readback.data(), second.data(), second.size()) == 0);
+    }
+  };
+
+  delete buf;
+};
+
+TEST_CASE("Deduplicated chunks with a size estimate", "[serialiser]")
+{
+  bytebuf contents;
+  contents.resize(64 * 1024);
+  for(size_t i = 0; i < contents.size(); i++)
+    contents[i] = byte((i * 7) & 0xff);
+
+  // the upper bound the chunk would be estimated at without knowing about deduplication
+  const uint64_t estimate = 128 + contents.size() + WriteSerialiser::GetChunkAlignment();
+  const int numChunks = 4;
+
+  // write through a compressor like a capture file, so the chunk header can't be seeked back to
+  StreamWriter compressed(StreamWriter::DefaultScratchSize);
+  uint64_t uncompressedSize = 0;
+
+  {
+    WriteSerialiser ser(new StreamWriter(new LZ4Compressor(&compressed, Ownership::Nothing, true),
+                                         Ownership::Stream),
+                        Ownership::Stream);
+
+    ser.SetBlobDeduplication(true);
+
+    // start the deduplicated chunks at an unaligned offset
+    {
+      SCOPED_SERIALISE_CHUNK(2, 64);
+      uint16_t value = 0x1234;
+      SERIALISE_ELEMENT(value);
+    }
+
+    for(int i = 0; i < numChunks; i++)
+    {
+      SCOPED_SERIALISE_CHUNK(1, estimate);
+      SERIALISE_ELEMENT(i);
+      byte *data = contents.data();
+      ser.Serialise("Contents"_lit, data, contents.size(), SerialiserFlags::Deduplicate);
+    }
+
+    CHECK(ser.GetDeduplicatedBytes() == contents.size() * (numChunks - 1));
+
+    uncompressedSize = ser.GetWriter()->GetOffset();
+
+    REQUIRE_FALSE(ser.IsErrored());
+  }
+
+  // only the first chunk holds the contents, the others aren't padded out to the estimate
+  CHECK(uncompressedSize < estimate + numChunks * 256);
+
+  StreamReader *reader = new StreamReader(
+      new LZ4Decompressor(new StreamReader(compressed.GetData(), compressed.GetOffset()),
+                          Ownership::Stream, true),
+      uncompressedSize, Ownership::Stream);
+
+  ReadSerialiser ser(reader, Ownership::Stream);
+
+  {
+    CHECK(ser.ReadChunk<uint32_t>() == 2);
+    uint16_t value = 0;
+    SERIALISE_ELEMENT(value);
+    ser.EndChunk();
+    CHECK(value == 0x1234);
+  }
+
+  for(int i = 0; i < numChunks; i++)
+  {
+    CHECK(ser.ReadChunk<uint32_t>() == 1);
+
+    uint64_t length = ser.ChunkMetadata().length;
+    if(i == 0)
+      CHECK(length > contents.size());
+    else
+      CHECK(length < 256);
+
+    int idx = -1;
+    SERIALISE_ELEMENT(idx);
+    CHECK(idx == i);
+
+    bytebuf readback;
+    readback.resize(contents.size());
+    byte *data = readback.data();
+    ser.Serialise("Contents"_lit, data, 0, SerialiserFlags::Deduplicate);
+    ser.EndChunk();
+
+    REQUIRE_FALSE(ser.IsErrored());
+    CHECK(readback == contents);
+  }
+
+  CHECK(ser.GetReader()->AtEnd());
+};
+
 enum class TestEnumClass
 {
   A = 1,
@@ -26,6 +26,19 @@
 #include <errno.h>
 #include "api/replay/stringise.h"
 #include "common/timing.h"
+#include "core/settings.h"
+
+RDOC_CONFIG(bool, Serialise_MapFiles, true,
+            "Memory-map uncompressed file sections rather than reading them into memory, so large "
+            "blobs can be used in place without being copied.");
+
+struct StreamMapping
+{
+  byte *data;
+  uint64_t fileOffset;
+  uint64_t size;
+  int32_t refCount;
+};
 
 Compressor::~Compressor()
 {
@@ -100,7 +113,7 @@ StreamReader::StreamReader(Network::Socket *sock, Ownership own)
   m_Ownership = own;
 }
 
-StreamReader::StreamReader(FILE *file, uint64_t fileSize, Ownership own)
+StreamReader::StreamReader(FILE *file, uint64_t fileSize, Ownership own, bool allowMapping)
 {
   if(file == NULL)
   {
@@ -115,13 +128,17 @@ StreamReader::StreamReader(FILE *file, uint64_t fileSize, Ownership own)
 
   m_File = file;
   m_InputSize = fileSize;
+  m_BaseOffset = FileIO::ftell64(file);
+
+  m_Ownership = own;
+
+  if(allowMapping && MapFile())
+    return;
 
   m_BufferSize = initialBufferSize;
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
   ReadFromExternal(m_BufferBase, RDCMIN(m_InputSize, m_BufferSize));
-
-  m_Ownership = own;
 }
 
 StreamReader::StreamReader(FILE *file)
@@ -143,34 +160,59 @@ StreamReader::StreamReader(FILE *file)
 
   m_File = file;
 
+  m_Ownership = Ownership::Stream;
+
+  if(MapFile())
+    return;
+
   m_BufferSize = initialBufferSize;
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
   ReadFromExternal(m_BufferBase, RDCMIN(m_InputSize, m_BufferSize));
-
-  m_Ownership = Ownership::Stream;
 }
 
 StreamReader::StreamReader(StreamReader *reader, uint64_t bufferSize)
 {
   m_InputSize = m_BufferSize = bufferSize;
+
+  m_Ownership = Ownership::Nothing;
+
+  // if the source is mapped, share its mapping instead of copying the data out of it
+  const byte *inplace = reader->IsMapped() ? reader->ReadInPlace(bufferSize) : NULL;
+
+  if(inplace)
+  {
+    m_Mapping = reader->m_Mapping;
+    Atomic::Inc32(&m_Mapping->refCount);
+
+    m_BufferHead = m_BufferBase = (byte *)inplace;
+    return;
+  }
+
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
   reader->Read(m_BufferBase, bufferSize);
-
-  m_Ownership = Ownership::Nothing;
 }
 
-StreamReader::StreamReader(Decompressor *decompressor, uint64_t uncompressedSize, Ownership own)
+StreamReader::StreamReader(Decompressor *decompressor, uint64_t uncompressedSize, Ownership own,
+                           uint64_t offset)
 {
   m_Decompressor = decompressor;
   m_InputSize = uncompressedSize;
+  m_BaseOffset = offset;
 
   m_BufferSize = initialBufferSize;
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
   m_Ownership = own;
 
+  if(offset > 0 && !m_Decompressor->Seek(offset))
+  {
+    RDCERR("Decompressor stream does not support seeking");
+    m_HasError = true;
+    return;
+  }
+
   ReadFromExternal(m_BufferBase, RDCMIN(uncompressedSize, m_BufferSize));
 }
 
@@ -179,7 +221,18 @@ StreamReader::~StreamReader()
   for(StreamCloseCallback cb : m_Callbacks)
     cb();
 
-  FreeAlignedBuffer(m_BufferBase);
+  if(m_Mapping)
+  {
+    if(Atomic::Dec32(&m_Mapping->refCount) == 0)
+    {
+      FileIO::UnmapFileRange(m_Mapping->data, m_Mapping->fileOffset, m_Mapping->size);
+      delete m_Mapping;
+    }
+  }
+  else
+  {
+    FreeAlignedBuffer(m_BufferBase);
+  }
 
   if(m_Ownership == Ownership::Stream)
   {
@@ -195,13 +248,68 @@ void StreamReader::SetOffset(uint64_t offs)
 {
   if(m_File || m_Decompressor)
   {
-    RDCERR("File and decompress stream readers do not support seeking");
+    // nothing to do if we're already there, this keeps sequential block reads cheap
+    if(offs == GetOffset() || m_HasError)
+      return;
+
+    if(offs > m_InputSize)
+    {
+      RDCERR("Seeking to %llu past the end of the stream (%llu bytes)", offs, m_InputSize);
+      return;
+    }
+
+    if(m_File)
+    {
+      FileIO::fseek64(m_File, m_BaseOffset + offs, SEEK_SET);
+    }
+    else if(!m_Decompressor->Seek(m_BaseOffset + offs))
+    {
+      RDCERR("Decompressor stream does not support seeking");
+      return;
+    }
+
+    // discard the current window and re-fill it starting at the new offset
+    m_ReadOffset = offs;
+    m_BufferHead = m_BufferBase;
+
+    ReadFromExternal(m_BufferBase, RDCMIN(m_InputSize - offs, m_BufferSize));
+
     return;
   }
 
   m_BufferHead = m_BufferBase + offs;
 }
 
+bool StreamReader::MapFile()
+{
+  // small streams fit in a single window anyway, so there's nothing to gain from mapping them
+  if(!Serialise_MapFiles() || m_InputSize <= initialBufferSize)
+    return false;
+
+  byte *data = FileIO::MapFileRange(m_File, m_BaseOffset, m_InputSize);
+
+  if(data == NULL)
+    return false;
+
+  m_Mapping = new StreamMapping;
+  m_Mapping->data = data;
+  m_Mapping->fileOffset = m_BaseOffset;
+  m_Mapping->size = m_InputSize;
+  m_Mapping->refCount = 1;
+
+  // the whole stream is now resident, so from here on we behave like an in-memory stream and the
+  // file is no longer needed.
+  m_BufferHead = m_BufferBase = data;
+  m_BufferSize = m_InputSize;
+
+  if(m_Ownership == Ownership::Stream)
+    FileIO::fclose(m_File);
+
+  m_File = NULL;
+
+  return true;
+}
+
 bool StreamReader::Reserve(uint64_t numBytes)
 {
   RDCASSERT(m_Sock || m_File || m_Decompressor);
@@ -638,3 +746,63 @@ void StreamTransfer(StreamWriter *writer, StreamReader *reader, RENDERDOC_Progre
 
   delete[] buf;
 }
+
+struct BlockIndexFooter
+{
+  uint32_t magic;
+  uint32_t blockSize;
+  uint64_t numBlocks;
+};
+
+static const uint32_t BLOCK_INDEX_MAGIC = MAKE_FOURCC('R', 'D', 'B', 'I');
+
+bool WriteBlockIndex(StreamWriter *writer, const rdcarray<uint64_t> &blockOffsets,
+                     uint64_t blockSize)
+{
+  BlockIndexFooter footer;
+  footer.magic = BLOCK_INDEX_MAGIC;
+  footer.blockSize = (uint32_t)blockSize;
+  footer.numBlocks = blockOffsets.size();
+
+  bool success = true;
+
+  success &= writer->Write(blockOffsets.data(), blockOffsets.byteSize());
+  success &= writer->Write(footer);
+
+  return success;
+}
+
+bool ReadBlockIndex(StreamReader *reader, rdcarray<uint64_t> &blockOffsets, uint64_t blockSize)
+{
+  const uint64_t size = reader->GetSize();
+
+  if(size < sizeof(BlockIndexFooter))
+  {
+    RDCERR("Block-indexed stream is too small to contain an index: %llu bytes", size);
+    return false;
+  }
+
+  BlockIndexFooter footer = {};
+
+  reader->SetOffset(size - sizeof(BlockIndexFooter));
+  reader->Read(footer);
+
+  if(reader->IsErrored() || footer.magic != BLOCK_INDEX_MAGIC || footer.blockSize != blockSize ||
+     footer.numBlocks == 0 ||
+     footer.numBlocks * sizeof(uint64_t) > size - sizeof(BlockIndexFooter))
+  {
+    RDCERR("Invalid block index footer: magic %x, %u byte blocks, %llu blocks", footer.magic,
+           footer.blockSize, footer.numBlocks);
+    return false;
+  }
+
+  blockOffsets.resize((size_t)footer.numBlocks);
+
+  reader->SetOffset(size - sizeof(BlockIndexFooter) - blockOffsets.byteSize());
+  reader->Read(blockOffsets.data(), blockOffsets.byteSize());
+
+  // go back to the first block, ready for sequential reads
+  reader->SetOffset(blockOffsets[0]);
+
+  return !reader->IsErrored();
+}
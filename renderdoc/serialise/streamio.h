@@ -37,6 +37,7 @@ enum class Ownership
 
 class StreamWriter;
 class StreamReader;
+struct StreamMapping;
 
 typedef std::function<void()> StreamCloseCallback;
 
@@ -61,6 +62,10 @@ public:
   virtual bool Recompress(Compressor *comp) = 0;
   virtual bool Read(void *data, uint64_t numBytes) = 0;
 
+  // seek to an offset in the uncompressed data. Only possible for block-indexed streams where each
+  // block is compressed independently, other decompressors can only be read from the start.
+  virtual bool Seek(uint64_t offs) { return false; }
+
 protected:
   StreamReader *m_Read;
   Ownership m_Ownership;
@@ -84,10 +89,16 @@ public:
   StreamReader(const bytebuf &buffer);
 
   StreamReader(Network::Socket *sock, Ownership own);
-  StreamReader(FILE *file, uint64_t fileSize, Ownership own);
+  // a range of an open file. This is only mapped into memory if allowMapping is set, in which case
+  // the caller must make sure the range isn't modified or truncated while the stream or any reader
+  // created from it is alive.
+  StreamReader(FILE *file, uint64_t fileSize, Ownership own, bool allowMapping = false);
   StreamReader(FILE *file);
   StreamReader(StreamReader *reader, uint64_t bufferSize);
-  StreamReader(Decompressor *decompressor, uint64_t uncompressedSize, Ownership own);
+  // reads uncompressedSize bytes of decompressed data. Starting at a non-zero offset into it is
+  // only possible with a decompressor that can seek.
+  StreamReader(Decompressor *decompressor, uint64_t uncompressedSize, Ownership own,
+               uint64_t offset = 0);
 
   ~StreamReader();
 
@@ -229,6 +240,34 @@ public:
     return Read(&data, sizeof(T));
   }
 
+  // if the stream holds the data resident in memory (an in-memory or memory-mapped stream), return
+  // a pointer to the next numBytes bytes and skip past them without copying. Otherwise returns NULL
+  // and nothing is read. The data is owned by the stream and must not be modified.
+  const byte *ReadInPlace(uint64_t numBytes)
+  {
+    if(numBytes == 0 || m_Dummy || m_HasError || !m_BufferBase || m_File || m_Sock ||
+       m_Decompressor)
+      return NULL;
+
+    if(GetOffset() + numBytes > GetSize())
+      return NULL;
+
+    const byte *ret = m_BufferHead;
+    m_BufferHead += numBytes;
+    return ret;
+  }
+
+  // returns true if ptr points into data owned by the stream, i.e. it came from ReadInPlace
+  bool IsInPlace(const void *ptr) const
+  {
+    if(!ptr || !m_BufferBase || m_File || m_Sock || m_Decompressor)
+      return false;
+
+    return (const byte *)ptr >= m_BufferBase && (const byte *)ptr < m_BufferBase + m_BufferSize;
+  }
+
+  bool IsMapped() const { return m_Mapping != NULL; }
+
   void AddCloseCallback(StreamCloseCallback callback) { m_Callbacks.push_back(callback); }
 private:
   inline uint64_t Available()
@@ -237,6 +276,7 @@ private:
       return m_InputSize - (m_BufferHead - m_BufferBase);
     return m_BufferSize - (m_BufferHead - m_BufferBase);
   }
+  bool MapFile();
   bool Reserve(uint64_t numBytes);
   bool ReadLargeBuffer(void *buffer, uint64_t length);
   bool ReadFromExternal(void *buffer, uint64_t length);
@@ -267,6 +307,13 @@ private:
   // the offset in the file/decompressor that corresponds to the start of m_BufferBase
   uint64_t m_ReadOffset = 0;
 
+  // the position in the file or the decompressed data where this stream starts, for seeking
+  uint64_t m_BaseOffset = 0;
+
+  // the file mapping that m_BufferBase points into, if the file was mapped instead of read. This
+  // can be shared with readers created from this one, so is refcounted
+  StreamMapping *m_Mapping = NULL;
+
   // flag indicating if an error has been encountered and the stream is now invalid
   bool m_HasError = false;
 
@@ -535,3 +582,10 @@ private:
 };
 
 void StreamTransfer(StreamWriter *writer, StreamReader *reader, RENDERDOC_ProgressCallback progress);
+
+// block-indexed compressed streams store the compressed blocks as normal, followed by a table with
+// the offset of each block in the compressed stream and a footer. These are shared between the
+// compressors to write and read that table.
+bool WriteBlockIndex(StreamWriter *writer, const rdcarray<uint64_t> &blockOffsets,
+                     uint64_t blockSize);
+bool ReadBlockIndex(StreamReader *reader, rdcarray<uint64_t> &blockOffsets, uint64_t blockSize);
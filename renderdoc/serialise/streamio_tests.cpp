@@ -94,6 +94,86 @@ TEST_CASE("Test basic stream I/O operations", "[streamio]")
   CHECK(reader.IsErrored());
 };
 
+TEST_CASE("Test memory-mapped file stream reading", "[streamio]")
+{
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/streamio_mapped.bin";
+
+  // large enough to be mapped rather than read through a window
+  rdcarray<uint32_t> values;
+  values.resize(256 * 1024);
+  for(size_t i = 0; i < values.size(); i++)
+    values[i] = uint32_t(i * 7);
+
+  const uint64_t dataSize = values.byteSize();
+
+  // write an odd-sized header first so the stream doesn't start on a page boundary
+  {
+    StreamWriter writer(FileIO::fopen(filename.c_str(), "wb"), Ownership::Stream);
+    writer.Write<byte>(0xcc);
+    writer.Write(values.data(), dataSize);
+  }
+
+  FILE *f = FileIO::fopen(filename.c_str(), "rb");
+  REQUIRE(f);
+  FileIO::fseek64(f, 1, SEEK_SET);
+
+  // file ranges are only mapped when asked for
+  {
+    StreamReader unmapped(f, dataSize, Ownership::Nothing);
+    CHECK_FALSE(unmapped.IsMapped());
+  }
+
+  FileIO::fseek64(f, 1, SEEK_SET);
+
+  StreamReader *reader = new StreamReader(f, dataSize, Ownership::Stream, true);
+
+  CHECK(reader->IsMapped());
+  CHECK(reader->GetSize() == dataSize);
+
+  uint32_t test = 0;
+  reader->Read(test);
+  CHECK(test == values[0]);
+
+  // large reads can be taken in place, pointing into the mapping
+  const byte *inplace = reader->ReadInPlace(1024 * sizeof(uint32_t));
+  REQUIRE(inplace);
+  CHECK(reader->IsInPlace(inplace));
+  CHECK(memcmp(inplace, &values[1], 1024 * sizeof(uint32_t)) == 0);
+  CHECK(reader->GetOffset() == 1025 * sizeof(uint32_t));
+
+  // but not past the end
+  CHECK(reader->ReadInPlace(dataSize) == NULL);
+  CHECK_FALSE(reader->IsErrored());
+
+  reader->SetOffset(100000 * sizeof(uint32_t));
+  reader->Read(test);
+  CHECK(test == values[100000]);
+
+  // a reader created from a mapped reader shares the mapping and outlives it
+  StreamReader *subReader = new StreamReader(reader, 1000 * sizeof(uint32_t));
+  CHECK(subReader->IsMapped());
+  CHECK(reader->GetOffset() == 101001 * sizeof(uint32_t));
+
+  delete reader;
+
+  subReader->Read(test);
+  CHECK(test == values[100001]);
+  subReader->SetOffset(999 * sizeof(uint32_t));
+  subReader->Read(test);
+  CHECK(test == values[101000]);
+  CHECK(subReader->AtEnd());
+  CHECK_FALSE(subReader->IsErrored());
+
+  // allocations are never mistaken for in-place data
+  byte *alloc = AllocAlignedBuffer(64);
+  CHECK_FALSE(subReader->IsInPlace(alloc));
+  FreeAlignedBuffer(alloc);
+
+  delete subReader;
+
+  FileIO::Delete(filename.c_str());
+};
+
 TEST_CASE("Test stream I/O operations over the network", "[streamio][network]")
 {
   uint16_t port = 8235;
@@ -25,16 +25,19 @@
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstdio.h"
 
-static const uint64_t zstdBlockSize = 128 * 1024;
 static const uint64_t compressBlockSize = ZSTD_compressBound(zstdBlockSize);
 
-ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own) : Compressor(write, own)
+ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own, bool blockIndexed)
+    : Compressor(write, own)
 {
   m_Page = AllocAlignedBuffer(zstdBlockSize);
   m_CompressBuffer = AllocAlignedBuffer(compressBlockSize);
 
   m_PageOffset = 0;
 
+  m_BlockIndexed = blockIndexed;
+  m_BaseOffset = write->GetOffset();
+
   m_Stream = ZSTD_createCStream();
 }
 
@@ -112,7 +115,13 @@ bool ZSTDCompressor::Finish()
   // only the last one can be smaller, so we only write a partial page when finishing.
   // Calling Write() after Finish() is illegal
 
-  return FlushPage();
+  bool success = FlushPage();
+
+  // block-indexed streams then have the index of each block's offset appended
+  if(success && m_BlockIndexed)
+    success &= WriteBlockIndex(m_Write, m_BlockOffsets, zstdBlockSize);
+
+  return success;
 }
 
 bool ZSTDCompressor::FlushPage()
@@ -132,6 +141,9 @@ bool ZSTDCompressor::FlushPage()
   if(!m_CompressBuffer)
     return false;
 
+  if(m_BlockIndexed)
+    m_BlockOffsets.push_back(m_Write->GetOffset() - m_BaseOffset);
+
   // a bit redundant to write this but it means we can read the entire frame without
   // doing multiple reads
   success &= m_Write->Write((uint32_t)out.pos);
@@ -194,7 +206,8 @@ bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
   return true;
 }
 
-ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own) : Decompressor(read, own)
+ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own, bool blockIndexed)
+    : Decompressor(read, own)
 {
   m_Page = AllocAlignedBuffer(zstdBlockSize);
   m_CompressBuffer = AllocAlignedBuffer(compressBlockSize);
@@ -202,7 +215,17 @@ ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own) : Decompre
   m_PageOffset = 0;
   m_PageLength = 0;
 
+  m_NextBlock = 0;
+
   m_Stream = ZSTD_createDStream();
+
+  if(blockIndexed && !ReadBlockIndex(m_Read, m_BlockOffsets, zstdBlockSize))
+  {
+    RDCERR("Couldn't read block index for ZSTD stream");
+    FreeAlignedBuffer(m_Page);
+    FreeAlignedBuffer(m_CompressBuffer);
+    m_Page = m_CompressBuffer = NULL;
+  }
 }
 
 ZSTDDecompressor::~ZSTDDecompressor()
@@ -216,7 +239,8 @@ bool ZSTDDecompressor::Recompress(Compressor *comp)
 {
   bool success = true;
 
-  while(success && !m_Read->AtEnd())
+  // block-indexed streams have the index after the last block, so we stop based on the block count
+  while(success && (m_BlockOffsets.empty() ? !m_Read->AtEnd() : m_NextBlock < m_BlockOffsets.size()))
   {
     success &= FillPage();
     if(success)
@@ -286,12 +310,66 @@ bool ZSTDDecompressor::Read(void *data, uint64_t numBytes)
   return success;
 }
 
+bool ZSTDDecompressor::Seek(uint64_t offs)
+{
+  // if we encountered a stream error this will be NULL
+  if(!m_CompressBuffer || m_BlockOffsets.empty())
+    return false;
+
+  // see LZ4Decompressor::Seek, the logic is identical
+  uint64_t block = offs / zstdBlockSize;
+
+  if(block + 1 == m_NextBlock && offs % zstdBlockSize <= m_PageLength)
+  {
+    m_PageOffset = offs % zstdBlockSize;
+    return true;
+  }
+
+  if(block == m_BlockOffsets.size() && offs % zstdBlockSize == 0)
+  {
+    m_NextBlock = block;
+    m_PageOffset = m_PageLength = 0;
+    return true;
+  }
+
+  if(block >= m_BlockOffsets.size())
+  {
+    RDCERR("Seeking to %llu outside of the %llu blocks in stream", offs,
+           (uint64_t)m_BlockOffsets.size());
+    return false;
+  }
+
+  m_Read->SetOffset(m_BlockOffsets[block]);
+  m_NextBlock = block;
+
+  if(!FillPage())
+    return false;
+
+  m_PageOffset = offs % zstdBlockSize;
+
+  return true;
+}
+
 bool ZSTDDecompressor::FillPage()
 {
   uint32_t compSize = 0;
 
   bool success = true;
 
+  if(!m_BlockOffsets.empty())
+  {
+    if(m_NextBlock >= m_BlockOffsets.size())
+    {
+      RDCERR("Reading past the last block %llu in stream", (uint64_t)m_BlockOffsets.size());
+      FreeAlignedBuffer(m_Page);
+      FreeAlignedBuffer(m_CompressBuffer);
+      m_Page = m_CompressBuffer = NULL;
+      return false;
+    }
+
+    m_NextBlock++;
+  }
+
   success &= m_Read->Read(compSize);
   success &= m_Read->Read(m_CompressBuffer, compSize);
 
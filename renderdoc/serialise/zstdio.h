@@ -27,10 +27,12 @@
 #include "zstd/zstd.h"
 #include "streamio.h"
 
+static const uint64_t zstdBlockSize = 128 * 1024;
+
 class ZSTDCompressor : public Compressor
 {
 public:
-  ZSTDCompressor(StreamWriter *write, Ownership own);
+  ZSTDCompressor(StreamWriter *write, Ownership own, bool blockIndexed = false);
   ~ZSTDCompressor();
 
   bool Write(const void *data, uint64_t numBytes);
@@ -45,17 +47,24 @@ private:
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
 
+  // if block-indexed, the offset of each block is recorded so that the index can be written on
+  // Finish(). Each frame is already independent.
+  bool m_BlockIndexed;
+  uint64_t m_BaseOffset;
+  rdcarray<uint64_t> m_BlockOffsets;
+
   ZSTD_CStream *m_Stream;
 };
 
 class ZSTDDecompressor : public Decompressor
 {
 public:
-  ZSTDDecompressor(StreamReader *read, Ownership own);
+  ZSTDDecompressor(StreamReader *read, Ownership own, bool blockIndexed = false);
   ~ZSTDDecompressor();
 
   bool Recompress(Compressor *comp);
   bool Read(void *data, uint64_t numBytes);
+  bool Seek(uint64_t offs);
 
 private:
   bool FillPage();
@@ -65,5 +74,9 @@ private:
   uint64_t m_PageOffset;
   uint64_t m_PageLength;
 
+  // the block index if the stream is block-indexed, and the index of the next block to decompress
+  rdcarray<uint64_t> m_BlockOffsets;
+  uint64_t m_NextBlock;
+
   ZSTD_DStream *m_Stream;
 };
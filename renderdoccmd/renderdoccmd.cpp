@@ -825,6 +825,43 @@ public:
   }
 };
 
+struct BenchCommand : public Command
+{
+private:
+  rdcarray<rdcstr> args;
+
+public:
+  BenchCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("[... parameters to benchmarks, --help for a list ...]");
+    parser.add("help", '\0', "print this message");
+    parser.stop_at_rest(true);
+  }
+  virtual const char *Description()
+  {
+    return "Run internal micro-benchmarks of serialisation and compression.";
+  }
+  virtual bool HandlesUsageManually() { return true; }
+  virtual bool IsInternalOnly() { return true; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+
+    parser.set_rest({});
+
+    if(parser.exist("help"))
+      rest.push_back("--help");
+
+    args = convertArgs(rest);
+
+    return true;
+  }
+
+  virtual int Execute(const CaptureOptions &) { return RENDERDOC_RunBenchmarks(args); }
+};
+
 struct TestCommand : public Command
 {
 private:
@@ -1556,6 +1593,7 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
     add_command("replay", new ReplayCommand());
     add_command("capaltbit", new CapAltBitCommand());
     add_command("test", new TestCommand());
+    add_command("bench", new BenchCommand());
     add_command("convert", new ConvertCommand());
     add_command("embed", new EmbeddedSectionCommand(false));
     add_command("extract", new EmbeddedSectionCommand(true));